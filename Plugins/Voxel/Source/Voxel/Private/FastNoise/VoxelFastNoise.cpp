@@ -0,0 +1,107 @@
+// Copyright 2020 Phyronnaz
+
+#include "FastNoise/VoxelFastNoise.inl"
+#include "VoxelMinimal.h"
+
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+
+static FAutoConsoleCommand CmdTestDerivatives(
+	TEXT("voxel.noise.TestDerivatives"),
+	TEXT("Compares the analytic Value, Perlin and Simplex noise derivatives against central finite differences at random positions. Args: NumTests (default 100000), Step (default 0.01), Tolerance (default 0.01)"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 NumTests = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 100000;
+		const v_flt Step = Args.Num() > 1 ? FCString::Atof(*Args[1]) : 0.01f;
+		const v_flt Tolerance = Args.Num() > 2 ? FCString::Atof(*Args[2]) : 0.01f;
+
+		FVoxelFastNoise Noise;
+		Noise.SetSeed(1337);
+		// Hermite and linear interpolations don't have continuous derivatives
+		Noise.SetInterpolation(EVoxelNoiseInterpolation::Quintic);
+
+		FRandomStream Stream(0);
+
+		const auto Test2D = [&](const TCHAR* Name, auto Get, auto GetDeriv)
+		{
+			int32 NumFailed = 0;
+			v_flt MaxError = 0;
+			for (int32 Index = 0; Index < NumTests; Index++)
+			{
+				const v_flt X = Stream.FRandRange(-100.f, 100.f);
+				const v_flt Y = Stream.FRandRange(-100.f, 100.f);
+
+				v_flt DX, DY;
+				const v_flt Value = GetDeriv(X, Y, DX, DY);
+
+				const v_flt FiniteDX = (Get(X + Step, Y) - Get(X - Step, Y)) / (2 * Step);
+				const v_flt FiniteDY = (Get(X, Y + Step) - Get(X, Y - Step)) / (2 * Step);
+
+				const v_flt Error = FMath::Max3(
+					FMath::Abs(Value - Get(X, Y)),
+					FMath::Abs(DX - FiniteDX),
+					FMath::Abs(DY - FiniteDY));
+				MaxError = FMath::Max(MaxError, Error);
+
+				if (Error > Tolerance)
+				{
+					if (NumFailed == 0)
+					{
+						LOG_VOXEL(Error, TEXT("TestDerivatives: %s at (%f, %f): analytic (%f, %f) vs finite differences (%f, %f)"),
+							Name, X, Y, DX, DY, FiniteDX, FiniteDY);
+					}
+					NumFailed++;
+				}
+			}
+			LOG_VOXEL(Log, TEXT("TestDerivatives: %s: %d/%d tests passed. Max error: %f"), Name, NumTests - NumFailed, NumTests, MaxError);
+		};
+		const auto Test3D = [&](const TCHAR* Name, auto Get, auto GetDeriv)
+		{
+			int32 NumFailed = 0;
+			v_flt MaxError = 0;
+			for (int32 Index = 0; Index < NumTests; Index++)
+			{
+				const v_flt X = Stream.FRandRange(-100.f, 100.f);
+				const v_flt Y = Stream.FRandRange(-100.f, 100.f);
+				const v_flt Z = Stream.FRandRange(-100.f, 100.f);
+
+				v_flt DX, DY, DZ;
+				const v_flt Value = GetDeriv(X, Y, Z, DX, DY, DZ);
+
+				const v_flt FiniteDX = (Get(X + Step, Y, Z) - Get(X - Step, Y, Z)) / (2 * Step);
+				const v_flt FiniteDY = (Get(X, Y + Step, Z) - Get(X, Y - Step, Z)) / (2 * Step);
+				const v_flt FiniteDZ = (Get(X, Y, Z + Step) - Get(X, Y, Z - Step)) / (2 * Step);
+
+				const v_flt Error = FMath::Max(
+					FMath::Abs(Value - Get(X, Y, Z)),
+					FMath::Max3(FMath::Abs(DX - FiniteDX), FMath::Abs(DY - FiniteDY), FMath::Abs(DZ - FiniteDZ)));
+				MaxError = FMath::Max(MaxError, Error);
+
+				if (Error > Tolerance)
+				{
+					if (NumFailed == 0)
+					{
+						LOG_VOXEL(Error, TEXT("TestDerivatives: %s at (%f, %f, %f): analytic (%f, %f, %f) vs finite differences (%f, %f, %f)"),
+							Name, X, Y, Z, DX, DY, DZ, FiniteDX, FiniteDY, FiniteDZ);
+					}
+					NumFailed++;
+				}
+			}
+			LOG_VOXEL(Log, TEXT("TestDerivatives: %s: %d/%d tests passed. Max error: %f"), Name, NumTests - NumFailed, NumTests, MaxError);
+		};
+
+		// Frequency is 1 so that the analytic derivatives are in the same space as the finite differences
+#define TEST(Name) \
+		Test2D(TEXT(#Name " 2D"), \
+			[&](v_flt X, v_flt Y) { return Noise.Get##Name##_2D(X, Y, 1); }, \
+			[&](v_flt X, v_flt Y, v_flt& DX, v_flt& DY) { return Noise.Get##Name##_2D_Deriv(X, Y, 1, DX, DY); }); \
+		Test3D(TEXT(#Name " 3D"), \
+			[&](v_flt X, v_flt Y, v_flt Z) { return Noise.Get##Name##_3D(X, Y, Z, 1); }, \
+			[&](v_flt X, v_flt Y, v_flt Z, v_flt& DX, v_flt& DY, v_flt& DZ) { return Noise.Get##Name##_3D_Deriv(X, Y, Z, 1, DX, DY, DZ); });
+
+		TEST(Value);
+		TEST(Perlin);
+		TEST(Simplex);
+
+#undef TEST
+	}));
@@ -1,6 +1,7 @@
 // Copyright 2020 Phyronnaz
 
 #include "VoxelAsyncWork.h"
+#include "VoxelThreadPool.h"
 #include "VoxelMinimal.h"
 #include "HAL/Event.h"
 #include "VoxelUtilities/VoxelStatsUtilities.h"
@@ -45,6 +46,8 @@ void FVoxelAsyncWork::DoThreadedWork()
 		PostDoWork();
 	}
 
+	FlushContinuation(!IsCanceled());
+
 	if (bAutodelete)
 	{
 		DoneSection.Unlock();
@@ -66,6 +69,8 @@ void FVoxelAsyncWork::Abandon()
 
 	IsDoneCounter.Increment();
 	WasAbandonedCounter.Increment();
+
+	FlushContinuation(false);
 	
 	if (bAutodelete)
 	{
@@ -95,11 +100,59 @@ bool FVoxelAsyncWork::CancelAndAutodelete()
 		delete this;
 		return true;
 	}
-	else
+
+	// Remove the work from the pool queue right away, instead of waiting for it to be dequeued to skip it
+	if (FVoxelQueuedThreadPool::RetractQueuedWork(*this))
 	{
+		// DoThreadedWork & Abandon will never be called
+		IsDoneCounter.Increment();
+		WasAbandonedCounter.Increment();
+		FlushContinuation(false);
+		
 		DoneSection.Unlock();
+		delete this;
+		// PostDoWork wasn't called
 		return false;
 	}
+	
+	DoneSection.Unlock();
+	return false;
+}
+
+void FVoxelAsyncWork::SetContinuation(const TVoxelSharedRef<IVoxelPool>& Pool, EVoxelTaskType TaskType, IVoxelQueuedWork* Work)
+{
+	check(Work);
+	check(!Continuation.Work);
+	check(!IsDone());
+	
+	Continuation.Pool = Pool;
+	Continuation.TaskType = TaskType;
+	Continuation.Work = Work;
+}
+
+void FVoxelAsyncWork::FlushContinuation(bool bQueue)
+{
+	VOXEL_ASYNC_VERBOSE_FUNCTION_COUNTER();
+	
+	IVoxelQueuedWork* const Work = Continuation.Work;
+	if (!Work)
+	{
+		return;
+	}
+	Continuation.Work = nullptr;
+
+	const auto Pool = Continuation.Pool.Pin();
+	Continuation.Pool.Reset();
+	
+	if (bQueue && Pool.IsValid())
+	{
+		// Pools are thread safe
+		Pool->QueueTask(Continuation.TaskType, Work);
+	}
+	else
+	{
+		Work->Abandon();
+	}
 }
 
 void FVoxelAsyncWork::WaitForDoThreadedWorkToExit()
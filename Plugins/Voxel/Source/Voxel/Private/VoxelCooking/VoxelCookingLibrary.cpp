@@ -5,6 +5,7 @@
 #include "VoxelWorld.h"
 #include "VoxelMessages.h"
 #include "VoxelDefaultPool.h"
+#include "VoxelAsyncWork.h"
 #include "VoxelData/VoxelDataIncludes.h"
 #include "VoxelDebug/VoxelDebugManager.h"
 #include "VoxelRender/Renderers/VoxelDefaultRenderer.h"
@@ -25,7 +26,6 @@ struct FVoxelCookingTaskData
 {
 	IVoxelRenderer& Renderer;
 	FVoxelCookedDataImpl& CookedData;
-	IPhysXCooking& PhysXCooking;
 	
 	const int32 NumChunksToBuild;
 	const FVoxelCookingSettings CookingSettings;
@@ -39,7 +39,6 @@ struct FVoxelCookingTaskData
 	FVoxelCookingTaskData(IVoxelRenderer& Renderer, FVoxelCookedDataImpl& CookedData, int32 NumChunksToBuild, const FVoxelCookingSettings& CookingSettings)
 		: Renderer(Renderer)
 		, CookedData(CookedData)
-		, PhysXCooking(*GetPhysXCookingModule()->GetPhysXCooking())
 		, NumChunksToBuild(NumChunksToBuild)
 		, CookingSettings(CookingSettings)
 		, DoneEvent(FPlatformProcess::GetSynchEventFromPool())
@@ -69,12 +68,17 @@ struct FVoxelCookingTaskData
 	}
 };
 
+// Queued by FVoxelCookingMeshingTask once the geometry is created
 class FVoxelCookingTask : public IVoxelQueuedWork
 {
 public:
 	const FIntVector ChunkPosition;
 	FVoxelCookingTaskData& TaskData;
 
+	// Set by FVoxelCookingMeshingTask
+	TArray<uint32> Indices;
+	TArray<FVector> Vertices;
+
 	FVoxelCookingTask(const FIntVector& ChunkPosition, FVoxelCookingTaskData& TaskData)
 		: IVoxelQueuedWork(STATIC_FNAME("Cooking Task"), 0)
 		, ChunkPosition(ChunkPosition)
@@ -86,52 +90,20 @@ public:
 	{
 		VOXEL_ASYNC_FUNCTION_COUNTER();
 		
-		TArray<uint32> Indices;
-		TArray<FVector> Vertices;
-		{
-			VOXEL_ASYNC_SCOPE_COUNTER("Creating geometry");
-			
-			const uint64 StartTime = FPlatformTime::Cycles64();
-			TaskData.Renderer.CreateGeometry_AnyThread(0, ChunkPosition, Indices, Vertices);
-			const uint64 EndTime = FPlatformTime::Cycles64();
-			TaskData.MeshingTime.Add(EndTime - StartTime);
-		}
-		
 		TArray<uint8> Buffer;
 		if (Indices.Num() > 0)
 		{
-			static const FName PhysXFormat = FPlatformProperties::GetPhysicsFormat();
-			
-			EPhysXMeshCookFlags CookFlags = EPhysXMeshCookFlags::Default;
-			if (!TaskData.CookingSettings.bCleanCollisionMesh) 
-			{
-				CookFlags |= EPhysXMeshCookFlags::DeformableMesh;
-			}
-			if (TaskData.CookingSettings.bFastCollisionCook)
-			{
-				CookFlags |= EPhysXMeshCookFlags::FastCook;
-			}
-
-			check(Indices.Num() % 3 == 0);
-			
-			TArray<FTriIndices> TriIndices;
-			TriIndices.SetNumUninitialized(Indices.Num() / 3);
-			FMemory::Memcpy(TriIndices.GetData(), Indices.GetData(), Indices.Num() * sizeof(int32));
-
-			// Put the chunk in global space, as tri meshes don't support individual transforms
-			for (auto& Vertex : Vertices)
-			{
-				Vertex = (Vertex + FVector(ChunkPosition)) * TaskData.CookingSettings.VoxelSize;
-			}
-			
-			constexpr bool bFlipNormals = true; // Always true due to the order of the vertices (clock wise vs not)
-
 			bool bResult;
 			{
-				VOXEL_ASYNC_SCOPE_COUNTER("Cooking collision");
-			
 				const uint64 StartTime = FPlatformTime::Cycles64();
-				bResult = TaskData.PhysXCooking.CookTriMesh(PhysXFormat, CookFlags, Vertices, TriIndices, {}, bFlipNormals, Buffer);
+				bResult = UVoxelCookingLibrary::CookChunkCollision(
+					ChunkPosition,
+					TaskData.CookingSettings.VoxelSize,
+					TaskData.CookingSettings.bFastCollisionCook,
+					TaskData.CookingSettings.bCleanCollisionMesh,
+					Indices,
+					Vertices,
+					Buffer);
 				const uint64 EndTime = FPlatformTime::Cycles64();
 				TaskData.CollisionTime.Add(EndTime - StartTime);
 			}
@@ -155,6 +127,37 @@ public:
 		return 0;
 	}
 };
+
+// Creates the geometry, then queues CookingTask as a continuation directly from the pool thread
+class FVoxelCookingMeshingTask : public FVoxelAsyncWork
+{
+public:
+	FVoxelCookingTask& CookingTask;
+
+	explicit FVoxelCookingMeshingTask(FVoxelCookingTask& CookingTask)
+		: FVoxelAsyncWork(STATIC_FNAME("Cooking Meshing Task"), 0, true)
+		, CookingTask(CookingTask)
+	{
+	}
+
+	virtual void DoWork() override
+	{
+		VOXEL_ASYNC_SCOPE_COUNTER("Creating geometry");
+		
+		const uint64 StartTime = FPlatformTime::Cycles64();
+		CookingTask.TaskData.Renderer.CreateGeometry_AnyThread(0, CookingTask.ChunkPosition, CookingTask.Indices, CookingTask.Vertices);
+		const uint64 EndTime = FPlatformTime::Cycles64();
+		CookingTask.TaskData.MeshingTime.Add(EndTime - StartTime);
+	}
+	virtual uint32 GetPriority() const override
+	{
+		return 0;
+	}
+
+private:
+	// Important: do not allow public delete
+	virtual ~FVoxelCookingMeshingTask() override = default;
+};
 #endif
 
 FVoxelCookedData UVoxelCookingLibrary::CookVoxelDataImpl(const FVoxelCookingSettings& Settings, const FVoxelUncompressedWorldSaveImpl* Save)
@@ -174,7 +177,19 @@ FVoxelCookedData UVoxelCookingLibrary::CookVoxelDataImpl(const FVoxelCookingSett
 	VoxelWorld->RenderType = Settings.RenderType;
 	VoxelWorld->Generator = Settings.Generator;
 
-	const auto Pool = FVoxelDefaultPool::Create(Settings.ThreadCount, true, {}, {});
+	// The pool orders works by priority category first: cooking tasks must run before the meshing ones,
+	// so that the geometry of a chunk is cooked and freed instead of piling up while all the other chunks are meshed
+	const auto Pool = FVoxelDefaultPool::Create(
+		Settings.ThreadCount,
+		true,
+		{
+			{ EVoxelTaskType::CollisionsChunksMeshing, EVoxelTaskType_DefaultPriorityCategories::CollisionsChunksMeshing },
+			{ EVoxelTaskType::CollisionCooking, EVoxelTaskType_DefaultPriorityCategories::CollisionCooking }
+		},
+		{});
+	static_assert(
+		EVoxelTaskType_DefaultPriorityCategories::CollisionCooking > EVoxelTaskType_DefaultPriorityCategories::CollisionsChunksMeshing,
+		"Cooking tasks need a higher priority category than the meshing ones");
 	const auto Data = FVoxelData::Create(FVoxelDataSettings(VoxelWorld, EVoxelPlayType::Game));
 	const auto DebugManager = FVoxelDebugManager::Create(FVoxelDebugManagerSettings(VoxelWorld, EVoxelPlayType::Game, Pool, Data));
 
@@ -220,8 +235,10 @@ FVoxelCookedData UVoxelCookingLibrary::CookVoxelDataImpl(const FVoxelCookingSett
 			for (int32 Z = Min.Z; Z < Max.Z; Z += RENDER_CHUNK_SIZE)
 			{
 				const FIntVector ChunkPosition = FIntVector(X, Y, Z);
-				auto* Task = new FVoxelCookingTask(ChunkPosition, TaskData);
-				Pool->QueueTask({}, Task);
+				auto* CookingTask = new FVoxelCookingTask(ChunkPosition, TaskData);
+				auto* MeshingTask = new FVoxelCookingMeshingTask(*CookingTask);
+				MeshingTask->SetContinuation(Pool, EVoxelTaskType::CollisionCooking, CookingTask);
+				Pool->QueueTask(EVoxelTaskType::CollisionsChunksMeshing, MeshingTask);
 			}
 		}
 	}
@@ -254,6 +271,52 @@ FVoxelCookedData UVoxelCookingLibrary::CookVoxelDataImpl(const FVoxelCookingSett
 	return CookedData;
 }
 
+bool UVoxelCookingLibrary::CookChunkCollision(
+	const FIntVector& ChunkPosition, 
+	float VoxelSize, 
+	bool bFastCollisionCook, 
+	bool bCleanCollisionMesh, 
+	const TArray<uint32>& Indices, 
+	TArray<FVector>& Vertices, 
+	TArray<uint8>& OutData)
+{
+	VOXEL_ASYNC_FUNCTION_COUNTER();
+	
+#if WITH_PHYSX && PHYSICS_INTERFACE_PHYSX
+	static const FName PhysXFormat = FPlatformProperties::GetPhysicsFormat();
+	IPhysXCooking& PhysXCooking = *GetPhysXCookingModule()->GetPhysXCooking();
+	
+	EPhysXMeshCookFlags CookFlags = EPhysXMeshCookFlags::Default;
+	if (!bCleanCollisionMesh) 
+	{
+		CookFlags |= EPhysXMeshCookFlags::DeformableMesh;
+	}
+	if (bFastCollisionCook)
+	{
+		CookFlags |= EPhysXMeshCookFlags::FastCook;
+	}
+
+	check(Indices.Num() % 3 == 0);
+	
+	TArray<FTriIndices> TriIndices;
+	TriIndices.SetNumUninitialized(Indices.Num() / 3);
+	FMemory::Memcpy(TriIndices.GetData(), Indices.GetData(), Indices.Num() * sizeof(int32));
+
+	// Put the chunk in global space, as tri meshes don't support individual transforms
+	for (auto& Vertex : Vertices)
+	{
+		Vertex = (Vertex + FVector(ChunkPosition)) * VoxelSize;
+	}
+	
+	constexpr bool bFlipNormals = true; // Always true due to the order of the vertices (clock wise vs not)
+
+	return PhysXCooking.CookTriMesh(PhysXFormat, CookFlags, Vertices, TriIndices, {}, bFlipNormals, OutData);
+#else
+	ensure(false);
+	return false;
+#endif
+}
+
 FVoxelCookingSettings UVoxelCookingLibrary::MakeVoxelCookingSettingsFromVoxelWorld(AVoxelWorld* World, int32 ThreadCount)
 {
 	if (!World)
@@ -7,6 +7,7 @@
 #include "VoxelData/VoxelDataOctree.h"
 #include "VoxelData/VoxelSaveUtilities.h"
 #include "VoxelData/VoxelDataUtilities.h"
+#include "VoxelData/VoxelGeneratorCache.h"
 
 #include "VoxelDiff.h"
 #include "VoxelEnums.h"
@@ -97,6 +98,13 @@ FVoxelData::FVoxelData(const FVoxelDataSettings& Settings)
 	, Octree(MakeUnique<FVoxelDataOctreeParent>(Depth))
 {
 	check(Depth > 0);
+	
+	const int32 GeneratorCacheSize = CVarGeneratorCacheSize.GetValueOnAnyThread();
+	if (GeneratorCacheSize > 0)
+	{
+		GeneratorCache = MakeUnique<FVoxelGeneratorCache>(GeneratorCacheSize);
+	}
+
 	check(Octree->GetBounds().Contains(WorldBounds));
 }
 
@@ -264,12 +272,19 @@ TUniquePtr<FVoxelDataLockInfo> FVoxelData::Lock(EVoxelLockType LockType, const F
 	VOXEL_ASYNC_FUNCTION_COUNTER();
 	ensure(Bounds.IsValid());
 
+	VOXEL_TRACE_DYNAMIC_SCOPE(Lock, Name);
+
 	MainLock.Lock(EVoxelLockType::Read);
 
 	auto LockInfo = TUniquePtr<FVoxelDataLockInfo>(new FVoxelDataLockInfo());
 	LockInfo->Name = Name;
 	LockInfo->LockType = LockType;
 	LockInfo->LockedOctrees = FVoxelDataOctreeLocker(LockType, Bounds, Name).Lock(GetOctree());
+	if (LockType == EVoxelLockType::Write)
+	{
+		// Only once locked: readers of the same octrees are then guaranteed to see the new counter
+		ModificationCounter.Increment();
+	}
 	return LockInfo;
 }
 
@@ -310,6 +325,7 @@ void FVoxelData::ClearData()
 		ensure(GetCachedMemory().Materials.GetValue() == 0);
 
 		Octree = MakeUnique<FVoxelDataOctreeParent>(Depth);
+		ModificationCounter.Increment();
 	}
 	MainLock.Unlock(EVoxelLockType::Write);
 
@@ -407,6 +423,12 @@ void FVoxelData::Get(TVoxelQueryZone<T>& GlobalQueryZone, int32 LOD) const
 			}
 		}
 		
+		if (GeneratorCache.IsValid() && GeneratorCache->CanCache(InOctree, QueryZone.Step))
+		{
+			GeneratorCache->Get<T>(*Generator, InOctree, QueryZone, LOD);
+			return;
+		}
+		
 		InOctree.GetFromGeneratorAndAssets<T>(*Generator, QueryZone, LOD);
 	});
 
@@ -18,6 +18,11 @@ static TAutoConsoleVariable<int32> CVarShowStats(
 	0,
 	TEXT("Log stats about accelerators hit/misses"),
 	ECVF_Default);
+static TAutoConsoleVariable<int32> CVarUseAnalyticGradients(
+	TEXT("voxel.data.UseAnalyticGradients"),
+	1,
+	TEXT("If true, gradient normals will use the generator analytic gradients when it provides them instead of 6 value queries"),
+	ECVF_Default);
 
 int32 FVoxelDataAcceleratorParameters::GetDefaultCacheSize()
 {
@@ -30,4 +35,8 @@ bool FVoxelDataAcceleratorParameters::GetUseAcceleratorMap()
 bool FVoxelDataAcceleratorParameters::GetShowStats()
 {
 	return CVarShowStats.GetValueOnAnyThread() != 0;
+}
+bool FVoxelDataAcceleratorParameters::GetUseAnalyticGradients()
+{
+	return CVarUseAnalyticGradients.GetValueOnAnyThread() != 0;
 }
\ No newline at end of file
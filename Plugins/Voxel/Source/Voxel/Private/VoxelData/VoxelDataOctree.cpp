@@ -43,6 +43,21 @@ template VOXEL_API v_flt          FVoxelDataOctreeBase::GetFromGeneratorAndAsset
 template VOXEL_API FVoxelValue    FVoxelDataOctreeBase::GetFromGeneratorAndAssets<FVoxelValue   , int32>(const FVoxelGeneratorInstance& Generator, int32 X, int32 Y, int32 Z, int32 LOD) const;
 template VOXEL_API FVoxelMaterial FVoxelDataOctreeBase::GetFromGeneratorAndAssets<FVoxelMaterial, int32>(const FVoxelGeneratorInstance& Generator, int32 X, int32 Y, int32 Z, int32 LOD) const;
 
+bool FVoxelDataOctreeBase::GetGradientFromGenerator(const FVoxelGeneratorInstance& Generator, v_flt X, v_flt Y, v_flt Z, int32 LOD, FVector& OutGradient) const
+{
+	ensureThreadSafe(IsLockedForRead());
+	check(IsLeafOrHasNoChildren());
+
+	for (auto& Asset : ItemHolder->GetAssetItems())
+	{
+		if (Asset->Bounds.ContainsTemplate(X, Y, Z))
+		{
+			return false;
+		}
+	}
+	return Generator.GetGradient(X, Y, Z, LOD, FVoxelItemStack(*ItemHolder), OutGradient);
+}
+
 template<typename T>
 void FVoxelDataOctreeBase::GetFromGeneratorAndAssets(const FVoxelGeneratorInstance& Generator, TVoxelQueryZone<T>& QueryZone, int32 LOD) const
 {
@@ -0,0 +1,217 @@
+// Copyright 2020 Phyronnaz
+
+#include "VoxelData/VoxelGeneratorCache.h"
+#include "VoxelData/VoxelDataOctree.h"
+#include "VoxelPlaceableItems/VoxelPlaceableItem.h"
+#include "VoxelUtilities/VoxelIntVectorUtilities.h"
+#include "VoxelQueryZone.h"
+
+#include "Misc/ScopeLock.h"
+#include "HAL/IConsoleManager.h"
+
+DEFINE_VOXEL_MEMORY_STAT(STAT_VoxelGeneratorCacheMemory);
+
+DEFINE_STAT(STAT_VoxelGeneratorCacheHits);
+DEFINE_STAT(STAT_VoxelGeneratorCacheMisses);
+
+VOXEL_API TAutoConsoleVariable<int32> CVarGeneratorCacheSize(
+	TEXT("voxel.data.GeneratorCacheSize"),
+	0,
+	TEXT("If above 0, each voxel data will keep up to this many generated 16x16x16 blocks of values and of materials in a LRU cache, ")
+	TEXT("so that meshing, collisions and spawners querying the same zones do not run the generator again. 0 to disable.\n")
+	TEXT("Only read when the voxel data is created"),
+	ECVF_Default);
+
+static FThreadSafeCounter64 GlobalNumHits;
+static FThreadSafeCounter64 GlobalNumMisses;
+
+static FAutoConsoleCommand LogGeneratorCacheStatsCmd(
+	TEXT("voxel.data.LogGeneratorCacheStats"),
+	TEXT("Log the hit rate of the generator caches since the last call, see voxel.data.GeneratorCacheSize"),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		const FVoxelGeneratorCacheStats Stats = FVoxelGeneratorCache::GetGlobalStats();
+		LOG_VOXEL(Log, TEXT("Generator cache: %lld hits, %lld misses, hit rate: %.1f%%"),
+			Stats.NumHits,
+			Stats.NumMisses,
+			Stats.GetHitRate() * 100);
+		FVoxelGeneratorCache::ResetGlobalStats();
+	}));
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+FVoxelGeneratorCache::FVoxelGeneratorCache(int32 MaxBlocks)
+	: ValueBlocks(FMath::Max(1, MaxBlocks))
+	, MaterialBlocks(FMath::Max(1, MaxBlocks))
+{
+}
+
+FVoxelGeneratorCache::~FVoxelGeneratorCache()
+{
+	Clear();
+}
+
+bool FVoxelGeneratorCache::CanCache(const FVoxelDataOctreeBase& Octree, int32 Step) const
+{
+	// Items can change the generator output (assets, data items...)
+	if (Octree.GetItemHolder().NumItems() > 0)
+	{
+		return false;
+	}
+	// Blocks must not overlap other octrees, as they might have items
+	return BlockSize * Step <= int32(Octree.GetSize());
+}
+
+void FVoxelGeneratorCache::Clear()
+{
+	FScopeLock Lock(&Section);
+
+	DEC_VOXEL_MEMORY_STAT_BY(STAT_VoxelGeneratorCacheMemory, ValueBlocks.Num() * BlockNum * sizeof(FVoxelValue));
+	DEC_VOXEL_MEMORY_STAT_BY(STAT_VoxelGeneratorCacheMemory, MaterialBlocks.Num() * BlockNum * sizeof(FVoxelMaterial));
+
+	ValueBlocks.Empty(ValueBlocks.Max());
+	MaterialBlocks.Empty(MaterialBlocks.Max());
+}
+
+FVoxelGeneratorCacheStats FVoxelGeneratorCache::GetStats() const
+{
+	FScopeLock Lock(&Section);
+
+	FVoxelGeneratorCacheStats Stats;
+	Stats.NumHits = NumHits;
+	Stats.NumMisses = NumMisses;
+	Stats.NumValueBlocks = ValueBlocks.Num();
+	Stats.NumMaterialBlocks = MaterialBlocks.Num();
+	Stats.AllocatedSize =
+		int64(ValueBlocks.Num()) * BlockNum * sizeof(FVoxelValue) +
+		int64(MaterialBlocks.Num()) * BlockNum * sizeof(FVoxelMaterial);
+	return Stats;
+}
+
+FVoxelGeneratorCacheStats FVoxelGeneratorCache::GetGlobalStats()
+{
+	FVoxelGeneratorCacheStats Stats;
+	Stats.NumHits = GlobalNumHits.GetValue();
+	Stats.NumMisses = GlobalNumMisses.GetValue();
+	return Stats;
+}
+
+void FVoxelGeneratorCache::ResetGlobalStats()
+{
+	GlobalNumHits.Reset();
+	GlobalNumMisses.Reset();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+template<>
+FVoxelGeneratorCache::TBlocks<FVoxelValue>& FVoxelGeneratorCache::GetBlocks<FVoxelValue>()
+{
+	return ValueBlocks;
+}
+
+template<>
+FVoxelGeneratorCache::TBlocks<FVoxelMaterial>& FVoxelGeneratorCache::GetBlocks<FVoxelMaterial>()
+{
+	return MaterialBlocks;
+}
+
+template<typename T>
+FVoxelGeneratorCache::TBlock<T> FVoxelGeneratorCache::FindOrGenerateBlock(const FVoxelGeneratorInstance& Generator, const FVoxelDataOctreeBase& Octree, const FKey& Key)
+{
+	TBlocks<T>& Blocks = GetBlocks<T>();
+	{
+		FScopeLock Lock(&Section);
+		if (const TBlock<T>* Block = Blocks.FindAndTouch(Key))
+		{
+			NumHits++;
+			GlobalNumHits.Increment();
+			INC_DWORD_STAT(STAT_VoxelGeneratorCacheHits);
+			return *Block;
+		}
+		NumMisses++;
+	}
+	GlobalNumMisses.Increment();
+	INC_DWORD_STAT(STAT_VoxelGeneratorCacheMisses);
+
+	// Generate outside of the lock. Several threads might generate the same block, which is fine as the result is the same
+	TArray<T> Data;
+	{
+		VOXEL_SLOW_SCOPE_COUNTER("Generate Block");
+		Data.SetNumUninitialized(BlockNum);
+		TVoxelQueryZone<T> QueryZone(
+			FVoxelIntBox(Key.Min, Key.Min + BlockSize * Key.Step),
+			FIntVector(BlockSize),
+			FMath::FloorLog2(Key.Step),
+			Data);
+		Octree.GetFromGeneratorAndAssets<T>(Generator, QueryZone, Key.LOD);
+	}
+	const TBlock<T> Block = MakeVoxelShared<TArray<T>>(MoveTemp(Data));
+
+	FScopeLock Lock(&Section);
+	if (!Blocks.Contains(Key))
+	{
+		if (Blocks.Num() >= Blocks.Max())
+		{
+			Blocks.RemoveLeastRecent();
+			DEC_VOXEL_MEMORY_STAT_BY(STAT_VoxelGeneratorCacheMemory, BlockNum * sizeof(T));
+		}
+		INC_VOXEL_MEMORY_STAT_BY(STAT_VoxelGeneratorCacheMemory, BlockNum * sizeof(T));
+	}
+	Blocks.Add(Key, Block);
+	return Block;
+}
+
+template<typename T>
+void FVoxelGeneratorCache::Get(const FVoxelGeneratorInstance& Generator, const FVoxelDataOctreeBase& Octree, TVoxelQueryZone<T>& QueryZone, int32 LOD)
+{
+	VOXEL_SLOW_FUNCTION_COUNTER();
+	checkVoxelSlow(CanCache(Octree, QueryZone.Step));
+	checkVoxelSlow(Octree.GetBounds().Contains(QueryZone.Bounds));
+
+	const int32 Step = QueryZone.Step;
+	const int32 StepLOD = FMath::FloorLog2(Step);
+	const int32 BlockWorldSize = BlockSize * Step;
+
+	const FIntVector MinBlock = FVoxelUtilities::DivideFloor(QueryZone.Bounds.Min, BlockWorldSize);
+	const FIntVector MaxBlock = FVoxelUtilities::DivideCeil(QueryZone.Bounds.Max, BlockWorldSize);
+
+	for (int32 BlockX = MinBlock.X; BlockX < MaxBlock.X; BlockX++)
+	{
+		for (int32 BlockY = MinBlock.Y; BlockY < MaxBlock.Y; BlockY++)
+		{
+			for (int32 BlockZ = MinBlock.Z; BlockZ < MaxBlock.Z; BlockZ++)
+			{
+				const FIntVector BlockMin = FIntVector(BlockX, BlockY, BlockZ) * BlockWorldSize;
+				const FVoxelIntBox BlockBounds(BlockMin, BlockMin + BlockWorldSize);
+
+				const TBlock<T> Block = FindOrGenerateBlock<T>(Generator, Octree, FKey{ BlockMin, Step, LOD });
+				const T* RESTRICT BlockData = Block->GetData();
+
+				auto LocalQueryZone = QueryZone.ShrinkTo(BlockBounds);
+				for (VOXEL_QUERY_ZONE_ITERATE(LocalQueryZone, X))
+				{
+					for (VOXEL_QUERY_ZONE_ITERATE(LocalQueryZone, Y))
+					{
+						for (VOXEL_QUERY_ZONE_ITERATE(LocalQueryZone, Z))
+						{
+							const int32 Index = FVoxelUtilities::Get3DIndex(
+								FIntVector(BlockSize),
+								(X - BlockMin.X) >> StepLOD,
+								(Y - BlockMin.Y) >> StepLOD,
+								(Z - BlockMin.Z) >> StepLOD);
+							LocalQueryZone.Set(X, Y, Z, BlockData[Index]);
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+template VOXEL_API void FVoxelGeneratorCache::Get<FVoxelValue   >(const FVoxelGeneratorInstance&, const FVoxelDataOctreeBase&, TVoxelQueryZone<FVoxelValue   >&, int32);
+template VOXEL_API void FVoxelGeneratorCache::Get<FVoxelMaterial>(const FVoxelGeneratorInstance&, const FVoxelDataOctreeBase&, TVoxelQueryZone<FVoxelMaterial>&, int32);
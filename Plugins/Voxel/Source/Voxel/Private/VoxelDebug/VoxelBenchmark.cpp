@@ -0,0 +1,411 @@
+// Copyright 2020 Phyronnaz
+
+#include "VoxelDebug/VoxelBenchmark.h"
+#include "VoxelDebug/VoxelDebugManager.h"
+#include "VoxelData/VoxelDataIncludes.h"
+#include "VoxelRender/VoxelChunkMesh.h"
+#include "VoxelRender/VoxelMesherAsyncWork.h"
+#include "VoxelRender/Meshers/VoxelMesher.h"
+#include "VoxelRender/Renderers/VoxelDefaultRenderer.h"
+#include "VoxelCooking/VoxelCookingLibrary.h"
+#include "VoxelGenerators/VoxelFlatGenerator.h"
+#include "VoxelComponents/VoxelInvokerComponent.h"
+#include "VoxelSpawners/IVoxelSpawnerManager.h"
+#include "VoxelSpawners/VoxelInstancedMeshManager.h"
+#include "VoxelDefaultPool.h"
+#include "VoxelWorld.h"
+#include "VoxelMinimal.h"
+
+#include "Tickable.h"
+#include "Engine/World.h"
+#include "Engine/Engine.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+static FAutoConsoleCommand BenchmarkCmd(
+	TEXT("voxel.Benchmark"),
+	TEXT("Generate, mesh & cook a region with a generator and write the timings as JSON. See also the VoxelBenchmark commandlet. Args: [Generator class or object path] [Region size] [Output path]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		FVoxelBenchmarkSettings Settings;
+		if (Args.Num() > 0)
+		{
+			if (UClass* Class = FindObject<UClass>(ANY_PACKAGE, *Args[0]))
+			{
+				Settings.Generator = Class;
+			}
+			else
+			{
+				Settings.Generator = LoadObject<UVoxelGenerator>(nullptr, *Args[0]);
+			}
+		}
+		else
+		{
+			Settings.Generator = UVoxelFlatGenerator::StaticClass();
+		}
+		if (Args.Num() > 1)
+		{
+			const int32 Size = FMath::Max(RENDER_CHUNK_SIZE, FCString::Atoi(*Args[1]));
+			Settings.Bounds = FVoxelIntBox(-Size / 2, Size / 2);
+		}
+		const FString Path = Args.Num() > 2 ? Args[2] : FVoxelBenchmark::GetDefaultOutputPath();
+
+		const FVoxelBenchmarkResult Result = FVoxelBenchmark::Run(Settings);
+		if (FFileHelper::SaveStringToFile(FVoxelBenchmark::ToJson({ Result }), *Path))
+		{
+			LOG_VOXEL(Log, TEXT("Voxel benchmark results written to %s"), *Path);
+		}
+		else
+		{
+			LOG_VOXEL(Error, TEXT("Failed to write voxel benchmark results to %s"), *Path);
+		}
+	}));
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+class FVoxelBenchmarkStageScope
+{
+public:
+	FVoxelBenchmarkStageScope(FVoxelBenchmarkResult& Result, const FString& Name)
+		: Result(Result)
+		, StartTime(FPlatformTime::Seconds())
+	{
+		Stage.Name = Name;
+		Stage.UsedMemoryBefore = FPlatformMemory::GetStats().UsedPhysical;
+
+		LOG_VOXEL(Log, TEXT("VOXEL BENCHMARK: %s: %s"), *Result.Name, *Name);
+	}
+	~FVoxelBenchmarkStageScope()
+	{
+		Stage.WallTime = FPlatformTime::Seconds() - StartTime;
+		Stage.TaskTime = TaskCycles.GetValue() * FPlatformTime::GetSecondsPerCycle64();
+		Stage.NumTasks = NumTasks.GetValue();
+		Stage.NumVertices = NumVertices.GetValue();
+		Stage.NumTriangles = NumTriangles.GetValue();
+
+		const FPlatformMemoryStats MemoryStats = FPlatformMemory::GetStats();
+		Stage.UsedMemoryAfter = MemoryStats.UsedPhysical;
+		Stage.PeakUsedMemory = MemoryStats.PeakUsedPhysical;
+
+		LOG_VOXEL(Log, TEXT("VOXEL BENCHMARK: %s: %s took %fs (%fs in %lld tasks)"), *Result.Name, *Stage.Name, Stage.WallTime, Stage.TaskTime, Stage.NumTasks);
+
+		Result.Stages.Add(Stage);
+	}
+
+	template<typename T>
+	void RunTasks(int32 Num, bool bSingleThread, T Lambda)
+	{
+		ParallelFor(Num, [&](int32 Index)
+		{
+			const uint64 TaskStartCycles = FPlatformTime::Cycles64();
+			Lambda(Index);
+			TaskCycles.Add(FPlatformTime::Cycles64() - TaskStartCycles);
+			NumTasks.Increment();
+		}, bSingleThread);
+	}
+
+public:
+	FVoxelBenchmarkStage Stage;
+
+	FThreadSafeCounter64 TaskCycles;
+	FThreadSafeCounter64 NumTasks;
+	FThreadSafeCounter64 NumVertices;
+	FThreadSafeCounter64 NumTriangles;
+
+private:
+	FVoxelBenchmarkResult& Result;
+	const double StartTime;
+};
+
+inline FString RenderTypeToString(EVoxelRenderType RenderType)
+{
+	const UEnum* Enum = StaticEnum<EVoxelRenderType>();
+	return Enum->GetNameStringByValue(int64(RenderType));
+}
+
+inline void GetChunks(const FVoxelIntBox& Bounds, int32 LOD, TArray<FIntVector>& OutChunks)
+{
+	const int32 ChunkSize = RENDER_CHUNK_SIZE << LOD;
+	for (int32 X = Bounds.Min.X; X < Bounds.Max.X; X += ChunkSize)
+	{
+		for (int32 Y = Bounds.Min.Y; Y < Bounds.Max.Y; Y += ChunkSize)
+		{
+			for (int32 Z = Bounds.Min.Z; Z < Bounds.Max.Z; Z += ChunkSize)
+			{
+				OutChunks.Emplace(X, Y, Z);
+			}
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+static void RunSpawnersBenchmark(const FVoxelBenchmarkSettings& Settings, const FVoxelIntBox& Bounds, FVoxelBenchmarkResult& Result)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	// Spawners need a full voxel world (events, LOD manager, HISMs), so create a transient game world and tick it manually
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("VoxelBenchmark"));
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+	World->InitializeActorsForPlay(FURL());
+	World->BeginPlay();
+
+	AVoxelWorld* VoxelWorld = World->SpawnActor<AVoxelWorld>();
+	VoxelWorld->VoxelSize = Settings.VoxelSize;
+	VoxelWorld->Generator = Settings.Generator;
+	VoxelWorld->SpawnerConfig = Settings.SpawnerConfig;
+	VoxelWorld->SetRenderOctreeDepth(FVoxelUtilities::GetOctreeDepthContainingBounds<RENDER_CHUNK_SIZE>(Bounds));
+	VoxelWorld->bUseCustomWorldBounds = true;
+	VoxelWorld->CustomWorldBounds = Bounds;
+	VoxelWorld->NumberOfThreads = Settings.bSingleThread ? 1 : FMath::Max(1, FPlatformMisc::NumberOfCoresIncludingHyperthreads() - 1);
+
+	AActor* InvokerActor = World->SpawnActor<AActor>();
+	UVoxelSimpleInvokerComponent* Invoker = NewObject<UVoxelSimpleInvokerComponent>(InvokerActor);
+	InvokerActor->SetRootComponent(Invoker);
+	Invoker->LODRange = Bounds.Size().GetMax() * Settings.VoxelSize;
+	Invoker->CollisionsRange = 0;
+	Invoker->bUseForNavmesh = false;
+	Invoker->RegisterComponent();
+	InvokerActor->SetActorLocation(VoxelWorld->LocalToGlobal(Bounds.GetCenter()));
+
+	{
+		FVoxelBenchmarkStageScope Scope(Result, TEXT("Spawners"));
+
+		VoxelWorld->CreateWorld();
+
+		constexpr float DeltaTime = 1.f / 30.f;
+		constexpr int32 NumIdleFramesToFinish = 10;
+
+		const double StartTime = FPlatformTime::Seconds();
+		int32 NumIdleFrames = 0;
+		while (NumIdleFrames < NumIdleFramesToFinish)
+		{
+			World->Tick(LEVELTICK_All, DeltaTime);
+			FTickableGameObject::TickObjects(World, LEVELTICK_All, false, DeltaTime);
+
+			const bool bIsIdle =
+				VoxelWorld->IsLoaded() &&
+				VoxelWorld->GetPool().GetNumTasks() == 0 &&
+				VoxelWorld->GetSpawnerManager().GetTaskCount() == 0;
+			NumIdleFrames = bIsIdle ? NumIdleFrames + 1 : 0;
+
+			if (FPlatformTime::Seconds() - StartTime > Settings.SpawnerTimeout)
+			{
+				Result.bSuccess = false;
+				Result.Error = FString::Printf(TEXT("Spawners timed out after %fs"), Settings.SpawnerTimeout);
+				break;
+			}
+
+			FPlatformProcess::Sleep(0.001f);
+		}
+
+		Scope.Stage.NumInstances = VoxelWorld->GetInstancedMeshManager().GetNumInstances();
+	}
+
+	VoxelWorld->DestroyWorld();
+	World->DestroyWorld(false);
+	GEngine->DestroyWorldContext(World);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+FVoxelBenchmarkResult FVoxelBenchmark::Run(const FVoxelBenchmarkSettings& Settings)
+{
+	VOXEL_FUNCTION_COUNTER();
+	check(IsInGameThread());
+
+	FVoxelBenchmarkResult Result;
+	Result.Name = Settings.Name;
+	if (Result.Name.IsEmpty() && Settings.Generator.IsValid())
+	{
+		Result.Name = Settings.Generator.GetObject()->GetPathName();
+	}
+
+	if (!Settings.Generator.IsValid())
+	{
+		Result.bSuccess = false;
+		Result.Error = TEXT("Invalid generator");
+		return Result;
+	}
+	for (int32 LOD : Settings.LODs)
+	{
+		if (LOD < 0 || LOD > 8)
+		{
+			Result.bSuccess = false;
+			Result.Error = FString::Printf(TEXT("Invalid LOD: %d"), LOD);
+			return Result;
+		}
+	}
+
+	int32 MaxLOD = 0;
+	for (int32 LOD : Settings.LODs)
+	{
+		MaxLOD = FMath::Max(MaxLOD, LOD);
+	}
+	const FVoxelIntBox Bounds = Settings.Bounds.MakeMultipleOfBigger(RENDER_CHUNK_SIZE << MaxLOD);
+
+	AVoxelWorld* VoxelWorld = NewObject<AVoxelWorld>();
+	VoxelWorld->VoxelSize = Settings.VoxelSize;
+	VoxelWorld->Generator = Settings.Generator;
+	// +1: meshers read outside of the chunks
+	VoxelWorld->SetRenderOctreeDepth(FVoxelUtilities::GetOctreeDepthContainingBounds<RENDER_CHUNK_SIZE>(Bounds) + 1);
+
+	const auto Pool = FVoxelDefaultPool::Create(1, true, {}, {});
+
+	TVoxelSharedPtr<FVoxelData> Data;
+	{
+		FVoxelBenchmarkStageScope Scope(Result, TEXT("CreateData"));
+		Data = FVoxelData::Create(FVoxelDataSettings(VoxelWorld, EVoxelPlayType::Game));
+	}
+	{
+		FVoxelBenchmarkStageScope Scope(Result, TEXT("Generate"));
+
+		// Split in chunks so that the generation is parallel
+		TArray<FIntVector> Chunks;
+		GetChunks(Bounds, 0, Chunks);
+		Scope.RunTasks(Chunks.Num(), Settings.bSingleThread, [&](int32 Index)
+		{
+			const FVoxelIntBox ChunkBounds(Chunks[Index], Chunks[Index] + RENDER_CHUNK_SIZE);
+			FVoxelReadScopeLock Lock(*Data, ChunkBounds, STATIC_FNAME("Voxel Benchmark"));
+			const TArray<FVoxelValue> Values = Data->Get<FVoxelValue>(ChunkBounds);
+			const TArray<FVoxelMaterial> Materials = Data->Get<FVoxelMaterial>(ChunkBounds);
+		});
+	}
+
+	const auto DebugManager = FVoxelDebugManager::Create(FVoxelDebugManagerSettings(VoxelWorld, EVoxelPlayType::Game, Pool, Data.ToSharedRef()));
+
+	for (const EVoxelRenderType RenderType : Settings.RenderTypes)
+	{
+		VoxelWorld->RenderType = RenderType;
+
+		const auto Renderer = FVoxelDefaultRenderer::Create(FVoxelRendererSettings(
+			VoxelWorld,
+			EVoxelPlayType::Game,
+			nullptr,
+			Data.ToSharedRef(),
+			Pool,
+			nullptr,
+			DebugManager,
+			false));
+
+		for (const int32 LOD : Settings.LODs)
+		{
+			TArray<FIntVector> Chunks;
+			GetChunks(Bounds, LOD, Chunks);
+
+			FVoxelBenchmarkStageScope Scope(Result, FString::Printf(TEXT("Mesh_%s_LOD%d"), *RenderTypeToString(RenderType), LOD));
+			Scope.RunTasks(Chunks.Num(), Settings.bSingleThread, [&](int32 Index)
+			{
+				const auto Mesher = FVoxelMesherAsyncWork::GetMesher(Renderer->Settings, LOD, Chunks[Index], false, 0);
+				const auto Chunk = Mesher->CreateFullChunk();
+				if (Chunk.IsValid())
+				{
+					Chunk->IterateBuffers([&](const FVoxelChunkMeshBuffers& Buffers)
+					{
+						Scope.NumVertices.Add(Buffers.GetNumVertices());
+						Scope.NumTriangles.Add(Buffers.Indices.Num() / 3);
+					});
+				}
+			});
+		}
+
+		if (Settings.bCookCollisions && RenderType == EVoxelRenderType::MarchingCubes)
+		{
+			TArray<FIntVector> Chunks;
+			GetChunks(Bounds, 0, Chunks);
+
+			FVoxelBenchmarkStageScope Scope(Result, TEXT("CookCollisions"));
+			Scope.RunTasks(Chunks.Num(), Settings.bSingleThread, [&](int32 Index)
+			{
+				TArray<uint32> Indices;
+				TArray<FVector> Vertices;
+				Renderer->CreateGeometry_AnyThread(0, Chunks[Index], Indices, Vertices);
+				if (Indices.Num() == 0)
+				{
+					return;
+				}
+
+				Scope.NumVertices.Add(Vertices.Num());
+				Scope.NumTriangles.Add(Indices.Num() / 3);
+
+				TArray<uint8> CookedData;
+				UVoxelCookingLibrary::CookChunkCollision(Chunks[Index], Settings.VoxelSize, true, false, Indices, Vertices, CookedData);
+			});
+		}
+
+		Renderer->Destroy();
+	}
+
+	DebugManager->Destroy();
+	Data.Reset();
+
+	if (Settings.SpawnerConfig)
+	{
+		RunSpawnersBenchmark(Settings, Bounds, Result);
+	}
+
+	return Result;
+}
+
+FString FVoxelBenchmark::ToJson(const TArray<FVoxelBenchmarkResult>& Results)
+{
+	FString Json;
+	Json += TEXT("{\n");
+	Json += FString::Printf(TEXT("\t\"platform\": \"%s\",\n"), ANSI_TO_TCHAR(FPlatformProperties::IniPlatformName()));
+	Json += FString::Printf(TEXT("\t\"cpu\": \"%s\",\n"), *FPlatformMisc::GetCPUBrand().TrimStartAndEnd().ReplaceCharWithEscapedChar());
+	Json += FString::Printf(TEXT("\t\"numCores\": %d,\n"), FPlatformMisc::NumberOfCoresIncludingHyperthreads());
+	Json += TEXT("\t\"results\": [\n");
+
+	for (int32 ResultIndex = 0; ResultIndex < Results.Num(); ResultIndex++)
+	{
+		const FVoxelBenchmarkResult& Result = Results[ResultIndex];
+
+		Json += TEXT("\t\t{\n");
+		Json += FString::Printf(TEXT("\t\t\t\"name\": \"%s\",\n"), *Result.Name.ReplaceCharWithEscapedChar());
+		Json += FString::Printf(TEXT("\t\t\t\"success\": %s,\n"), Result.bSuccess ? TEXT("true") : TEXT("false"));
+		Json += FString::Printf(TEXT("\t\t\t\"error\": \"%s\",\n"), *Result.Error.ReplaceCharWithEscapedChar());
+		Json += TEXT("\t\t\t\"stages\": [\n");
+
+		for (int32 StageIndex = 0; StageIndex < Result.Stages.Num(); StageIndex++)
+		{
+			const FVoxelBenchmarkStage& Stage = Result.Stages[StageIndex];
+			Json += FString::Printf(
+				TEXT("\t\t\t\t{ \"name\": \"%s\", \"wallTime\": %f, \"taskTime\": %f, \"numTasks\": %lld, \"numVertices\": %lld, \"numTriangles\": %lld, \"numInstances\": %lld, ")
+				TEXT("\"usedMemoryBefore\": %lld, \"usedMemoryAfter\": %lld, \"peakUsedMemory\": %lld }%s\n"),
+				*Stage.Name.ReplaceCharWithEscapedChar(),
+				Stage.WallTime,
+				Stage.TaskTime,
+				Stage.NumTasks,
+				Stage.NumVertices,
+				Stage.NumTriangles,
+				Stage.NumInstances,
+				Stage.UsedMemoryBefore,
+				Stage.UsedMemoryAfter,
+				Stage.PeakUsedMemory,
+				StageIndex + 1 < Result.Stages.Num() ? TEXT(",") : TEXT(""));
+		}
+
+		Json += TEXT("\t\t\t]\n");
+		Json += FString::Printf(TEXT("\t\t}%s\n"), ResultIndex + 1 < Results.Num() ? TEXT(",") : TEXT(""));
+	}
+
+	Json += TEXT("\t]\n");
+	Json += TEXT("}\n");
+	return Json;
+}
+
+FString FVoxelBenchmark::GetDefaultOutputPath()
+{
+	return FPaths::ProfilingDir() / FString::Printf(TEXT("VoxelBenchmark-%s.json"), *FDateTime::Now().ToString());
+}
@@ -295,9 +295,14 @@ static FAutoConsoleCommandWithWorld CmdDestroyWorldThreadPool(
 
 static FAutoConsoleCommand CmdLogThreadPoolStats(
     TEXT("voxel.threading.LogStats"),
-    TEXT(""),
+    TEXT("Log the number of tasks, their time & their time in the queue per task type since the last voxel.threading.ResetStats"),
 	FConsoleCommandDelegate::CreateLambda([](){ FVoxelQueuedThreadPoolStats::Get().LogTimes(); }));
 
+static FAutoConsoleCommand CmdResetThreadPoolStats(
+    TEXT("voxel.threading.ResetStats"),
+    TEXT("Reset the stats logged by voxel.threading.LogStats"),
+	FConsoleCommandDelegate::CreateLambda([](){ FVoxelQueuedThreadPoolStats::Get().Reset(); }));
+
 static FAutoConsoleCommand CmdLogMemoryStats(
     TEXT("voxel.LogMemoryStats"),
     TEXT(""),
@@ -0,0 +1,255 @@
+// Copyright 2020 Phyronnaz
+
+#include "VoxelThreadPool.h"
+#include "VoxelQueuedWork.h"
+#include "VoxelMinimal.h"
+
+#include "HAL/IConsoleManager.h"
+
+// Measures the time between a work being queued & it starting on a pool thread
+// WorkTime: time in seconds the work then keeps its thread busy
+class FVoxelLatencyBenchmarkWork : public IVoxelQueuedWork
+{
+public:
+	FVoxelLatencyBenchmarkWork(uint64& OutLatencyCycles, FThreadSafeCounter& NumDone, float WorkTime = 0.f)
+		: IVoxelQueuedWork(STATIC_FNAME("Latency Benchmark"), 1e9)
+		, OutLatencyCycles(OutLatencyCycles)
+		, NumDone(NumDone)
+		, WorkTime(WorkTime)
+	{
+	}
+
+	uint64 QueuedCycles = 0;
+
+	//~ Begin IVoxelQueuedWork Interface
+	virtual void DoThreadedWork() override
+	{
+		OutLatencyCycles = FPlatformTime::Cycles64() - QueuedCycles;
+		if (WorkTime > 0)
+		{
+			FPlatformProcess::SleepNoStats(WorkTime);
+		}
+		NumDone.Increment();
+		delete this;
+	}
+	virtual void Abandon() override
+	{
+		NumDone.Increment();
+		delete this;
+	}
+	virtual uint32 GetPriority() const override
+	{
+		return 0;
+	}
+	//~ End IVoxelQueuedWork Interface
+
+private:
+	uint64& OutLatencyCycles;
+	FThreadSafeCounter& NumDone;
+	const float WorkTime;
+};
+
+static void LogLatencies(const TCHAR* Name, TArray<uint64>& LatencyCycles)
+{
+	if (LatencyCycles.Num() == 0)
+	{
+		return;
+	}
+
+	LatencyCycles.Sort();
+
+	const auto GetMicroseconds = [&](double Percentile)
+	{
+		const int32 Index = FMath::Clamp(FMath::CeilToInt(LatencyCycles.Num() * Percentile) - 1, 0, LatencyCycles.Num() - 1);
+		return LatencyCycles[Index] * FPlatformTime::GetSecondsPerCycle64() * 1e6;
+	};
+	LOG_VOXEL(Log, TEXT("%s: %d works; P50: %.1fus; P90: %.1fus; P99: %.1fus; Max: %.1fus"),
+		Name,
+		LatencyCycles.Num(),
+		GetMicroseconds(0.5),
+		GetMicroseconds(0.9),
+		GetMicroseconds(0.99),
+		GetMicroseconds(1));
+}
+
+static void BenchmarkThreadPoolLatency(int32 NumSamples, int32 NumThreads)
+{
+	VOXEL_FUNCTION_COUNTER();
+	check(IsInGameThread());
+
+	const auto Pool = FVoxelQueuedThreadPool::Create(FVoxelQueuedThreadPoolSettings(
+		TEXT("Voxel Latency Benchmark Pool"),
+		NumThreads,
+		1024 * 1024,
+		EThreadPriority::TPri_Normal,
+		false));
+
+	// Make sure the threads are sleeping, and not spinning
+	const auto WaitForThreadsToSleep = []()
+	{
+		FPlatformProcess::Sleep(0.002f + IConsoleManager::Get().FindConsoleVariable(TEXT("voxel.threading.SpinTime"))->GetInt() / 1e6f);
+	};
+
+	FThreadSafeCounter NumDone;
+	const auto QueueWorks = [&](TArray<uint64>& LatencyCycles, int32 Num)
+	{
+		const int32 FirstIndex = LatencyCycles.AddZeroed(Num);
+		TArray<IVoxelQueuedWork*> Works;
+		for (int32 Index = 0; Index < Num; Index++)
+		{
+			Works.Add(new FVoxelLatencyBenchmarkWork(LatencyCycles[FirstIndex + Index], NumDone));
+		}
+
+		const uint64 QueuedCycles = FPlatformTime::Cycles64();
+		for (IVoxelQueuedWork* Work : Works)
+		{
+			static_cast<FVoxelLatencyBenchmarkWork*>(Work)->QueuedCycles = QueuedCycles;
+		}
+
+		const int32 Target = NumDone.GetValue() + Num;
+		if (Num == 1)
+		{
+			Pool->AddQueuedWork(Works[0], 0, 0, EVoxelTaskType::AsyncEditFunctions);
+		}
+		else
+		{
+			Pool->AddQueuedWorks(Works, 0, 0, EVoxelTaskType::AsyncEditFunctions);
+		}
+
+		while (NumDone.GetValue() < Target)
+		{
+			FPlatformProcess::SleepNoStats(0.f);
+		}
+	};
+
+	// Works queued one by one, with the threads sleeping
+	TArray<uint64> IdleLatencies;
+	IdleLatencies.Reserve(NumSamples);
+	for (int32 Index = 0; Index < NumSamples; Index++)
+	{
+		WaitForThreadsToSleep();
+		QueueWorks(IdleLatencies, 1);
+	}
+
+	// Works queued one by one, right after the previous one is done
+	TArray<uint64> BackToBackLatencies;
+	BackToBackLatencies.Reserve(NumSamples);
+	for (int32 Index = 0; Index < NumSamples; Index++)
+	{
+		QueueWorks(BackToBackLatencies, 1);
+	}
+
+	// Batches of works, with the threads sleeping
+	TArray<uint64> BurstLatencies;
+	BurstLatencies.Reserve(NumSamples);
+	while (BurstLatencies.Num() < NumSamples)
+	{
+		WaitForThreadsToSleep();
+		QueueWorks(BurstLatencies, FMath::Min(4 * NumThreads, NumSamples - BurstLatencies.Num()));
+	}
+
+	LOG_VOXEL(Log, TEXT("Voxel thread pool latency with %d threads:"), NumThreads);
+	LogLatencies(TEXT("Idle"), IdleLatencies);
+	LogLatencies(TEXT("Back to back"), BackToBackLatencies);
+	LogLatencies(TEXT("Burst"), BurstLatencies);
+}
+
+static FAutoConsoleCommand BenchmarkThreadPoolLatencyCmd(
+	TEXT("voxel.threading.BenchmarkLatency"),
+	TEXT("Measure the time between queuing a work and it starting on a voxel pool thread, see voxel.threading.SpinTime. Args: [NumSamples] [NumThreads]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 NumSamples = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 1000;
+		const int32 NumThreads = Args.Num() > 1 ? FMath::Max(1, FCString::Atoi(*Args[1])) : 4;
+		BenchmarkThreadPoolLatency(NumSamples, NumThreads);
+	}));
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// Queues a burst of foliage tasks, and visible chunks meshing tasks at a regular interval while the burst is processed
+// Foliage has a higher priority category than visible meshing by default, so without quotas meshing waits for the whole burst
+static void SimulateScheduling(int32 NumThreads, int32 NumFoliageTasks, int32 NumMeshingTasks)
+{
+	VOXEL_FUNCTION_COUNTER();
+	check(IsInGameThread());
+
+	constexpr float FoliageTaskTime = 0.005f;
+	constexpr float MeshingTaskTime = 0.001f;
+	constexpr float MeshingTasksInterval = 0.002f;
+
+	const auto Simulate = [&](const TCHAR* Name, const TArray<int32>& MaxConcurrentTasks, const TArray<int32>& NumReservedThreads)
+	{
+		const auto Pool = FVoxelQueuedThreadPool::Create(FVoxelQueuedThreadPoolSettings(
+			TEXT("Voxel Scheduling Simulation Pool"),
+			NumThreads,
+			1024 * 1024,
+			EThreadPriority::TPri_Normal,
+			false,
+			MaxConcurrentTasks,
+			NumReservedThreads));
+
+		const double StartTime = FPlatformTime::Seconds();
+		
+		FThreadSafeCounter NumDone;
+		TArray<uint64> FoliageLatencies;
+		TArray<uint64> MeshingLatencies;
+		FoliageLatencies.SetNumZeroed(NumFoliageTasks);
+		MeshingLatencies.SetNumZeroed(NumMeshingTasks);
+
+		{
+			TArray<IVoxelQueuedWork*> Works;
+			const uint64 QueuedCycles = FPlatformTime::Cycles64();
+			for (int32 Index = 0; Index < NumFoliageTasks; Index++)
+			{
+				auto* Work = new FVoxelLatencyBenchmarkWork(FoliageLatencies[Index], NumDone, FoliageTaskTime);
+				Work->QueuedCycles = QueuedCycles;
+				Works.Add(Work);
+			}
+			Pool->AddQueuedWorks(Works, EVoxelTaskType_DefaultPriorityCategories::FoliageBuild, 0, EVoxelTaskType::FoliageBuild);
+		}
+
+		for (int32 Index = 0; Index < NumMeshingTasks; Index++)
+		{
+			FPlatformProcess::Sleep(MeshingTasksInterval);
+			
+			auto* Work = new FVoxelLatencyBenchmarkWork(MeshingLatencies[Index], NumDone, MeshingTaskTime);
+			Work->QueuedCycles = FPlatformTime::Cycles64();
+			Pool->AddQueuedWork(Work, EVoxelTaskType_DefaultPriorityCategories::VisibleChunksMeshing, 0, EVoxelTaskType::VisibleChunksMeshing);
+		}
+
+		while (NumDone.GetValue() < NumFoliageTasks + NumMeshingTasks)
+		{
+			FPlatformProcess::Sleep(0.001f);
+		}
+
+		LOG_VOXEL(Log, TEXT("%s: took %.1fms"), Name, (FPlatformTime::Seconds() - StartTime) * 1000);
+		LogLatencies(TEXT("    VisibleChunksMeshing queue time"), MeshingLatencies);
+		LogLatencies(TEXT("    FoliageBuild queue time"), FoliageLatencies);
+	};
+
+	const auto MakeTaskTypeArray = [](EVoxelTaskType TaskType, int32 Value)
+	{
+		TArray<int32> Result;
+		Result.SetNumZeroed(FVoxelQueuedThreadPoolStats::NumTaskTypes);
+		Result[int32(TaskType)] = Value;
+		return Result;
+	};
+
+	LOG_VOXEL(Log, TEXT("Voxel thread pool scheduling simulation with %d threads, %d foliage tasks & %d visible meshing tasks:"), NumThreads, NumFoliageTasks, NumMeshingTasks);
+	Simulate(TEXT("No quotas"), {}, {});
+	Simulate(TEXT("FoliageBuild limited to NumThreads - 1"), MakeTaskTypeArray(EVoxelTaskType::FoliageBuild, NumThreads - 1), {});
+	Simulate(TEXT("1 thread reserved to VisibleChunksMeshing"), {}, MakeTaskTypeArray(EVoxelTaskType::VisibleChunksMeshing, 1));
+}
+
+static FAutoConsoleCommand SimulateSchedulingCmd(
+	TEXT("voxel.threading.SimulateScheduling"),
+	TEXT("Measure the queue time of visible chunks meshing tasks during a burst of foliage tasks, with & without task type quotas or reserved threads. Args: [NumThreads] [NumFoliageTasks] [NumMeshingTasks]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 NumThreads = Args.Num() > 0 ? FMath::Max(2, FCString::Atoi(*Args[0])) : 4;
+		const int32 NumFoliageTasks = Args.Num() > 1 ? FMath::Max(1, FCString::Atoi(*Args[1])) : 50 * NumThreads;
+		const int32 NumMeshingTasks = Args.Num() > 2 ? FMath::Max(1, FCString::Atoi(*Args[2])) : 100;
+		SimulateScheduling(NumThreads, NumFoliageTasks, NumMeshingTasks);
+	}));
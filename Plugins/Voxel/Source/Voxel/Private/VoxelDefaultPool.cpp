@@ -6,17 +6,37 @@
 #include "Misc/QueuedThreadPool.h"
 #include "VoxelMinimal.h"
 
+inline TArray<int32> TaskTypeMapToArray(const TMap<EVoxelTaskType, int32>& Map)
+{
+	TArray<int32> Result;
+	Result.SetNumZeroed(FVoxelQueuedThreadPoolStats::NumTaskTypes);
+	for (auto& It : Map)
+	{
+		if (ensure(Result.IsValidIndex(int32(It.Key))))
+		{
+			Result[int32(It.Key)] = FMath::Max(0, It.Value);
+		}
+	}
+	return Result;
+}
+
 FVoxelDefaultPool::FVoxelDefaultPool(
 	int32 ThreadCount,
 	bool bConstantPriorities,
 	const TMap<EVoxelTaskType, int32>& InPriorityCategories,
-	const TMap<EVoxelTaskType, int32>& InPriorityOffsets)
+	const TMap<EVoxelTaskType, int32>& InPriorityOffsets,
+	const TMap<EVoxelTaskType, int32>& MaxConcurrentTasks,
+	const TMap<EVoxelTaskType, int32>& ReservedThreads,
+	int32 ThreadsFirstCore)
 	: Pool(FVoxelQueuedThreadPool::Create(FVoxelQueuedThreadPoolSettings(
 		FString::Printf(TEXT("Voxel Pool %llu"), UNIQUE_ID()),
 		ThreadCount,
 		1024 * 1024,
 		EThreadPriority::TPri_Normal,
-		bConstantPriorities)))
+		bConstantPriorities,
+		TaskTypeMapToArray(MaxConcurrentTasks),
+		TaskTypeMapToArray(ReservedThreads),
+		ThreadsFirstCore)))
 {
 	for (int32 Index = 0; Index < 256; Index++)
 	{
@@ -33,7 +53,10 @@ TVoxelSharedRef<FVoxelDefaultPool> FVoxelDefaultPool::Create(
 	int32 ThreadCount,
 	bool bConstantPriorities,
 	const TMap<EVoxelTaskType, int32>& PriorityCategories,
-	const TMap<EVoxelTaskType, int32>& PriorityOffsets)
+	const TMap<EVoxelTaskType, int32>& PriorityOffsets,
+	const TMap<EVoxelTaskType, int32>& MaxConcurrentTasks,
+	const TMap<EVoxelTaskType, int32>& ReservedThreads,
+	int32 ThreadsFirstCore)
 {
 	LOG_VOXEL(Log, TEXT("Creating pool with %d threads"), ThreadCount);
 	if (!ensureMsgf(ThreadCount >= 1, TEXT("Invalid MeshThreadCount: %d"), ThreadCount))
@@ -50,17 +73,25 @@ TVoxelSharedRef<FVoxelDefaultPool> FVoxelDefaultPool::Create(
 		ThreadCount,
 		bConstantPriorities,
 		FixedPriorityCategories,
-		FixedPriorityOffsets));
+		FixedPriorityOffsets,
+		MaxConcurrentTasks,
+		ReservedThreads,
+		ThreadsFirstCore));
 }
 
 void FVoxelDefaultPool::QueueTask(EVoxelTaskType Type, IVoxelQueuedWork* Task)
 {
-	Pool->AddQueuedWork(Task, PriorityCategories[uint8(Type)], PriorityOffsets[uint8(Type)]);
+	Pool->AddQueuedWork(Task, PriorityCategories[uint8(Type)], PriorityOffsets[uint8(Type)], Type);
 }
 
 void FVoxelDefaultPool::QueueTasks(EVoxelTaskType Type, const TArray<IVoxelQueuedWork*>& Tasks)
 {
-	Pool->AddQueuedWorks(Tasks, PriorityCategories[uint8(Type)], PriorityOffsets[uint8(Type)]);
+	Pool->AddQueuedWorks(Tasks, PriorityCategories[uint8(Type)], PriorityOffsets[uint8(Type)], Type);
+}
+
+void FVoxelDefaultPool::InvalidatePriorities()
+{
+	Pool->InvalidatePriorities();
 }
 
 int32 FVoxelDefaultPool::GetNumTasks() const
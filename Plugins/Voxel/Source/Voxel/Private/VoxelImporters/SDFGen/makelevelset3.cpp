@@ -4,6 +4,9 @@
 #include "VoxelImporters/VoxelMeshImporter.h"
 #include "VoxelUtilities/VoxelIntVectorUtilities.h"
 
+#include "Async/ParallelFor.h"
+#include "HAL/ThreadSafeCounter.h"
+
 // 10% faster to build with FORCEINLINE
 FORCEINLINE float PointSegmentDistance(const FVector& Point, const FVector& A, const FVector& B, float& Alpha)
 {
@@ -258,43 +261,112 @@ void MakeLevelSet3(
 	case EVoxelAxis::Z: IndexI = 0; IndexJ = 1; IndexK = 2; break;
 	}
 	
-	// We begin by initializing distances near the mesh, and figuring out intersection counts
+	const auto ToVoxelSpace = [&](const FVector& Value)
 	{
-		VOXEL_ASYNC_SCOPE_COUNTER("Intersections");
-		for (int32 TriangleIndex = 0; TriangleIndex < InData.Triangles.Num(); TriangleIndex++)
-		{
-			VOXEL_SLOW_SCOPE_COUNTER("Process triangle");
+		return (Value - InData.Origin) / Settings.VoxelSize;
+	};
+	const auto FromVoxelSpace = [&](const FVector& Value)
+	{
+		return Value * Settings.VoxelSize + InData.Origin;
+	};
 
+	struct FVoxelTriangle
+	{
+		FVector VoxelVertexA;
+		FVector VoxelVertexB;
+		FVector VoxelVertexC;
+		FVector MinVoxelVertex;
+		FVector MaxVoxelVertex;
+	};
+	TArray<FVoxelTriangle> VoxelTriangles;
+	{
+		VOXEL_ASYNC_SCOPE_COUNTER("Transform triangles");
+		
+		VoxelTriangles.SetNumUninitialized(InData.Triangles.Num());
+		ParallelFor(InData.Triangles.Num(), [&](int32 TriangleIndex)
+		{
 			const FIntVector& Triangle = InData.Triangles[TriangleIndex];
-			const int32 IndexA = Triangle.X;
-			const int32 IndexB = Triangle.Y;
-			const int32 IndexC = Triangle.Z;
-
-			const FVector& VertexA = InData.Vertices[IndexA];
-			const FVector& VertexB = InData.Vertices[IndexB];
-			const FVector& VertexC = InData.Vertices[IndexC];
+			
+			FVoxelTriangle& VoxelTriangle = VoxelTriangles[TriangleIndex];
+			VoxelTriangle.VoxelVertexA = ToVoxelSpace(InData.Vertices[Triangle.X]);
+			VoxelTriangle.VoxelVertexB = ToVoxelSpace(InData.Vertices[Triangle.Y]);
+			VoxelTriangle.VoxelVertexC = ToVoxelSpace(InData.Vertices[Triangle.Z]);
+			VoxelTriangle.MinVoxelVertex = FVoxelUtilities::ComponentMin3(VoxelTriangle.VoxelVertexA, VoxelTriangle.VoxelVertexB, VoxelTriangle.VoxelVertexC);
+			VoxelTriangle.MaxVoxelVertex = FVoxelUtilities::ComponentMax3(VoxelTriangle.VoxelVertexA, VoxelTriangle.VoxelVertexB, VoxelTriangle.VoxelVertexC);
+		}, !InData.bMultiThreaded);
+	}
 
-			const auto ToVoxelSpace = [&](const FVector& Value)
+	// Triangles are rasterized in slabs: each slab only writes to its own voxels, and processes its triangles in increasing index order,
+	// so the result is exactly the same as a serial rasterization
+	constexpr int32 SlabSize = 8;
+	
+	const auto BuildSlabs = [&](int32 Axis, auto GetRange)
+	{
+		VOXEL_ASYNC_SCOPE_COUNTER("Build slabs");
+		
+		TArray<TArray<int32>> Slabs;
+		Slabs.SetNum(FVoxelUtilities::DivideCeil(Size[Axis], SlabSize));
+		for (int32 TriangleIndex = 0; TriangleIndex < VoxelTriangles.Num(); TriangleIndex++)
+		{
+			int32 Start;
+			int32 End;
+			GetRange(VoxelTriangles[TriangleIndex], Start, End);
+			if (Start > End)
 			{
-				return (Value - InData.Origin) / Settings.VoxelSize;
-			};
-			const auto FromVoxelSpace = [&](const FVector& Value)
+				continue;
+			}
+			for (int32 SlabIndex = Start / SlabSize; SlabIndex <= End / SlabSize; SlabIndex++)
 			{
-				return Value * Settings.VoxelSize + InData.Origin;
-			};
+				Slabs[SlabIndex].Add(TriangleIndex);
+			}
+		}
+		return Slabs;
+	};
+	
+	// We begin by initializing distances near the mesh
+	{
+		VOXEL_ASYNC_SCOPE_COUNTER("Distances");
 
-			const FVector VoxelVertexA = ToVoxelSpace(VertexA);
-			const FVector VoxelVertexB = ToVoxelSpace(VertexB);
-			const FVector VoxelVertexC = ToVoxelSpace(VertexC);
+		const auto GetRange = [&](const FVoxelTriangle& Triangle, FIntVector& Start, FIntVector& End)
+		{
+			Start = FVoxelUtilities::Clamp(FVoxelUtilities::FloorToInt(Triangle.MinVoxelVertex) - Settings.ExactBand, FIntVector(0), Size - 1);
+			End = FVoxelUtilities::Clamp(FVoxelUtilities::CeilToInt(Triangle.MaxVoxelVertex) + Settings.ExactBand, FIntVector(0), Size - 1);
+		};
+		
+		const TArray<TArray<int32>> Slabs = BuildSlabs(2, [&](const FVoxelTriangle& Triangle, int32& OutStart, int32& OutEnd)
+		{
+			FIntVector Start;
+			FIntVector End;
+			GetRange(Triangle, Start, End);
+			OutStart = Start.Z;
+			OutEnd = End.Z;
+		});
+		
+		ParallelFor(Slabs.Num(), [&](int32 SlabIndex)
+		{
+			VOXEL_ASYNC_SCOPE_COUNTER("Process slab");
+			
+			const int32 SlabStart = SlabIndex * SlabSize;
+			const int32 SlabEnd = FMath::Min(SlabStart + SlabSize, Size.Z) - 1;
+			
+			for (const int32 TriangleIndex : Slabs[SlabIndex])
+			{
+				const FIntVector& Triangle = InData.Triangles[TriangleIndex];
+				const int32 IndexA = Triangle.X;
+				const int32 IndexB = Triangle.Y;
+				const int32 IndexC = Triangle.Z;
 
-			const FVector MinVoxelVertex = FVoxelUtilities::ComponentMin3(VoxelVertexA, VoxelVertexB, VoxelVertexC);
-			const FVector MaxVoxelVertex = FVoxelUtilities::ComponentMax3(VoxelVertexA, VoxelVertexB, VoxelVertexC);
+				const FVector& VertexA = InData.Vertices[IndexA];
+				const FVector& VertexB = InData.Vertices[IndexB];
+				const FVector& VertexC = InData.Vertices[IndexC];
 
-			{
-				VOXEL_SLOW_SCOPE_COUNTER("Compute distance");
+				const FVoxelTriangle& VoxelTriangle = VoxelTriangles[TriangleIndex];
 
-				const FIntVector Start = FVoxelUtilities::Clamp(FVoxelUtilities::FloorToInt(MinVoxelVertex) - Settings.ExactBand, FIntVector(0), Size - 1);
-				const FIntVector End = FVoxelUtilities::Clamp(FVoxelUtilities::CeilToInt(MaxVoxelVertex) + Settings.ExactBand, FIntVector(0), Size - 1);
+				FIntVector Start;
+				FIntVector End;
+				GetRange(VoxelTriangle, Start, End);
+				Start.Z = FMath::Max(Start.Z, SlabStart);
+				End.Z = FMath::Min(End.Z, SlabEnd);
 
 				// Do distances nearby
 				for (int32 Z = Start.Z; Z <= End.Z; Z++)
@@ -331,19 +403,55 @@ void MakeLevelSet3(
 								
 								if (InData.bExportPositions)
 								{
-									OutData.Positions(X, Y, Z) = AlphaA * VoxelVertexA + AlphaB * VoxelVertexB + AlphaC * VoxelVertexC;
+									OutData.Positions(X, Y, Z) = AlphaA * VoxelTriangle.VoxelVertexA + AlphaB * VoxelTriangle.VoxelVertexB + AlphaC * VoxelTriangle.VoxelVertexC;
 								}
 							}
 						}
 					}
 				}
 			}
+		}, !InData.bMultiThreaded);
+	}
+
+	// Then figure out intersection counts
+	{
+		VOXEL_ASYNC_SCOPE_COUNTER("Intersections");
+		
+		const auto GetRange = [&](const FVoxelTriangle& Triangle, FIntVector& Start, FIntVector& End)
+		{
+			Start = FVoxelUtilities::Clamp(FVoxelUtilities::CeilToInt(Triangle.MinVoxelVertex), FIntVector(0), Size - 1);
+			End = FVoxelUtilities::Clamp(FVoxelUtilities::FloorToInt(Triangle.MaxVoxelVertex), FIntVector(0), Size - 1);
+		};
 
+		// Slabs are along I: a column (I, J) is always fully owned by a single slab
+		const TArray<TArray<int32>> Slabs = BuildSlabs(IndexI, [&](const FVoxelTriangle& Triangle, int32& OutStart, int32& OutEnd)
+		{
+			FIntVector Start;
+			FIntVector End;
+			GetRange(Triangle, Start, End);
+			OutStart = Start[IndexI];
+			OutEnd = End[IndexI];
+		});
+
+		ParallelFor(Slabs.Num(), [&](int32 SlabIndex)
+		{
+			VOXEL_ASYNC_SCOPE_COUNTER("Process slab");
+			
+			const int32 SlabStart = SlabIndex * SlabSize;
+			const int32 SlabEnd = FMath::Min(SlabStart + SlabSize, Size[IndexI]) - 1;
+			
+			for (const int32 TriangleIndex : Slabs[SlabIndex])
 			{
-				VOXEL_SLOW_SCOPE_COUNTER("Compute intersections");
+				const FVoxelTriangle& VoxelTriangle = VoxelTriangles[TriangleIndex];
+				const FVector& VoxelVertexA = VoxelTriangle.VoxelVertexA;
+				const FVector& VoxelVertexB = VoxelTriangle.VoxelVertexB;
+				const FVector& VoxelVertexC = VoxelTriangle.VoxelVertexC;
 				
-				const FIntVector Start = FVoxelUtilities::Clamp(FVoxelUtilities::CeilToInt(MinVoxelVertex), FIntVector(0), Size - 1);
-				const FIntVector End = FVoxelUtilities::Clamp(FVoxelUtilities::FloorToInt(MaxVoxelVertex), FIntVector(0), Size - 1);
+				FIntVector Start;
+				FIntVector End;
+				GetRange(VoxelTriangle, Start, End);
+				Start[IndexI] = FMath::Max(Start[IndexI], SlabStart);
+				End[IndexI] = FMath::Min(End[IndexI], SlabEnd);
 
 				// Do intersection counts. Make sure to follow SweepDirection!
 				FIntVector Position;
@@ -360,34 +468,25 @@ void MakeLevelSet3(
 						if (PointInTriangle2D(FVector2D_Double(I, J), Get2D(VoxelVertexA), Get2D(VoxelVertexB), Get2D(VoxelVertexC), AlphaA, AlphaB, AlphaC))
 						{
 							const float K = AlphaA * VoxelVertexA[IndexK] + AlphaB * VoxelVertexB[IndexK] + AlphaC * VoxelVertexC[IndexK]; // Intersection K coordinate
-#if 1
 							Position[IndexK] = FMath::Clamp(Settings.bReverseSweep ? FMath::FloorToInt(K) : FMath::CeilToInt(K), 0, Size[IndexK] - 1);
 							IntersectionCount(Position)++;
-#else
-							const int32 IntervalX = FMath::CeilToInt(X); // Intersection is in (IntervalX - 1, IntervalX]
-							if (IntervalX < 0)
-							{
-								IntersectionCount(FMath::Clamp(FMath::CeilToInt(X), 0, Size.X - 1), Y, Z)++; // We enlarge the first interval to include everything to the -X direction
-							}
-							else if (IntervalX < Size.X)
-							{
-								IntersectionCount(IntervalX, Y, Z)++; // We ignore intersections that are beyond the +X side of the grid
-							}
-#endif
 						}
 					}
 				}
 			}
-		}
+		}, !InData.bMultiThreaded);
 	}
 
 	{
 		VOXEL_ASYNC_SCOPE_COUNTER("Compute Signs");
+
+		FThreadSafeCounter NumLeaks;
 		
 		// Then figure out signs (inside/outside) from intersection counts
-		FIntVector Position;
-		for (int32 I = 0; I < Size[IndexI]; I++)
+		// Each I is independent
+		ParallelFor(Size[IndexI], [&](int32 I)
 		{
+			FIntVector Position;
 			Position[IndexI] = I;
 			for (int32 J = 0; J < Size[IndexJ]; J++)
 			{
@@ -408,7 +507,7 @@ void MakeLevelSet3(
 						if (Count % 2 == 1)
 						{
 							// For watertight meshes, we're expecting to come in and out of the mesh
-							OutData.NumLeaks++;
+							NumLeaks.Increment();
 							continue;
 						}
 					}
@@ -417,7 +516,7 @@ void MakeLevelSet3(
 						if (Count == 0)
 						{
 							// For other meshes, only skip when there was no hit
-							OutData.NumLeaks++;
+							NumLeaks.Increment();
 							continue;
 						}
 					}
@@ -467,15 +566,26 @@ void MakeLevelSet3(
 					}
 				}
 			}
-		}
+		}, !InData.bMultiThreaded);
+
+		OutData.NumLeaks += NumLeaks.GetValue();
 	}
 
 	{
 		VOXEL_ASYNC_SCOPE_COUNTER("Divide distances");
-		for (float& Distance : OutData.Phi.Data)
+
+		const int32 Num = OutData.Phi.Data.Num();
+		constexpr int32 BatchSize = 4096;
+		
+		ParallelFor(FVoxelUtilities::DivideCeil(Num, BatchSize), [&](int32 BatchIndex)
 		{
-			Distance /= Settings.VoxelSize;
-			Distance /= Settings.DistanceDivisor;
-		}
+			float* RESTRICT const Distances = OutData.Phi.Data.GetData();
+			const int32 End = FMath::Min(Num, (BatchIndex + 1) * BatchSize);
+			for (int32 Index = BatchIndex * BatchSize; Index < End; Index++)
+			{
+				Distances[Index] /= Settings.VoxelSize;
+				Distances[Index] /= Settings.DistanceDivisor;
+			}
+		}, !InData.bMultiThreaded);
 	}
 }
@@ -22,6 +22,9 @@ struct FMakeLevelSet3InData
 
 	bool bExportPositions = false;
 	bool bExportUVs = false;
+
+	// Rasterization and sign computation are split in slabs, output is the same as single threaded
+	bool bMultiThreaded = true;
 };
 
 struct FMakeLevelSet3OutData
@@ -413,12 +413,17 @@ void UVoxelMeshImporterLibrary::ConvertMeshToDistanceField(
 
 		InData.bExportPositions = true;
 		InData.bExportUVs = false;
+		InData.bMultiThreaded = bMultiThreaded;
 	}
 
 	auto SettingsCopy = Settings;
 	SettingsCopy.DistanceDivisor = 1;
 	SettingsCopy.ExactBand = 0.f; // No need for anything bigger
 	
+	// Slow tasks can only be used on the game thread
+	FVoxelScopedSlowTask Progress(2.f, VOXEL_LOCTEXT("Converting mesh to distance field"), IsInGameThread());
+	
+	Progress.EnterProgressFrame(1.f, VOXEL_LOCTEXT("Computing surface positions"));
 	FMakeLevelSet3OutData OutData;
 	MakeLevelSet3(SettingsCopy, InData, OutData);
 	
@@ -430,7 +435,16 @@ void UVoxelMeshImporterLibrary::ConvertMeshToDistanceField(
 	OutNumLeaks = OutData.NumLeaks;
 
 	// Propagate distances
-	FVoxelDistanceFieldUtilities::JumpFlood(Size, OutSurfacePositions, Device, bMultiThreaded, MaxPasses_Debug);
+	Progress.EnterProgressFrame(1.f, VOXEL_LOCTEXT("Propagating distances"));
+	{
+		FVoxelScopedSlowTask JumpFloodProgress(1.f, FText(), IsInGameThread());
+		float LastProgress = 0.f;
+		FVoxelDistanceFieldUtilities::JumpFlood(Size, OutSurfacePositions, Device, bMultiThreaded, MaxPasses_Debug, [&](float NewProgress)
+		{
+			JumpFloodProgress.EnterProgressFrame(NewProgress - LastProgress);
+			LastProgress = NewProgress;
+		});
+	}
 	FVoxelDistanceFieldUtilities::GetDistancesFromSurfacePositions(Size, OutSurfacePositions, OutDistanceField);
 }
 
@@ -4,9 +4,12 @@
 #include "VoxelRender/VoxelProceduralMeshComponent.h"
 #include "VoxelRender/MaterialCollections/VoxelMaterialCollectionBase.h"
 #include "VoxelRender/VoxelMaterialIndices.h"
+#include "VoxelRender/Meshers/VoxelMesherValuesCache.h"
+#include "VoxelRender/Meshers/VoxelChunkMeshDeduplicator.h"
 #include "VoxelData/VoxelData.h"
 #include "VoxelMessages.h"
 #include "VoxelPriorityHandler.h"
+#include "IVoxelPool.h"
 #include "VoxelWorld.h"
 #include "VoxelUniqueError.h"
 #include "VoxelUtilities/VoxelMaterialUtilities.h"
@@ -101,6 +104,8 @@ FVoxelRendererSettings::FVoxelRendererSettings(
 	, Pool(Pool)
 	, ToolRenderingManager(ToolRenderingManager)
 	, DebugManager(DebugManager)
+	, MesherValuesCache(MakeVoxelShared<FVoxelMesherValuesCache>(CVarMesherValuesCacheSize.GetValueOnAnyThread()))
+	, ChunkMeshDeduplicator(MakeVoxelShared<FVoxelChunkMeshDeduplicator>(CVarDeduplicateChunkMeshes.GetValueOnAnyThread() != 0))
 {
 
 }
@@ -118,6 +123,9 @@ void IVoxelRenderer::SetInvokersPositionsForPriorities(const TArray<FIntVector>&
 		InvokersPositionsForPriorities = MakeVoxelShared<FInvokerPositionsArray>(2 * InvokersPositionsForPriorities->GetMax());
 	}
 	InvokersPositionsForPriorities->Set(NewInvokersPositionsForPriorities);
+
+	// Don't wait for the cached priorities to expire: after a teleport, the old ones are all wrong
+	Settings.Pool->InvalidatePriorities();
 }
 
 inline UObject* GetRootOwner(const TWeakObjectPtr<UPrimitiveComponent>& RootComponent)
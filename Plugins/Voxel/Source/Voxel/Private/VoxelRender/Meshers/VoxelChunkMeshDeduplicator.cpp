@@ -0,0 +1,216 @@
+// Copyright 2020 Phyronnaz
+
+#include "VoxelRender/Meshers/VoxelChunkMeshDeduplicator.h"
+#include "VoxelRender/VoxelChunkMesh.h"
+
+#include "Hash/CityHash.h"
+#include "Misc/ScopeLock.h"
+#include "HAL/IConsoleManager.h"
+
+TAutoConsoleVariable<int32> CVarDeduplicateChunkMeshes(
+	TEXT("voxel.renderer.DeduplicateChunkMeshes"),
+	1,
+	TEXT("If true, chunks with the exact same mesh will share their buffers, reducing memory & collision cooking on flat or repetitive worlds.\n")
+	TEXT("Only read when the renderer is created"),
+	ECVF_Default);
+
+static FThreadSafeCounter64 GlobalNumBuffers;
+static FThreadSafeCounter64 GlobalNumDeduplicatedBuffers;
+static FThreadSafeCounter64 GlobalDeduplicatedSize;
+
+static FAutoConsoleCommand LogChunkMeshDeduplicationStatsCmd(
+	TEXT("voxel.renderer.LogChunkMeshDeduplicationStats"),
+	TEXT("Log how many chunk buffers were shared with identical chunks since the last call, see voxel.renderer.DeduplicateChunkMeshes"),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		const FVoxelChunkMeshDeduplicatorStats Stats = FVoxelChunkMeshDeduplicator::GetGlobalStats();
+		LOG_VOXEL(Log, TEXT("Chunk mesh deduplication: %lld buffers, %lld deduplicated (%.1f%%), %.1fMB saved"),
+			Stats.NumBuffers,
+			Stats.NumDeduplicatedBuffers,
+			Stats.GetDeduplicationRate() * 100,
+			Stats.DeduplicatedSize / double(1 << 20));
+		FVoxelChunkMeshDeduplicator::ResetGlobalStats();
+	}));
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+FVoxelChunkMeshDeduplicator::FVoxelChunkMeshDeduplicator(bool bEnabled)
+	: bEnabled(bEnabled)
+{
+}
+
+void FVoxelChunkMeshDeduplicator::Deduplicate(FVoxelChunkMesh& Chunk, bool bIsTransitions)
+{
+	VOXEL_ASYNC_FUNCTION_COUNTER();
+
+	Chunk.IterateBufferPtrs([&](const FVoxelMaterialIndices& MaterialIndices, TVoxelSharedPtr<FVoxelChunkMeshBuffers>& ChunkBuffers)
+	{
+		check(ChunkBuffers.IsValid());
+
+		// Empty buffers are cheap, and the main & transitions chunks of a section would end up with the same guid
+		if (!bEnabled || ChunkBuffers->Indices.Num() == 0)
+		{
+			ChunkBuffers->Guid = FGuid::NewGuid();
+			return;
+		}
+
+		GlobalNumBuffers.Increment();
+
+		const FKey Key = ComputeKey(*ChunkBuffers, MaterialIndices, bIsTransitions);
+
+		TVoxelSharedPtr<FVoxelChunkMeshBuffers> ExistingBuffers;
+		{
+			FScopeLock Lock(&Section);
+			ExistingBuffers = Buffers.FindRef(Key).Pin();
+		}
+
+		// Compare outside of the lock: existing buffers are immutable
+		if (ExistingBuffers.IsValid() && AreEqual(*ExistingBuffers, *ChunkBuffers))
+		{
+			GlobalNumDeduplicatedBuffers.Increment();
+			GlobalDeduplicatedSize.Add(ChunkBuffers->GetAllocatedSize());
+
+			ChunkBuffers = ExistingBuffers;
+			return;
+		}
+
+		ChunkBuffers->Guid = FGuid::NewGuid();
+
+		FScopeLock Lock(&Section);
+		Buffers.Add(Key, ChunkBuffers);
+		if (Buffers.Num() > 2 * FMath::Max(NumBuffersAfterLastPrune, 64))
+		{
+			Prune_Locked();
+		}
+	});
+}
+
+FVoxelChunkMeshDeduplicatorStats FVoxelChunkMeshDeduplicator::GetGlobalStats()
+{
+	FVoxelChunkMeshDeduplicatorStats Stats;
+	Stats.NumBuffers = GlobalNumBuffers.GetValue();
+	Stats.NumDeduplicatedBuffers = GlobalNumDeduplicatedBuffers.GetValue();
+	Stats.DeduplicatedSize = GlobalDeduplicatedSize.GetValue();
+	return Stats;
+}
+
+void FVoxelChunkMeshDeduplicator::ResetGlobalStats()
+{
+	GlobalNumBuffers.Reset();
+	GlobalNumDeduplicatedBuffers.Reset();
+	GlobalDeduplicatedSize.Reset();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+FVoxelChunkMeshDeduplicator::FKey FVoxelChunkMeshDeduplicator::ComputeKey(const FVoxelChunkMeshBuffers& ChunkBuffers, const FVoxelMaterialIndices& MaterialIndices, bool bIsTransitions)
+{
+	VOXEL_ASYNC_FUNCTION_COUNTER();
+
+	// Same as FVoxelCookedCollisionCache::ComputeKey
+	FKey Key;
+	Key.HashA = 0x9E3779B97F4A7C15ull;
+	Key.HashB = 0xC2B2AE3D27D4EB4Full;
+	Key.MaterialIndices = MaterialIndices;
+	Key.bIsTransitions = bIsTransitions;
+
+	const auto Hash = [&](const void* Data, int64 Size)
+	{
+		check(Size < MAX_uint32);
+		Key.HashA = CityHash64WithSeed(static_cast<const char*>(Data), Size, Key.HashA);
+		Key.HashB = CityHash64WithSeed(static_cast<const char*>(Data), Size, Key.HashB);
+	};
+	const auto HashValue = [&](auto Value)
+	{
+		Hash(&Value, sizeof(Value));
+	};
+	const auto HashArray = [&](const auto& Array)
+	{
+		HashValue(Array.Num());
+		if (Array.Num() > 0)
+		{
+			Hash(Array.GetData(), Array.Num() * Array.GetTypeSize());
+		}
+	};
+
+	HashArray(ChunkBuffers.Indices);
+	HashArray(ChunkBuffers.Positions);
+	HashArray(ChunkBuffers.Normals);
+	HashArray(ChunkBuffers.Colors);
+	HashValue(ChunkBuffers.TextureCoordinates.Num());
+	for (auto& TextureCoordinates : ChunkBuffers.TextureCoordinates)
+	{
+		HashArray(TextureCoordinates);
+	}
+
+	// Tangents have padding
+	HashValue(ChunkBuffers.Tangents.Num());
+	for (auto& Tangent : ChunkBuffers.Tangents)
+	{
+		HashValue(Tangent.TangentX);
+		HashValue(Tangent.bFlipTangentY);
+	}
+
+	return Key;
+}
+
+bool FVoxelChunkMeshDeduplicator::AreEqual(const FVoxelChunkMeshBuffers& A, const FVoxelChunkMeshBuffers& B)
+{
+	VOXEL_ASYNC_FUNCTION_COUNTER();
+
+	const auto AreArraysEqual = [](const auto& ArrayA, const auto& ArrayB)
+	{
+		return
+			ArrayA.Num() == ArrayB.Num() &&
+			FMemory::Memcmp(ArrayA.GetData(), ArrayB.GetData(), ArrayA.Num() * ArrayA.GetTypeSize()) == 0;
+	};
+
+	if (!AreArraysEqual(A.Indices, B.Indices) ||
+		!AreArraysEqual(A.Positions, B.Positions) ||
+		!AreArraysEqual(A.Normals, B.Normals) ||
+		!AreArraysEqual(A.Colors, B.Colors) ||
+		A.TextureCoordinates.Num() != B.TextureCoordinates.Num() ||
+		A.Tangents.Num() != B.Tangents.Num())
+	{
+		return false;
+	}
+
+	for (int32 Index = 0; Index < A.TextureCoordinates.Num(); Index++)
+	{
+		if (!AreArraysEqual(A.TextureCoordinates[Index], B.TextureCoordinates[Index]))
+		{
+			return false;
+		}
+	}
+
+	for (int32 Index = 0; Index < A.Tangents.Num(); Index++)
+	{
+		const FVoxelProcMeshTangent& TangentA = A.Tangents[Index];
+		const FVoxelProcMeshTangent& TangentB = B.Tangents[Index];
+		if (FMemory::Memcmp(&TangentA.TangentX, &TangentB.TangentX, sizeof(FVector)) != 0 ||
+			TangentA.bFlipTangentY != TangentB.bFlipTangentY)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void FVoxelChunkMeshDeduplicator::Prune_Locked()
+{
+	VOXEL_ASYNC_FUNCTION_COUNTER();
+
+	for (auto It = Buffers.CreateIterator(); It; ++It)
+	{
+		if (!It.Value().IsValid())
+		{
+			It.RemoveCurrent();
+		}
+	}
+	NumBuffersAfterLastPrune = Buffers.Num();
+}
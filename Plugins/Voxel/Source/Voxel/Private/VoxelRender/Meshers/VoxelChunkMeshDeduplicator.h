@@ -0,0 +1,84 @@
+// Copyright 2020 Phyronnaz
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VoxelMinimal.h"
+#include "VoxelRender/VoxelMaterialIndices.h"
+#include "HAL/ConsoleManager.h"
+
+struct FVoxelChunkMesh;
+struct FVoxelChunkMeshBuffers;
+
+extern TAutoConsoleVariable<int32> CVarDeduplicateChunkMeshes;
+
+struct FVoxelChunkMeshDeduplicatorStats
+{
+	int64 NumBuffers = 0;
+	int64 NumDeduplicatedBuffers = 0;
+	// Memory freed by using an existing buffer instead
+	int64 DeduplicatedSize = 0;
+
+	double GetDeduplicationRate() const
+	{
+		return NumBuffers == 0 ? 0. : double(NumDeduplicatedBuffers) / double(NumBuffers);
+	}
+};
+
+/**
+ * Shares the buffers of chunks with identical meshes, eg flat or repetitive worlds
+ * Once a mesher is done, its buffers are hashed: if a live buffer has the exact same content, the chunk uses it instead
+ * Shared buffers keep their guid, so the same mesh always has the same guid:
+ * chunks re-meshed to an identical mesh don't rebuild their collisions, and identical chunks share their cooked collisions through FVoxelCookedCollisionCache
+ * Buffers are immutable once deduplicated
+ * Only weak pointers are kept: buffers are freed with the last chunk using them
+ * Thread safe
+ */
+class FVoxelChunkMeshDeduplicator
+{
+public:
+	explicit FVoxelChunkMeshDeduplicator(bool bEnabled);
+
+	// Set the guids of the chunk buffers, replacing them by identical existing buffers if possible
+	void Deduplicate(FVoxelChunkMesh& Chunk, bool bIsTransitions);
+
+	// Stats of all the deduplicators since the last reset
+	static FVoxelChunkMeshDeduplicatorStats GetGlobalStats();
+	static void ResetGlobalStats();
+
+private:
+	struct FKey
+	{
+		uint64 HashA = 0;
+		uint64 HashB = 0;
+		// Never share buffers between sections of the same chunk: they need different guids
+		FVoxelMaterialIndices MaterialIndices;
+		bool bIsTransitions = false;
+
+		FORCEINLINE bool operator==(const FKey& Other) const
+		{
+			return
+				HashA == Other.HashA &&
+				HashB == Other.HashB &&
+				MaterialIndices == Other.MaterialIndices &&
+				bIsTransitions == Other.bIsTransitions;
+		}
+		FORCEINLINE friend uint32 GetTypeHash(const FKey& Key)
+		{
+			return uint32(Key.HashA);
+		}
+	};
+
+	const bool bEnabled;
+
+	FCriticalSection Section;
+	TMap<FKey, TVoxelWeakPtr<FVoxelChunkMeshBuffers>> Buffers;
+	// Expired buffers are removed once the map doubled in size since the last time
+	int32 NumBuffersAfterLastPrune = 0;
+
+	static FKey ComputeKey(const FVoxelChunkMeshBuffers& ChunkBuffers, const FVoxelMaterialIndices& MaterialIndices, bool bIsTransitions);
+	// The hashes should be enough, but a collision would give a chunk the mesh of another one
+	static bool AreEqual(const FVoxelChunkMeshBuffers& A, const FVoxelChunkMeshBuffers& B);
+
+	void Prune_Locked();
+};
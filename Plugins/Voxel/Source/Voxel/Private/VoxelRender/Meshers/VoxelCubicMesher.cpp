@@ -2,6 +2,7 @@
 
 #include "VoxelRender/Meshers/VoxelCubicMesher.h"
 #include "VoxelRender/Meshers/VoxelMesherUtilities.h"
+#include "VoxelRender/Meshers/VoxelMesherValuesCache.h"
 #include "VoxelRender/IVoxelRenderer.h"
 #include "VoxelData/VoxelDataIncludes.h"
 
@@ -299,8 +300,8 @@ void FVoxelCubicMesher::CreateGeometryTemplate(FVoxelMesherTimes& Times, TArray<
 		Accelerator = MakeUnique<FVoxelConstDataAccelerator>(Data, GetBoundsToLock());
 	}
 
-	TVoxelQueryZone<FVoxelValue> QueryZone(GetBoundsToCheckIsEmptyOn(), FIntVector(CUBIC_CHUNK_SIZE_WITH_NEIGHBORS), LOD, CachedValues);
-	MESHER_TIME_VALUES(CUBIC_CHUNK_SIZE_WITH_NEIGHBORS * CUBIC_CHUNK_SIZE_WITH_NEIGHBORS * CUBIC_CHUNK_SIZE_WITH_NEIGHBORS, Data.Get<FVoxelValue>(QueryZone, LOD));
+	MESHER_TIME_VALUES(CUBIC_CHUNK_SIZE_WITH_NEIGHBORS * CUBIC_CHUNK_SIZE_WITH_NEIGHBORS * CUBIC_CHUNK_SIZE_WITH_NEIGHBORS, Settings.MesherValuesCache->GetValues(Data, GetBoundsToCheckIsEmptyOn().Min, CUBIC_CHUNK_SIZE_WITH_NEIGHBORS, LOD, CachedValues.GetData()));
+	QueriedValues = { GetBoundsToCheckIsEmptyOn(), CachedValues.GetData() };
 	
 	{
 		VOXEL_ASYNC_SCOPE_COUNTER("Iteration");
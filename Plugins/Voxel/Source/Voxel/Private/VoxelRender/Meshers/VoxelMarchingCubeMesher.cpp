@@ -2,6 +2,8 @@
 
 #include "VoxelRender/Meshers/VoxelMarchingCubeMesher.h"
 #include "VoxelRender/Meshers/VoxelMesherUtilities.h"
+#include "VoxelRender/Meshers/VoxelMesherValuesCache.h"
+#include "VoxelRender/Meshers/VoxelMeshSimplifier.h"
 #include "VoxelRender/IVoxelRenderer.h"
 #include "VoxelData/VoxelDataIncludes.h"
 #include "Transvoxel.h"
@@ -15,6 +17,18 @@ static TAutoConsoleVariable<int32> CVarEnableUniqueUVs(
 	TEXT("If true, will duplicate the vertices to assign to each triangle in a chunk a unique part of the UV space"),
 	ECVF_Default);
 
+static TAutoConsoleVariable<int32> CVarSimplificationMinLOD(
+	TEXT("voxel.mesher.SimplificationMinLOD"),
+	-1,
+	TEXT("If >= 0, marching cubes chunks with a LOD >= this will be simplified before computing their normals, see voxel.mesher.SimplificationMaxError. -1 to disable"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarSimplificationMaxError(
+	TEXT("voxel.mesher.SimplificationMaxError"),
+	0.25f,
+	TEXT("Max distance between a simplified chunk and the original one, in voxels of the chunk LOD"),
+	ECVF_Default);
+
 static TAutoConsoleVariable<int32> CVarRandomizeTangents(
 	TEXT("voxel.mesher.RandomizeTangents"),
 	0,
@@ -123,6 +137,48 @@ public:
 		}
 	}
 
+	static bool ShouldSimplify(const FVoxelMarchingCubeMesher& Mesher)
+	{
+		const int32 MinLOD = CVarSimplificationMinLOD.GetValueOnAnyThread();
+		return MinLOD >= 0 && Mesher.LOD >= MinLOD;
+	}
+	static void Simplify(const FVoxelMarchingCubeMesher& Mesher, TArray<FVoxelMesherVertex>& MesherVertices, TArray<uint32>& Indices)
+	{
+		VOXEL_ASYNC_FUNCTION_COUNTER();
+
+		// Lock the vertices in the border cells: the chunk must still match its neighbors, and these vertices are moved by the transitions
+		// Same bounds as FVoxelMesherUtilities::GetTranslatedTransvoxel
+		const float LowerBound = Mesher.Step;
+		const float UpperBound = (RENDER_CHUNK_SIZE - 1) * Mesher.Step;
+
+		TArray<FVector> Positions;
+		Positions.Reserve(MesherVertices.Num());
+		TBitArray<> LockedVertices;
+		LockedVertices.Reserve(MesherVertices.Num());
+		for (auto& Vertex : MesherVertices)
+		{
+			const FVector& Position = Vertex.Position;
+			Positions.Add(Position);
+			LockedVertices.Add(
+				Position.X < LowerBound || Position.X > UpperBound ||
+				Position.Y < LowerBound || Position.Y > UpperBound ||
+				Position.Z < LowerBound || Position.Z > UpperBound);
+		}
+
+		FVoxelMeshSimplifier::Simplify(
+			Positions,
+			LockedVertices,
+			[&](int32 From, int32 To)
+			{
+				// The surviving vertex keeps its material
+				return MesherVertices[From].Material == MesherVertices[To].Material;
+			},
+			CVarSimplificationMaxError.GetValueOnAnyThread() * Mesher.Step,
+			Indices);
+
+		FVoxelMesherUtilities::RemoveUnusedVertices(Indices, MesherVertices);
+	}
+
 	static void FixupTangents(TArray<FVoxelMesherVertex>& MesherVertices)
 	{
 		if (CVarRandomizeTangents.GetValueOnAnyThread() != 0)
@@ -340,6 +396,11 @@ TVoxelSharedPtr<FVoxelChunkMesh> FVoxelMarchingCubeMesher::CreateFullChunkImpl(F
 	TArray<FVoxelMesherVertex> MesherVertices = FMarchingCubeHelpers::CreateMesherVertices(Vertices);
 
 	MESHER_TIME_MATERIALS(MesherVertices.Num(), FMarchingCubeHelpers::ComputeMaterials(*this, MesherVertices, Vertices));
+	if (FMarchingCubeHelpers::ShouldSimplify(*this))
+	{
+		// Before the normals, so that they are only computed for the vertices left
+		FMarchingCubeHelpers::Simplify(*this, MesherVertices, Indices);
+	}
 	MESHER_TIME(Normals, FMarchingCubeHelpers::ComputeNormals(*this, MesherVertices, Indices));
 
 	UnlockData();
@@ -451,8 +512,8 @@ bool FVoxelMarchingCubeMesher::CreateGeometryTemplate(FVoxelMesherTimes& Times,
 		// Account for normals
 		BoundsToQuery = BoundsToQuery.Extend(1);
 	}
-	TVoxelQueryZone<FVoxelValue> QueryZone(BoundsToQuery, FIntVector(DataSize), LOD, CachedValues);
-	MESHER_TIME_VALUES(DataSize * DataSize * DataSize, Data.Get<FVoxelValue>(QueryZone, LOD));
+	MESHER_TIME_VALUES(DataSize * DataSize * DataSize, Settings.MesherValuesCache->GetValues(Data, BoundsToQuery.Min, DataSize, LOD, CachedValues));
+	QueriedValues = { BoundsToQuery, CachedValues };
 	
 	Accelerator = MakeUnique<FVoxelConstDataAccelerator>(Data, GetBoundsToLock());
 
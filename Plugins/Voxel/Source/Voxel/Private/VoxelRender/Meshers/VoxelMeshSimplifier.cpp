@@ -0,0 +1,439 @@
+// Copyright 2020 Phyronnaz
+
+#include "VoxelRender/Meshers/VoxelMeshSimplifier.h"
+#include "Math/RandomStream.h"
+#include "HAL/IConsoleManager.h"
+
+namespace FVoxelMeshSimplifierImpl
+{
+	// Symmetric 4x4 matrix: the squared distance to a set of planes is P^T Q P with P = (X, Y, Z, 1)
+	struct FQuadric
+	{
+		double XX = 0, XY = 0, XZ = 0, XW = 0;
+		double YY = 0, YZ = 0, YW = 0;
+		double ZZ = 0, ZW = 0;
+		double WW = 0;
+
+		FQuadric() = default;
+		// Plane of equation Normal.P + D = 0, Normal normalized
+		FQuadric(const FVector& Normal, float D)
+		{
+			const double A = Normal.X;
+			const double B = Normal.Y;
+			const double C = Normal.Z;
+			XX = A * A; XY = A * B; XZ = A * C; XW = A * D;
+			YY = B * B; YZ = B * C; YW = B * D;
+			ZZ = C * C; ZW = C * D;
+			WW = double(D) * D;
+		}
+
+		FORCEINLINE void operator+=(const FQuadric& Other)
+		{
+			XX += Other.XX; XY += Other.XY; XZ += Other.XZ; XW += Other.XW;
+			YY += Other.YY; YZ += Other.YZ; YW += Other.YW;
+			ZZ += Other.ZZ; ZW += Other.ZW;
+			WW += Other.WW;
+		}
+		FORCEINLINE FQuadric operator+(const FQuadric& Other) const
+		{
+			FQuadric Result = *this;
+			Result += Other;
+			return Result;
+		}
+
+		FORCEINLINE double Evaluate(const FVector& P) const
+		{
+			const double X = P.X;
+			const double Y = P.Y;
+			const double Z = P.Z;
+			const double Error =
+				XX * X * X + 2 * XY * X * Y + 2 * XZ * X * Z + 2 * XW * X +
+				YY * Y * Y + 2 * YZ * Y * Z + 2 * YW * Y +
+				ZZ * Z * Z + 2 * ZW * Z +
+				WW;
+			// Can be slightly negative because of float errors
+			return FMath::Max(Error, 0.);
+		}
+	};
+
+	struct FCandidate
+	{
+		double Error;
+		int32 From;
+		int32 To;
+		// Versions of the vertices when the error was computed
+		uint32 FromVersion;
+		uint32 ToVersion;
+
+		FORCEINLINE bool operator<(const FCandidate& Other) const
+		{
+			return Error < Other.Error;
+		}
+	};
+
+	// Cosine of the max rotation of a triangle normal allowed when collapsing
+	constexpr float MinNormalDot = 0.2f;
+}
+
+FVoxelMeshSimplifierStats FVoxelMeshSimplifier::Simplify(
+	const TArray<FVector>& Positions,
+	const TBitArray<>& LockedVertices,
+	TFunctionRef<bool(int32 From, int32 To)> CanCollapse,
+	float MaxError,
+	TArray<uint32>& Indices)
+{
+	VOXEL_ASYNC_FUNCTION_COUNTER();
+
+	using namespace FVoxelMeshSimplifierImpl;
+
+	check(Indices.Num() % 3 == 0);
+	check(LockedVertices.Num() == Positions.Num());
+
+	FVoxelMeshSimplifierStats Stats;
+
+	const int32 NumVertices = Positions.Num();
+	const int32 NumTriangles = Indices.Num() / 3;
+	const double MaxSquaredError = FMath::Square(double(MaxError));
+
+	TArray<FQuadric> Quadrics;
+	TArray<TArray<int32, TInlineAllocator<8>>> VertexTriangles;
+	TArray<uint32> Versions;
+	TBitArray<> RemovedTriangles(false, NumTriangles);
+	{
+		VOXEL_ASYNC_SCOPE_COUNTER("Build Quadrics");
+
+		Quadrics.SetNum(NumVertices);
+		VertexTriangles.SetNum(NumVertices);
+		Versions.SetNumZeroed(NumVertices);
+
+		for (int32 Triangle = 0; Triangle < NumTriangles; Triangle++)
+		{
+			const uint32 IndexA = Indices[3 * Triangle + 0];
+			const uint32 IndexB = Indices[3 * Triangle + 1];
+			const uint32 IndexC = Indices[3 * Triangle + 2];
+
+			const FVector& A = Positions[IndexA];
+			const FVector Normal = FVector::CrossProduct(Positions[IndexB] - A, Positions[IndexC] - A).GetSafeNormal();
+			const FQuadric Quadric(Normal, -FVector::DotProduct(Normal, A));
+
+			for (int32 Corner = 0; Corner < 3; Corner++)
+			{
+				const uint32 Index = Indices[3 * Triangle + Corner];
+				Quadrics[Index] += Quadric;
+				VertexTriangles[Index].Add(Triangle);
+			}
+		}
+	}
+
+	using FNeighbors = TArray<int32, TInlineAllocator<16>>;
+	const auto GetNeighbors = [&](int32 Vertex, FNeighbors& OutNeighbors)
+	{
+		OutNeighbors.Reset();
+		for (const int32 Triangle : VertexTriangles[Vertex])
+		{
+			for (int32 Corner = 0; Corner < 3; Corner++)
+			{
+				const int32 Neighbor = Indices[3 * Triangle + Corner];
+				if (Neighbor != Vertex)
+				{
+					OutNeighbors.AddUnique(Neighbor);
+				}
+			}
+		}
+	};
+
+	TArray<FCandidate> Heap;
+	const auto AddCandidate = [&](int32 From, int32 To)
+	{
+		if (LockedVertices[From])
+		{
+			return;
+		}
+		const double Error = (Quadrics[From] + Quadrics[To]).Evaluate(Positions[To]);
+		if (Error > MaxSquaredError)
+		{
+			return;
+		}
+		Heap.HeapPush(FCandidate{ Error, From, To, Versions[From], Versions[To] });
+	};
+
+	{
+		VOXEL_ASYNC_SCOPE_COUNTER("Build Candidates");
+		for (int32 Triangle = 0; Triangle < NumTriangles; Triangle++)
+		{
+			for (int32 Corner = 0; Corner < 3; Corner++)
+			{
+				const int32 IndexA = Indices[3 * Triangle + Corner];
+				const int32 IndexB = Indices[3 * Triangle + (Corner + 1) % 3];
+				// Each edge is in two triangles: add both directions once
+				if (IndexA < IndexB)
+				{
+					AddCandidate(IndexA, IndexB);
+					AddCandidate(IndexB, IndexA);
+				}
+			}
+		}
+	}
+
+	const auto IsValidCollapse = [&](int32 From, int32 To)
+	{
+		// Number of triangles using each edge of From
+		TArray<TPair<int32, int32>, TInlineAllocator<16>> EdgesCount;
+		int32 NumSharedTriangles = 0;
+		for (const int32 Triangle : VertexTriangles[From])
+		{
+			bool bContainsTo = false;
+			for (int32 Corner = 0; Corner < 3; Corner++)
+			{
+				const int32 Vertex = Indices[3 * Triangle + Corner];
+				if (Vertex == From)
+				{
+					continue;
+				}
+				bContainsTo |= Vertex == To;
+
+				auto* Count = EdgesCount.FindByPredicate([&](auto& It) { return It.Key == Vertex; });
+				if (Count)
+				{
+					Count->Value++;
+				}
+				else
+				{
+					EdgesCount.Emplace(Vertex, 1);
+				}
+			}
+
+			if (bContainsTo)
+			{
+				NumSharedTriangles++;
+				continue;
+			}
+
+			// The triangle is kept: check that it doesn't flip or become degenerate
+			FVector OldPositions[3];
+			FVector NewPositions[3];
+			for (int32 Corner = 0; Corner < 3; Corner++)
+			{
+				const int32 Vertex = Indices[3 * Triangle + Corner];
+				OldPositions[Corner] = Positions[Vertex];
+				NewPositions[Corner] = Positions[Vertex == From ? To : Vertex];
+			}
+			const FVector OldNormal = FVector::CrossProduct(OldPositions[1] - OldPositions[0], OldPositions[2] - OldPositions[0]).GetSafeNormal();
+			const FVector NewNormal = FVector::CrossProduct(NewPositions[1] - NewPositions[0], NewPositions[2] - NewPositions[0]).GetSafeNormal();
+			if (FVector::DotProduct(OldNormal, NewNormal) < MinNormalDot)
+			{
+				return false;
+			}
+		}
+
+		if (NumSharedTriangles == 0)
+		{
+			// Not an edge anymore
+			return false;
+		}
+
+		for (auto& It : EdgesCount)
+		{
+			if (It.Value < 2)
+			{
+				// From is on a hole border, removing it would change the border
+				return false;
+			}
+		}
+
+		// Link condition: the only neighbors From & To have in common must be the ones of the triangles they share,
+		// else the collapse creates non-manifold edges
+		FNeighbors ToNeighbors;
+		GetNeighbors(To, ToNeighbors);
+		int32 NumCommonNeighbors = 0;
+		for (auto& It : EdgesCount)
+		{
+			NumCommonNeighbors += ToNeighbors.Contains(It.Key);
+		}
+		return NumCommonNeighbors == NumSharedTriangles;
+	};
+
+	const auto Collapse = [&](int32 From, int32 To)
+	{
+		for (const int32 Triangle : VertexTriangles[From])
+		{
+			uint32* TriangleIndices = &Indices[3 * Triangle];
+			if (TriangleIndices[0] == uint32(To) || TriangleIndices[1] == uint32(To) || TriangleIndices[2] == uint32(To))
+			{
+				RemovedTriangles[Triangle] = true;
+				for (int32 Corner = 0; Corner < 3; Corner++)
+				{
+					const int32 Vertex = TriangleIndices[Corner];
+					if (Vertex != From)
+					{
+						VertexTriangles[Vertex].RemoveSwap(Triangle);
+					}
+				}
+			}
+			else
+			{
+				for (int32 Corner = 0; Corner < 3; Corner++)
+				{
+					if (TriangleIndices[Corner] == uint32(From))
+					{
+						TriangleIndices[Corner] = To;
+					}
+				}
+				VertexTriangles[To].Add(Triangle);
+			}
+		}
+		VertexTriangles[From].Empty();
+
+		Quadrics[To] += Quadrics[From];
+		Versions[From]++;
+		Versions[To]++;
+	};
+
+	{
+		VOXEL_ASYNC_SCOPE_COUNTER("Collapse");
+
+		FNeighbors Neighbors;
+		while (Heap.Num() > 0)
+		{
+			FCandidate Candidate;
+			Heap.HeapPop(Candidate, false);
+
+			if (Candidate.FromVersion != Versions[Candidate.From] ||
+				Candidate.ToVersion != Versions[Candidate.To])
+			{
+				// Outdated
+				continue;
+			}
+			if (!CanCollapse(Candidate.From, Candidate.To) || !IsValidCollapse(Candidate.From, Candidate.To))
+			{
+				Stats.NumRejectedCollapses++;
+				continue;
+			}
+
+			Collapse(Candidate.From, Candidate.To);
+			Stats.NumCollapses++;
+
+			GetNeighbors(Candidate.To, Neighbors);
+			for (const int32 Neighbor : Neighbors)
+			{
+				AddCandidate(Candidate.To, Neighbor);
+				AddCandidate(Neighbor, Candidate.To);
+			}
+		}
+	}
+
+	TArray<uint32> NewIndices;
+	NewIndices.Reserve(Indices.Num() - 3 * RemovedTriangles.CountSetBits());
+	for (int32 Triangle = 0; Triangle < NumTriangles; Triangle++)
+	{
+		if (!RemovedTriangles[Triangle])
+		{
+			NewIndices.Add(Indices[3 * Triangle + 0]);
+			NewIndices.Add(Indices[3 * Triangle + 1]);
+			NewIndices.Add(Indices[3 * Triangle + 2]);
+		}
+	}
+	Indices = MoveTemp(NewIndices);
+
+	return Stats;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+static FAutoConsoleCommand CmdTestMeshSimplifier(
+	TEXT("voxel.mesher.TestSimplification"),
+	TEXT("Simplifies random terrain chunks and logs the triangle reduction & the max distance from the original vertices to the simplified mesh. Args: NumTests (default 16), MaxError in voxels (default 0.25), LOD (default 4)"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 NumTests = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 16;
+		const float MaxErrorInVoxels = Args.Num() > 1 ? FCString::Atof(*Args[1]) : 0.25f;
+		const int32 LOD = Args.Num() > 2 ? FCString::Atoi(*Args[2]) : 4;
+
+		const int32 Step = 1 << LOD;
+		const int32 NumSamples = RENDER_CHUNK_SIZE + 1;
+
+		int64 NumTrianglesBefore = 0;
+		int64 NumTrianglesAfter = 0;
+		float MaxDistance = 0;
+		int32 NumBrokenBorders = 0;
+		double Time = 0;
+
+		for (int32 Seed = 0; Seed < NumTests; Seed++)
+		{
+			FRandomStream Stream(Seed);
+
+			// Flat plateaus with hills in between, like distant terrain
+			const float Frequency = Stream.FRandRange(0.05f, 0.2f);
+			const float Amplitude = Stream.FRandRange(0.f, 4.f) * Step;
+			const float PlateauHeight = Stream.FRandRange(-1.f, 1.f) * Amplitude;
+
+			TArray<FVector> Positions;
+			TBitArray<> LockedVertices;
+			for (int32 Y = 0; Y < NumSamples; Y++)
+			{
+				for (int32 X = 0; X < NumSamples; X++)
+				{
+					const float Height = FMath::Max(PlateauHeight, Amplitude * FMath::Sin(X * Frequency) * FMath::Cos(Y * Frequency));
+					Positions.Add(FVector(X * Step, Y * Step, Height));
+					// Same as FMarchingCubeHelpers::Simplify
+					LockedVertices.Add(X < 1 || Y < 1 || X > RENDER_CHUNK_SIZE - 1 || Y > RENDER_CHUNK_SIZE - 1);
+				}
+			}
+
+			TArray<uint32> Indices;
+			for (int32 Y = 0; Y < NumSamples - 1; Y++)
+			{
+				for (int32 X = 0; X < NumSamples - 1; X++)
+				{
+					const uint32 Index = X + Y * NumSamples;
+					Indices.Append({ Index, Index + NumSamples, Index + 1 });
+					Indices.Append({ Index + 1, Index + NumSamples, Index + 1 + NumSamples });
+				}
+			}
+			const TArray<uint32> OriginalIndices = Indices;
+
+			const double StartTime = FPlatformTime::Seconds();
+			FVoxelMeshSimplifier::Simplify(Positions, LockedVertices, [](int32, int32) { return true; }, MaxErrorInVoxels * Step, Indices);
+			Time += FPlatformTime::Seconds() - StartTime;
+
+			NumTrianglesBefore += OriginalIndices.Num() / 3;
+			NumTrianglesAfter += Indices.Num() / 3;
+
+			TBitArray<> UsedVertices(false, Positions.Num());
+			for (const uint32 Index : Indices)
+			{
+				UsedVertices[Index] = true;
+			}
+			for (int32 Index = 0; Index < Positions.Num(); Index++)
+			{
+				NumBrokenBorders += LockedVertices[Index] && !UsedVertices[Index];
+			}
+
+			// Distance from each original vertex to the simplified surface
+			for (const FVector& Position : Positions)
+			{
+				float Distance = MAX_flt;
+				for (int32 Index = 0; Index < Indices.Num(); Index += 3)
+				{
+					const FVector Closest = FMath::ClosestPointOnTriangleToPoint(
+						Position,
+						Positions[Indices[Index + 0]],
+						Positions[Indices[Index + 1]],
+						Positions[Indices[Index + 2]]);
+					Distance = FMath::Min(Distance, FVector::Dist(Position, Closest));
+				}
+				MaxDistance = FMath::Max(MaxDistance, Distance);
+			}
+		}
+
+		LOG_VOXEL(Log, TEXT("TestSimplification: %lld triangles -> %lld (%.1f%% removed). Max error: %f voxels (allowed: %f). %d border vertices removed. Time: %.3fms per chunk"),
+			NumTrianglesBefore,
+			NumTrianglesAfter,
+			NumTrianglesBefore == 0 ? 0. : 100. * (NumTrianglesBefore - NumTrianglesAfter) / NumTrianglesBefore,
+			MaxDistance / Step,
+			MaxErrorInVoxels,
+			NumBrokenBorders,
+			Time * 1000 / FMath::Max(1, NumTests));
+	}));
@@ -0,0 +1,35 @@
+// Copyright 2020 Phyronnaz
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VoxelMinimal.h"
+
+struct FVoxelMeshSimplifierStats
+{
+	int32 NumCollapses = 0;
+	int32 NumRejectedCollapses = 0;
+};
+
+struct FVoxelMeshSimplifier
+{
+public:
+	/**
+	 * Error bounded quadric edge collapse (Garland & Heckbert)
+	 * Edges are collapsed on one of their vertices, so vertices are never moved and attributes never need to be interpolated
+	 * The error of a vertex is the sum of its squared distances to the planes of the original triangles it replaces:
+	 * collapses are done, cheapest first, as long as this error is below MaxError^2
+	 *
+	 * @param	Positions		Vertex positions
+	 * @param	LockedVertices	Vertices that must not be removed, eg on chunk borders
+	 * @param	CanCollapse		(From, To): whether From can be merged into To, eg if they have the same material
+	 * @param	MaxError		Max distance to the original planes
+	 * @param	Indices			Triangles, simplified in place. Removed vertices are not referenced anymore, see FVoxelMesherUtilities::RemoveUnusedVertices
+	 */
+	static FVoxelMeshSimplifierStats Simplify(
+		const TArray<FVector>& Positions,
+		const TBitArray<>& LockedVertices,
+		TFunctionRef<bool(int32 From, int32 To)> CanCollapse,
+		float MaxError,
+		TArray<uint32>& Indices);
+};
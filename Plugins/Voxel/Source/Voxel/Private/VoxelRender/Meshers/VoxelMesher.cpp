@@ -290,7 +290,8 @@ void FVoxelMesherBase::FinishCreatingChunk(FVoxelChunkMesh& Chunk) const
 	}
 	Chunk.IterateBuffers([](FVoxelChunkMeshBuffers& Buffer) { Buffer.Shrink(); });
 	Chunk.IterateBuffers([](FVoxelChunkMeshBuffers& Buffer) { Buffer.ComputeBounds(); });
-	Chunk.IterateBuffers([](FVoxelChunkMeshBuffers& Buffer) { Buffer.Guid = FGuid::NewGuid(); });
+	// Sets the guids
+	Settings.ChunkMeshDeduplicator->Deduplicate(Chunk, bIsTransitions);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -341,7 +342,7 @@ TVoxelSharedPtr<FVoxelChunkMesh> FVoxelMesher::CreateFullChunk()
 			if (LOD <= Settings.MaxDistanceFieldLOD)
 			{
 				MESHER_TIME_SCOPE(DistanceField)
-				Chunk->BuildDistanceField(LOD, ChunkPosition, Data, Settings);
+				Chunk->BuildDistanceField(LOD, ChunkPosition, Data, Settings, QueriedValues);
 			}
 		}
 
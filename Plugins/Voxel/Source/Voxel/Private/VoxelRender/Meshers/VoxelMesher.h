@@ -5,9 +5,9 @@
 #include "CoreMinimal.h"
 #include "VoxelIntBox.h"
 #include "VoxelMinimal.h"
+#include "VoxelRender/VoxelChunkMesh.h"
 
 struct FVoxelRendererSettings;
-struct FVoxelChunkMesh;
 class FVoxelData;
 class FVoxelDataLockInfo;
 
@@ -27,8 +27,9 @@ struct FVoxelScopedMesherTime
 	}
 };
 
-#define MESHER_TIME_SCOPE(Time) FVoxelScopedMesherTime LocalScope(Times.Time);
-#define MESHER_TIME(Time, X) { FVoxelScopedMesherTime LocalScope(Times.Time); X; }
+// Also recorded by FVoxelTrace. Values & materials accesses are not, as they are too frequent
+#define MESHER_TIME_SCOPE(Time) FVoxelScopedMesherTime LocalScope(Times.Time); VOXEL_TRACE_SCOPE(Mesher, TEXT("Mesher " #Time));
+#define MESHER_TIME(Time, X) { FVoxelScopedMesherTime LocalScope(Times.Time); VOXEL_TRACE_SCOPE(Mesher, TEXT("Mesher " #Time)); X; }
 #define MESHER_TIME_RETURN(Time, X) [&]() { FVoxelScopedMesherTime LocalScope(Times.Time); return X; }()
 
 #define MESHER_TIME_SCOPE_VALUES(Count) FVoxelScopedMesherTime LocalScope(Times._Values); Times._ValuesAccesses += Count;
@@ -91,11 +92,20 @@ public:
 	
 	TVoxelSharedPtr<FVoxelChunkMesh> CreateEmptyChunk() const;
 
+	// Valid until the mesher is destroyed
+	inline const FVoxelChunkMeshKnownValues& GetQueriedValues() const
+	{
+		return QueriedValues;
+	}
+
 protected:
 	virtual FVoxelIntBox GetBoundsToCheckIsEmptyOn() const = 0;
 	virtual FVoxelIntBox GetBoundsToLock() const = 0;
 
 	void UnlockData();
+
+	// Set by the implementations once they have queried their values, used to build the distance field
+	FVoxelChunkMeshKnownValues QueriedValues;
 	
 private:
 	TUniquePtr<FVoxelDataLockInfo> LockInfo;
@@ -0,0 +1,236 @@
+// Copyright 2020 Phyronnaz
+
+#include "VoxelRender/Meshers/VoxelMesherValuesCache.h"
+#include "VoxelData/VoxelDataIncludes.h"
+#include "VoxelQueryZone.h"
+
+#include "Misc/ScopeLock.h"
+#include "HAL/IConsoleManager.h"
+
+DEFINE_VOXEL_MEMORY_STAT(STAT_VoxelMesherValuesCacheMemory);
+
+TAutoConsoleVariable<int32> CVarMesherValuesCacheSize(
+	TEXT("voxel.mesher.ValuesCacheSize"),
+	128,
+	TEXT("Number of blocks of values each renderer keeps so that neighboring chunks can reuse the borders they have in common, instead of querying them again. ")
+	TEXT("A marching cubes block is around 85kB. The blocks are freed once the renderer has no mesh tasks left. 0 to disable.\n")
+	TEXT("Only read when the renderer is created"),
+	ECVF_Default);
+
+static FThreadSafeCounter64 GlobalNumQueries;
+static FThreadSafeCounter64 GlobalNumNeighborHits;
+static FThreadSafeCounter64 GlobalNumQueriedValues;
+static FThreadSafeCounter64 GlobalNumReusedValues;
+
+static FAutoConsoleCommand LogMesherValuesCacheStatsCmd(
+	TEXT("voxel.mesher.LogValuesCacheStats"),
+	TEXT("Log how many values the meshers reused from their neighbors since the last call, see voxel.mesher.ValuesCacheSize"),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		const FVoxelMesherValuesCacheStats Stats = FVoxelMesherValuesCache::GetGlobalStats();
+		LOG_VOXEL(Log, TEXT("Mesher values cache: %lld queries, %lld neighbor blocks reused, %lld values queried, %lld values reused (%.1f%%)"),
+			Stats.NumQueries,
+			Stats.NumNeighborHits,
+			Stats.NumQueriedValues,
+			Stats.NumReusedValues,
+			Stats.GetReuseRate() * 100);
+		FVoxelMesherValuesCache::ResetGlobalStats();
+	}));
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+FVoxelMesherValuesCache::FVoxelMesherValuesCache(int32 MaxBlocks)
+	: bEnabled(MaxBlocks > 0)
+	, Blocks(FMath::Max(1, MaxBlocks))
+{
+}
+
+FVoxelMesherValuesCache::~FVoxelMesherValuesCache()
+{
+	Clear();
+}
+
+void FVoxelMesherValuesCache::GetValues(const FVoxelData& Data, const FIntVector& Min, int32 Size, int32 LOD, FVoxelValue* RESTRICT Values)
+{
+	VOXEL_ASYNC_FUNCTION_COUNTER();
+
+	const int32 Step = 1 << LOD;
+	const int32 Num = Size * Size * Size;
+	const FVoxelIntBox Bounds(Min, Min + Size * Step);
+
+	if (!bEnabled || Size <= RENDER_CHUNK_SIZE)
+	{
+		TVoxelQueryZone<FVoxelValue> QueryZone(Bounds, FIntVector(Size), LOD, Values);
+		Data.Get<FVoxelValue>(QueryZone, LOD);
+		return;
+	}
+
+	// Read under the caller lock: if it matches the counter of the blocks, their values in our bounds are still valid
+	const uint64 DataModificationCounter = Data.GetModificationCounter();
+
+	// Neighbors along -X, +X, -Y, +Y, -Z, +Z
+	FBlock Neighbors[6];
+	{
+		FScopeLock Lock(&Section);
+		if (UpdateModificationCounter_Locked(DataModificationCounter))
+		{
+			for (int32 Direction = 0; Direction < 6; Direction++)
+			{
+				FIntVector NeighborMin = Min;
+				NeighborMin[Direction / 2] += (Direction % 2 == 0 ? -1 : 1) * RENDER_CHUNK_SIZE * Step;
+				if (const FBlock* Block = Blocks.FindAndTouch(FKey{ NeighborMin, Size, LOD }))
+				{
+					Neighbors[Direction] = *Block;
+				}
+			}
+		}
+	}
+
+	// Values left to query, in local coordinates. Max is exclusive
+	FIntVector QueryMin(0);
+	FIntVector QueryMax(Size);
+
+	const int32 Overlap = Size - RENDER_CHUNK_SIZE;
+	int32 NumNeighborHits = 0;
+	{
+		VOXEL_ASYNC_SCOPE_COUNTER("Copy Neighbors");
+		for (int32 Direction = 0; Direction < 6; Direction++)
+		{
+			const FBlock& Neighbor = Neighbors[Direction];
+			if (!Neighbor.IsValid())
+			{
+				continue;
+			}
+			NumNeighborHits++;
+
+			const int32 Axis = Direction / 2;
+			const bool bIsMin = Direction % 2 == 0;
+
+			// The slab we copy, in our local coordinates
+			FIntVector SlabMin(0);
+			FIntVector SlabMax(Size);
+			if (bIsMin)
+			{
+				SlabMax[Axis] = Overlap;
+				QueryMin[Axis] = Overlap;
+			}
+			else
+			{
+				SlabMin[Axis] = RENDER_CHUNK_SIZE;
+				QueryMax[Axis] = RENDER_CHUNK_SIZE;
+			}
+			// Offset to add to our local coordinates to get the neighbor ones
+			FIntVector NeighborOffset(0);
+			NeighborOffset[Axis] = bIsMin ? RENDER_CHUNK_SIZE : -RENDER_CHUNK_SIZE;
+			const int32 NeighborIndexOffset = NeighborOffset.X + NeighborOffset.Y * Size + NeighborOffset.Z * Size * Size;
+
+			const FVoxelValue* RESTRICT NeighborValues = Neighbor->GetData();
+			const int32 RowSize = SlabMax.X - SlabMin.X;
+			for (int32 Z = SlabMin.Z; Z < SlabMax.Z; Z++)
+			{
+				for (int32 Y = SlabMin.Y; Y < SlabMax.Y; Y++)
+				{
+					const int32 Index = SlabMin.X + Y * Size + Z * Size * Size;
+					checkVoxelSlow(0 <= Index + NeighborIndexOffset && Index + NeighborIndexOffset + RowSize <= Num);
+					FMemory::Memcpy(Values + Index, NeighborValues + Index + NeighborIndexOffset, RowSize * sizeof(FVoxelValue));
+				}
+			}
+		}
+	}
+
+	int64 NumQueriedValues = 0;
+	{
+		const FIntVector QuerySize = QueryMax - QueryMin;
+		if (QuerySize.X > 0 && QuerySize.Y > 0 && QuerySize.Z > 0)
+		{
+			NumQueriedValues = int64(QuerySize.X) * QuerySize.Y * QuerySize.Z;
+
+			TVoxelQueryZone<FVoxelValue> QueryZone(Bounds, FIntVector(Size), LOD, Values);
+			auto LocalQueryZone = QueryZone.ShrinkTo(FVoxelIntBox(Min + QueryMin * Step, Min + QueryMax * Step));
+			Data.Get<FVoxelValue>(LocalQueryZone, LOD);
+		}
+	}
+
+	GlobalNumQueries.Increment();
+	GlobalNumNeighborHits.Add(NumNeighborHits);
+	GlobalNumQueriedValues.Add(NumQueriedValues);
+	GlobalNumReusedValues.Add(Num - NumQueriedValues);
+
+	// Copy outside of the lock
+	const FBlock Block = MakeVoxelShared<TArray<FVoxelValue>>(Values, Num);
+
+	FScopeLock Lock(&Section);
+	if (!UpdateModificationCounter_Locked(DataModificationCounter))
+	{
+		// The data was modified since we queried our values
+		return;
+	}
+
+	const FKey Key{ Min, Size, LOD };
+	if (const FBlock* ExistingBlock = Blocks.Find(Key))
+	{
+		AllocatedSize -= (*ExistingBlock)->GetAllocatedSize();
+		DEC_VOXEL_MEMORY_STAT_BY(STAT_VoxelMesherValuesCacheMemory, (*ExistingBlock)->GetAllocatedSize());
+	}
+	else if (Blocks.Num() >= Blocks.Max())
+	{
+		const FBlock RemovedBlock = Blocks.RemoveLeastRecent();
+		AllocatedSize -= RemovedBlock->GetAllocatedSize();
+		DEC_VOXEL_MEMORY_STAT_BY(STAT_VoxelMesherValuesCacheMemory, RemovedBlock->GetAllocatedSize());
+	}
+	AllocatedSize += Block->GetAllocatedSize();
+	INC_VOXEL_MEMORY_STAT_BY(STAT_VoxelMesherValuesCacheMemory, Block->GetAllocatedSize());
+	Blocks.Add(Key, Block);
+}
+
+void FVoxelMesherValuesCache::Clear()
+{
+	FScopeLock Lock(&Section);
+	Empty_Locked();
+}
+
+FVoxelMesherValuesCacheStats FVoxelMesherValuesCache::GetGlobalStats()
+{
+	FVoxelMesherValuesCacheStats Stats;
+	Stats.NumQueries = GlobalNumQueries.GetValue();
+	Stats.NumNeighborHits = GlobalNumNeighborHits.GetValue();
+	Stats.NumQueriedValues = GlobalNumQueriedValues.GetValue();
+	Stats.NumReusedValues = GlobalNumReusedValues.GetValue();
+	return Stats;
+}
+
+void FVoxelMesherValuesCache::ResetGlobalStats()
+{
+	GlobalNumQueries.Reset();
+	GlobalNumNeighborHits.Reset();
+	GlobalNumQueriedValues.Reset();
+	GlobalNumReusedValues.Reset();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+bool FVoxelMesherValuesCache::UpdateModificationCounter_Locked(uint64 NewModificationCounter)
+{
+	if (NewModificationCounter < ModificationCounter)
+	{
+		// Another thread already saw a newer data
+		return false;
+	}
+	if (NewModificationCounter > ModificationCounter)
+	{
+		Empty_Locked();
+		ModificationCounter = NewModificationCounter;
+	}
+	return true;
+}
+
+void FVoxelMesherValuesCache::Empty_Locked()
+{
+	DEC_VOXEL_MEMORY_STAT_BY(STAT_VoxelMesherValuesCacheMemory, AllocatedSize);
+	AllocatedSize = 0;
+	Blocks.Empty(Blocks.Max());
+}
@@ -0,0 +1,88 @@
+// Copyright 2020 Phyronnaz
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VoxelMinimal.h"
+#include "VoxelValue.h"
+#include "Containers/LruCache.h"
+#include "HAL/ConsoleManager.h"
+
+class FVoxelData;
+
+DECLARE_VOXEL_MEMORY_STAT(TEXT("Voxel Mesher Values Cache Memory"), STAT_VoxelMesherValuesCacheMemory, STATGROUP_VoxelMemory, VOXEL_API);
+
+extern TAutoConsoleVariable<int32> CVarMesherValuesCacheSize;
+
+struct FVoxelMesherValuesCacheStats
+{
+	int64 NumQueries = 0;
+	// Neighbor blocks the borders were copied from
+	int64 NumNeighborHits = 0;
+	int64 NumQueriedValues = 0;
+	int64 NumReusedValues = 0;
+
+	double GetReuseRate() const
+	{
+		return NumQueriedValues + NumReusedValues == 0 ? 0. : double(NumReusedValues) / double(NumQueriedValues + NumReusedValues);
+	}
+};
+
+/**
+ * Short lived cache of the blocks of values queried by the meshers
+ * Neighboring chunks of the same LOD query blocks that overlap on their borders (3 voxels for marching cubes at LOD 0):
+ * when meshing a chunk, the overlap is copied from the blocks of its 6 neighbors if they are still in the cache,
+ * and only the rest of the block is queried from the data
+ * The cache is emptied as soon as the data is modified, see FVoxelData::GetModificationCounter,
+ * and by the renderer once all its mesh tasks are done, so it only lives for a meshing wave
+ * Thread safe
+ */
+class FVoxelMesherValuesCache
+{
+public:
+	// MaxBlocks: 0 to disable the cache
+	explicit FVoxelMesherValuesCache(int32 MaxBlocks);
+	~FVoxelMesherValuesCache();
+
+	/**
+	 * Query the Size^3 values starting at Min with a step of 1 << LOD. Same as FVoxelData::Get with a query zone
+	 * Data must be locked for read on these bounds
+	 */
+	void GetValues(const FVoxelData& Data, const FIntVector& Min, int32 Size, int32 LOD, FVoxelValue* RESTRICT Values);
+
+	void Clear();
+
+	// Stats of all the caches since the last reset
+	static FVoxelMesherValuesCacheStats GetGlobalStats();
+	static void ResetGlobalStats();
+
+private:
+	struct FKey
+	{
+		FIntVector Min;
+		int32 Size = 0;
+		int32 LOD = 0;
+
+		FORCEINLINE bool operator==(const FKey& Other) const
+		{
+			return Min == Other.Min && Size == Other.Size && LOD == Other.LOD;
+		}
+		FORCEINLINE friend uint32 GetTypeHash(const FKey& Key)
+		{
+			return HashCombine(HashCombine(GetTypeHash(Key.Min), GetTypeHash(Key.Size)), GetTypeHash(Key.LOD));
+		}
+	};
+	using FBlock = TVoxelSharedPtr<const TArray<FVoxelValue>>;
+
+	const bool bEnabled;
+
+	FCriticalSection Section;
+	TLruCache<FKey, FBlock> Blocks;
+	int64 AllocatedSize = 0;
+	// Modification counter of the data when the blocks were queried
+	uint64 ModificationCounter = 0;
+
+	// Empty the blocks if the data was modified. Returns false if the blocks are newer than ModificationCounter
+	bool UpdateModificationCounter_Locked(uint64 NewModificationCounter);
+	void Empty_Locked();
+};
@@ -1,9 +1,16 @@
 // Copyright 2020 Phyronnaz
 
 #include "VoxelRender/Meshers/VoxelSurfaceNetMesher.h"
+#include "VoxelRender/Meshers/VoxelMarchingCubeMesher.h"
 #include "VoxelRender/Meshers/VoxelMesherUtilities.h"
+#include "VoxelRender/Meshers/VoxelMesherValuesCache.h"
 #include "VoxelRender/IVoxelRenderer.h"
 #include "VoxelData/VoxelDataIncludes.h"
+#include "VoxelWorld.h"
+
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
 
 /**
  * This code is based on an original implementation kindly provided by Dexyfex
@@ -110,8 +117,8 @@ void FVoxelSurfaceNetMesher::CreateGeometryTemplate(FVoxelMesherTimes& Times, TA
 {
 	VOXEL_ASYNC_FUNCTION_COUNTER();
 
-	TVoxelQueryZone<FVoxelValue> QueryZone(GetBoundsToCheckIsEmptyOn(), FIntVector(SN_EXTENDED_CHUNK_SIZE), LOD, CachedValues);
-	MESHER_TIME_VALUES(SN_EXTENDED_CHUNK_SIZE * SN_EXTENDED_CHUNK_SIZE * SN_EXTENDED_CHUNK_SIZE, Data.Get<FVoxelValue>(QueryZone, LOD));
+	MESHER_TIME_VALUES(SN_EXTENDED_CHUNK_SIZE * SN_EXTENDED_CHUNK_SIZE * SN_EXTENDED_CHUNK_SIZE, Settings.MesherValuesCache->GetValues(Data, GetBoundsToCheckIsEmptyOn().Min, SN_EXTENDED_CHUNK_SIZE, LOD, CachedValues));
+	QueriedValues = { GetBoundsToCheckIsEmptyOn(), CachedValues };
 
 	Accelerator = MakeUnique<FVoxelConstDataAccelerator>(Data, GetBoundsToLock());
 
@@ -188,10 +195,71 @@ void FVoxelSurfaceNetMesher::CreateGeometryTemplate(FVoxelMesherTimes& Times, TA
 	constexpr uint32 Offsets[3] = { 1, SN_EXTENDED_CHUNK_SIZE, SN_EXTENDED_CHUNK_SIZE * SN_EXTENDED_CHUNK_SIZE };
 	const FIntVector icorners[3] = { {1,0,0},{0,1,0},{0,0,1} };
 
+	// One bit per value, set if the value is empty. SN_EXTENDED_CHUNK_SIZE values fit in an uint64,
+	// so that the signs of a whole row of edges or cells can be classified with a few bit operations
+	static_assert(SN_EXTENDED_CHUNK_SIZE < 64, "");
+	if (!bScalarClassification)
 	{
-		VOXEL_ASYNC_SCOPE_COUNTER("Find Intersections");
+		VOXEL_ASYNC_SCOPE_COUNTER("Classify Values");
+
+		for (int32 Row = 0; Row < SN_EXTENDED_CHUNK_SIZE * SN_EXTENDED_CHUNK_SIZE; Row++)
+		{
+			const FVoxelValue* RowValues = CachedValues + Row * SN_EXTENDED_CHUNK_SIZE;
+			uint64 Bits = 0;
+			for (int32 LX = 0; LX < SN_EXTENDED_CHUNK_SIZE; LX++)
+			{
+				Bits |= uint64(RowValues[LX].IsEmpty()) << LX;
+			}
+			EmptyBits[Row] = Bits;
+		}
+	}
+
+	// Only called on edges with a sign change
+	const auto ComputeEdgeFactor = [&](int32 LX, int32 LY, int32 LZ, uint32 Direction) -> float
+	{
+		const uint32 VoxelIndex = LX + LY * SN_EXTENDED_CHUNK_SIZE + LZ * SN_EXTENDED_CHUNK_SIZE * SN_EXTENDED_CHUNK_SIZE;
+		FVoxelValue MinValue = CachedValues[VoxelIndex];
+		FVoxelValue MaxValue = CachedValues[VoxelIndex + Offsets[Direction]];
+		checkVoxelSlow(MinValue.IsEmpty() != MaxValue.IsEmpty());
+
+		if (LOD != 0)
+		{
+			// for LOD chunks, search along the edge for the actual intersecting segment
+			FIntVector MinPosition = FIntVector(LX, LY, LZ) * Step;
+			FIntVector MaxPosition = MinPosition + icorners[Direction] * Step;
+			float c1 = 0;
+			float c2 = 1;
+			for (int iStep = Step; iStep > 1; iStep >>= 1)
+			{
+				const float cmid = (c1 + c2) * 0.5f;
+				const FIntVector MidPosition = (MinPosition + MaxPosition) / 2;
+				const FVoxelValue MidValue = MESHER_TIME_RETURN_VALUES(1, Accelerator->Get<FVoxelValue>(MidPosition + ChunkPosition, LOD));
+				if (MinValue.IsEmpty() != MidValue.IsEmpty())//intersection is between c1 and cmid
+				{
+					c2 = cmid;
+					MaxValue = MidValue;
+					MaxPosition = MidPosition;
+				}
+				else //intersection is between cmid and c2
+				{
+					c1 = cmid;
+					MinValue = MidValue;
+					MinPosition = MidPosition;
+				}
+			}
+			// TODO is this needed
+			return c1 + (c2 - c1) * MinValue.ToFloat() / (MinValue.ToFloat() - MaxValue.ToFloat());
+		}
+		else
+		{
+			return MinValue.ToFloat() / (MinValue.ToFloat() - MaxValue.ToFloat());
+		}
+	};
+
+	if (bScalarClassification)
+	{
+		VOXEL_ASYNC_SCOPE_COUNTER("Find Intersections Scalar");
 
-		// find intersections and calculate the edge blend factors for all cells
 		for (int32 LZ = 0; LZ < SN_EXTENDED_CHUNK_SIZE; LZ++)
 		{
 			for (int32 LY = 0; LY < SN_EXTENDED_CHUNK_SIZE; LY++)
@@ -199,262 +267,283 @@ void FVoxelSurfaceNetMesher::CreateGeometryTemplate(FVoxelMesherTimes& Times, TA
 				for (int32 LX = 0; LX < SN_EXTENDED_CHUNK_SIZE; LX++)
 				{
 					const uint32 VoxelIndex = LX + LY * SN_EXTENDED_CHUNK_SIZE + LZ * SN_EXTENDED_CHUNK_SIZE * SN_EXTENDED_CHUNK_SIZE;
-					const FVoxelValue MinCornerValue = CachedValues[VoxelIndex];
-					FIntVector MinCornerPosition = FIntVector(LX, LY, LZ) * Step;
-					FIntVector MaxCornerPositions = FIntVector(LX + 1, LY + 1, LZ + 1);
+					const FIntVector MaxCornerPositions(LX + 1, LY + 1, LZ + 1);
 
 					for (uint32 Direction = 0; Direction < 3; Direction++)
 					{
 						float Factor = -1; // empty value, valid factor should be between 0 and 1
-						if (MaxCornerPositions[Direction] < SN_EXTENDED_CHUNK_SIZE) // don't go outside of the cached area
+						if (MaxCornerPositions[Direction] < SN_EXTENDED_CHUNK_SIZE && // don't go outside of the cached area
+							CachedValues[VoxelIndex].IsEmpty() != CachedValues[VoxelIndex + Offsets[Direction]].IsEmpty())
 						{
-							const FVoxelValue MaxCornerInDirectionValue = CachedValues[VoxelIndex + Offsets[Direction]];
-							if (MinCornerValue.IsEmpty() != MaxCornerInDirectionValue.IsEmpty())
-							{
-								FVoxelValue MinValue = MinCornerValue;
-								FVoxelValue MaxValue = MaxCornerInDirectionValue;
-
-								if (LOD != 0)
-								{
-									// for LOD chunks, search along the edge for the actual intersecting segment
-									FIntVector MinPosition = MinCornerPosition;
-									FIntVector MaxPosition = MinCornerPosition + icorners[Direction] * Step;
-									float c1 = 0;
-									float c2 = 1;
-									for (int iStep = Step; iStep > 1; iStep >>= 1)
-									{
-										const float cmid = (c1 + c2) * 0.5f;
-										const FIntVector MidPosition = (MinPosition + MaxPosition) / 2;
-										const FVoxelValue MidValue = MESHER_TIME_RETURN_VALUES(1, Accelerator->Get<FVoxelValue>(MidPosition + ChunkPosition, LOD));
-										if (MinValue.IsEmpty() != MidValue.IsEmpty())//intersection is between c1 and cmid
-										{
-											c2 = cmid;
-											MaxValue = MidValue;
-											MaxPosition = MidPosition;
-										}
-										else //intersection is between cmid and c2
-										{
-											c1 = cmid;
-											MinValue = MidValue;
-											MinPosition = MidPosition;
-										}
-									}
-									// TODO is this needed
-									Factor = c1 + (c2 - c1) * MinValue.ToFloat() / (MinValue.ToFloat() - MaxValue.ToFloat());
-								}
-								else
-								{
-									Factor = MinValue.ToFloat() / (MinValue.ToFloat() - MaxValue.ToFloat());
-								}
-							}
+							Factor = ComputeEdgeFactor(LX, LY, LZ, Direction);
 						}
 						EdgeFactors[3 * VoxelIndex + Direction] = Factor;
 					}
-					
-					if (TVertex::bComputeMaterial)
+				}
+			}
+		}
+	}
+	else
+	{
+		VOXEL_ASYNC_SCOPE_COUNTER("Find Intersections");
+
+		// -1 is the empty value, valid factors are between 0 and 1
+		{
+			constexpr int32 NumEdgeFactors = SN_EXTENDED_CHUNK_SIZE * SN_EXTENDED_CHUNK_SIZE * SN_EXTENDED_CHUNK_SIZE * 3;
+			const VectorRegister EmptyFactor = VectorSetFloat1(-1.f);
+			int32 Index = 0;
+			for (; Index + 4 <= NumEdgeFactors; Index += 4)
+			{
+				VectorStore(EmptyFactor, EdgeFactors + Index);
+			}
+			for (; Index < NumEdgeFactors; Index++)
+			{
+				EdgeFactors[Index] = -1.f;
+			}
+		}
+
+		// find intersections and calculate the edge blend factors for all cells
+		// Most edges don't have any, so only the set bits of the row sign changes are visited
+		for (int32 LZ = 0; LZ < SN_EXTENDED_CHUNK_SIZE; LZ++)
+		{
+			for (int32 LY = 0; LY < SN_EXTENDED_CHUNK_SIZE; LY++)
+			{
+				const int32 Row = LY + LZ * SN_EXTENDED_CHUNK_SIZE;
+				const uint64 Bits = EmptyBits[Row];
+
+				// don't go outside of the cached area
+				uint64 SignChanges[3];
+				SignChanges[0] = (Bits ^ (Bits >> 1)) & ((uint64(1) << (SN_EXTENDED_CHUNK_SIZE - 1)) - 1);
+				SignChanges[1] = LY + 1 < SN_EXTENDED_CHUNK_SIZE ? Bits ^ EmptyBits[Row + 1] : 0;
+				SignChanges[2] = LZ + 1 < SN_EXTENDED_CHUNK_SIZE ? Bits ^ EmptyBits[Row + SN_EXTENDED_CHUNK_SIZE] : 0;
+
+				for (uint32 Direction = 0; Direction < 3; Direction++)
+				{
+					for (uint64 Edges = SignChanges[Direction]; Edges != 0; Edges &= Edges - 1)
 					{
-						// We need to find the min value that's a surface value
-						if (LX < SN_EXTENDED_CHUNK_SIZE - 1 && 
-							LY < SN_EXTENDED_CHUNK_SIZE - 1 &&
-							LZ < SN_EXTENDED_CHUNK_SIZE - 1)
-						{
-							FVoxelValue VoxelValues[8];
-							VoxelValues[0] = CachedValues[VoxelIndex];
-							VoxelValues[1] = CachedValues[VoxelIndex + 1];
-							VoxelValues[2] = CachedValues[VoxelIndex + SN_EXTENDED_CHUNK_SIZE];
-							VoxelValues[3] = CachedValues[VoxelIndex + SN_EXTENDED_CHUNK_SIZE + 1];
-							VoxelValues[4] = CachedValues[VoxelIndex + SN_EXTENDED_CHUNK_SIZE * SN_EXTENDED_CHUNK_SIZE];
-							VoxelValues[5] = CachedValues[VoxelIndex + SN_EXTENDED_CHUNK_SIZE * SN_EXTENDED_CHUNK_SIZE + 1];
-							VoxelValues[6] = CachedValues[VoxelIndex + SN_EXTENDED_CHUNK_SIZE + SN_EXTENDED_CHUNK_SIZE * SN_EXTENDED_CHUNK_SIZE];
-							VoxelValues[7] = CachedValues[VoxelIndex + SN_EXTENDED_CHUNK_SIZE + SN_EXTENDED_CHUNK_SIZE * SN_EXTENDED_CHUNK_SIZE + 1];
-							
-							FVoxelValue MinValue = FVoxelValue::Empty();
-							int32 MinValueIndex = 0;
-							
-							for (int32 Index = 0; Index < 8; Index++)
-							{
-								if (VoxelValues[Index] > MinValue)
-								{
-									continue;
-								}
-								bool bIsSurfaceValue = false;
-								for (int32 Neighbor = 0; Neighbor < 3; Neighbor++)
-								{
-									const int32 NeighborIndex = Index ^ (1 << Neighbor);
-									if (VoxelValues[Index].IsEmpty() != VoxelValues[NeighborIndex].IsEmpty())
-									{
-										bIsSurfaceValue = true;
-										break;
-									}
-								}
-								if (!bIsSurfaceValue)
-								{
-									continue;
-								}
-								MinValue = VoxelValues[Index];
-								MinValueIndex = Index;
-							}
-							
-							MaterialPositions[VoxelIndex] = 
-							{
-								LX + bool(MinValueIndex & 0x1),
-								LY + bool(MinValueIndex & 0x2),
-								LZ + bool(MinValueIndex & 0x4)
-							};
-						}
-						else
-						{
-							MaterialPositions[VoxelIndex] = { LX, LY, LZ };
-						}
+						const int32 LX = FMath::CountTrailingZeros64(Edges);
+						EdgeFactors[3 * (LX + Row * SN_EXTENDED_CHUNK_SIZE) + Direction] = ComputeEdgeFactor(LX, LY, LZ, Direction);
 					}
 				}
 			}
 		}
 	}
 
+	// We need to find the min value that's a surface value
+	const auto GetMaterialPosition = [](uint32 LX, uint32 LY, uint32 LZ, const FVoxelValue VoxelValues[8])
 	{
-		VOXEL_ASYNC_SCOPE_COUNTER("Generate Vertices");
+		FVoxelValue MinValue = FVoxelValue::Empty();
+		int32 MinValueIndex = 0;
 
-		// generate the vertices and store the indices for the next step
-		for (uint32 LZ = 0; LZ < SN_CHUNK_SIZE; LZ++)
+		for (int32 Index = 0; Index < 8; Index++)
 		{
-			for (uint32 LY = 0; LY < SN_CHUNK_SIZE; LY++)
+			if (VoxelValues[Index] > MinValue)
 			{
-				for (uint32 LX = 0; LX < SN_CHUNK_SIZE; LX++)
+				continue;
+			}
+			bool bIsSurfaceValue = false;
+			for (int32 Neighbor = 0; Neighbor < 3; Neighbor++)
+			{
+				const int32 NeighborIndex = Index ^ (1 << Neighbor);
+				if (VoxelValues[Index].IsEmpty() != VoxelValues[NeighborIndex].IsEmpty())
 				{
-					const uint32 VoxelIndex = LX + LY * SN_EXTENDED_CHUNK_SIZE + LZ * SN_EXTENDED_CHUNK_SIZE * SN_EXTENDED_CHUNK_SIZE;
-					const uint32 VertexIndex = LX + LY * SN_CHUNK_SIZE + LZ * SN_CHUNK_SIZE * SN_CHUNK_SIZE;
-
-					uint32 VoxelIndices[8];
-					VoxelIndices[0] = VoxelIndex;
-					VoxelIndices[1] = VoxelIndex + 1;
-					VoxelIndices[2] = VoxelIndex + SN_EXTENDED_CHUNK_SIZE;
-					VoxelIndices[3] = VoxelIndex + SN_EXTENDED_CHUNK_SIZE + 1;
-					VoxelIndices[4] = VoxelIndex + SN_EXTENDED_CHUNK_SIZE * SN_EXTENDED_CHUNK_SIZE;
-					VoxelIndices[5] = VoxelIndex + SN_EXTENDED_CHUNK_SIZE * SN_EXTENDED_CHUNK_SIZE + 1;
-					VoxelIndices[6] = VoxelIndex + SN_EXTENDED_CHUNK_SIZE + SN_EXTENDED_CHUNK_SIZE * SN_EXTENDED_CHUNK_SIZE;
-					VoxelIndices[7] = VoxelIndex + SN_EXTENDED_CHUNK_SIZE + SN_EXTENDED_CHUNK_SIZE * SN_EXTENDED_CHUNK_SIZE + 1;
-
-					FVoxelValue VoxelValues[8];
-					VoxelValues[0] = CachedValues[VoxelIndices[0]];
-					VoxelValues[1] = CachedValues[VoxelIndices[1]];
-					VoxelValues[2] = CachedValues[VoxelIndices[2]];
-					VoxelValues[3] = CachedValues[VoxelIndices[3]];
-					VoxelValues[4] = CachedValues[VoxelIndices[4]];
-					VoxelValues[5] = CachedValues[VoxelIndices[5]];
-					VoxelValues[6] = CachedValues[VoxelIndices[6]];
-					VoxelValues[7] = CachedValues[VoxelIndices[7]];
-
-					float VoxelFloats[8];
-					VoxelFloats[0] = VoxelValues[0].ToFloat();
-					VoxelFloats[1] = VoxelValues[1].ToFloat();
-					VoxelFloats[2] = VoxelValues[2].ToFloat();
-					VoxelFloats[3] = VoxelValues[3].ToFloat();
-					VoxelFloats[4] = VoxelValues[4].ToFloat();
-					VoxelFloats[5] = VoxelValues[5].ToFloat();
-					VoxelFloats[6] = VoxelValues[6].ToFloat();
-					VoxelFloats[7] = VoxelValues[7].ToFloat();
-
-					const uint32 MarchingCubesCase =
-						(VoxelValues[0].IsEmpty() << 0) |
-						(VoxelValues[1].IsEmpty() << 1) |
-						(VoxelValues[2].IsEmpty() << 2) |
-						(VoxelValues[3].IsEmpty() << 3) |
-						(VoxelValues[4].IsEmpty() << 4) |
-						(VoxelValues[5].IsEmpty() << 5) |
-						(VoxelValues[6].IsEmpty() << 6) |
-						(VoxelValues[7].IsEmpty() << 7);
-
-					const uint8 SurfaceNetsCase =
-						(VoxelValues[3].IsEmpty() << 0) |
-						(VoxelValues[5].IsEmpty() << 1) |
-						(VoxelValues[6].IsEmpty() << 2) |
-						(VoxelValues[7].IsEmpty() << 3);
-
-					VertexSNCases[VertexIndex] = SurfaceNetsCase;
-
-					if ((MarchingCubesCase == 0) || (MarchingCubesCase == 255)) //cell is empty
-					{
-						VertexIndices[VertexIndex] = -1;
-						continue;
-					}
+					bIsSurfaceValue = true;
+					break;
+				}
+			}
+			if (!bIsSurfaceValue)
+			{
+				continue;
+			}
+			MinValue = VoxelValues[Index];
+			MinValueIndex = Index;
+		}
 
-					VertexIndices[VertexIndex] = Vertices.Num();
+		return FIntVector(
+			LX + bool(MinValueIndex & 0x1),
+			LY + bool(MinValueIndex & 0x2),
+			LZ + bool(MinValueIndex & 0x4));
+	};
 
+	// Only called on cells with both empty and full corners
+	const auto AddVertex = [&](uint32 LX, uint32 LY, uint32 LZ)
+	{
+		const uint32 VoxelIndex = LX + LY * SN_EXTENDED_CHUNK_SIZE + LZ * SN_EXTENDED_CHUNK_SIZE * SN_EXTENDED_CHUNK_SIZE;
+		const uint32 VertexIndex = LX + LY * SN_CHUNK_SIZE + LZ * SN_CHUNK_SIZE * SN_CHUNK_SIZE;
+
+		FVoxelValue VoxelValues[8];
+		VoxelValues[0] = CachedValues[VoxelIndex];
+		VoxelValues[1] = CachedValues[VoxelIndex + 1];
+		VoxelValues[2] = CachedValues[VoxelIndex + SN_EXTENDED_CHUNK_SIZE];
+		VoxelValues[3] = CachedValues[VoxelIndex + SN_EXTENDED_CHUNK_SIZE + 1];
+		VoxelValues[4] = CachedValues[VoxelIndex + SN_EXTENDED_CHUNK_SIZE * SN_EXTENDED_CHUNK_SIZE];
+		VoxelValues[5] = CachedValues[VoxelIndex + SN_EXTENDED_CHUNK_SIZE * SN_EXTENDED_CHUNK_SIZE + 1];
+		VoxelValues[6] = CachedValues[VoxelIndex + SN_EXTENDED_CHUNK_SIZE + SN_EXTENDED_CHUNK_SIZE * SN_EXTENDED_CHUNK_SIZE];
+		VoxelValues[7] = CachedValues[VoxelIndex + SN_EXTENDED_CHUNK_SIZE + SN_EXTENDED_CHUNK_SIZE * SN_EXTENDED_CHUNK_SIZE + 1];
+
+		float VoxelFloats[8];
+		VoxelFloats[0] = VoxelValues[0].ToFloat();
+		VoxelFloats[1] = VoxelValues[1].ToFloat();
+		VoxelFloats[2] = VoxelValues[2].ToFloat();
+		VoxelFloats[3] = VoxelValues[3].ToFloat();
+		VoxelFloats[4] = VoxelValues[4].ToFloat();
+		VoxelFloats[5] = VoxelValues[5].ToFloat();
+		VoxelFloats[6] = VoxelValues[6].ToFloat();
+		VoxelFloats[7] = VoxelValues[7].ToFloat();
+
+		VertexIndices[VertexIndex] = Vertices.Num();
+
+
+		const uint32 VoxelEdgeIndex = VoxelIndex * 3;
+		FVector CrossingTotal = FVector(0, 0, 0);
+		uint32 CrossingCount = 0;
+
+		constexpr int32 RemoveFirstBit = 0xFFFE; // TODO: what if more than 64k vertices
+		const FIntVector ParentPosition((LX & RemoveFirstBit), (LY & RemoveFirstBit), (LZ & RemoveFirstBit));
+		const uint32 ParentVoxelIndex = ParentPosition.X + ParentPosition.Y * SN_EXTENDED_CHUNK_SIZE + ParentPosition.Z * SN_EXTENDED_CHUNK_SIZE * SN_EXTENDED_CHUNK_SIZE;
+		const uint32 ParentVoxelEdgeIndex = ParentVoxelIndex * 3;
+		FVector ParentCrossingTotal = FVector(0, 0, 0);
+		uint32 ParentCrossingCount = 0;
+
+		for (uint32 Edge = 0; Edge < 12; Edge++)
+		{
+			// if this edge has a crossing, find the point and add it to the avg total, increment count
+			const float EdgeFactor = EdgeFactors[VoxelEdgeIndex + EdgeIndexOffsets[Edge]];
+			if (EdgeFactor >= 0)
+			{
+				const FVector MinPosition = Corners[EdgeFirstCornerIndex[Edge]];
+				const FVector MaxPosition = Corners[EdgeSecondCornerIndex[Edge]];
+				const FVector MidPosition = FMath::Lerp(MinPosition, MaxPosition, EdgeFactor); // blend between corners
+				CrossingTotal += MidPosition;
+				CrossingCount++;
+			}
+
+			// find crossings of parent cell
+			const float ParentEdgeFactorMin = EdgeFactors[ParentVoxelEdgeIndex + ParentEdgeIndexOffsetsMin[Edge]];
+			const float ParentEdgeFactorMax = EdgeFactors[ParentVoxelEdgeIndex + ParentEdgeIndexOffsetsMax[Edge]];
+			if ((ParentEdgeFactorMin >= 0) || (ParentEdgeFactorMax >= 0))
+			{
+				const float ParentEdgeFactor =
+					((ParentEdgeFactorMin >= 0) ? 0.5f * ParentEdgeFactorMin : 0.5f) +
+					((ParentEdgeFactorMax >= 0) ? 0.5f * ParentEdgeFactorMax : 0);
+				const FVector MinPosition = ParentCorners[EdgeFirstCornerIndex[Edge]];
+				const FVector MaxPosition = ParentCorners[EdgeSecondCornerIndex[Edge]];
+				const FVector MidPosition = FMath::Lerp(MinPosition, MaxPosition, ParentEdgeFactor); // blend between corners
+				ParentCrossingTotal += MidPosition;
+				ParentCrossingCount++;
+			}
+		}
 
-					const uint32 VoxelEdgeIndex = VoxelIndex * 3;
-					FVector CrossingTotal = FVector(0, 0, 0);
-					uint32 CrossingCount = 0;
+		ensureVoxelSlowNoSideEffects(CrossingCount > 0);
+		const FVector Offset = CrossingTotal / CrossingCount;
 
-					constexpr int32 RemoveFirstBit = 0xFFFE; // TODO: what if more than 64k vertices
-					const FIntVector ParentPosition((LX & RemoveFirstBit), (LY & RemoveFirstBit), (LZ & RemoveFirstBit));
-					const uint32 ParentVoxelIndex = ParentPosition.X + ParentPosition.Y * SN_EXTENDED_CHUNK_SIZE + ParentPosition.Z * SN_EXTENDED_CHUNK_SIZE * SN_EXTENDED_CHUNK_SIZE;
-					const uint32 ParentVoxelEdgeIndex = ParentVoxelIndex * 3;
-					FVector ParentCrossingTotal = FVector(0, 0, 0);
-					uint32 ParentCrossingCount = 0;
+		const FVector ParentOffset = ParentCrossingCount == 0 ? FVector::ZeroVector : ParentCrossingTotal / ParentCrossingCount;
 
-					for (uint32 Edge = 0; Edge < 12; Edge++)
+
+		const FIntVector CellPosition(LX * Step, LY * Step, LZ * Step);
+		const FVector CornerPosition{ CellPosition };
+		const FVector FinalPosition = CornerPosition + Offset * Step;
+
+		const FIntVector ParentCellPosition = ParentPosition * Step;
+		const FVector ParentCornerPosition{ ParentCellPosition };
+		const FVector ParentFinalPosition = ParentCornerPosition + ParentOffset * Step;
+		
+		TVertex Vertex;
+		Vertex.SetPosition(FinalPosition);
+		if (TVertex::bComputeParentPosition)
+		{
+			Vertex.SetParentPosition((ParentFinalPosition - FinalPosition) / Step); // Divide by Step to avoid overflowing the tangent
+		}
+		if (TVertex::bComputeNormal)
+		{
+			Vertex.SetNormal(MESHER_TIME_RETURN(Normals, GetNormal(VoxelFloats, Offset)));
+		}
+		if (TVertex::bComputeMaterial)
+		{
+			Vertex.SetMaterial(MESHER_TIME_RETURN_MATERIALS(1, Accelerator->GetMaterial(GetMaterialPosition(LX, LY, LZ, VoxelValues) * Step + ChunkPosition, LOD)));
+		}
+		if (TVertex::bComputeTextureCoordinate)
+		{
+			Vertex.SetTextureCoordinate(MESHER_TIME_RETURN(UVs, FVoxelMesherUtilities::GetUVs(*this, FinalPosition)));
+		}
+		Vertices.Add(Vertex);
+	};
+
+	{
+		VOXEL_ASYNC_SCOPE_COUNTER("Generate Vertices");
+
+		// generate the vertices and store the indices for the next step
+		for (uint32 LZ = 0; LZ < SN_CHUNK_SIZE; LZ++)
+		{
+			for (uint32 LY = 0; LY < SN_CHUNK_SIZE; LY++)
+			{
+				if (bScalarClassification)
+				{
+					for (uint32 LX = 0; LX < SN_CHUNK_SIZE; LX++)
 					{
-						// if this edge has a crossing, find the point and add it to the avg total, increment count
-						const float EdgeFactor = EdgeFactors[VoxelEdgeIndex + EdgeIndexOffsets[Edge]];
-						if (EdgeFactor >= 0)
+						const uint32 VoxelIndex = LX + LY * SN_EXTENDED_CHUNK_SIZE + LZ * SN_EXTENDED_CHUNK_SIZE * SN_EXTENDED_CHUNK_SIZE;
+						const uint32 VertexIndex = LX + LY * SN_CHUNK_SIZE + LZ * SN_CHUNK_SIZE * SN_CHUNK_SIZE;
+
+						uint32 MarchingCubesCase = 0;
+						for (uint32 Corner = 0; Corner < 8; Corner++)
 						{
-							const FVector MinPosition = Corners[EdgeFirstCornerIndex[Edge]];
-							const FVector MaxPosition = Corners[EdgeSecondCornerIndex[Edge]];
-							const FVector MidPosition = FMath::Lerp(MinPosition, MaxPosition, EdgeFactor); // blend between corners
-							CrossingTotal += MidPosition;
-							CrossingCount++;
+							const uint32 CornerIndex =
+								VoxelIndex +
+								bool(Corner & 0x1) * Offsets[0] +
+								bool(Corner & 0x2) * Offsets[1] +
+								bool(Corner & 0x4) * Offsets[2];
+							MarchingCubesCase |= uint32(CachedValues[CornerIndex].IsEmpty()) << Corner;
 						}
 
-						// find crossings of parent cell
-						const float ParentEdgeFactorMin = EdgeFactors[ParentVoxelEdgeIndex + ParentEdgeIndexOffsetsMin[Edge]];
-						const float ParentEdgeFactorMax = EdgeFactors[ParentVoxelEdgeIndex + ParentEdgeIndexOffsetsMax[Edge]];
-						if ((ParentEdgeFactorMin >= 0) || (ParentEdgeFactorMax >= 0))
+						// Corners 3, 5, 6 and 7
+						VertexSNCases[VertexIndex] =
+							(((MarchingCubesCase >> 3) & 1) << 0) |
+							(((MarchingCubesCase >> 5) & 1) << 1) |
+							(((MarchingCubesCase >> 6) & 1) << 2) |
+							(((MarchingCubesCase >> 7) & 1) << 3);
+
+						if (MarchingCubesCase == 0 || MarchingCubesCase == 255) // cell is empty
 						{
-							const float ParentEdgeFactor =
-								((ParentEdgeFactorMin >= 0) ? 0.5f * ParentEdgeFactorMin : 0.5f) +
-								((ParentEdgeFactorMax >= 0) ? 0.5f * ParentEdgeFactorMax : 0);
-							const FVector MinPosition = ParentCorners[EdgeFirstCornerIndex[Edge]];
-							const FVector MaxPosition = ParentCorners[EdgeSecondCornerIndex[Edge]];
-							const FVector MidPosition = FMath::Lerp(MinPosition, MaxPosition, ParentEdgeFactor); // blend between corners
-							ParentCrossingTotal += MidPosition;
-							ParentCrossingCount++;
+							VertexIndices[VertexIndex] = -1;
+							continue;
 						}
-					}
 
-					ensureVoxelSlowNoSideEffects(CrossingCount > 0);
-					const FVector Offset = CrossingTotal / CrossingCount;
+						AddVertex(LX, LY, LZ);
+					}
+					continue;
+				}
 
-					const FVector ParentOffset = ParentCrossingCount == 0 ? FVector::ZeroVector : ParentCrossingTotal / ParentCrossingCount;
+				// Bits of the 4 rows of corners of this row of cells
+				const uint32 Row = LY + LZ * SN_EXTENDED_CHUNK_SIZE;
+				const uint64 Bits00 = EmptyBits[Row];
+				const uint64 Bits10 = EmptyBits[Row + 1];
+				const uint64 Bits01 = EmptyBits[Row + SN_EXTENDED_CHUNK_SIZE];
+				const uint64 Bits11 = EmptyBits[Row + 1 + SN_EXTENDED_CHUNK_SIZE];
 
+				const uint32 RowVertexIndex = LY * SN_CHUNK_SIZE + LZ * SN_CHUNK_SIZE * SN_CHUNK_SIZE;
+				for (uint32 LX = 0; LX < SN_CHUNK_SIZE; LX++)
+				{
+					// Corners 3, 5, 6 and 7
+					VertexSNCases[RowVertexIndex + LX] =
+						(((Bits10 >> (LX + 1)) & 1) << 0) |
+						(((Bits01 >> (LX + 1)) & 1) << 1) |
+						(((Bits11 >> LX) & 1) << 2) |
+						(((Bits11 >> (LX + 1)) & 1) << 3);
+					VertexIndices[RowVertexIndex + LX] = -1;
+				}
 
-					const FIntVector CellPosition(LX * Step, LY * Step, LZ * Step);
-					const FVector CornerPosition{ CellPosition };
-					const FVector FinalPosition = CornerPosition + Offset * Step;
+				// Cells with both empty and full corners are the only ones with a vertex
+				const uint64 AnyEmpty = Bits00 | Bits10 | Bits01 | Bits11;
+				const uint64 AllEmpty = Bits00 & Bits10 & Bits01 & Bits11;
+				const uint64 SurfaceCells =
+					(AnyEmpty | (AnyEmpty >> 1)) &
+					~(AllEmpty & (AllEmpty >> 1)) &
+					((uint64(1) << SN_CHUNK_SIZE) - 1);
 
-					const FIntVector ParentCellPosition = ParentPosition * Step;
-					const FVector ParentCornerPosition{ ParentCellPosition };
-					const FVector ParentFinalPosition = ParentCornerPosition + ParentOffset * Step;
-					
-					TVertex Vertex;
-					Vertex.SetPosition(FinalPosition);
-					if (TVertex::bComputeParentPosition)
-					{
-						Vertex.SetParentPosition((ParentFinalPosition - FinalPosition) / Step); // Divide by Step to avoid overflowing the tangent
-					}
-					if (TVertex::bComputeNormal)
-					{
-						Vertex.SetNormal(MESHER_TIME_RETURN(Normals, GetNormal(VoxelFloats, Offset)));
-					}
-					if (TVertex::bComputeMaterial)
-					{
-						Vertex.SetMaterial(MESHER_TIME_RETURN_MATERIALS(1, Accelerator->GetMaterial(MaterialPositions[VoxelIndex] * Step + ChunkPosition, LOD)));
-					}
-					if (TVertex::bComputeTextureCoordinate)
-					{
-						Vertex.SetTextureCoordinate(MESHER_TIME_RETURN(UVs, FVoxelMesherUtilities::GetUVs(*this, FinalPosition)));
-					}
-					Vertices.Add(Vertex);
+				for (uint64 Cells = SurfaceCells; Cells != 0; Cells &= Cells - 1)
+				{
+					const uint32 LX = FMath::CountTrailingZeros64(Cells);
+					AddVertex(LX, LY, LZ);
 				}
 			}
 		}
@@ -560,4 +649,145 @@ TVoxelSharedPtr<FVoxelChunkMesh> FVoxelSurfaceNetMesher::CreateFullChunkImpl(FVo
 void FVoxelSurfaceNetMesher::CreateGeometryImpl(FVoxelMesherTimes& Times, TArray<uint32>& Indices, TArray<FVector>& Vertices)
 {
 	CreateGeometryTemplate(Times, Indices, reinterpret_cast<TArray<FVoxelSurfaceNetGeometryVertex>&>(Vertices));
-}
\ No newline at end of file
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+static FAutoConsoleCommandWithWorldAndArgs CmdTestSurfaceNets(
+	TEXT("voxel.mesher.TestSurfaceNets"),
+	TEXT("Meshes random chunks of the voxel worlds in the scene with the row and the scalar surface nets classifications, checks that the meshes are identical and compares their times with marching cubes. Args: NumTests (default 64), Radius around the world origin in voxels (default 512)"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const int32 NumTests = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 64;
+		const int32 Radius = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 512;
+
+		const auto GetBuffers = [](FVoxelChunkMesh& Chunk)
+		{
+			TMap<FVoxelMaterialIndices, TVoxelSharedPtr<FVoxelChunkMeshBuffers>> Buffers;
+			Chunk.IterateBufferPtrs([&](const FVoxelMaterialIndices& MaterialIndices, TVoxelSharedPtr<FVoxelChunkMeshBuffers>& BuffersPtr)
+			{
+				Buffers.Add(MaterialIndices, BuffersPtr);
+			});
+			return Buffers;
+		};
+		// The materials end up in the buffers keys, colors and texture coordinates depending on the material config
+		const auto AreIdentical = [&](FVoxelChunkMesh& A, FVoxelChunkMesh& B)
+		{
+			if (A.IsSingle() != B.IsSingle())
+			{
+				return false;
+			}
+
+			const auto BuffersA = GetBuffers(A);
+			const auto BuffersB = GetBuffers(B);
+			if (BuffersA.Num() != BuffersB.Num())
+			{
+				return false;
+			}
+			for (auto& It : BuffersA)
+			{
+				const auto* OtherPtr = BuffersB.Find(It.Key);
+				if (!OtherPtr)
+				{
+					return false;
+				}
+				const FVoxelChunkMeshBuffers& Buffer = *It.Value;
+				const FVoxelChunkMeshBuffers& Other = **OtherPtr;
+				if (Buffer.Indices != Other.Indices ||
+					Buffer.Positions != Other.Positions ||
+					Buffer.Normals != Other.Normals ||
+					Buffer.Colors != Other.Colors ||
+					Buffer.TextureCoordinates != Other.TextureCoordinates)
+				{
+					return false;
+				}
+			}
+			return true;
+		};
+
+		for (TActorIterator<AVoxelWorld> It(World); It; ++It)
+		{
+			if (!It->IsCreated())
+			{
+				continue;
+			}
+
+			const FVoxelRendererSettings& Settings = It->GetRenderer().Settings;
+
+			int32 NumFailed = 0;
+			int32 NumEmpty = 0;
+			double RowTime = 0;
+			double ScalarTime = 0;
+			double MarchingCubesTime = 0;
+
+			FRandomStream Stream(0);
+			for (int32 Test = 0; Test < NumTests; Test++)
+			{
+				const int32 LOD = Stream.RandRange(0, 2);
+				const int32 ChunkSize = RENDER_CHUNK_SIZE << LOD;
+				const auto GetRandomCoordinate = [&]()
+				{
+					return FMath::FloorToInt(Stream.FRandRange(-Radius, Radius) / ChunkSize) * ChunkSize;
+				};
+				const FIntVector ChunkPosition(GetRandomCoordinate(), GetRandomCoordinate(), GetRandomCoordinate());
+
+				const auto MakeSurfaceNetMesher = [&](bool bScalarClassification)
+				{
+					auto Mesher = MakeUnique<FVoxelSurfaceNetMesher>(LOD, ChunkPosition, Settings);
+					Mesher->bScalarClassification = bScalarClassification;
+					return Mesher;
+				};
+				const auto MakeMarchingCubeMesher = [&]()
+				{
+					return MakeUnique<FVoxelMarchingCubeMesher>(LOD, ChunkPosition, Settings);
+				};
+				const auto Mesh = [](TUniquePtr<FVoxelMesher> Mesher, double& Time)
+				{
+					const double StartTime = FPlatformTime::Seconds();
+					const TVoxelSharedPtr<FVoxelChunkMesh> Chunk = Mesher->CreateFullChunk();
+					Time += FPlatformTime::Seconds() - StartTime;
+					return Chunk;
+				};
+
+				// Fill the mesher values cache first, so that all the timed meshers get their values the same way
+				double IgnoredTime = 0;
+				Mesh(MakeSurfaceNetMesher(false), IgnoredTime);
+				Mesh(MakeMarchingCubeMesher(), IgnoredTime);
+
+				const TVoxelSharedPtr<FVoxelChunkMesh> RowChunk = Mesh(MakeSurfaceNetMesher(false), RowTime);
+				const TVoxelSharedPtr<FVoxelChunkMesh> ScalarChunk = Mesh(MakeSurfaceNetMesher(true), ScalarTime);
+				Mesh(MakeMarchingCubeMesher(), MarchingCubesTime);
+
+				if (!RowChunk.IsValid() || !ScalarChunk.IsValid())
+				{
+					if (RowChunk.IsValid() != ScalarChunk.IsValid())
+					{
+						LOG_VOXEL(Error, TEXT("TestSurfaceNets: LOD %d chunk %s: only one classification created a chunk"), LOD, *ChunkPosition.ToString());
+						NumFailed++;
+					}
+					continue;
+				}
+
+				if (RowChunk->IsEmpty())
+				{
+					NumEmpty++;
+				}
+				if (!AreIdentical(*RowChunk, *ScalarChunk))
+				{
+					LOG_VOXEL(Error, TEXT("TestSurfaceNets: LOD %d chunk %s: the row and scalar classifications give different meshes"), LOD, *ChunkPosition.ToString());
+					NumFailed++;
+				}
+			}
+
+			LOG_VOXEL(Log, TEXT("TestSurfaceNets: %s: %d/%d tests passed (%d empty chunks). Surface nets rows: %.3fms, Surface nets scalar: %.3fms, Marching cubes: %.3fms"),
+				*It->GetName(),
+				NumTests - NumFailed,
+				NumTests,
+				NumEmpty,
+				RowTime * 1000,
+				ScalarTime * 1000,
+				MarchingCubesTime * 1000);
+		}
+	}));
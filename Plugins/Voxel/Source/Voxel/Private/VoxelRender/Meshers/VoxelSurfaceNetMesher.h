@@ -19,6 +19,10 @@ class FVoxelSurfaceNetMesher : public FVoxelMesher
 public:
 	using FVoxelMesher::FVoxelMesher;
 
+	// If true, the edges and cells are classified one by one instead of by rows of bits
+	// Slower reference implementation, used by voxel.mesher.TestSurfaceNets
+	bool bScalarClassification = false;
+
 protected:
 	virtual FVoxelIntBox GetBoundsToCheckIsEmptyOn() const override final;
 	virtual FVoxelIntBox GetBoundsToLock() const override final;
@@ -32,9 +36,7 @@ private:
 	float EdgeFactors[SN_EXTENDED_CHUNK_SIZE * SN_EXTENDED_CHUNK_SIZE * SN_EXTENDED_CHUNK_SIZE * 3]; // edge blending factors for each cell, X,Y,Z
 	uint32 VertexIndices[SN_CHUNK_SIZE * SN_CHUNK_SIZE * SN_CHUNK_SIZE]; // final vertex indices, per voxel. 65535 if no vertex
 	uint8 VertexSNCases[SN_CHUNK_SIZE * SN_CHUNK_SIZE * SN_CHUNK_SIZE]; // surface net voxel cases for each cell
-
-	// The material position is detected in a first step
-	TVoxelStaticArray<FIntVector, SN_EXTENDED_CHUNK_SIZE * SN_EXTENDED_CHUNK_SIZE * SN_EXTENDED_CHUNK_SIZE> MaterialPositions;
+	uint64 EmptyBits[SN_EXTENDED_CHUNK_SIZE * SN_EXTENDED_CHUNK_SIZE]; // one bit per value along X, set if empty
 	
 	template<typename TVertex>
 	void CreateGeometryTemplate(FVoxelMesherTimes& Times, TArray<uint32>& Indices, TArray<TVertex>& Vertices);
@@ -5,9 +5,11 @@
 #include "VoxelRender/PhysicsCooker/VoxelAsyncPhysicsCooker_Chaos.h"
 #include "VoxelRender/VoxelProceduralMeshComponent.h"
 #include "VoxelRender/VoxelProcMeshBuffers.h"
+#include "VoxelRender/VoxelChunkMesh.h"
 #include "VoxelRender/IVoxelProceduralMeshComponent_PhysicsCallbackHandler.h"
 #include "VoxelUtilities/VoxelThreadingUtilities.h"
 #include "PhysicsEngine/PhysicsSettings.h"
+#include "Serialization/MemoryWriter.h"
 
 double GTotalVoxelCollisionCookingTime = 0;
 
@@ -65,6 +67,10 @@ IVoxelAsyncPhysicsCooker::IVoxelAsyncPhysicsCooker(UVoxelProceduralMeshComponent
 			return TmpBuffers;
 		}())
 	, LocalToRoot(Component->GetRelativeTransform())
+#if WITH_PHYSX && PHYSICS_INTERFACE_PHYSX
+	, HeightfieldCollisionData(Component->HeightfieldCollisionData)
+	, ConvexCollisionData(Component->ConvexCollisionData)
+#endif
 {
 	check(IsInGameThread());
 	ensure(CollisionTraceFlag != ECollisionTraceFlag::CTF_UseDefault);
@@ -88,6 +94,39 @@ void IVoxelAsyncPhysicsCooker::DoWork()
 	VOXEL_ASYNC_FUNCTION_COUNTER();
 
 	const double CookStartTime = FPlatformTime::Seconds();
+
+	// Heightfields are fast enough to create that they don't need the cache
+	if (FVoxelCookedCollisionCache::IsEnabled() && !HeightfieldCollisionData.IsValid())
+	{
+		TArray<uint8> Settings;
+		FMemoryWriter Writer(Settings);
+
+		int32 LODCopy = LOD;
+		uint8 CollisionTraceFlagCopy = CollisionTraceFlag;
+		bool bCleanCollisionMeshCopy = bCleanCollisionMesh;
+		int32 NumConvexHullsPerAxisCopy = NumConvexHullsPerAxis;
+		Writer << LODCopy;
+		Writer << CollisionTraceFlagCopy;
+		Writer << bCleanCollisionMeshCopy;
+		Writer << NumConvexHullsPerAxisCopy;
+		if (CollisionTraceFlag != ECollisionTraceFlag::CTF_UseComplexAsSimple)
+		{
+			// Convex meshes are cooked in root space
+			FTransform LocalToRootCopy = LocalToRoot;
+			Writer << LocalToRootCopy;
+
+			// The convexes don't depend on the buffers if they are built from the voxels
+			bool bHasConvexCollisionData = ConvexCollisionData.IsValid();
+			Writer << bHasConvexCollisionData;
+			if (bHasConvexCollisionData)
+			{
+				TArray<TArray<FVector>> Convexes = ConvexCollisionData->Convexes;
+				Writer << Convexes;
+			}
+		}
+
+		CacheKey = FVoxelCookedCollisionCache::ComputeKey(Buffers, Settings);
+	}
 	
 	CookMesh();
 
@@ -6,10 +6,13 @@
 #include "VoxelMinimal.h"
 #include "VoxelAsyncWork.h"
 #include "VoxelPriorityHandler.h"
+#include "VoxelRender/PhysicsCooker/VoxelCookedCollisionCache.h"
 #include "PhysicsEngine/BodySetup.h"
 #include "UObject/WeakObjectPtrTemplates.h"
 
 struct FVoxelProcMeshBuffers;
+struct FVoxelHeightfieldCollisionData;
+struct FVoxelConvexCollisionData;
 struct FVoxelProceduralMeshComponentMemoryUsage;
 class UBodySetup;
 class UVoxelProceduralMeshComponent;
@@ -29,6 +32,10 @@ public:
 	const int32 NumConvexHullsPerAxis;
 	const TArray<TVoxelSharedPtr<const FVoxelProcMeshBuffers>> Buffers;
 	const FTransform LocalToRoot;
+	// If valid, a heightfield is created instead of the trimesh & convexes. Only supported by PhysX
+	const TVoxelSharedPtr<const FVoxelHeightfieldCollisionData> HeightfieldCollisionData;
+	// If valid, used for the convexes instead of decomposing the mesh. Only supported by PhysX
+	const TVoxelSharedPtr<const FVoxelConvexCollisionData> ConvexCollisionData;
 
 	explicit IVoxelAsyncPhysicsCooker(UVoxelProceduralMeshComponent* Component);
 
@@ -41,6 +48,9 @@ protected:
 	virtual void CookMesh() = 0;
 	//~ End IVoxelAsyncPhysicsCooker Interface
 
+	// Key in FVoxelCookedCollisionCache, invalid if the cache is disabled. Set before CookMesh is called
+	FVoxelCookedCollisionKey CacheKey;
+
 protected:
 	//~ Begin FVoxelAsyncWork Interface
 	virtual void DoWork() override;
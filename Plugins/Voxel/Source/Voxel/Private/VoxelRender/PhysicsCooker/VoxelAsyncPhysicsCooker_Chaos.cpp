@@ -45,7 +45,33 @@ void FVoxelAsyncPhysicsCooker_Chaos::CookMesh()
 	}
 	if (CollisionTraceFlag != ECollisionTraceFlag::CTF_UseSimpleAsComplex)
 	{
+		if (!CacheKey.IsValid())
+		{
+			CreateTriMesh();
+			return;
+		}
+
+		// The implicit objects are never modified once built, so they can be shared with other body setups
+		FVoxelCookedCollisionCache& Cache = FVoxelCookedCollisionCache::Get();
+		if (const TVoxelSharedPtr<const FVoxelCookedCollision> Cooked = Cache.Find(CacheKey))
+		{
+			TriMeshes = Cooked->ChaosTriMeshes;
+			return;
+		}
+
 		CreateTriMesh();
+
+		int64 AllocatedSize = 0;
+		for (auto& Buffer : Buffers)
+		{
+			// Rough estimate: particles & triangles, twice for the BVH
+			AllocatedSize += 2 * (Buffer->GetNumVertices() * sizeof(Chaos::TVector<Chaos::FReal, 3>) + Buffer->GetNumIndices() * sizeof(int32));
+		}
+
+		const TVoxelSharedRef<FVoxelCookedCollision> NewCooked = MakeVoxelShared<FVoxelCookedCollision>();
+		NewCooked->ChaosTriMeshes = TriMeshes;
+		NewCooked->ChaosTriMeshesAllocatedSize = AllocatedSize;
+		Cache.Add(CacheKey, NewCooked);
 	}
 }
 
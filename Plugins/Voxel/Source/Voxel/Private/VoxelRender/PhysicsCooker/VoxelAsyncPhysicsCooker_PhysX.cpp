@@ -3,13 +3,18 @@
 #include "VoxelRender/PhysicsCooker/VoxelAsyncPhysicsCooker_PhysX.h"
 #include "VoxelRender/VoxelProcMeshBuffers.h"
 #include "VoxelRender/VoxelProceduralMeshComponent.h"
+#include "VoxelRender/VoxelChunkMesh.h"
+#include "VoxelUtilities/VoxelConvexDecompositionUtilities.h"
 #include "VoxelPhysXHelpers.h"
 
 #include "IPhysXCookingModule.h"
+#include "PhysXIncludes.h"
+#include "Engine/Private/PhysicsEngine/PhysXSupport.h" // For FPhysXInputStream
 
 #include "PhysicsPublic.h"
 #include "PhysicsEngine/BodySetup.h"
 #include "PhysicsEngine/PhysicsSettings.h"
+#include "HAL/IConsoleManager.h"
 
 #if WITH_PHYSX && PHYSICS_INTERFACE_PHYSX
 inline IPhysXCooking* GetPhysXCooking()
@@ -65,6 +70,8 @@ bool FVoxelAsyncPhysicsCooker_PhysX::Finalize(UBodySetup& BodySetup, FVoxelProce
 	
 	// TODO a bit hacky?
 	Component->UpdateConvexMeshes(CookResult.ConvexBounds, MoveTemp(CookResult.ConvexElems), MoveTemp(CookResult.ConvexMeshes));
+	Component->SetCookedHeightfield(CookResult.Heightfield, CookResult.Heightfield ? HeightfieldCollisionData : nullptr);
+	CookResult.Heightfield = nullptr;
 	
 	OutMemoryUsage.TriangleMeshes = CookResult.TriangleMeshesMemoryUsage;
 
@@ -73,6 +80,43 @@ bool FVoxelAsyncPhysicsCooker_PhysX::Finalize(UBodySetup& BodySetup, FVoxelProce
 
 void FVoxelAsyncPhysicsCooker_PhysX::CookMesh()
 {
+	if (HeightfieldCollisionData.IsValid())
+	{
+		if (CreateHeightfield())
+		{
+			return;
+		}
+		LOG_VOXEL(Warning, TEXT("Failed to cook heightfield, falling back to a trimesh"));
+	}
+
+	if (CacheKey.IsValid())
+	{
+		FVoxelCookedCollisionCache& Cache = FVoxelCookedCollisionCache::Get();
+		if (const TVoxelSharedPtr<const FVoxelCookedCollision> Cooked = Cache.Find(CacheKey))
+		{
+			if (CreateFromCachedData(*Cooked))
+			{
+				return;
+			}
+
+			// Can happen if the data was loaded from disk: cook again
+			LOG_VOXEL(Warning, TEXT("Failed to create collisions from cached cooked data"));
+			ReleaseCookResult();
+		}
+		else
+		{
+			const TVoxelSharedRef<FVoxelCookedCollision> NewCooked = CookToCachedData();
+			if (ErrorCounter.GetValue() == 0 && CreateFromCachedData(*NewCooked))
+			{
+				Cache.Add(CacheKey, NewCooked);
+				return;
+			}
+
+			// Cook again without the cache to get the same errors as usual
+			ReleaseCookResult();
+		}
+	}
+
 	if (CollisionTraceFlag != ECollisionTraceFlag::CTF_UseComplexAsSimple)
 	{
 		DecomposeMeshToHulls();
@@ -88,115 +132,64 @@ void FVoxelAsyncPhysicsCooker_PhysX::CookMesh()
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
-void FVoxelAsyncPhysicsCooker_PhysX::CreateTriMesh()
+bool FVoxelAsyncPhysicsCooker_PhysX::CreateHeightfield()
 {
 	VOXEL_ASYNC_FUNCTION_COUNTER();
 
-	TArray<FVector> Vertices;
-	TArray<FTriIndices> Indices;
-	TArray<uint16> MaterialIndices;
-
-	// Copy data from buffers
+	const FVoxelHeightfieldCollisionData& Data = *HeightfieldCollisionData;
+	const int32 NumSamples = Data.NumSamples;
+	if (!ensure(NumSamples > 1) || !ensure(Data.Heights.Num() == NumSamples * NumSamples))
 	{
-		VOXEL_ASYNC_SCOPE_COUNTER("Copy data from buffers");
+		return false;
+	}
 
-		{
-			int32 NumIndices = 0;
-			int32 NumVertices = 0;
-			for (auto& Buffer : Buffers)
-			{
-				NumIndices += Buffer->GetNumIndices();
-				NumVertices += Buffer->GetNumVertices();
-			}
-			VOXEL_ASYNC_SCOPE_COUNTER("Reserve");
-			Vertices.Reserve(NumVertices);
-			Indices.Reserve(NumIndices);
-			MaterialIndices.Reserve(NumIndices);
-		}
+	const float HeightScale = Data.GetHeightScale();
 
-		int32 VertexOffset = 0;
-		for (int32 SectionIndex = 0; SectionIndex < Buffers.Num(); SectionIndex++)
+	// PhysX heightfields are in the XZ plane, with the heights along Y
+	// The component rotates them so that rows are along X, columns along -Y and heights along Z
+	// Row R, column C is the sample at X = R, Y = NumSamples - 1 - C
+	TArray<physx::PxHeightFieldSample> Samples;
+	Samples.SetNumZeroed(NumSamples * NumSamples);
+	for (int32 Row = 0; Row < NumSamples; Row++)
+	{
+		for (int32 Column = 0; Column < NumSamples; Column++)
 		{
-			auto& Buffer = *Buffers[SectionIndex];
-			const auto Get = [](auto& Array, int32 Index) -> auto&
-			{
-#if VOXEL_DEBUG
-				return Array[Index];
-#else
-				return Array.GetData()[Index];
-#endif
-			};
-
-			// Copy vertices
-			{
-				auto& PositionBuffer = Buffer.VertexBuffers.PositionVertexBuffer;
-
-				const int32 Offset = Vertices.Num();
-				check(PositionBuffer.GetNumVertices() <= uint32(Vertices.GetSlack()));
-				Vertices.AddUninitialized(PositionBuffer.GetNumVertices());
+			const int32 X = Row;
+			const int32 Y = NumSamples - 1 - Column;
 
-				VOXEL_ASYNC_SCOPE_COUNTER("Copy vertices");
-				for (uint32 Index = 0; Index < PositionBuffer.GetNumVertices(); Index++)
-				{
-					Get(Vertices, Offset + Index) = PositionBuffer.VertexPosition(Index);
-				}
-			}
+			physx::PxHeightFieldSample& Sample = Samples[Row * NumSamples + Column];
+			Sample.height = FMath::Clamp<int32>(FMath::RoundToInt(Data.GetHeight(X, Y) / HeightScale), MIN_int16, MAX_int16);
 
-			// Copy triangle data
+			// The cell at row R, column C is stored in the sample at row R, column C
+			// Its corners are X in [R, R + 1], Y in [NumSamples - 2 - C, NumSamples - 1 - C]
+			if (Row < NumSamples - 1 && Column < NumSamples - 1 && Data.IsHole(X, Y - 1))
 			{
-				auto& IndexBuffer = Buffer.IndexBuffer;
-
-				ensure(Indices.Num() == MaterialIndices.Num());
-				const int32 Offset = Indices.Num();
-				ensure(IndexBuffer.GetNumIndices() % 3 == 0);
-				const int32 NumTriangles = IndexBuffer.GetNumIndices() / 3;
-
-				check(NumTriangles <= Indices.GetSlack());
-				check(NumTriangles <= MaterialIndices.GetSlack());
-				Indices.AddUninitialized(NumTriangles);
-				MaterialIndices.AddUninitialized(NumTriangles);
-
-				{
-					VOXEL_ASYNC_SCOPE_COUNTER("Copy triangles");
-					const auto Lambda = [&](const auto* RESTRICT Data)
-					{
-						for (int32 Index = 0; Index < NumTriangles; Index++)
-						{
-							// Need to add base offset for indices
-							FTriIndices TriIndices;
-							TriIndices.v0 = Data[3 * Index + 0] + VertexOffset;
-							TriIndices.v1 = Data[3 * Index + 1] + VertexOffset;
-							TriIndices.v2 = Data[3 * Index + 2] + VertexOffset;
-							checkVoxelSlow(3 * Index + 2 < IndexBuffer.GetNumIndices());
-							Get(Indices, Offset + Index) = TriIndices;
-						}
-					};
-					if (IndexBuffer.Is32Bit())
-					{
-						Lambda(IndexBuffer.GetData_32());
-					}
-					else
-					{
-						Lambda(IndexBuffer.GetData_16());
-					}
-				}
-				// Also store material info
-				{
-					VOXEL_ASYNC_SCOPE_COUNTER("Copy material info");
-					for (int32 Index = 0; Index < NumTriangles; Index++)
-					{
-						Get(MaterialIndices, Offset + Index) = SectionIndex;
-					}
-				}
+				Sample.materialIndex0 = physx::PxHeightFieldMaterial::eHOLE;
+				Sample.materialIndex1 = physx::PxHeightFieldMaterial::eHOLE;
 			}
-
-			VertexOffset = Vertices.Num();
 		}
 	}
 
-	if (Indices.Num() < 3)
+	physx::PxHeightField* Heightfield = nullptr;
+	if (!PhysXCooking->CreateHeightField(PhysXFormat, FIntPoint(NumSamples, NumSamples), Samples.GetData(), sizeof(physx::PxHeightFieldSample), Heightfield) || !Heightfield)
+	{
+		return false;
+	}
+
+	CookResult.Heightfield = Heightfield;
+	CookResult.TriangleMeshesMemoryUsage += Samples.Num() * sizeof(physx::PxHeightFieldSample);
+	return true;
+}
+
+void FVoxelAsyncPhysicsCooker_PhysX::CreateTriMesh()
+{
+	VOXEL_ASYNC_FUNCTION_COUNTER();
+
+	TArray<FVector> Vertices;
+	TArray<FTriIndices> Indices;
+	TArray<uint16> MaterialIndices;
+	if (!GetTriMeshData(Vertices, Indices, MaterialIndices))
 	{
-		// If less than 3 triangles the cooking is likely to fail
 		return;
 	}
 
@@ -227,6 +220,107 @@ void FVoxelAsyncPhysicsCooker_PhysX::CreateTriMesh()
 	}
 }
 
+bool FVoxelAsyncPhysicsCooker_PhysX::GetTriMeshData(TArray<FVector>& OutVertices, TArray<FTriIndices>& OutIndices, TArray<uint16>& OutMaterialIndices) const
+{
+	VOXEL_ASYNC_SCOPE_COUNTER("Copy data from buffers");
+
+	{
+		int32 NumIndices = 0;
+		int32 NumVertices = 0;
+		for (auto& Buffer : Buffers)
+		{
+			NumIndices += Buffer->GetNumIndices();
+			NumVertices += Buffer->GetNumVertices();
+		}
+		VOXEL_ASYNC_SCOPE_COUNTER("Reserve");
+		OutVertices.Reserve(NumVertices);
+		OutIndices.Reserve(NumIndices);
+		OutMaterialIndices.Reserve(NumIndices);
+	}
+
+	int32 VertexOffset = 0;
+	for (int32 SectionIndex = 0; SectionIndex < Buffers.Num(); SectionIndex++)
+	{
+		auto& Buffer = *Buffers[SectionIndex];
+		const auto Get = [](auto& Array, int32 Index) -> auto&
+		{
+#if VOXEL_DEBUG
+			return Array[Index];
+#else
+			return Array.GetData()[Index];
+#endif
+		};
+
+		// Copy vertices
+		{
+			auto& PositionBuffer = Buffer.VertexBuffers.PositionVertexBuffer;
+
+			const int32 Offset = OutVertices.Num();
+			check(PositionBuffer.GetNumVertices() <= uint32(OutVertices.GetSlack()));
+			OutVertices.AddUninitialized(PositionBuffer.GetNumVertices());
+
+			VOXEL_ASYNC_SCOPE_COUNTER("Copy vertices");
+			for (uint32 Index = 0; Index < PositionBuffer.GetNumVertices(); Index++)
+			{
+				Get(OutVertices, Offset + Index) = PositionBuffer.VertexPosition(Index);
+			}
+		}
+
+		// Copy triangle data
+		{
+			auto& IndexBuffer = Buffer.IndexBuffer;
+
+			ensure(OutIndices.Num() == OutMaterialIndices.Num());
+			const int32 Offset = OutIndices.Num();
+			ensure(IndexBuffer.GetNumIndices() % 3 == 0);
+			const int32 NumTriangles = IndexBuffer.GetNumIndices() / 3;
+
+			check(NumTriangles <= OutIndices.GetSlack());
+			check(NumTriangles <= OutMaterialIndices.GetSlack());
+			OutIndices.AddUninitialized(NumTriangles);
+			OutMaterialIndices.AddUninitialized(NumTriangles);
+
+			{
+				VOXEL_ASYNC_SCOPE_COUNTER("Copy triangles");
+				const auto Lambda = [&](const auto* RESTRICT Data)
+				{
+					for (int32 Index = 0; Index < NumTriangles; Index++)
+					{
+						// Need to add base offset for indices
+						FTriIndices TriIndices;
+						TriIndices.v0 = Data[3 * Index + 0] + VertexOffset;
+						TriIndices.v1 = Data[3 * Index + 1] + VertexOffset;
+						TriIndices.v2 = Data[3 * Index + 2] + VertexOffset;
+						checkVoxelSlow(3 * Index + 2 < IndexBuffer.GetNumIndices());
+						Get(OutIndices, Offset + Index) = TriIndices;
+					}
+				};
+				if (IndexBuffer.Is32Bit())
+				{
+					Lambda(IndexBuffer.GetData_32());
+				}
+				else
+				{
+					Lambda(IndexBuffer.GetData_16());
+				}
+			}
+			// Also store material info
+			{
+				VOXEL_ASYNC_SCOPE_COUNTER("Copy material info");
+				for (int32 Index = 0; Index < NumTriangles; Index++)
+				{
+					Get(OutMaterialIndices, Offset + Index) = SectionIndex;
+				}
+			}
+		}
+
+		VertexOffset = OutVertices.Num();
+	}
+
+	// If less than 3 triangles the cooking is likely to fail
+	return OutIndices.Num() >= 3;
+}
+
 void FVoxelAsyncPhysicsCooker_PhysX::CreateConvexMesh()
 {
 	VOXEL_ASYNC_FUNCTION_COUNTER();
@@ -254,23 +348,16 @@ void FVoxelAsyncPhysicsCooker_PhysX::CreateConvexMesh()
 	}
 }
 
-void FVoxelAsyncPhysicsCooker_PhysX::DecomposeMeshToHulls()
+// Split the vertices in a grid of hulls
+// IterateVertices is called with a lambda taking a vertex
+template<typename T>
+static void DecomposeVerticesToGridHulls(int32 LOD, int32 NumConvexHullsPerAxis, T IterateVertices, TArray<FKConvexElem>& ConvexElems)
 {
-	VOXEL_ASYNC_FUNCTION_COUNTER();
-	
-	if (Buffers.Num() == 1 && Buffers[0]->GetNumVertices() < 4) return;
-
-	auto& ConvexElems = CookResult.ConvexElems;
-	
 	FBox Box(ForceInit);
-	for(auto& Buffer : Buffers)
+	IterateVertices([&](const FVector& Vertex)
 	{
-		auto& PositionBuffer = Buffer->VertexBuffers.PositionVertexBuffer;
-		for (uint32 Index = 0; Index < PositionBuffer.GetNumVertices(); Index++)
-		{
-			Box += PositionBuffer.VertexPosition(Index);
-		}
-	}
+		Box += Vertex;
+	});
 
 	const int32 ChunkSize = RENDER_CHUNK_SIZE << LOD;
 	const FIntVector Size =
@@ -282,44 +369,38 @@ void FVoxelAsyncPhysicsCooker_PhysX::DecomposeMeshToHulls()
 
 	ConvexElems.SetNum(Size.X * Size.Y * Size.Z);
 
-	for (auto& Buffer : Buffers)
+	IterateVertices([&](const FVector& Vertex)
 	{
-		auto& PositionBuffer = Buffer->VertexBuffers.PositionVertexBuffer;
-		for (uint32 Index = 0; Index < PositionBuffer.GetNumVertices(); Index++)
+		FIntVector MainPosition;
+		const auto Lambda = [&](int32 OffsetX, int32 OffsetY, int32 OffsetZ)
 		{
-			const FVector Vertex = PositionBuffer.VertexPosition(Index);
-			
-			FIntVector MainPosition;
-			const auto Lambda = [&](int32 OffsetX, int32 OffsetY, int32 OffsetZ)
-			{
-				const FVector Offset = FVector(OffsetX, OffsetY, OffsetZ) * (1 << LOD); // 1 << LOD: should be max distance between the vertices
-				FIntVector Position = FVoxelUtilities::FloorToInt((Vertex + Offset - Box.Min) / ChunkSize * NumConvexHullsPerAxis);
-				Position = FVoxelUtilities::Clamp(Position, FIntVector(0), Size - 1);
+			const FVector Offset = FVector(OffsetX, OffsetY, OffsetZ) * (1 << LOD); // 1 << LOD: should be max distance between the vertices
+			FIntVector Position = FVoxelUtilities::FloorToInt((Vertex + Offset - Box.Min) / ChunkSize * NumConvexHullsPerAxis);
+			Position = FVoxelUtilities::Clamp(Position, FIntVector(0), Size - 1);
 
-				// Avoid adding too many duplicates by checking we're not in the center
-				if (OffsetX == 0 && OffsetY == 0 && OffsetZ == 0)
+			// Avoid adding too many duplicates by checking we're not in the center
+			if (OffsetX == 0 && OffsetY == 0 && OffsetZ == 0)
+			{
+				MainPosition = Position;
+			}
+			else
+			{
+				if (Position == MainPosition)
 				{
-					MainPosition = Position;
+					return;
 				}
-				else
-				{
-					if (Position == MainPosition)
-					{
-						return;
-					}
-				}
-				ConvexElems[Position.X + Size.X * Position.Y + Size.X * Size.Y * Position.Z].VertexData.Add(Vertex);
-			};
-			Lambda(0, 0, 0);
-			// Iterate possible neighbors to avoid holes between hulls
-			Lambda(+1, 0, 0);
-			Lambda(-1, 0, 0);
-			Lambda(0, +1, 0);
-			Lambda(0, -1, 0);
-			Lambda(0, 0, +1);
-			Lambda(0, 0, -1);
-		}
-	}
+			}
+			ConvexElems[Position.X + Size.X * Position.Y + Size.X * Size.Y * Position.Z].VertexData.Add(Vertex);
+		};
+		Lambda(0, 0, 0);
+		// Iterate possible neighbors to avoid holes between hulls
+		Lambda(+1, 0, 0);
+		Lambda(-1, 0, 0);
+		Lambda(0, +1, 0);
+		Lambda(0, -1, 0);
+		Lambda(0, 0, +1);
+		Lambda(0, 0, -1);
+	});
 
 	constexpr int32 Threshold = 8;
 
@@ -345,6 +426,38 @@ void FVoxelAsyncPhysicsCooker_PhysX::DecomposeMeshToHulls()
 		ConvexElems[ConvexElems.Num() - 2].VertexData.Append(ConvexElems.Last().VertexData);
 		ConvexElems.Pop();
 	}
+}
+
+void FVoxelAsyncPhysicsCooker_PhysX::DecomposeMeshToHulls()
+{
+	VOXEL_ASYNC_FUNCTION_COUNTER();
+	
+	auto& ConvexElems = CookResult.ConvexElems;
+
+	if (ConvexCollisionData.IsValid())
+	{
+		// Already decomposed from the voxels by the mesher
+		for (auto& Convex : ConvexCollisionData->Convexes)
+		{
+			ConvexElems.Emplace_GetRef().VertexData = Convex;
+		}
+	}
+	else
+	{
+		if (Buffers.Num() == 1 && Buffers[0]->GetNumVertices() < 4) return;
+
+		DecomposeVerticesToGridHulls(LOD, NumConvexHullsPerAxis, [&](auto Lambda)
+		{
+			for (auto& Buffer : Buffers)
+			{
+				auto& PositionBuffer = Buffer->VertexBuffers.PositionVertexBuffer;
+				for (uint32 Index = 0; Index < PositionBuffer.GetNumVertices(); Index++)
+				{
+					Lambda(PositionBuffer.VertexPosition(Index));
+				}
+			}
+		}, ConvexElems);
+	}
 
 	CookResult.ConvexBounds = FBox(ForceInit);
 	for (auto& Element : ConvexElems)
@@ -360,6 +473,258 @@ void FVoxelAsyncPhysicsCooker_PhysX::DecomposeMeshToHulls()
 	}
 }
 
+static FAutoConsoleCommand CmdTestConvexDecomposition(
+	TEXT("voxel.collision.TestConvexDecomposition"),
+	TEXT("Compares the grid & the voxel convex decompositions on random chunks: number of hulls, decomposition & cooking times. Args: NumTests (default 16), NumConvexHullsPerAxis (default 2)"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 NumTests = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 16;
+		const int32 NumConvexHullsPerAxis = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 2;
+		const EPhysXMeshCookFlags CookFlags = EPhysXMeshCookFlags::DeformableMesh | EPhysXMeshCookFlags::FastCook;
+
+		struct FResult
+		{
+			int32 NumHulls = 0;
+			int32 NumVertices = 0;
+			double DecompositionTime = 0;
+			double CookTime = 0;
+		};
+		FResult GridResult;
+		FResult VoxelResult;
+
+		const auto Cook = [&](const TArray<TArray<FVector>>& Convexes, FResult& Result)
+		{
+			const double StartTime = FPlatformTime::Seconds();
+			for (auto& Convex : Convexes)
+			{
+				TArray<uint8> Data;
+				GetPhysXCooking()->CookConvex(PhysXFormat, CookFlags, Convex, Data);
+				Result.NumVertices += Convex.Num();
+			}
+			Result.CookTime += FPlatformTime::Seconds() - StartTime;
+			Result.NumHulls += Convexes.Num();
+		};
+
+		for (int32 Seed = 0; Seed < NumTests; Seed++)
+		{
+			FRandomStream Stream(Seed);
+
+			// Hills with a cave
+			const int32 NumSamples = RENDER_CHUNK_SIZE + 1;
+			const float Frequency = Stream.FRandRange(0.05f, 0.3f);
+			const float Amplitude = Stream.FRandRange(1.f, 12.f);
+			const FVector CaveCenter = FVector(Stream.FRandRange(0, NumSamples), Stream.FRandRange(0, NumSamples), Stream.FRandRange(0, NumSamples / 2));
+			const float CaveRadius = Stream.FRandRange(0, 8);
+
+			TArray<float> Densities;
+			TArray<bool> SolidSamples;
+			for (int32 Z = 0; Z < NumSamples; Z++)
+			{
+				for (int32 Y = 0; Y < NumSamples; Y++)
+				{
+					for (int32 X = 0; X < NumSamples; X++)
+					{
+						const float Height = NumSamples / 2 + Amplitude * FMath::Sin(X * Frequency) * FMath::Cos(Y * Frequency);
+						const float Density = FMath::Max(Z - Height, CaveRadius - FVector::Dist(FVector(X, Y, Z), CaveCenter));
+						Densities.Add(Density);
+						SolidSamples.Add(Density <= 0);
+					}
+				}
+			}
+
+			// Vertices on the edges crossing the surface, like the marching cubes ones
+			TArray<FVector> Vertices;
+			for (int32 Z = 0; Z < NumSamples; Z++)
+			{
+				for (int32 Y = 0; Y < NumSamples; Y++)
+				{
+					for (int32 X = 0; X < NumSamples; X++)
+					{
+						const int32 Index = X + NumSamples * Y + NumSamples * NumSamples * Z;
+						const auto AddEdge = [&](int32 OtherX, int32 OtherY, int32 OtherZ)
+						{
+							if (OtherX >= NumSamples || OtherY >= NumSamples || OtherZ >= NumSamples) return;
+							const int32 OtherIndex = OtherX + NumSamples * OtherY + NumSamples * NumSamples * OtherZ;
+							if (SolidSamples[Index] == SolidSamples[OtherIndex]) return;
+							const float Alpha = Densities[Index] / (Densities[Index] - Densities[OtherIndex]);
+							Vertices.Add(FMath::Lerp(FVector(X, Y, Z), FVector(OtherX, OtherY, OtherZ), Alpha));
+						};
+						AddEdge(X + 1, Y, Z);
+						AddEdge(X, Y + 1, Z);
+						AddEdge(X, Y, Z + 1);
+					}
+				}
+			}
+			if (Vertices.Num() < 4)
+			{
+				continue;
+			}
+
+			{
+				const double StartTime = FPlatformTime::Seconds();
+				TArray<FKConvexElem> ConvexElems;
+				DecomposeVerticesToGridHulls(0, NumConvexHullsPerAxis, [&](auto Lambda)
+				{
+					for (auto& Vertex : Vertices)
+					{
+						Lambda(Vertex);
+					}
+				}, ConvexElems);
+				TArray<TArray<FVector>> Convexes;
+				for (auto& Element : ConvexElems)
+				{
+					Convexes.Add(MoveTemp(Element.VertexData));
+				}
+				GridResult.DecompositionTime += FPlatformTime::Seconds() - StartTime;
+				Cook(Convexes, GridResult);
+			}
+			{
+				const double StartTime = FPlatformTime::Seconds();
+				TArray<TArray<FVector>> Convexes;
+				FVoxelConvexDecompositionUtilities::DecomposeSolidSamples(
+					RENDER_CHUNK_SIZE,
+					SolidSamples,
+					FVoxelConvexDecompositionUtilities::GetResolution(RENDER_CHUNK_SIZE, 4 * NumConvexHullsPerAxis),
+					0.25f,
+					Convexes);
+				VoxelResult.DecompositionTime += FPlatformTime::Seconds() - StartTime;
+				Cook(Convexes, VoxelResult);
+			}
+		}
+
+		const auto Log = [&](const TCHAR* Name, const FResult& Result)
+		{
+			LOG_VOXEL(Log, TEXT("TestConvexDecomposition: %s: %d hulls, %d vertices. Decomposition: %.3fms, Cooking: %.3fms"),
+				Name,
+				Result.NumHulls,
+				Result.NumVertices,
+				Result.DecompositionTime * 1000,
+				Result.CookTime * 1000);
+		};
+		Log(TEXT("Grid"), GridResult);
+		Log(TEXT("Voxel"), VoxelResult);
+	}));
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+TVoxelSharedRef<FVoxelCookedCollision> FVoxelAsyncPhysicsCooker_PhysX::CookToCachedData()
+{
+	VOXEL_ASYNC_FUNCTION_COUNTER();
+
+	const TVoxelSharedRef<FVoxelCookedCollision> Cooked = MakeVoxelShared<FVoxelCookedCollision>();
+
+	if (CollisionTraceFlag != ECollisionTraceFlag::CTF_UseComplexAsSimple)
+	{
+		DecomposeMeshToHulls();
+
+		VOXEL_ASYNC_SCOPE_COUNTER("Cook convexes");
+		for (auto& Element : CookResult.ConvexElems)
+		{
+			TArray<uint8>& Data = Cooked->CookedConvexes.Emplace_GetRef();
+			const EPhysXCookingResult Result = PhysXCooking->CookConvex(PhysXFormat, GetCookFlags(), Element.VertexData, Data);
+			if (Result == EPhysXCookingResult::Failed)
+			{
+				LOG_VOXEL(Warning, TEXT("Failed to cook convex"));
+				ErrorCounter.Increment();
+			}
+			Cooked->ConvexVertices.Emplace(MoveTemp(Element.VertexData));
+		}
+		Cooked->ConvexBounds = CookResult.ConvexBounds;
+		CookResult.ConvexElems.Reset();
+	}
+	if (CollisionTraceFlag != ECollisionTraceFlag::CTF_UseSimpleAsComplex)
+	{
+		TArray<FVector> Vertices;
+		TArray<FTriIndices> Indices;
+		TArray<uint16> MaterialIndices;
+		if (GetTriMeshData(Vertices, Indices, MaterialIndices))
+		{
+			VOXEL_ASYNC_SCOPE_COUNTER("Cook TriMesh");
+			constexpr bool bFlipNormals = true; // Always true due to the order of the vertices (clock wise vs not)
+			if (!PhysXCooking->CookTriMesh(PhysXFormat, GetCookFlags(), Vertices, Indices, MaterialIndices, bFlipNormals, Cooked->CookedTriMesh))
+			{
+				LOG_VOXEL(Warning, TEXT("Failed to cook TriMesh. Num vertices: %d; Num triangles: %d"), Vertices.Num(), Indices.Num());
+				ErrorCounter.Increment();
+			}
+		}
+	}
+
+	return Cooked;
+}
+
+bool FVoxelAsyncPhysicsCooker_PhysX::CreateFromCachedData(const FVoxelCookedCollision& Cooked)
+{
+	VOXEL_ASYNC_FUNCTION_COUNTER();
+
+	if (!ensure(Cooked.CookedConvexes.Num() == Cooked.ConvexVertices.Num()))
+	{
+		return false;
+	}
+
+	for (int32 Index = 0; Index < Cooked.CookedConvexes.Num(); Index++)
+	{
+		const TArray<uint8>& Data = Cooked.CookedConvexes[Index];
+
+		FKConvexElem& Element = CookResult.ConvexElems.Emplace_GetRef();
+		Element.VertexData = Cooked.ConvexVertices[Index];
+		Element.UpdateElemBox();
+
+		physx::PxConvexMesh* ConvexMesh = nullptr;
+		if (Data.Num() > 0)
+		{
+			FPhysXInputStream Buffer(Data.GetData(), Data.Num());
+			ConvexMesh = GPhysXSDK->createConvexMesh(Buffer);
+		}
+		CookResult.ConvexMeshes.Add(ConvexMesh);
+
+		if (!ConvexMesh)
+		{
+			return false;
+		}
+	}
+	CookResult.ConvexBounds = Cooked.ConvexBounds;
+
+	if (Cooked.CookedTriMesh.Num() > 0)
+	{
+		FPhysXInputStream Buffer(Cooked.CookedTriMesh.GetData(), Cooked.CookedTriMesh.Num());
+		physx::PxTriangleMesh* TriangleMesh = GPhysXSDK->createTriangleMesh(Buffer);
+		if (!TriangleMesh)
+		{
+			return false;
+		}
+		CookResult.TriangleMeshes.Add(TriangleMesh);
+		CookResult.TriangleMeshesMemoryUsage += FVoxelPhysXHelpers::GetAllocatedSize(*TriangleMesh);
+	}
+
+	return true;
+}
+
+void FVoxelAsyncPhysicsCooker_PhysX::ReleaseCookResult()
+{
+	for (physx::PxConvexMesh* ConvexMesh : CookResult.ConvexMeshes)
+	{
+		if (ConvexMesh)
+		{
+			ConvexMesh->release();
+		}
+	}
+	for (physx::PxTriangleMesh* TriangleMesh : CookResult.TriangleMeshes)
+	{
+		if (TriangleMesh)
+		{
+			TriangleMesh->release();
+		}
+	}
+	if (CookResult.Heightfield)
+	{
+		CookResult.Heightfield->release();
+	}
+	CookResult = {};
+	ErrorCounter.Reset();
+}
+
 EPhysXMeshCookFlags FVoxelAsyncPhysicsCooker_PhysX::GetCookFlags() const
 {
 	EPhysXMeshCookFlags CookFlags = EPhysXMeshCookFlags::Default;
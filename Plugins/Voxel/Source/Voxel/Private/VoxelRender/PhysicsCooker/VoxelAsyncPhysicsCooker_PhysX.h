@@ -27,10 +27,20 @@ private:
 	//~ End IVoxelAsyncPhysicsCooker Interface
 	
 private:
+	// Returns false on failure
+	bool CreateHeightfield();
 	void CreateTriMesh();
 	void CreateConvexMesh();
 	void DecomposeMeshToHulls();
 	EPhysXMeshCookFlags GetCookFlags() const;
+	// Returns false if there are too few triangles to cook
+	bool GetTriMeshData(TArray<FVector>& OutVertices, TArray<FTriIndices>& OutIndices, TArray<uint16>& OutMaterialIndices) const;
+
+	// Cook to serialized data that can be stored in FVoxelCookedCollisionCache
+	TVoxelSharedRef<FVoxelCookedCollision> CookToCachedData();
+	// Create the meshes from the cooked data. Returns false on failure
+	bool CreateFromCachedData(const FVoxelCookedCollision& Cooked);
+	void ReleaseCookResult();
 
 	IPhysXCooking* const PhysXCooking;
 	FThreadSafeCounter ErrorCounter;
@@ -41,6 +51,7 @@ private:
 		TArray<FKConvexElem> ConvexElems;
 		TArray<physx::PxConvexMesh*> ConvexMeshes;
 		TArray<physx::PxTriangleMesh*> TriangleMeshes;
+		physx::PxHeightField* Heightfield = nullptr;
 
 		uint64 TriangleMeshesMemoryUsage = 0;
 	};
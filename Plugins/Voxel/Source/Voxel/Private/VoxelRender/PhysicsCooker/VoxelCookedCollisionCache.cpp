@@ -0,0 +1,427 @@
+// Copyright 2020 Phyronnaz
+
+#include "VoxelRender/PhysicsCooker/VoxelCookedCollisionCache.h"
+#include "VoxelRender/VoxelProcMeshBuffers.h"
+
+#include "Hash/CityHash.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "Misc/FileHelper.h"
+#include "Misc/CoreDelegates.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "HAL/IConsoleManager.h"
+#include "Runtime/Launch/Resources/Version.h"
+
+DEFINE_VOXEL_MEMORY_STAT(STAT_VoxelCookedCollisionCacheMemory);
+
+TAutoConsoleVariable<int32> CVarCookedCollisionCacheSize(
+	TEXT("voxel.collision.CookedCacheSizeMB"),
+	64,
+	TEXT("Max size in MB of the cache of cooked collisions. Chunks re-meshed with the exact same collision mesh will reuse the cooked data instead of cooking again. 0 to disable"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarPersistCookedCollisionCache(
+	TEXT("voxel.collision.PersistCookedCache"),
+	0,
+	TEXT("If true, the cooked collisions cache will be loaded from Saved/VoxelCollisionCache when first used, and saved there on exit. PhysX only"),
+	ECVF_Default);
+
+static FAutoConsoleCommand LogCookedCollisionCacheStatsCmd(
+	TEXT("voxel.collision.LogCookedCacheStats"),
+	TEXT("Log the hit rate of the cooked collisions cache since the last call, see voxel.collision.CookedCacheSizeMB"),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		FVoxelCookedCollisionCache& Cache = FVoxelCookedCollisionCache::Get();
+		const FVoxelCookedCollisionCacheStats Stats = Cache.GetStats();
+		LOG_VOXEL(Log, TEXT("Cooked collisions cache: %lld hits, %lld misses, hit rate: %.1f%%. %d entries, %.1fMB"),
+			Stats.NumHits,
+			Stats.NumMisses,
+			Stats.GetHitRate() * 100,
+			Stats.NumEntries,
+			Stats.AllocatedSize / double(1 << 20));
+		Cache.ResetStats();
+	}));
+
+static FAutoConsoleCommand ClearCookedCollisionCacheCmd(
+	TEXT("voxel.collision.ClearCookedCache"),
+	TEXT("Clear the cooked collisions cache"),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		FVoxelCookedCollisionCache::Get().Clear();
+	}));
+
+static FAutoConsoleCommand SaveCookedCollisionCacheCmd(
+	TEXT("voxel.collision.SaveCookedCache"),
+	TEXT("Save the cooked collisions cache to Saved/VoxelCollisionCache. PhysX only"),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		FVoxelCookedCollisionCache::Get().SaveToDisk();
+	}));
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+int64 FVoxelCookedCollision::GetAllocatedSize() const
+{
+	int64 Size = sizeof(FVoxelCookedCollision);
+	Size += CookedTriMesh.GetAllocatedSize();
+	Size += CookedConvexes.GetAllocatedSize();
+	for (auto& Convex : CookedConvexes)
+	{
+		Size += Convex.GetAllocatedSize();
+	}
+	Size += ConvexVertices.GetAllocatedSize();
+	for (auto& Vertices : ConvexVertices)
+	{
+		Size += Vertices.GetAllocatedSize();
+	}
+	Size += ChaosTriMeshes.GetAllocatedSize();
+	Size += ChaosTriMeshesAllocatedSize;
+	return Size;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+FVoxelCookedCollisionCache& FVoxelCookedCollisionCache::Get()
+{
+	static FVoxelCookedCollisionCache* Cache = nullptr;
+	if (!Cache)
+	{
+		static FCriticalSection CreateSection;
+		FScopeLock Lock(&CreateSection);
+		if (!Cache)
+		{
+			Cache = new FVoxelCookedCollisionCache();
+			FCoreDelegates::OnPreExit.AddLambda([]()
+			{
+				if (CVarPersistCookedCollisionCache.GetValueOnAnyThread() != 0)
+				{
+					Get().SaveToDisk();
+				}
+			});
+		}
+	}
+	return *Cache;
+}
+
+bool FVoxelCookedCollisionCache::IsEnabled()
+{
+	return CVarCookedCollisionCacheSize.GetValueOnAnyThread() > 0;
+}
+
+FVoxelCookedCollisionKey FVoxelCookedCollisionCache::ComputeKey(const TArray<TVoxelSharedPtr<const FVoxelProcMeshBuffers>>& Buffers, const TArray<uint8>& Settings)
+{
+	VOXEL_ASYNC_FUNCTION_COUNTER();
+
+	// Two independent 64 bit hashes: a collision would give a chunk the collision of another one, so 64 bits are not enough
+	FVoxelCookedCollisionKey Key;
+	Key.HashA = 0x9E3779B97F4A7C15ull;
+	Key.HashB = 0xC2B2AE3D27D4EB4Full;
+
+	const auto Hash = [&](const void* Data, int64 Size)
+	{
+		check(Size < MAX_uint32);
+		Key.HashA = CityHash64WithSeed(static_cast<const char*>(Data), Size, Key.HashA);
+		Key.HashB = CityHash64WithSeed(static_cast<const char*>(Data), Size, Key.HashB);
+	};
+	const auto HashValue = [&](auto Value)
+	{
+		Hash(&Value, sizeof(Value));
+	};
+
+	Hash(Settings.GetData(), Settings.Num());
+
+	HashValue(Buffers.Num());
+	for (auto& Buffer : Buffers)
+	{
+		const int32 NumVertices = Buffer->GetNumVertices();
+		const int32 NumIndices = Buffer->GetNumIndices();
+		const bool b32Bit = Buffer->IndexBuffer.Is32Bit();
+
+		HashValue(NumVertices);
+		HashValue(NumIndices);
+		HashValue(b32Bit);
+
+		if (NumVertices > 0)
+		{
+			Hash(&Buffer->VertexBuffers.PositionVertexBuffer.VertexPosition(0), NumVertices * sizeof(FVector));
+		}
+		if (NumIndices > 0)
+		{
+			if (b32Bit)
+			{
+				Hash(Buffer->IndexBuffer.GetData_32(), NumIndices * sizeof(uint32));
+			}
+			else
+			{
+				Hash(Buffer->IndexBuffer.GetData_16(), NumIndices * sizeof(uint16));
+			}
+		}
+	}
+
+	// Zero is used as invalid key
+	if (!Key.IsValid())
+	{
+		Key.HashA = 1;
+	}
+	return Key;
+}
+
+TVoxelSharedPtr<const FVoxelCookedCollision> FVoxelCookedCollisionCache::Find(const FVoxelCookedCollisionKey& Key)
+{
+	VOXEL_ASYNC_FUNCTION_COUNTER();
+
+	if (!bLoadedFromDisk.Load() && CVarPersistCookedCollisionCache.GetValueOnAnyThread() != 0)
+	{
+		LoadFromDisk();
+	}
+
+	FScopeLock Lock(&Section);
+	if (FEntry* Entry = Entries.Find(Key))
+	{
+		NumHits.Increment();
+		Entry->LastUse = ++UseCounter;
+		return Entry->Collision;
+	}
+	NumMisses.Increment();
+	return nullptr;
+}
+
+void FVoxelCookedCollisionCache::Add(const FVoxelCookedCollisionKey& Key, const TVoxelSharedPtr<const FVoxelCookedCollision>& Collision)
+{
+	VOXEL_ASYNC_FUNCTION_COUNTER();
+	check(Key.IsValid() && Collision.IsValid());
+
+	const int64 MaxSize = int64(CVarCookedCollisionCacheSize.GetValueOnAnyThread()) << 20;
+
+	FScopeLock Lock(&Section);
+	AddEntry_Locked(Key, Collision);
+	Evict_Locked(MaxSize);
+}
+
+void FVoxelCookedCollisionCache::Clear()
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	FScopeLock Lock(&Section);
+	DEC_VOXEL_MEMORY_STAT_BY(STAT_VoxelCookedCollisionCacheMemory, AllocatedSize);
+	Entries.Empty();
+	AllocatedSize = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// Bump when the file layout changes
+static constexpr int32 CookedCollisionCacheVersion = 1;
+
+void FVoxelCookedCollisionCache::SaveToDisk()
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	TArray<uint8> Data;
+	FMemoryWriter Writer(Data);
+
+	int32 Version = CookedCollisionCacheVersion;
+	int32 EngineMajorVersion = ENGINE_MAJOR_VERSION;
+	int32 EngineMinorVersion = ENGINE_MINOR_VERSION;
+	Writer << Version;
+	Writer << EngineMajorVersion;
+	Writer << EngineMinorVersion;
+
+	int32 NumSaved = 0;
+	{
+		FScopeLock Lock(&Section);
+
+		// Most recently used first, so that loading in a smaller cache keeps the useful entries
+		TArray<TPair<FVoxelCookedCollisionKey, const FEntry*>> SortedEntries;
+		for (auto& It : Entries)
+		{
+			if (It.Value.Collision->CanSaveToDisk())
+			{
+				SortedEntries.Emplace(It.Key, &It.Value);
+			}
+		}
+		SortedEntries.Sort([](const auto& A, const auto& B) { return A.Value->LastUse > B.Value->LastUse; });
+
+		int32 Num = SortedEntries.Num();
+		Writer << Num;
+		for (auto& It : SortedEntries)
+		{
+			FVoxelCookedCollisionKey Key = It.Key;
+			FVoxelCookedCollision& Collision = const_cast<FVoxelCookedCollision&>(*It.Value->Collision);
+			Writer << Key;
+			Writer << Collision.CookedTriMesh;
+			Writer << Collision.CookedConvexes;
+			Writer << Collision.ConvexVertices;
+			Writer << Collision.ConvexBounds;
+		}
+		NumSaved = Num;
+	}
+
+	const FString Path = GetDiskPath();
+	if (FFileHelper::SaveArrayToFile(Data, *Path))
+	{
+		LOG_VOXEL(Log, TEXT("Saved %d cooked collisions to %s (%.1fMB)"), NumSaved, *Path, Data.Num() / double(1 << 20));
+	}
+	else
+	{
+		LOG_VOXEL(Warning, TEXT("Failed to save the cooked collisions cache to %s"), *Path);
+	}
+}
+
+void FVoxelCookedCollisionCache::LoadFromDisk()
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	FScopeLock Lock(&Section);
+	if (bLoadedFromDisk.Load())
+	{
+		return;
+	}
+	bLoadedFromDisk.Store(true);
+
+	const FString Path = GetDiskPath();
+
+	TArray<uint8> Data;
+	if (!FFileHelper::LoadFileToArray(Data, *Path, FILEREAD_Silent))
+	{
+		return;
+	}
+
+	FMemoryReader Reader(Data);
+
+	int32 Version = 0;
+	int32 EngineMajorVersion = 0;
+	int32 EngineMinorVersion = 0;
+	Reader << Version;
+	Reader << EngineMajorVersion;
+	Reader << EngineMinorVersion;
+
+	// Cooked data is not compatible across PhysX versions
+	if (Version != CookedCollisionCacheVersion ||
+		EngineMajorVersion != ENGINE_MAJOR_VERSION ||
+		EngineMinorVersion != ENGINE_MINOR_VERSION)
+	{
+		LOG_VOXEL(Log, TEXT("Ignoring outdated cooked collisions cache %s"), *Path);
+		return;
+	}
+
+	const int64 MaxSize = int64(CVarCookedCollisionCacheSize.GetValueOnAnyThread()) << 20;
+
+	int32 Num = 0;
+	Reader << Num;
+
+	int32 NumLoaded = 0;
+	for (int32 Index = 0; Index < Num && !Reader.IsError(); Index++)
+	{
+		FVoxelCookedCollisionKey Key;
+		const TVoxelSharedRef<FVoxelCookedCollision> Collision = MakeVoxelShared<FVoxelCookedCollision>();
+		Reader << Key;
+		Reader << Collision->CookedTriMesh;
+		Reader << Collision->CookedConvexes;
+		Reader << Collision->ConvexVertices;
+		Reader << Collision->ConvexBounds;
+
+		if (Reader.IsError() || !Key.IsValid())
+		{
+			break;
+		}
+		if (AllocatedSize + Collision->GetAllocatedSize() > MaxSize)
+		{
+			// Entries are sorted by last use
+			break;
+		}
+		if (!Entries.Contains(Key))
+		{
+			AddEntry_Locked(Key, Collision);
+			NumLoaded++;
+		}
+	}
+
+	LOG_VOXEL(Log, TEXT("Loaded %d cooked collisions from %s"), NumLoaded, *Path);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+FVoxelCookedCollisionCacheStats FVoxelCookedCollisionCache::GetStats() const
+{
+	FScopeLock Lock(&Section);
+
+	FVoxelCookedCollisionCacheStats Stats;
+	Stats.NumHits = NumHits.GetValue();
+	Stats.NumMisses = NumMisses.GetValue();
+	Stats.NumEntries = Entries.Num();
+	Stats.AllocatedSize = AllocatedSize;
+	return Stats;
+}
+
+void FVoxelCookedCollisionCache::ResetStats()
+{
+	NumHits.Reset();
+	NumMisses.Reset();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+void FVoxelCookedCollisionCache::AddEntry_Locked(const FVoxelCookedCollisionKey& Key, const TVoxelSharedPtr<const FVoxelCookedCollision>& Collision)
+{
+	FEntry& Entry = Entries.FindOrAdd(Key);
+
+	AllocatedSize -= Entry.AllocatedSize;
+	DEC_VOXEL_MEMORY_STAT_BY(STAT_VoxelCookedCollisionCacheMemory, Entry.AllocatedSize);
+
+	Entry.Collision = Collision;
+	Entry.AllocatedSize = Collision->GetAllocatedSize();
+	Entry.LastUse = ++UseCounter;
+
+	AllocatedSize += Entry.AllocatedSize;
+	INC_VOXEL_MEMORY_STAT_BY(STAT_VoxelCookedCollisionCacheMemory, Entry.AllocatedSize);
+}
+
+void FVoxelCookedCollisionCache::Evict_Locked(int64 MaxSize)
+{
+	if (AllocatedSize <= MaxSize)
+	{
+		return;
+	}
+
+	VOXEL_ASYNC_FUNCTION_COUNTER();
+
+	// Evict down to 3/4 of the budget so that we don't have to sort the entries on every add
+	const int64 TargetSize = MaxSize / 4 * 3;
+
+	TArray<TPair<uint64, FVoxelCookedCollisionKey>> SortedKeys;
+	SortedKeys.Reserve(Entries.Num());
+	for (auto& It : Entries)
+	{
+		SortedKeys.Emplace(It.Value.LastUse, It.Key);
+	}
+	SortedKeys.Sort([](const auto& A, const auto& B) { return A.Key < B.Key; });
+
+	for (auto& It : SortedKeys)
+	{
+		if (AllocatedSize <= TargetSize)
+		{
+			break;
+		}
+
+		const FEntry Entry = Entries.FindAndRemoveChecked(It.Value);
+		AllocatedSize -= Entry.AllocatedSize;
+		DEC_VOXEL_MEMORY_STAT_BY(STAT_VoxelCookedCollisionCacheMemory, Entry.AllocatedSize);
+	}
+}
+
+FString FVoxelCookedCollisionCache::GetDiskPath()
+{
+	return FPaths::ProjectSavedDir() / TEXT("VoxelCollisionCache") / FString::Printf(TEXT("CookedCollisions_%s.bin"), *FPlatformProperties::GetPhysicsFormat().ToString());
+}
@@ -0,0 +1,130 @@
+// Copyright 2020 Phyronnaz
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VoxelMinimal.h"
+#include "HAL/ConsoleManager.h"
+
+struct FVoxelProcMeshBuffers;
+
+namespace Chaos
+{
+	class FTriangleMeshImplicitObject;
+}
+
+DECLARE_VOXEL_MEMORY_STAT(TEXT("Voxel Cooked Collision Cache Memory"), STAT_VoxelCookedCollisionCacheMemory, STATGROUP_VoxelMemory, VOXEL_API);
+
+extern TAutoConsoleVariable<int32> CVarCookedCollisionCacheSize;
+
+struct FVoxelCookedCollisionKey
+{
+	uint64 HashA = 0;
+	uint64 HashB = 0;
+
+	FORCEINLINE bool IsValid() const
+	{
+		return HashA != 0 || HashB != 0;
+	}
+	FORCEINLINE bool operator==(const FVoxelCookedCollisionKey& Other) const
+	{
+		return HashA == Other.HashA && HashB == Other.HashB;
+	}
+	FORCEINLINE friend uint32 GetTypeHash(const FVoxelCookedCollisionKey& Key)
+	{
+		return uint32(Key.HashA);
+	}
+	friend FArchive& operator<<(FArchive& Ar, FVoxelCookedCollisionKey& Key)
+	{
+		Ar << Key.HashA;
+		Ar << Key.HashB;
+		return Ar;
+	}
+};
+
+// Output of a cooker, enough to recreate the physics meshes without cooking again
+struct FVoxelCookedCollision
+{
+	// PhysX: cooked data, can be saved to disk
+	TArray<uint8> CookedTriMesh;
+	TArray<TArray<uint8>> CookedConvexes;
+	// Vertices of the convexes, in root space
+	TArray<TArray<FVector>> ConvexVertices;
+	FBox ConvexBounds = FBox(ForceInit);
+
+	// Chaos: the implicit objects are immutable once built and can be shared by several body setups
+	TArray<TSharedPtr<Chaos::FTriangleMeshImplicitObject, ESPMode::ThreadSafe>> ChaosTriMeshes;
+	// Chaos has no easy way to query the size of its meshes, so the cooker estimates it
+	int64 ChaosTriMeshesAllocatedSize = 0;
+
+	int64 GetAllocatedSize() const;
+	bool CanSaveToDisk() const
+	{
+		return ChaosTriMeshes.Num() == 0;
+	}
+};
+
+struct FVoxelCookedCollisionCacheStats
+{
+	int64 NumHits = 0;
+	int64 NumMisses = 0;
+	int32 NumEntries = 0;
+	int64 AllocatedSize = 0;
+
+	double GetHitRate() const
+	{
+		return NumHits + NumMisses == 0 ? 0. : double(NumHits) / double(NumHits + NumMisses);
+	}
+};
+
+/**
+ * Bounded cache of cooked collisions, keyed by a 128 bit hash of the collision buffers & of the cooking settings
+ * Re-meshing a chunk very often gives back the exact same collision mesh (edits far from the chunk, LOD changes, flat terrain...):
+ * this lets the cookers skip cooking entirely
+ * Entries are evicted in least recently used order, by batches, once the cache is above voxel.collision.CookedCacheSizeMB
+ * PhysX entries can optionally be saved to disk between sessions, see voxel.collision.PersistCookedCache
+ * Thread safe
+ */
+class FVoxelCookedCollisionCache
+{
+public:
+	static FVoxelCookedCollisionCache& Get();
+
+	static bool IsEnabled();
+	// Settings must contain everything the cooked result depends on, apart from the buffers
+	static FVoxelCookedCollisionKey ComputeKey(const TArray<TVoxelSharedPtr<const FVoxelProcMeshBuffers>>& Buffers, const TArray<uint8>& Settings);
+
+	TVoxelSharedPtr<const FVoxelCookedCollision> Find(const FVoxelCookedCollisionKey& Key);
+	void Add(const FVoxelCookedCollisionKey& Key, const TVoxelSharedPtr<const FVoxelCookedCollision>& Collision);
+	void Clear();
+
+	void SaveToDisk();
+	void LoadFromDisk();
+
+	FVoxelCookedCollisionCacheStats GetStats() const;
+	void ResetStats();
+
+private:
+	FVoxelCookedCollisionCache() = default;
+
+	struct FEntry
+	{
+		TVoxelSharedPtr<const FVoxelCookedCollision> Collision;
+		int64 AllocatedSize = 0;
+		uint64 LastUse = 0;
+	};
+
+	mutable FCriticalSection Section;
+	TMap<FVoxelCookedCollisionKey, FEntry> Entries;
+	int64 AllocatedSize = 0;
+	uint64 UseCounter = 0;
+	// Read without the lock by Find, only set under the lock by LoadFromDisk
+	TAtomic<bool> bLoadedFromDisk{ false };
+
+	FThreadSafeCounter64 NumHits;
+	FThreadSafeCounter64 NumMisses;
+
+	void AddEntry_Locked(const FVoxelCookedCollisionKey& Key, const TVoxelSharedPtr<const FVoxelCookedCollision>& Collision);
+	void Evict_Locked(int64 MaxSize);
+	static FString GetDiskPath();
+};
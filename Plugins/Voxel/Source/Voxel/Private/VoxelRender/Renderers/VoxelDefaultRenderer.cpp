@@ -4,6 +4,7 @@
 #include "VoxelMessages.h"
 #include "IVoxelPool.h"
 #include "VoxelRender/VoxelMesherAsyncWork.h"
+#include "VoxelRender/Meshers/VoxelMesherValuesCache.h"
 #include "VoxelRender/Renderers/VoxelRendererMeshHandler.h"
 #include "VoxelRender/Renderers/VoxelRendererBasicMeshHandler.h"
 #include "VoxelRender/Renderers/VoxelRendererClusteredMeshHandler.h"
@@ -14,6 +15,10 @@
 #include "VoxelDebug/VoxelDebugManager.h"
 #include "VoxelData/VoxelData.h"
 #include "VoxelGenerators/VoxelGeneratorInstance.h"
+#include "VoxelPriorityHandler.h"
+
+#include "Camera/PlayerCameraManager.h"
+#include "Kismet/GameplayStatics.h"
 
 DEFINE_VOXEL_MEMORY_STAT(STAT_VoxelRenderer);
 
@@ -23,6 +28,146 @@ static TAutoConsoleVariable<int32> CVarFreezeRenderer(
 	TEXT("Stops renderer tick"),
 	ECVF_Default);
 
+static TAutoConsoleVariable<int32> CVarPrioritizeMeshUpdates(
+	TEXT("voxel.renderer.PrioritizeMeshUpdates"),
+	1,
+	TEXT("If 1, the mesh updates that don't fit in the MeshUpdatesBudget are sorted by distance to the invokers & camera frustum. If 0, they are applied in the order the tasks finished"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarMeshUpdatesMaxDelay(
+	TEXT("voxel.renderer.MeshUpdatesMaxDelay"),
+	1.f,
+	TEXT("Time in seconds after which a mesh update is applied before any higher priority one, so that far away chunks are still updated"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarRecordLODUpdates(
+	TEXT("voxel.renderer.RecordLODUpdates"),
+	0,
+	TEXT("If 1, the chunk updates received by the renderers are recorded, to be replayed by voxel.renderer.BenchmarkChunkTable"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarMaxRecordedLODUpdates(
+	TEXT("voxel.renderer.MaxRecordedLODUpdates"),
+	10000,
+	TEXT("Max number of LOD updates kept by voxel.renderer.RecordLODUpdates. Once reached, the oldest updates are dropped"),
+	ECVF_Default);
+
+// Game thread only
+static TArray<TArray<FVoxelChunkUpdate>> GRecordedLODUpdates;
+
+// Replays the recorded updates the way UpdateLODs uses its chunks: find or add the updated chunks, find their previous chunks,
+// remove the chunks without render chunk, and iterate all the chunks once per update
+template<typename TAdd, typename TFind, typename TRemove, typename TIterate>
+static void ReplayLODUpdates(const TCHAR* Name, int32 NumIterations, TAdd Add, TFind Find, TRemove Remove, TIterate Iterate)
+{
+	uint64 LookupCycles = 0;
+	uint64 IterateCycles = 0;
+	uint64 Checksum = 0;
+	for (int32 Iteration = 0; Iteration < NumIterations; Iteration++)
+	{
+		for (const TArray<FVoxelChunkUpdate>& ChunkUpdates : GRecordedLODUpdates)
+		{
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+			for (const FVoxelChunkUpdate& ChunkUpdate : ChunkUpdates)
+			{
+				if (!Find(ChunkUpdate.Id, Checksum))
+				{
+					Add(ChunkUpdate.Id);
+				}
+				for (const uint64 PreviousChunkId : ChunkUpdate.PreviousChunks)
+				{
+					Find(PreviousChunkId, Checksum);
+				}
+			}
+			for (const FVoxelChunkUpdate& ChunkUpdate : ChunkUpdates)
+			{
+				if (!ChunkUpdate.NewSettings.HasRenderChunk())
+				{
+					Remove(ChunkUpdate.Id);
+				}
+			}
+			const uint64 MiddleCycles = FPlatformTime::Cycles64();
+			Iterate(Checksum);
+			const uint64 EndCycles = FPlatformTime::Cycles64();
+
+			LookupCycles += MiddleCycles - StartCycles;
+			IterateCycles += EndCycles - MiddleCycles;
+		}
+	}
+
+	LOG_VOXEL(Log, TEXT("%s: Find/Add/Remove: %.3fms; Iterate: %.3fms (checksum %llu)"),
+		Name,
+		FPlatformTime::ToMilliseconds64(LookupCycles) / NumIterations,
+		FPlatformTime::ToMilliseconds64(IterateCycles) / NumIterations,
+		Checksum);
+}
+
+static void BenchmarkChunkTable(int32 NumIterations)
+{
+	VOXEL_FUNCTION_COUNTER();
+	
+	if (GRecordedLODUpdates.Num() == 0)
+	{
+		LOG_VOXEL(Error, TEXT("No LOD update recorded. Set voxel.renderer.RecordLODUpdates to 1 and move around first"));
+		return;
+	}
+
+	int32 NumUpdates = 0;
+	for (auto& ChunkUpdates : GRecordedLODUpdates)
+	{
+		NumUpdates += ChunkUpdates.Num();
+	}
+	LOG_VOXEL(Log, TEXT("Replaying %d LOD updates with %d chunk updates %d times"), GRecordedLODUpdates.Num(), NumUpdates, NumIterations);
+
+	// Roughly the size of a renderer chunk
+	struct FBenchmarkChunk
+	{
+		uint64 Id;
+		uint8 Padding[248];
+	};
+
+	{
+		TMap<uint64, FBenchmarkChunk> Map;
+		ReplayLODUpdates(
+			TEXT("TMap"),
+			NumIterations,
+			[&](uint64 Id) { Map.Add(Id, FBenchmarkChunk{ Id }); },
+			[&](uint64 Id, uint64& Checksum) { const FBenchmarkChunk* Chunk = Map.Find(Id); Checksum += Chunk ? Chunk->Id : 0; return Chunk != nullptr; },
+			[&](uint64 Id) { Map.Remove(Id); },
+			[&](uint64& Checksum) { for (auto& It : Map) { Checksum += It.Value.Id; } });
+	}
+	{
+		TVoxelChunkTable<FBenchmarkChunk> Table;
+		ReplayLODUpdates(
+			TEXT("TVoxelChunkTable"),
+			NumIterations,
+			[&](uint64 Id) { Table.Add(Id, FBenchmarkChunk{ Id }); },
+			[&](uint64 Id, uint64& Checksum) { const FBenchmarkChunk* Chunk = Table.Find(Id); Checksum += Chunk ? Chunk->Id : 0; return Chunk != nullptr; },
+			[&](uint64 Id) { Table.Remove(Id); },
+			[&](uint64& Checksum) { for (const FBenchmarkChunk& Chunk : Table) { Checksum += Chunk.Id; } });
+	}
+}
+
+static FAutoConsoleCommand BenchmarkChunkTableCmd(
+	TEXT("voxel.renderer.BenchmarkChunkTable"),
+	TEXT("Replay the LOD updates recorded with voxel.renderer.RecordLODUpdates against a TMap and a TVoxelChunkTable. Args: [NumIterations]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		BenchmarkChunkTable(Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 10);
+	}));
+
+static FAutoConsoleCommand ClearRecordedLODUpdatesCmd(
+	TEXT("voxel.renderer.ClearRecordedLODUpdates"),
+	TEXT("Clear the LOD updates recorded with voxel.renderer.RecordLODUpdates"),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		GRecordedLODUpdates.Empty();
+	}));
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
 FVoxelDefaultRenderer::FVoxelDefaultRenderer(const FVoxelRendererSettings& Settings)
 	: IVoxelRenderer(Settings)
 	, MeshHandler(Settings.bMergeChunks ? Settings.bDoNotMergeCollisionsAndNavmesh
@@ -61,17 +206,21 @@ void FVoxelDefaultRenderer::Destroy()
 	// Destroy mesh handler & meshes
 	MeshHandler->StartDestroying();
 
-	for (auto& It : ChunksMap)
+	for (FChunk& Chunk : ChunksMap)
 	{
-		CancelTasks(It.Value);
-		if (It.Value.MeshId.IsValid())
+		CancelTasks(Chunk);
+		if (Chunk.MeshId.IsValid())
 		{
 			// Not really needed, but useful for error checks
-			MeshHandler->RemoveChunk(It.Value.MeshId);
+			MeshHandler->RemoveChunk(Chunk.MeshId);
 		}
 	}
 
 	ChunksMap.Reset();
+	for (auto& Chunks : ChunksByState)
+	{
+		Chunks.Reset();
+	}
 	MeshHandler.Reset();
 }
 
@@ -115,13 +264,13 @@ int32 FVoxelDefaultRenderer::UpdateChunks(
 
 		FVoxelIntBoxWithValidity ChunksToRemoveBounds;
 		// First remove all chunks that are dithering out
-		for (auto& ChunkToRemove : ChunksToRemove)
+		for (FChunk* Chunk : GetChunksInState(EChunkState::DitheringOut))
 		{
-			FChunk& Chunk = ChunksMap.FindChecked(ChunkToRemove.Id);
-			if (Chunk.Bounds.Intersect(Bounds))
+			if (Chunk->Bounds.Intersect(Bounds))
 			{
-				ChunkToRemove.Time = 0;
-				ChunksToRemoveBounds += Chunk.Bounds;
+				ensure(Chunk->IsDitheringScheduled());
+				Chunk->DitheringEndTime = 0;
+				ChunksToRemoveBounds += Chunk->Bounds;
 			}
 		}
 
@@ -132,12 +281,12 @@ int32 FVoxelDefaultRenderer::UpdateChunks(
 		// This chunk will have been picked up in the iteration above
 		if (ChunksToRemoveBounds.IsValid())
 		{
-			for (auto& ChunkToShow : ChunksToShow)
+			for (FChunk* Chunk : GetChunksInState(EChunkState::DitheringIn))
 			{
-				FChunk& Chunk = ChunksMap.FindChecked(ChunkToShow.Id);
-				if (Chunk.Bounds.Intersect(ChunksToRemoveBounds.GetBox()))
+				// Chunks without a mesh yet haven't started dithering in
+				if (Chunk->IsDitheringScheduled() && Chunk->Bounds.Intersect(ChunksToRemoveBounds.GetBox()))
 				{
-					ChunkToShow.Time = 0;
+					Chunk->DitheringEndTime = 0;
 				}
 			}
 		}
@@ -214,6 +363,16 @@ void FVoxelDefaultRenderer::UpdateLODs(const uint64 InUpdateIndex, const TArray<
 	UpdateIndex++;
 	if (!ensure(UpdateIndex == InUpdateIndex)) return;
 
+	if (CVarRecordLODUpdates.GetValueOnGameThread() != 0)
+	{
+		const int32 MaxRecordedLODUpdates = FMath::Max(1, CVarMaxRecordedLODUpdates.GetValueOnGameThread());
+		if (GRecordedLODUpdates.Num() >= MaxRecordedLODUpdates)
+		{
+			GRecordedLODUpdates.RemoveAt(0, GRecordedLODUpdates.Num() - MaxRecordedLODUpdates + 1, false);
+		}
+		GRecordedLODUpdates.Add(ChunkUpdates);
+	}
+
 	// Map used to know which chunks to wait for before dithering out
 	TMap<uint64, TArray<uint64, TInlineAllocator<8>>> OldChunksToNewChunks;
 	// Need to do it after the main pass, else OldChunksToNewChunks wouldn't be filled
@@ -236,7 +395,7 @@ void FVoxelDefaultRenderer::UpdateLODs(const uint64 InUpdateIndex, const TArray<
 			else
 			{
 				ensure(!OldSettings.HasRenderChunk());
-				Chunk = &ChunksMap.Add(ChunkUpdate.Id, FChunk(ChunkUpdate.Id, ChunkUpdate.LOD, ChunkUpdate.Bounds));
+				Chunk = &AddChunk(ChunkUpdate.Id, ChunkUpdate.LOD, ChunkUpdate.Bounds);
 			}
 			check(Chunk);
 			return *Chunk;
@@ -277,14 +436,14 @@ void FVoxelDefaultRenderer::UpdateLODs(const uint64 InUpdateIndex, const TArray<
 				if (Chunk.GetState() == EChunkState::DitheringOut)
 				{
 					ensure(Chunk.PreviousChunks.Num() == 0);
-					ChunksToRemove.RemoveAllSwap([&](auto& X) { return X.Id == Chunk.Id; }, false);
 				}
 				if (Chunk.GetState() == EChunkState::DitheringIn)
 				{
 					ensure(Settings.bDitherChunks);
 					// Note: will probably have previous chunks
-					ChunksToShow.RemoveAllSwap([&](auto& X) { return X.Id == Chunk.Id; }, false);
 				}
+				// No need to look it up: ProcessChunksToRemoveOrShow skips chunks whose dithering isn't scheduled
+				Chunk.DitheringEndTime = -1;
 			};
 			
 			if (NewSettings.bVisible)
@@ -375,7 +534,7 @@ void FVoxelDefaultRenderer::UpdateLODs(const uint64 InUpdateIndex, const TArray<
 				// Set UpdateIndex as we are being showed
 				Chunk.UpdateIndex = UpdateIndex;
 				
-				Chunk.SetState(Settings.bDitherChunks ? EChunkState::DitheringIn : EChunkState::Showed, STATIC_FNAME("Turned visible"));
+				SetChunkState(Chunk, Settings.bDitherChunks ? EChunkState::DitheringIn : EChunkState::Showed, STATIC_FNAME("Turned visible"));
 				if (!Chunk.MeshId.IsValid())
 				{
 					// If we don't have a mesh:
@@ -435,8 +594,7 @@ void FVoxelDefaultRenderer::UpdateLODs(const uint64 InUpdateIndex, const TArray<
 				}
 
 				// We can't be in any of these states if we get here
-				ensureVoxelSlowNoSideEffects(!ChunksToRemove.FindByPredicate([&](const FChunkToRemove& ChunkToRemove) { return ChunkToRemove.Id == Chunk.Id; }));
-				ensureVoxelSlowNoSideEffects(!ChunksToShow.FindByPredicate([&](const FChunkToShow& ChunkToShow) { return ChunkToShow.Id == Chunk.Id; }));
+				ensureVoxelSlowNoSideEffects(!Chunk.IsDitheringScheduled());
 				
 				if (!NewSettings.HasRenderChunk())
 				{
@@ -456,12 +614,12 @@ void FVoxelDefaultRenderer::UpdateLODs(const uint64 InUpdateIndex, const TArray<
 					else
 					{
 						// No mesh nor chunks to wait for: can just set the state to hidden
-						Chunk.SetState(EChunkState::Hidden, STATIC_FNAME(""));
+						SetChunkState(Chunk, EChunkState::Hidden, STATIC_FNAME(""));
 					}
 				}
 				else
 				{
-					Chunk.SetState(EChunkState::WaitingForNewChunks, STATIC_FNAME("Hiding chunk"));
+					SetChunkState(Chunk, EChunkState::WaitingForNewChunks, STATIC_FNAME("Hiding chunk"));
 					ChunksToDitherOutOrRemoveOnceNewChunksAreUpdated.Add(Chunk.Id);
 				}
 			}
@@ -482,7 +640,7 @@ void FVoxelDefaultRenderer::UpdateLODs(const uint64 InUpdateIndex, const TArray<
 				ensure(!NewSettings.bVisible);
 				ensure(NewSettings.HasRenderChunk() && !OldSettings.HasRenderChunk());
 				StartTask<EMainOrTransitions::Main, EIfTaskExists::Assert>(Chunk);
-				Chunk.SetState(EChunkState::Hidden, STATIC_FNAME("Hidden New Chunk"));
+				SetChunkState(Chunk, EChunkState::Hidden, STATIC_FNAME("Hidden New Chunk"));
 				break;
 			}
 			case EChunkState::Hidden:
@@ -616,9 +774,9 @@ void FVoxelDefaultRenderer::UpdateLODs(const uint64 InUpdateIndex, const TArray<
 		{
 			TArray<FVoxelIntBox> Result;
 			Result.Reserve(ChunksMap.Num());
-			for (auto& It : ChunksMap)
+			for (const FChunk& Chunk : ChunksMap)
 			{
-				Result.Add(It.Value.Bounds);
+				Result.Add(Chunk.Bounds);
 			}
 			return Result;
 		});
@@ -660,9 +818,8 @@ void FVoxelDefaultRenderer::ApplyNewMaterials()
 
 	MeshHandler->ClearChunkMaterials();
 
-	for (auto& It : ChunksMap)
+	for (const FChunk& Chunk : ChunksMap)
 	{
-		const auto& Chunk = It.Value;
 		if (Chunk.MeshId.IsValid() && ensure(Chunk.BuiltData.MainChunk.IsValid()))
 		{
 			MeshHandler->UpdateChunk(
@@ -720,16 +877,23 @@ void FVoxelDefaultRenderer::Tick(float)
 	ProcessMeshUpdates(MaxTime);
 	FlushQueuedTasks();
 
-	if (!OnWorldLoadedFired && UpdateIndex > 0 && TaskCount.GetValue() == 0 && TasksCallbacksQueue.IsEmpty())
+	if (!OnWorldLoadedFired && UpdateIndex > 0 && TaskCount.GetValue() == 0 && TasksCallbacksQueue.IsEmpty() && PendingMeshUpdates.Num() == 0)
 	{
 		OnWorldLoaded.Broadcast();
 		OnWorldLoadedFired = true;
 	}
 
+	if (bHasStartedTasks && TaskCount.GetValue() == 0)
+	{
+		// The meshing wave is over: the blocks would only be reused by the next one if nothing changed in between
+		Settings.MesherValuesCache->Clear();
+		bHasStartedTasks = false;
+	}
+
 	UpdateAllocatedSize();
 	
 	Settings.DebugManager->ReportMeshTaskCount(TaskCount.GetValue());
-	Settings.DebugManager->ReportMeshTasksCallbacksQueueNum(TasksCallbacksQueue.Num());
+	Settings.DebugManager->ReportMeshTasksCallbacksQueueNum(TasksCallbacksQueue.Num() + PendingMeshUpdates.Num());
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -862,8 +1026,7 @@ void FVoxelDefaultRenderer::NewChunksFinished(FChunk& Chunk, const FChunk& NewCh
 	
 	ensure(Chunk.GetState() == EChunkState::WaitingForNewChunks);
 	ensure(Chunk.NumNewChunksLeft == 0);
-	ensureVoxelSlowNoSideEffects(!ChunksToRemove.FindByPredicate([&](const FChunkToRemove& ChunkToRemove) { return ChunkToRemove.Id == Chunk.Id; }));
-	ensureVoxelSlowNoSideEffects(!ChunksToShow.FindByPredicate([&](const FChunkToShow& ChunkToShow) { return ChunkToShow.Id == Chunk.Id; }));
+	ensureVoxelSlowNoSideEffects(!Chunk.IsDitheringScheduled());
 	
 	ClearPreviousChunks(Chunk); // Recursively delete previous chunks
 
@@ -879,9 +1042,9 @@ void FVoxelDefaultRenderer::NewChunksFinished(FChunk& Chunk, const FChunk& NewCh
 				ensure(Chunk.MeshId.IsValid());
 				ensure(Chunk.Settings.bVisible);
 				
-				Chunk.SetState(EChunkState::DitheringOut, STATIC_FNAME("NewChunksFinished"));
+				SetChunkState(Chunk, EChunkState::DitheringOut, STATIC_FNAME("NewChunksFinished"));
 				MeshHandler->DitherChunk(Chunk.MeshId, EDitheringType::SurfaceNets_HighResToLowRes);
-				ChunksToRemove.Add(FChunkToRemove{ Chunk.Id, FPlatformTime::Seconds() + Settings.ChunksDitheringDuration });
+				Chunk.DitheringEndTime = FPlatformTime::Seconds() + Settings.ChunksDitheringDuration;
 			}
 			else
 			{
@@ -894,10 +1057,10 @@ void FVoxelDefaultRenderer::NewChunksFinished(FChunk& Chunk, const FChunk& NewCh
 			ensure(Chunk.MeshId.IsValid());
 			ensure(Chunk.Settings.bVisible);
 
-			Chunk.SetState(EChunkState::DitheringOut, STATIC_FNAME("NewChunksFinished"));
+			SetChunkState(Chunk, EChunkState::DitheringOut, STATIC_FNAME("NewChunksFinished"));
 			MeshHandler->DitherChunk(Chunk.MeshId, EDitheringType::Classic_DitherOut);
 			// 2x: First dithering in new chunk, then dither out old chunk
-			ChunksToRemove.Add(FChunkToRemove{ Chunk.Id, FPlatformTime::Seconds() + 2 * Settings.ChunksDitheringDuration });
+			Chunk.DitheringEndTime = FPlatformTime::Seconds() + 2 * Settings.ChunksDitheringDuration;
 		}
 	}
 	else
@@ -916,8 +1079,7 @@ void FVoxelDefaultRenderer::RemoveOrHideChunk(FChunk& Chunk)
 	// DitheringOut if dithering enabled, else it's removed once WaitingForNewChunks is over
 	ensure(Chunk.GetState() == EChunkState::DitheringOut || Chunk.GetState() == EChunkState::WaitingForNewChunks);
 	
-	ensureVoxelSlowNoSideEffects(!ChunksToRemove.FindByPredicate([&](const FChunkToRemove& ChunkToRemove) { return ChunkToRemove.Id == Chunk.Id; }));
-	ensureVoxelSlowNoSideEffects(!ChunksToShow.FindByPredicate([&](const FChunkToShow& ChunkToShow) { return ChunkToShow.Id == Chunk.Id; }));
+	ensureVoxelSlowNoSideEffects(!Chunk.IsDitheringScheduled());
 
 	// Note: MeshId might be 0 if we were waiting for other chunks
 	
@@ -933,7 +1095,7 @@ void FVoxelDefaultRenderer::RemoveOrHideChunk(FChunk& Chunk)
 	{
 		ApplyPendingSettings(Chunk, true); // Can apply the real settings now
 		ensure(Chunk.Settings == Chunk.PendingSettings);
-		Chunk.SetState(EChunkState::Hidden, STATIC_FNAME("RemoveOrHideChunk"));
+		SetChunkState(Chunk, EChunkState::Hidden, STATIC_FNAME("RemoveOrHideChunk"));
 	}
 	else
 	{
@@ -954,8 +1116,7 @@ void FVoxelDefaultRenderer::DitherInChunk(FChunk& Chunk, const TArray<uint64, TI
 	
 	if (!ensure(Chunk.MeshId.IsValid())) return;
 	
-	ensureVoxelSlowNoSideEffects(!ChunksToRemove.FindByPredicate([&](const FChunkToRemove& ChunkToRemove) { return ChunkToRemove.Id == Chunk.Id; }));
-	ensureVoxelSlowNoSideEffects(!ChunksToShow.FindByPredicate([&](const FChunkToShow& ChunkToShow) { return ChunkToShow.Id == Chunk.Id; }));
+	ensureVoxelSlowNoSideEffects(!Chunk.IsDitheringScheduled());
 	
 	if (Settings.RenderType == EVoxelRenderType::SurfaceNets)
 	{
@@ -973,21 +1134,21 @@ void FVoxelDefaultRenderer::DitherInChunk(FChunk& Chunk, const TArray<uint64, TI
 			{
 				// We are the high res one
 				MeshHandler->DitherChunk(Chunk.MeshId, EDitheringType::SurfaceNets_LowResToHighRes);
-				ChunksToShow.Add(FChunkToShow{ Chunk.Id, FPlatformTime::Seconds() + Settings.ChunksDitheringDuration });
+				Chunk.DitheringEndTime = FPlatformTime::Seconds() + Settings.ChunksDitheringDuration;
 			}
 			else
 			{
 				// We are the low res: the high res will do the work
 				// Note: bTransitionsChunkIsBuilt is always true for surface nets, so dithering will happen at the same time for both
 				MeshHandler->HideChunk(Chunk.MeshId);
-				ChunksToShow.Add(FChunkToShow{ Chunk.Id, FPlatformTime::Seconds() + Settings.ChunksDitheringDuration });
+				Chunk.DitheringEndTime = FPlatformTime::Seconds() + Settings.ChunksDitheringDuration;
 			}
 		}
 	}
 	else
 	{
 		MeshHandler->DitherChunk(Chunk.MeshId, EDitheringType::Classic_DitherIn);
-		ChunksToShow.Add(FChunkToShow{ Chunk.Id, FPlatformTime::Seconds() + Settings.ChunksDitheringDuration });
+		Chunk.DitheringEndTime = FPlatformTime::Seconds() + Settings.ChunksDitheringDuration;
 	}
 }
 
@@ -1103,172 +1264,314 @@ void FVoxelDefaultRenderer::ProcessChunksToRemoveOrShow()
 	
 	const double Time = FPlatformTime::Seconds();
 
-	// Process ChunksToShow before ChunksToRemove for action queue ordering
+	// Process the chunks dithering in before the ones dithering out for action queue ordering
 	
 	{
-		VOXEL_SCOPE_COUNTER("Processing ChunksToShow");
-		ensure(Settings.bDitherChunks || ChunksToShow.Num() == 0);
-		for (int32 Index = 0; Index < ChunksToShow.Num(); Index++)
+		VOXEL_SCOPE_COUNTER("Processing chunks dithering in");
+		const TArray<FChunk*>& ChunksDitheringIn = GetChunksInState(EChunkState::DitheringIn);
+		ensure(Settings.bDitherChunks || ChunksDitheringIn.Num() == 0);
+		// Iterate backwards: showing a chunk swaps the last chunk in its place, which was already processed
+		for (int32 Index = ChunksDitheringIn.Num() - 1; Index >= 0; Index--)
 		{
-			const auto ChunkToShow = ChunksToShow[Index];
-			if (ChunkToShow.Time < Time)
+			FChunk& Chunk = *ChunksDitheringIn[Index];
+			if (!Chunk.IsDitheringScheduled() || Chunk.DitheringEndTime >= Time)
 			{
-				FChunk& Chunk = ChunksMap.FindChecked(ChunkToShow.Id);
-				if (Chunk.GetState() != EChunkState::DitheringIn) continue; // Chunk is not dithering in anymore
+				continue;
+			}
 
-				// ensure(Chunk.PreviousChunks.Num() == 0); Not always true: main chunk can have finished dithering but transitions still being computed
-				Chunk.SetState(EChunkState::Showed, STATIC_FNAME("ChunkToShow"));
+			// ensure(Chunk.PreviousChunks.Num() == 0); Not always true: main chunk can have finished dithering but transitions still being computed
+			SetChunkState(Chunk, EChunkState::Showed, STATIC_FNAME("ChunkToShow"));
 
-				if (Chunk.MeshId.IsValid())
+			if (Chunk.MeshId.IsValid())
+			{
+				if (Settings.RenderType == EVoxelRenderType::SurfaceNets)
 				{
-					if (Settings.RenderType == EVoxelRenderType::SurfaceNets)
-					{
-						// If we were the low res chunk we were hidden
-						MeshHandler->ShowChunk(Chunk.MeshId);
-					}
-					else
-					{
-						// Needed if it was canceled in UpdateChunks
-						MeshHandler->ResetDithering(Chunk.MeshId);
-					}
+					// If we were the low res chunk we were hidden
+					MeshHandler->ShowChunk(Chunk.MeshId);
+				}
+				else
+				{
+					// Needed if it was canceled in UpdateChunks
+					MeshHandler->ResetDithering(Chunk.MeshId);
 				}
-
-				ChunksToShow.RemoveAtSwap(Index, 1, false);
-				Index--; // Go back to process the element we swapped
 			}
 		}
 	}
 
 	{
-		VOXEL_SCOPE_COUNTER("Processing ChunksToRemove");
-		ensure(Settings.bDitherChunks || ChunksToRemove.Num() == 0);
-		for (int32 Index = 0; Index < ChunksToRemove.Num(); Index++)
+		VOXEL_SCOPE_COUNTER("Processing chunks dithering out");
+		ensure(Settings.bDitherChunks || GetChunksInState(EChunkState::DitheringOut).Num() == 0);
+
+		// RemoveOrHideChunk can remove chunks: gather the ids first
+		TArray<uint64, TInlineAllocator<64>> ChunksToRemove;
+		for (const FChunk* Chunk : GetChunksInState(EChunkState::DitheringOut))
 		{
-			const auto ChunkToRemove = ChunksToRemove[Index];
-			if (ChunkToRemove.Time < Time)
+			if (ensure(Chunk->IsDitheringScheduled()) && Chunk->DitheringEndTime < Time)
 			{
-				FChunk& Chunk = ChunksMap.FindChecked(ChunkToRemove.Id);
-				if (Chunk.GetState() != EChunkState::DitheringOut) continue; // Chunk is not dithering out anymore
-
-				ChunksToRemove.RemoveAtSwap(Index, 1, false);
-				Index--; // Go back to process the element we swapped
-				
-				// Do it after so that it's not in ChunksToRemove anymore
-				// for the checks to pass
-				RemoveOrHideChunk(Chunk);
+				ChunksToRemove.Add(Chunk->Id);
 			}
 		}
+		
+		for (uint64 ChunkId : ChunksToRemove)
+		{
+			FChunk* Chunk = ChunksMap.Find(ChunkId);
+			if (!Chunk || Chunk->GetState() != EChunkState::DitheringOut) continue; // Chunk is not dithering out anymore
+
+			// Unschedule it first for the checks in RemoveOrHideChunk to pass
+			Chunk->DitheringEndTime = -1;
+			RemoveOrHideChunk(*Chunk);
+		}
 	}
 }
 
 void FVoxelDefaultRenderer::ProcessMeshUpdates(double MaxTime)
 {
 	VOXEL_FUNCTION_COUNTER();
+
+	const double Time = FPlatformTime::Seconds();
 	
-	FVoxelTaskCallback Callback;
-	while ( // First check the time, else dequeued elements aren't processed!
-		FPlatformTime::Seconds() < MaxTime &&
-		TasksCallbacksQueue.Dequeue(Callback))
-	{
-		FChunk* Chunk = ChunksMap.Find(Callback.ChunkId);
-		if (!Chunk) continue;
-
-		auto& Tasks = Chunk->Tasks;
-		auto& Task = Callback.bIsTransitionTask ? Tasks.TransitionsTask : Tasks.MainTask;
-		if (!Task.IsValid() || Task->TaskId != Callback.TaskId) continue; // If task was canceled
-		if (!ensure(Task->IsDone())) continue; // Must be done if we're in the callback
-
-		// Move built data
-		auto& BuiltData = Chunk->BuiltData;
-		const auto PreviousBuiltData = BuiltData;
-		if (Callback.bIsTransitionTask)
-		{
-			ensure(Task->TransitionsMask == Chunk->Settings.TransitionsMask); // Should have been canceled
-			BuiltData.TransitionsMask = Task->TransitionsMask;
-			BuiltData.TransitionsChunk = Task->Chunk;
-			BuiltData.TransitionsChunkCreationTime = Task->CreationTime;
-		}
-		else
+	{
+		VOXEL_SCOPE_COUNTER("Dequeue callbacks");
+		FVoxelTaskCallback Callback;
+		while (TasksCallbacksQueue.Dequeue(Callback))
 		{
-			BuiltData.MainChunk = Task->Chunk;
-			BuiltData.MainChunkCreationTime = Task->CreationTime;
+			PendingMeshUpdates.Add({ Callback, Time });
 		}
+	}
 
-		// Finally, delete the task
-		Task.Reset();
+	if (PendingMeshUpdates.Num() == 0)
+	{
+		return;
+	}
 
-		// Do nothing while the main chunk isn't valid - we don't want to have unneeded updates for transitions then main
-		if (BuiltData.MainChunk.IsValid())
+	if (CVarPrioritizeMeshUpdates.GetValueOnGameThread() != 0)
+	{
+		VOXEL_SCOPE_COUNTER("Sort mesh updates");
+
+		const FView View = GetView();
+		PendingMeshUpdates.RemoveAll([&](FPendingMeshUpdate& Update) { return !ComputeMeshUpdatePriority(Update, Time, View); });
+		
+		PendingMeshUpdates.Sort([](const FPendingMeshUpdate& A, const FPendingMeshUpdate& B)
 		{
-			auto& MeshId = Chunk->MeshId;
-			const auto Update = [&]()
+			if (A.bStarved != B.bStarved)
 			{
-				if (!MeshId.IsValid())
-				{
-					MeshId = MeshHandler->AddChunk(Chunk->LOD, Chunk->Bounds.Min);
-				}
-				MeshHandler->UpdateChunk(MeshId, Chunk->Settings, *BuiltData.MainChunk, BuiltData.TransitionsChunk.Get(), BuiltData.TransitionsMask);
+				return A.bStarved;
+			}
+			if (A.bStarved)
+			{
+				// Oldest first
+				return A.QueuedTime < B.QueuedTime;
+			}
+			return A.Priority > B.Priority;
+		});
+	}
 
-				if (Settings.bStaticWorld)
-				{
-					// Free up memory ASAP
-					BuiltData.MainChunk.Reset();
-					BuiltData.TransitionsChunk.Reset();
-				}
-			};
+	int32 NumProcessed = 0;
+	// First check the time, else dequeued elements aren't processed!
+	while (NumProcessed < PendingMeshUpdates.Num() && FPlatformTime::Seconds() < MaxTime)
+	{
+		ProcessMeshUpdate(PendingMeshUpdates[NumProcessed++].Callback);
+	}
+	PendingMeshUpdates.RemoveAt(0, NumProcessed, false);
+}
+
+FVoxelDefaultRenderer::FView FVoxelDefaultRenderer::GetView() const
+{
+	FView View;
+
+	// No player camera in the editor viewports: only use the distance to the invokers there
+	UWorld* World = Settings.World.Get();
+	UPrimitiveComponent* RootComponent = Settings.RootComponent.Get();
+	if (!World || !RootComponent || !World->IsGameWorld())
+	{
+		return View;
+	}
+
+	const APlayerCameraManager* CameraManager = UGameplayStatics::GetPlayerCameraManager(World, 0);
+	if (!CameraManager)
+	{
+		return View;
+	}
+
+	const FTransform& Transform = RootComponent->GetComponentTransform();
+	View.bIsValid = true;
+	View.Position = Transform.InverseTransformPosition(CameraManager->GetCameraLocation()) / Settings.VoxelSize - FVector(*Settings.WorldOffset);
+	View.Direction = Transform.InverseTransformVectorNoScale(CameraManager->GetCameraRotation().Vector()).GetSafeNormal();
+	View.HalfFOV = FMath::DegreesToRadians(FMath::Clamp(CameraManager->GetFOVAngle(), 1.f, 170.f)) / 2;
+	return View;
+}
+
+bool FVoxelDefaultRenderer::ComputeMeshUpdatePriority(FPendingMeshUpdate& Update, double Time, const FView& View) const
+{
+	const FChunk* Chunk = ChunksMap.Find(Update.Callback.ChunkId);
+	if (!Chunk)
+	{
+		return false;
+	}
+	const auto& Task = Update.Callback.bIsTransitionTask ? Chunk->Tasks.TransitionsTask : Chunk->Tasks.MainTask;
+	if (!Task.IsValid() || Task->TaskId != Update.Callback.TaskId)
+	{
+		return false;
+	}
+
+	if (Time - Update.QueuedTime > CVarMeshUpdatesMaxDelay.GetValueOnGameThread())
+	{
+		// Far away updates must still happen eventually
+		Update.bStarved = true;
+		return true;
+	}
+	
+	uint64 SquaredDistance = MAX_uint64;
+	const auto& InvokersPositions = GetInvokersPositionsForPriorities();
+	for (int32 Index = 0; Index < InvokersPositions->GetNum(); Index++)
+	{
+		SquaredDistance = FMath::Min(SquaredDistance, Chunk->Bounds.ComputeSquaredDistanceFromBoxToPoint(InvokersPositions->Get(Index)));
+	}
 
-			const bool bTransitionsChunkIsBuilt =
-				BuiltData.TransitionsChunk.IsValid() ||
-				Chunk->Settings.TransitionsMask == 0 ||
-				Settings.RenderType == EVoxelRenderType::SurfaceNets;
+	const float Size = Chunk->Bounds.Size().X;
+	const FVector Center = Chunk->Bounds.GetCenter().ToFloat();
+	if (View.bIsValid)
+	{
+		SquaredDistance = FMath::Min<uint64>(SquaredDistance, FMath::Square<uint64>(FMath::Max(0.f, FVector::Distance(View.Position, Center) - Size / 2)));
+	}
+
+	// Roughly the size of the chunk on screen
+	float Priority = Size / FMath::Max(1.f, FMath::Sqrt(float(SquaredDistance)));
+
+	if (!Chunk->Settings.bVisible)
+	{
+		// Only collisions/navmesh, or waiting to be shown: no pop in
+		Priority *= 0.5f;
+	}
+	else if (!Chunk->MeshId.IsValid())
+	{
+		// Visible chunk without any mesh yet: this is a hole
+		Priority *= 2.f;
+	}
 
-			if (BuiltData.MainChunk->IsEmpty() && (!BuiltData.TransitionsChunk.IsValid() || BuiltData.TransitionsChunk->IsEmpty()))
+	if (View.bIsValid)
+	{
+		const FVector ToCenter = Center - View.Position;
+		const float Distance = ToCenter.Size();
+		const float Radius = Size * 0.866f; // sqrt(3) / 2
+		if (Distance > Radius)
+		{
+			// Cone/sphere test
+			const float Angle = FMath::Acos(FMath::Clamp(FVector::DotProduct(ToCenter / Distance, View.Direction), -1.f, 1.f));
+			if (Angle > View.HalfFOV + FMath::Asin(Radius / Distance))
 			{
-				// Both empty, remove mesh if existing
-				if (MeshId.IsValid())
-				{
-					MeshHandler->RemoveChunk(MeshId);
-					MeshId = {};
-				}
+				Priority *= 0.25f;
 			}
-			else
+		}
+	}
+
+	Update.Priority = Priority;
+	Update.bStarved = false;
+	return true;
+}
+
+void FVoxelDefaultRenderer::ProcessMeshUpdate(const FVoxelTaskCallback& Callback)
+{
+	VOXEL_FUNCTION_COUNTER();
+	
+	FChunk* Chunk = ChunksMap.Find(Callback.ChunkId);
+	if (!Chunk) return;
+
+	auto& Tasks = Chunk->Tasks;
+	auto& Task = Callback.bIsTransitionTask ? Tasks.TransitionsTask : Tasks.MainTask;
+	if (!Task.IsValid() || Task->TaskId != Callback.TaskId) return; // If task was canceled
+	if (!ensure(Task->IsDone())) return; // Must be done if we're in the callback
+
+	// Move built data
+	auto& BuiltData = Chunk->BuiltData;
+	const auto PreviousBuiltData = BuiltData;
+	if (Callback.bIsTransitionTask)
+	{
+		ensure(Task->TransitionsMask == Chunk->Settings.TransitionsMask); // Should have been canceled
+		BuiltData.TransitionsMask = Task->TransitionsMask;
+		BuiltData.TransitionsChunk = Task->Chunk;
+		BuiltData.TransitionsChunkCreationTime = Task->CreationTime;
+	}
+	else
+	{
+		BuiltData.MainChunk = Task->Chunk;
+		BuiltData.MainChunkCreationTime = Task->CreationTime;
+	}
+
+	// Finally, delete the task
+	Task.Reset();
+
+	// Do nothing while the main chunk isn't valid - we don't want to have unneeded updates for transitions then main
+	if (BuiltData.MainChunk.IsValid())
+	{
+		auto& MeshId = Chunk->MeshId;
+		const auto Update = [&]()
+		{
+			if (!MeshId.IsValid())
 			{
-				Update();
-				
-				ensure(MeshId.IsValid());
+				MeshId = MeshHandler->AddChunk(Chunk->LOD, Chunk->Bounds.Min);
+			}
+			MeshHandler->UpdateChunk(MeshId, Chunk->Settings, *BuiltData.MainChunk, BuiltData.TransitionsChunk.Get(), BuiltData.TransitionsMask);
 
-				// Dither in if first update
-				// If first load and LOD 0, don't dither as it doesn't look nice to have the world dithering under the player
-				if (Settings.bDitherChunks &&
-					!PreviousBuiltData.MainChunk.IsValid() && 
-					!(UpdateIndex == 1 && Chunk->LOD == 0))
-				{
-					// Can be a first update if:
-					// - we are a showed new chunks that's dithering in
-					// - we are a hidden chunk that's updated for the first time. If so don't dither in
-					ensure(Chunk->GetState() == EChunkState::Hidden || Chunk->GetState() == EChunkState::DitheringIn);
-					if (Chunk->GetState() == EChunkState::DitheringIn)
-					{
-						DitherInChunk(*Chunk, Chunk->PreviousChunks);
-					}
-				}
+			if (Settings.bStaticWorld)
+			{
+				// Free up memory ASAP
+				BuiltData.MainChunk.Reset();
+				BuiltData.TransitionsChunk.Reset();
 			}
+		};
+
+		const bool bTransitionsChunkIsBuilt =
+			BuiltData.TransitionsChunk.IsValid() ||
+			Chunk->Settings.TransitionsMask == 0 ||
+			Settings.RenderType == EVoxelRenderType::SurfaceNets;
 
-			// Dither out/remove previous chunks only once transitions are built too
-			// Note: bTransitionsChunkIsBuilt is always true for surface nets
-			if (bTransitionsChunkIsBuilt)
+		if (BuiltData.MainChunk->IsEmpty() && (!BuiltData.TransitionsChunk.IsValid() || BuiltData.TransitionsChunk->IsEmpty()))
+		{
+			// Both empty, remove mesh if existing
+			if (MeshId.IsValid())
 			{
-				ClearPreviousChunks(*Chunk);
+				MeshHandler->RemoveChunk(MeshId);
+				MeshId = {};
 			}
 		}
 		else
 		{
-			ensure(!Chunk->MeshId.IsValid());
+			Update();
+			
+			ensure(MeshId.IsValid());
+
+			// Dither in if first update
+			// If first load and LOD 0, don't dither as it doesn't look nice to have the world dithering under the player
+			if (Settings.bDitherChunks &&
+				!PreviousBuiltData.MainChunk.IsValid() && 
+				!(UpdateIndex == 1 && Chunk->LOD == 0))
+			{
+				// Can be a first update if:
+				// - we are a showed new chunks that's dithering in
+				// - we are a hidden chunk that's updated for the first time. If so don't dither in
+				ensure(Chunk->GetState() == EChunkState::Hidden || Chunk->GetState() == EChunkState::DitheringIn);
+				if (Chunk->GetState() == EChunkState::DitheringIn)
+				{
+					DitherInChunk(*Chunk, Chunk->PreviousChunks);
+				}
+			}
 		}
 
-		// Start new tasks as needed
-		CheckPendingUpdates(*Chunk);
+		// Dither out/remove previous chunks only once transitions are built too
+		// Note: bTransitionsChunkIsBuilt is always true for surface nets
+		if (bTransitionsChunkIsBuilt)
+		{
+			ClearPreviousChunks(*Chunk);
+		}
+	}
+	else
+	{
+		ensure(!Chunk->MeshId.IsValid());
 	}
+
+	// Start new tasks as needed
+	CheckPendingUpdates(*Chunk);
 }
 
 void FVoxelDefaultRenderer::FlushQueuedTasks()
@@ -1281,6 +1584,7 @@ void FVoxelDefaultRenderer::FlushQueuedTasks()
 		if (Tasks.Num() > 0)
 		{
 			TaskCount.Add(Tasks.Num());
+			bHasStartedTasks = true;
 			const auto TaskType =
 				bVisible
 				? bHasCollisions
@@ -1305,8 +1609,7 @@ void FVoxelDefaultRenderer::DestroyChunk(FChunk& Chunk)
 
 	ensure(!Chunk.MeshId.IsValid());
 	ensure(Chunk.PreviousChunks.Num() == 0);
-	ensureVoxelSlowNoSideEffects(!ChunksToRemove.FindByPredicate([&](const FChunkToRemove& ChunkToRemove) { return ChunkToRemove.Id == Chunk.Id; }));
-	ensureVoxelSlowNoSideEffects(!ChunksToShow.FindByPredicate([&](const FChunkToShow& ChunkToShow) { return ChunkToShow.Id == Chunk.Id; }));
+	ensureVoxelSlowNoSideEffects(!Chunk.IsDitheringScheduled());
 
 	if (!ensure(!Chunk.Tasks.MainTask.IsValid()) || 
 		!ensure(!Chunk.Tasks.TransitionsTask.IsValid()))
@@ -1319,17 +1622,72 @@ void FVoxelDefaultRenderer::DestroyChunk(FChunk& Chunk)
 		// We must always fire all delegates
 		PendingUpdate.OnUpdateFinished.Broadcast(FVoxelIntBox());
 	}
+	RemoveFromStateList(Chunk);
 	ensure(ChunksMap.Remove(Chunk.Id) == 1);
 }
 
+FVoxelDefaultRenderer::FChunk& FVoxelDefaultRenderer::AddChunk(uint64 Id, uint8 LOD, const FVoxelIntBox& Bounds)
+{
+	FChunk& Chunk = ChunksMap.Emplace(Id, Id, LOD, Bounds);
+	AddToStateList(Chunk);
+	return Chunk;
+}
+
+void FVoxelDefaultRenderer::SetChunkState(FChunk& Chunk, EChunkState NewState, FName DebugName)
+{
+#if VOXEL_DEBUG
+	Chunk.StateHistory.Add(FChunk::FChunkStateDebug{ Chunk.State, NewState, DebugName });
+#endif
+
+	if (Chunk.State == NewState)
+	{
+		return;
+	}
+
+	RemoveFromStateList(Chunk);
+	Chunk.State = NewState;
+	AddToStateList(Chunk);
+
+	if (NewState != EChunkState::DitheringIn && NewState != EChunkState::DitheringOut)
+	{
+		Chunk.DitheringEndTime = -1;
+	}
+}
+
+void FVoxelDefaultRenderer::AddToStateList(FChunk& Chunk)
+{
+	checkVoxelSlow(Chunk.StateListIndex == -1);
+	Chunk.StateListIndex = ChunksByState[int32(Chunk.State)].Add(&Chunk);
+}
+
+void FVoxelDefaultRenderer::RemoveFromStateList(FChunk& Chunk)
+{
+	TArray<FChunk*>& Chunks = ChunksByState[int32(Chunk.State)];
+	
+	const int32 Index = Chunk.StateListIndex;
+	if (!ensure(Chunks.IsValidIndex(Index) && Chunks[Index] == &Chunk))
+	{
+		return;
+	}
+	
+	Chunks.RemoveAtSwap(Index, 1, false);
+	if (Index < Chunks.Num())
+	{
+		Chunks[Index]->StateListIndex = Index;
+	}
+	Chunk.StateListIndex = -1;
+}
+
 void FVoxelDefaultRenderer::UpdateAllocatedSize()
 {
 	DEC_VOXEL_MEMORY_STAT_BY(STAT_VoxelRenderer, AllocatedSize);
 
 	AllocatedSize = 0;
 	AllocatedSize += ChunksMap.GetAllocatedSize();
-	AllocatedSize += ChunksToRemove.GetAllocatedSize();
-	AllocatedSize += ChunksToShow.GetAllocatedSize();
+	for (auto& Chunks : ChunksByState)
+	{
+		AllocatedSize += Chunks.GetAllocatedSize();
+	}
 	
 	INC_VOXEL_MEMORY_STAT_BY(STAT_VoxelRenderer, AllocatedSize);
 }
@@ -9,6 +9,7 @@
 #include "VoxelRendererMeshHandler.h"
 #include "VoxelTickable.h"
 #include "VoxelQueueWithNum.h"
+#include "VoxelContainers/VoxelChunkTable.h"
 
 struct FVoxelChunkMesh;
 
@@ -58,6 +59,7 @@ private:
 		WaitingForNewChunks,
 		DitheringOut
 	};
+	static constexpr int32 NumChunkStates = int32(EChunkState::DitheringOut) + 1;
 	enum class EMainOrTransitions : uint8
 	{
 		Main,
@@ -78,6 +80,8 @@ private:
 
 	private:
 		EChunkState State = EChunkState::NewChunk;
+		// Index in ChunksByState[State]
+		int32 StateListIndex = -1;
 
 #if VOXEL_DEBUG
 		struct FChunkStateDebug
@@ -89,17 +93,22 @@ private:
 		TArray<FChunkStateDebug> StateHistory;
 #endif
 
+		// Use FVoxelDefaultRenderer::SetChunkState, that keeps ChunksByState up to date
+		friend class FVoxelDefaultRenderer;
+
 	public:
 		FORCEINLINE EChunkState GetState() const
 		{
 			return State;
 		}
-		FORCEINLINE void SetState(EChunkState NewState, FName DebugName)
+
+		// Time at which to stop dithering in/out, only set once the dithering really started
+		// Negative if not dithering, reset when leaving DitheringIn or DitheringOut
+		double DitheringEndTime = -1;
+
+		FORCEINLINE bool IsDitheringScheduled() const
 		{
-#if VOXEL_DEBUG
-			StateHistory.Add(FChunkStateDebug{ State, NewState, DebugName });
-#endif
-			State = NewState;
+			return DitheringEndTime >= 0;
 		}
 
 	public:
@@ -147,21 +156,22 @@ private:
 		// Else we'd be decreasing a wrong NumNewChunksLeft
 		uint64 UpdateIndex = 0;
 	};
-	TMap<uint64, FChunk> ChunksMap;
+	TVoxelChunkTable<FChunk> ChunksMap;
 
-	struct FChunkToRemove
-	{
-		uint64 Id = 0;
-		double Time = 0; // Time at which to remove the chunk
-	};
-	TArray<FChunkToRemove> ChunksToRemove;
+	// Dense list of the chunks in each state, so that a state can be processed without iterating all the chunks
+	// eg DitheringIn & DitheringOut are the chunks to show & remove once their dithering ends
+	// Chunks addresses are stable in ChunksMap until they are removed, and DestroyChunk removes them from these lists
+	TArray<FChunk*> ChunksByState[NumChunkStates];
+
+	FChunk& AddChunk(uint64 Id, uint8 LOD, const FVoxelIntBox& Bounds);
+	void SetChunkState(FChunk& Chunk, EChunkState NewState, FName DebugName);
+	void AddToStateList(FChunk& Chunk);
+	void RemoveFromStateList(FChunk& Chunk);
 	
-	struct FChunkToShow
+	FORCEINLINE const TArray<FChunk*>& GetChunksInState(EChunkState State) const
 	{
-		uint64 Id = 0;
-		double Time = 0; // Time at which to stop dithering the chunk
-	};
-	TArray<FChunkToShow> ChunksToShow;
+		return ChunksByState[int32(State)];
+	}
 
 	TArray<IVoxelQueuedWork*> QueuedTasks[2][2]; // [bVisible][bHasCollisions]
 
@@ -192,6 +202,8 @@ private:
 	TVoxelSharedPtr<IVoxelRendererMeshHandler> MeshHandler;
 	
 	FThreadSafeCounter TaskCount;
+	// Set when tasks are started: the mesher values cache is emptied once they are all done
+	bool bHasStartedTasks = false;
 	uint64 UpdateIndex = 0;
 	bool OnWorldLoadedFired = false;
 
@@ -216,5 +228,31 @@ private:
 	};
 	TVoxelQueueWithNum<FVoxelTaskCallback, EQueueMode::Mpsc> TasksCallbacksQueue;
 
+	struct FPendingMeshUpdate
+	{
+		FVoxelTaskCallback Callback;
+		// Time at which the callback was dequeued from TasksCallbacksQueue
+		double QueuedTime = 0;
+		// Higher is processed first
+		float Priority = 0;
+		bool bStarved = false;
+	};
+	// Callbacks that didn't fit in the mesh updates budget. Sorted by priority every tick
+	TArray<FPendingMeshUpdate> PendingMeshUpdates;
+
+	// Camera used to prioritize the mesh updates, in voxel space
+	struct FView
+	{
+		bool bIsValid = false;
+		FVector Position = FVector::ZeroVector;
+		FVector Direction = FVector::ForwardVector;
+		float HalfFOV = 0;
+	};
+	FView GetView() const;
+	
+	// Returns false if the callback is outdated, eg if the chunk was removed or the task canceled
+	bool ComputeMeshUpdatePriority(FPendingMeshUpdate& Update, double Time, const FView& View) const;
+	void ProcessMeshUpdate(const FVoxelTaskCallback& Callback);
+
 	void CancelTask(TUniquePtr<FVoxelMesherAsyncWork, TVoxelAsyncWorkDelete<FVoxelMesherAsyncWork>>& Task);
 };
\ No newline at end of file
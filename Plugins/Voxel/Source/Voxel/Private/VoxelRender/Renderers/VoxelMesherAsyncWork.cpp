@@ -9,8 +9,21 @@
 
 #include "Async/Async.h"
 #include "Misc/MessageDialog.h"
+#include "HAL/IConsoleManager.h"
 #include "VoxelUtilities/VoxelThreadingUtilities.h"
 
+static TAutoConsoleVariable<int32> CVarUseHeightfieldCollisions(
+	TEXT("voxel.collision.UseHeightfields"),
+	0,
+	TEXT("If 1, unedited chunks of heightmap generators will use heightfield collisions instead of cooking a trimesh. PhysX only"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarUseVoxelConvexDecomposition(
+	TEXT("voxel.collision.UseVoxelConvexDecomposition"),
+	0,
+	TEXT("If 1, the convex collisions will be built by merging the solid voxels of the chunks into convex pieces, instead of splitting the mesh in a grid of NumConvexHullsPerAxis^3 hulls. PhysX only"),
+	ECVF_Default);
+
 FVoxelMesherAsyncWork::FVoxelMesherAsyncWork(
 	FVoxelDefaultRenderer& Renderer,
 	const uint64 ChunkId,
@@ -100,6 +113,18 @@ void FVoxelMesherAsyncWork::DoWork()
 		Buffers.Indices = MoveTemp(Indices);
 		Buffers.Positions = MoveTemp(Vertices);
 	}
+
+	if (!bIsTransitionTask && CVarUseHeightfieldCollisions.GetValueOnAnyThread() != 0)
+	{
+		Chunk->BuildHeightfieldCollisionData(LOD, ChunkPosition, *PinnedRenderer->Settings.Data);
+	}
+	if (!bIsTransitionTask &&
+		!Chunk->GetHeightfieldCollisionData().IsValid() &&
+		PinnedRenderer->Settings.CollisionTraceFlag != ECollisionTraceFlag::CTF_UseComplexAsSimple &&
+		CVarUseVoxelConvexDecomposition.GetValueOnAnyThread() != 0)
+	{
+		Chunk->BuildConvexCollisionData(LOD, ChunkPosition, PinnedRenderer->Settings.NumConvexHullsPerAxis, Mesher->GetQueriedValues());
+	}
 	
 	FVoxelUtilities::DeleteOnGameThread_AnyThread(PinnedRenderer);
 }
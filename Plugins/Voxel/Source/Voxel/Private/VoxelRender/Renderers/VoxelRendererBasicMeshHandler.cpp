@@ -151,6 +151,8 @@ void FVoxelRendererBasicMeshHandler::ApplyAction(const FAction& Action)
 		NewAction.ChunkId = Action.ChunkId;
 		NewAction.UpdateChunk().AfterCall.UpdateIndex = ChunkInfo.UpdateIndex->GetValue();
 		NewAction.UpdateChunk().AfterCall.DistanceFieldVolumeData = Action.UpdateChunk().InitialCall.MainChunk->GetDistanceFieldVolumeData();
+		NewAction.UpdateChunk().AfterCall.HeightfieldCollisionData = Action.UpdateChunk().InitialCall.MainChunk->GetHeightfieldCollisionData();
+		NewAction.UpdateChunk().AfterCall.ConvexCollisionData = Action.UpdateChunk().InitialCall.MainChunk->GetConvexCollisionData();
 		ActionQueue.Enqueue(NewAction);
 			
 		if (Renderer.Settings.RenderType == EVoxelRenderType::SurfaceNets)
@@ -272,6 +274,21 @@ void FVoxelRendererBasicMeshHandler::FlushActionQueue(double MaxTime)
 
 			if (!ensure(BuiltMeshes.IsValid())) continue;
 
+			// The heightfield & the voxel convexes replace the collisions of the whole component: only use them if all the sections have collisions
+			TVoxelSharedPtr<const FVoxelHeightfieldCollisionData> HeightfieldCollisionData = Action.UpdateChunk().AfterCall.HeightfieldCollisionData;
+			TVoxelSharedPtr<const FVoxelConvexCollisionData> ConvexCollisionData = Action.UpdateChunk().AfterCall.ConvexCollisionData;
+			if (HeightfieldCollisionData.IsValid() || ConvexCollisionData.IsValid())
+			{
+				const bool bCanUseChunkCollisionData =
+					BuiltMeshes->Num() == 1 &&
+					!(*BuiltMeshes)[0].Value.FindByPredicate([](auto& Section) { return !Section.Key.bEnableCollisions; });
+				if (!bCanUseChunkCollisionData)
+				{
+					HeightfieldCollisionData.Reset();
+					ConvexCollisionData.Reset();
+				}
+			}
+
 			int32 MeshIndex = 0;
 			// Apply built meshes
 			for (auto& BuiltMesh : *BuiltMeshes)
@@ -289,6 +306,8 @@ void FVoxelRendererBasicMeshHandler::FlushActionQueue(double MaxTime)
 				MeshConfig.ApplyTo(Mesh);
 
 				Mesh.SetDistanceFieldData(nullptr);
+				Mesh.SetHeightfieldCollisionData(HeightfieldCollisionData);
+				Mesh.SetConvexCollisionData(ConvexCollisionData);
 				Mesh.ClearSections(EVoxelProcMeshSectionUpdate::DelayUpdate);
 				for (auto& Section : BuiltMesh.Value)
 				{
@@ -305,6 +324,8 @@ void FVoxelRendererBasicMeshHandler::FlushActionQueue(double MaxTime)
 			{
 				auto& Mesh = *ChunkInfo.Meshes[MeshIndex];
 				Mesh.SetDistanceFieldData(nullptr);
+				Mesh.SetHeightfieldCollisionData(nullptr);
+				Mesh.SetConvexCollisionData(nullptr);
 				Mesh.ClearSections(EVoxelProcMeshSectionUpdate::UpdateNow);
 			}
 
@@ -12,6 +12,7 @@
 #include "VoxelAsyncWork.h"
 
 #include "Async/Async.h"
+#include "Misc/ScopeLock.h"
 
 class FVoxelClusteredMeshMergeWork : public FVoxelAsyncWork
 {
@@ -27,7 +28,7 @@ public:
 			Cluster->Position,
 			Handler,
 			Cluster->UpdateIndex.ToSharedRef(),
-			Cluster->ChunkMeshesToBuild);
+			Cluster->ChunkMeshes);
 	}
 
 private:
@@ -36,7 +37,7 @@ private:
 	const FVoxelRendererSettingsBase RendererSettings;
 	const TVoxelWeakPtr<FVoxelRendererClusteredMeshHandler> Handler;
 
-	const TMap<uint64, TVoxelSharedPtr<const FVoxelChunkMeshesToBuild>> MeshesToBuild;
+	const TMap<uint64, TVoxelSharedPtr<FVoxelClusterChunkMeshes>> ChunkMeshes;
 	const TVoxelSharedRef<FThreadSafeCounter> UpdateIndexPtr;
 	const int32 UpdateIndex;
 	
@@ -45,13 +46,13 @@ private:
 		const FIntVector& Position,
 		FVoxelRendererClusteredMeshHandler& Handler,
 		const TVoxelSharedRef<FThreadSafeCounter>& UpdateIndexPtr,
-		const TMap<uint64, TVoxelSharedPtr<const FVoxelChunkMeshesToBuild>>& MeshesToBuild)
+		const TMap<uint64, TVoxelSharedPtr<FVoxelClusterChunkMeshes>>& ChunkMeshes)
 		: FVoxelAsyncWork(STATIC_FNAME("FVoxelClusteredMeshMergeWork"), 1e9, true)
 		, ClusterRef(ClusterRef)
 		, Position(Position)
 		, RendererSettings(static_cast<const FVoxelRendererSettingsBase&>(Handler.Renderer.Settings))
 		, Handler(StaticCastVoxelSharedRef<FVoxelRendererClusteredMeshHandler>(Handler.AsShared()))
-		, MeshesToBuild(MeshesToBuild)
+		, ChunkMeshes(ChunkMeshes)
 		, UpdateIndexPtr(UpdateIndexPtr)
 		, UpdateIndex(UpdateIndexPtr->GetValue())
 	{
@@ -69,24 +70,46 @@ private:
 			// Canceled
 			return;
 		}
-		FVoxelChunkMeshesToBuild RealMap;
-		for (auto& ChunkIt : MeshesToBuild)
+		// Mesh config -> section settings -> buffers of each chunk
+		TMap<FVoxelMeshConfig, TMap<FVoxelProcMeshSectionSettings, TArray<const FVoxelProcMeshBuffers*>>> BuffersToConcatenate;
+		for (auto& ChunkIt : ChunkMeshes)
 		{
 			// Key is ChunkId = useless here
-			for (auto& MeshIt : *ChunkIt.Value)
+			// Only the chunks updated since the last merge actually need to be built
+			const FVoxelBuiltChunkMeshes* ChunkBuiltMeshes = ChunkIt.Value->GetBuiltMeshes_AnyThread(RendererSettings, Position, *UpdateIndexPtr, UpdateIndex);
+			if (!ChunkBuiltMeshes)
 			{
-				auto& MeshMap = RealMap.FindOrAdd(MeshIt.Key);
+				// Canceled
+				return;
+			}
+			for (auto& MeshIt : *ChunkBuiltMeshes)
+			{
+				auto& MeshMap = BuffersToConcatenate.FindOrAdd(MeshIt.Key);
 				for (auto& SectionIt : MeshIt.Value)
 				{
-					MeshMap.FindOrAdd(SectionIt.Key).Append(SectionIt.Value);
+					if (SectionIt.Value.IsValid())
+					{
+						MeshMap.FindOrAdd(SectionIt.Key).Add(SectionIt.Value.Get());
+					}
 				}
 			}
 		}
-		auto BuiltMeshes = FVoxelRenderUtilities::BuildMeshes_AnyThread(RealMap, RendererSettings, Position, *UpdateIndexPtr, UpdateIndex);
-		if (!BuiltMeshes.IsValid())
+		
+		auto BuiltMeshes = MakeUnique<FVoxelBuiltChunkMeshes>();
+		for (auto& MeshIt : BuffersToConcatenate)
 		{
-			// Canceled
-			return;
+			TArray<TPair<FVoxelProcMeshSectionSettings, TUniquePtr<FVoxelProcMeshBuffers>>> BuiltSections;
+			for (auto& SectionIt : MeshIt.Value)
+			{
+				auto Buffers = FVoxelRenderUtilities::ConcatenateBuffers_AnyThread(SectionIt.Value, *UpdateIndexPtr, UpdateIndex);
+				if (UpdateIndexPtr->GetValue() > UpdateIndex)
+				{
+					// Canceled
+					return;
+				}
+				BuiltSections.Emplace(SectionIt.Key, MoveTemp(Buffers));
+			}
+			BuiltMeshes->Emplace(MeshIt.Key, MoveTemp(BuiltSections));
 		}
 		auto HandlerPinned = Handler.Pin();
 		if (HandlerPinned.IsValid())
@@ -98,6 +121,34 @@ private:
 	}
 };
 
+const FVoxelBuiltChunkMeshes* FVoxelClusterChunkMeshes::GetBuiltMeshes_AnyThread(
+	const FVoxelRendererSettingsBase& RendererSettings,
+	const FIntVector& ClusterPosition,
+	const FThreadSafeCounter& CancelCounter,
+	int32 CancelThreshold)
+{
+	VOXEL_ASYNC_FUNCTION_COUNTER();
+	
+	// If another merge task is building these, wait for it instead of building them twice
+	FScopeLock Lock(&Section);
+
+	if (!BuiltMeshes.IsValid())
+	{
+		BuiltMeshes = FVoxelRenderUtilities::BuildMeshes_AnyThread(MeshesToBuild, RendererSettings, ClusterPosition, CancelCounter, CancelThreshold);
+		if (BuiltMeshes.IsValid())
+		{
+			// Free the chunk mesh buffers
+			MeshesToBuild.Empty();
+		}
+	}
+
+	return BuiltMeshes.Get();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
 FVoxelRendererClusteredMeshHandler::~FVoxelRendererClusteredMeshHandler()
 {
 	FlushBuiltDataQueue();
@@ -165,7 +216,8 @@ void FVoxelRendererClusteredMeshHandler::ApplyAction(const FAction& Action)
 			Renderer.OnMaterialInstanceCreated,
 			{});
 
-		Cluster.ChunkMeshesToBuild.FindOrAdd(ChunkInfo.UniqueId) = MakeVoxelShared<FVoxelChunkMeshesToBuild>(MoveTemp(MeshesToBuild));
+		// Replace the chunk meshes: only these will be rebuilt by the merge task
+		Cluster.ChunkMeshes.FindOrAdd(ChunkInfo.UniqueId) = MakeVoxelShared<FVoxelClusterChunkMeshes>(MoveTemp(MeshesToBuild));
 
 		// Start a task to asynchronously build them
 		auto* Task = FVoxelClusteredMeshMergeWork::Create(*this, { ChunkInfo.ClusterId, Cluster.UniqueId });
@@ -200,7 +252,7 @@ void FVoxelRendererClusteredMeshHandler::ApplyAction(const FAction& Action)
 		// The added cost of applying the update is probably worth it compared to stalling the entire queue waiting for an update
 		Cluster.UpdateIndex->Increment();
 
-		ensure(Cluster.ChunkMeshesToBuild.Remove(ChunkInfo.UniqueId) == 1); // We must have some mesh
+		ensure(Cluster.ChunkMeshes.Remove(ChunkInfo.UniqueId) == 1); // We must have some mesh
 
 		// Start a task to asynchronously build them
 		auto* Task = FVoxelClusteredMeshMergeWork::Create(*this, { ChunkInfo.ClusterId, Cluster.UniqueId });
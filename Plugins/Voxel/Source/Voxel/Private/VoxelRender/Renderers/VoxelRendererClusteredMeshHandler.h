@@ -9,6 +9,31 @@
 #include "VoxelRender/VoxelRenderUtilities.h"
 #include "VoxelRendererMeshHandler.h"
 
+// The meshes of a single chunk of a cluster, converted to proc mesh buffers relative to the cluster position
+// These are built once and reused by all the merges of the cluster:
+// when a chunk is updated, only its own buffers are rebuilt and the others are just copied
+class FVoxelClusterChunkMeshes
+{
+public:
+	explicit FVoxelClusterChunkMeshes(FVoxelChunkMeshesToBuild&& MeshesToBuild)
+		: MeshesToBuild(MoveTemp(MeshesToBuild))
+	{
+	}
+
+	// Built by the first merge task needing them. Returns null if canceled
+	const FVoxelBuiltChunkMeshes* GetBuiltMeshes_AnyThread(
+		const FVoxelRendererSettingsBase& RendererSettings,
+		const FIntVector& ClusterPosition,
+		const FThreadSafeCounter& CancelCounter,
+		int32 CancelThreshold);
+
+private:
+	FCriticalSection Section;
+	// Released once built
+	FVoxelChunkMeshesToBuild MeshesToBuild;
+	TUniquePtr<FVoxelBuiltChunkMeshes> BuiltMeshes;
+};
+
 class FVoxelRendererClusteredMeshHandler : public IVoxelRendererMeshHandler
 {
 public:
@@ -52,7 +77,7 @@ private:
 
 		// Chunk unique id -> its meshes
 		// Shared ptr: used by build task
-		TMap<uint64, TVoxelSharedPtr<const FVoxelChunkMeshesToBuild>> ChunkMeshesToBuild;
+		TMap<uint64, TVoxelSharedPtr<FVoxelClusterChunkMeshes>> ChunkMeshes;
 
 		static FCluster Create(
 			int32 LOD,
@@ -14,6 +14,8 @@ struct FVoxelChunkMesh;
 struct FVoxelIntBox;
 class IVoxelRenderer;
 class FDistanceFieldVolumeData;
+struct FVoxelHeightfieldCollisionData;
+struct FVoxelConvexCollisionData;
 class UVoxelProceduralMeshComponent;
 template <class T>
 class TAutoConsoleVariable;
@@ -104,6 +106,8 @@ protected:
 				// This is used to check if the mesh has been updated
 				int32 UpdateIndex;
 				TVoxelSharedPtr<const FDistanceFieldVolumeData> DistanceFieldVolumeData;
+				TVoxelSharedPtr<const FVoxelHeightfieldCollisionData> HeightfieldCollisionData;
+				TVoxelSharedPtr<const FVoxelConvexCollisionData> ConvexCollisionData;
 			} AfterCall;
 		};
 		struct FDitherChunk
@@ -4,6 +4,9 @@
 #include "VoxelRender/IVoxelRenderer.h"
 #include "VoxelData/VoxelDataIncludes.h"
 #include "VoxelUtilities/VoxelDistanceFieldUtilities.h"
+#include "VoxelUtilities/VoxelOctreeUtilities.h"
+#include "VoxelGenerators/VoxelGeneratorInstance.h"
+#include "VoxelUtilities/VoxelConvexDecompositionUtilities.h"
 
 #include "Materials/MaterialInstanceDynamic.h"
 #include "DistanceFieldAtlas.h"
@@ -61,11 +64,17 @@ private:
 };
 #endif
 
-void FVoxelChunkMeshBuffers::BuildAdjacency(TArray<uint32>& OutAdjacencyIndices) const
+static TAutoConsoleVariable<int32> CVarUseNvTessAdjacency(
+	TEXT("voxel.renderer.UseNvTessAdjacency"),
+	0,
+	TEXT("If 1, the tessellation adjacency indices are built by the NVIDIA tessellation library instead of the voxel plugin hash based builder. Slower, for debugging"),
+	ECVF_Default);
+
+#if ENABLE_TESSELLATION
+static void BuildAdjacency_NvTess(const TArray<uint32>& Indices, const TArray<FVector>& Positions, TArray<uint32>& OutAdjacencyIndices)
 {
 	VOXEL_ASYNC_FUNCTION_COUNTER();
 	
-#if ENABLE_TESSELLATION
 	if (Indices.Num())
 	{
 		FVoxelStaticMeshNvRenderBuffer StaticMeshRenderBuffer(Positions, Indices);
@@ -84,9 +93,290 @@ void FVoxelChunkMeshBuffers::BuildAdjacency(TArray<uint32>& OutAdjacencyIndices)
 	{
 		OutAdjacencyIndices.Empty();
 	}
+}
+
+/**
+ * Same output as nvtess DBM_PnAenDominantCorner, 12 indices per triangle:
+ * - 0, 1, 2: the triangle
+ * - 3 to 8: for each edge, the vertices of the edge of the adjacent triangle, in the same order as ours. Our own edge if there's none
+ * - 9, 10, 11: for each corner, the dominant vertex, ie the first vertex with the same position
+ *
+ * The meshers already share most vertices, so the position dictionary is mostly an identity mapping:
+ * both dictionaries are open addressing tables of uint32/uint64 sized to the mesh, in per thread scratch memory,
+ * so that building the adjacency of a chunk doesn't allocate anything but its output
+ */
+static void BuildAdjacency_Hash(const TArray<uint32>& Indices, const TArray<FVector>& Positions, TArray<uint32>& OutAdjacencyIndices)
+{
+	VOXEL_ASYNC_FUNCTION_COUNTER();
+
+	const int32 NumIndices = Indices.Num();
+	const int32 NumVertices = Positions.Num();
+	checkVoxelSlow(NumIndices % 3 == 0);
+	
+	OutAdjacencyIndices.Empty(4 * NumIndices);
+	if (NumIndices == 0)
+	{
+		return;
+	}
+	OutAdjacencyIndices.SetNumUninitialized(4 * NumIndices);
+
+	struct FScratch
+	{
+		TArray<uint32> PositionTable;
+		TArray<uint32> DominantVertices;
+		TArray<uint64> EdgeKeys;
+		TArray<uint32> EdgeCorners;
+	};
+	static thread_local FScratch Scratch;
+
+	const auto Reset = [](auto& Array, int32 Num, auto Value)
+	{
+		Array.Reset(Num);
+		Array.SetNumUninitialized(Num, false);
+		for (auto& Element : Array)
+		{
+			Element = Value;
+		}
+	};
+
+	// Vertex -> first vertex with the same position
+	uint32* RESTRICT DominantVertices;
+	{
+		VOXEL_ASYNC_SCOPE_COUNTER("Positions");
+		
+		const int32 TableSize = FMath::RoundUpToPowerOfTwo(FMath::Max(2 * NumVertices, 16));
+		const uint32 Mask = TableSize - 1;
+		Reset(Scratch.PositionTable, TableSize, MAX_uint32);
+		Scratch.DominantVertices.Reset(NumVertices);
+		Scratch.DominantVertices.SetNumUninitialized(NumVertices, false);
+
+		uint32* RESTRICT Table = Scratch.PositionTable.GetData();
+		DominantVertices = Scratch.DominantVertices.GetData();
+		const FVector* RESTRICT PositionsData = Positions.GetData();
+
+		const auto GetBits = [](float Value)
+		{
+			// -0 and +0 are equal but don't have the same bits
+			Value += 0.f;
+			return *reinterpret_cast<const uint32*>(&Value);
+		};
+
+		for (int32 Vertex = 0; Vertex < NumVertices; Vertex++)
+		{
+			const FVector& Position = PositionsData[Vertex];
+			const uint32 Hash = FVoxelUtilities::MurmurHash32(GetBits(Position.X), GetBits(Position.Y), GetBits(Position.Z));
+			
+			for (uint32 Bucket = Hash & Mask; ; Bucket = (Bucket + 1) & Mask)
+			{
+				const uint32 Other = Table[Bucket];
+				if (Other == MAX_uint32)
+				{
+					Table[Bucket] = Vertex;
+					DominantVertices[Vertex] = Vertex;
+					break;
+				}
+				if (PositionsData[Other] == Position)
+				{
+					DominantVertices[Vertex] = Other;
+					break;
+				}
+			}
+		}
+	}
+
+	const uint32* RESTRICT IndicesData = Indices.GetData();
+	const auto GetNextCorner = [](uint32 Corner)
+	{
+		return Corner % 3 == 2 ? Corner - 2 : Corner + 1;
+	};
+	const auto GetEdgeKey = [&](uint32 CornerA, uint32 CornerB)
+	{
+		return uint64(DominantVertices[IndicesData[CornerA]]) << 32 | DominantVertices[IndicesData[CornerB]];
+	};
+
+	// Directed edge, in positions space -> first corner starting it
+	const int32 EdgeTableSize = FMath::RoundUpToPowerOfTwo(FMath::Max(2 * NumIndices, 16));
+	const uint32 EdgeMask = EdgeTableSize - 1;
+	{
+		VOXEL_ASYNC_SCOPE_COUNTER("Edges");
+		
+		Reset(Scratch.EdgeKeys, EdgeTableSize, MAX_uint64);
+		Scratch.EdgeCorners.Reset(EdgeTableSize);
+		Scratch.EdgeCorners.SetNumUninitialized(EdgeTableSize, false);
+		
+		uint64* RESTRICT Keys = Scratch.EdgeKeys.GetData();
+		uint32* RESTRICT Corners = Scratch.EdgeCorners.GetData();
+		
+		for (int32 Corner = 0; Corner < NumIndices; Corner++)
+		{
+			const uint64 Key = GetEdgeKey(Corner, GetNextCorner(Corner));
+			for (uint32 Bucket = uint32(FVoxelUtilities::MurmurHash64(Key)) & EdgeMask; ; Bucket = (Bucket + 1) & EdgeMask)
+			{
+				if (Keys[Bucket] == MAX_uint64)
+				{
+					Keys[Bucket] = Key;
+					Corners[Bucket] = Corner;
+					break;
+				}
+				if (Keys[Bucket] == Key)
+				{
+					// Non manifold edge: keep the first one, like nvtess
+					break;
+				}
+			}
+		}
+	}
+
+	{
+		VOXEL_ASYNC_SCOPE_COUNTER("Output");
+		
+		const uint64* RESTRICT Keys = Scratch.EdgeKeys.GetData();
+		const uint32* RESTRICT Corners = Scratch.EdgeCorners.GetData();
+		uint32* RESTRICT Output = OutAdjacencyIndices.GetData();
+		
+		for (int32 Triangle = 0; Triangle < NumIndices / 3; Triangle++)
+		{
+			uint32* RESTRICT TriangleOutput = Output + 12 * Triangle;
+			for (int32 Index = 0; Index < 3; Index++)
+			{
+				const uint32 Corner = 3 * Triangle + Index;
+				const uint32 NextCorner = GetNextCorner(Corner);
+				
+				TriangleOutput[Index] = IndicesData[Corner];
+				TriangleOutput[9 + Index] = DominantVertices[IndicesData[Corner]];
+
+				// The adjacent triangle has the same edge in the opposite direction
+				const uint64 Key = GetEdgeKey(NextCorner, Corner);
+				uint32 AdjacentCorner = MAX_uint32;
+				for (uint32 Bucket = uint32(FVoxelUtilities::MurmurHash64(Key)) & EdgeMask; Keys[Bucket] != MAX_uint64; Bucket = (Bucket + 1) & EdgeMask)
+				{
+					if (Keys[Bucket] == Key)
+					{
+						AdjacentCorner = Corners[Bucket];
+						break;
+					}
+				}
+
+				if (AdjacentCorner == MAX_uint32)
+				{
+					TriangleOutput[3 + 2 * Index + 0] = IndicesData[Corner];
+					TriangleOutput[3 + 2 * Index + 1] = IndicesData[NextCorner];
+				}
+				else
+				{
+					// Adjacent edge goes from our next corner position to our corner position
+					TriangleOutput[3 + 2 * Index + 0] = IndicesData[GetNextCorner(AdjacentCorner)];
+					TriangleOutput[3 + 2 * Index + 1] = IndicesData[AdjacentCorner];
+				}
+			}
+		}
+	}
+}
+#endif
+
+void FVoxelChunkMeshBuffers::BuildAdjacency(TArray<uint32>& OutAdjacencyIndices) const
+{
+#if ENABLE_TESSELLATION
+	if (CVarUseNvTessAdjacency.GetValueOnAnyThread() != 0)
+	{
+		BuildAdjacency_NvTess(Indices, Positions, OutAdjacencyIndices);
+	}
+	else
+	{
+		BuildAdjacency_Hash(Indices, Positions, OutAdjacencyIndices);
+	}
 #endif
 }
 
+#if ENABLE_TESSELLATION
+static FAutoConsoleCommand CmdTestAdjacency(
+	TEXT("voxel.renderer.TestAdjacency"),
+	TEXT("Compares the hash based tessellation adjacency builder against the NVIDIA tessellation library on random meshes. Args: NumTests (default 16)"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 NumTests = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 16;
+
+		int32 NumFailed = 0;
+		double NvTessTime = 0;
+		double HashTime = 0;
+		
+		for (int32 Seed = 0; Seed < NumTests; Seed++)
+		{
+			FRandomStream Stream(Seed);
+
+			// Grid with shared vertices, like the meshers output
+			// Some vertices are duplicated to have seams, and some triangles are duplicated to have non manifold edges
+			const int32 Size = Stream.RandRange(2, 64);
+			const float DuplicateProbability = Stream.FRandRange(0.f, 0.2f);
+
+			TArray<FVector> Positions;
+			TArray<uint32> Indices;
+			for (int32 X = 0; X < Size; X++)
+			{
+				for (int32 Y = 0; Y < Size; Y++)
+				{
+					Positions.Add(FVector(X, Y, Stream.FRandRange(-1.f, 1.f)));
+				}
+			}
+			const auto GetVertex = [&](int32 X, int32 Y)
+			{
+				const uint32 Vertex = X * Size + Y;
+				if (Stream.FRand() < DuplicateProbability)
+				{
+					return uint32(Positions.Add(Positions[Vertex]));
+				}
+				return Vertex;
+			};
+			for (int32 X = 0; X < Size - 1; X++)
+			{
+				for (int32 Y = 0; Y < Size - 1; Y++)
+				{
+					const uint32 A = GetVertex(X, Y);
+					const uint32 B = GetVertex(X + 1, Y);
+					const uint32 C = GetVertex(X + 1, Y + 1);
+					const uint32 D = GetVertex(X, Y + 1);
+					Indices.Append({ A, B, C, A, C, D });
+					if (Stream.FRand() < DuplicateProbability / 4)
+					{
+						Indices.Append({ A, B, C });
+					}
+				}
+			}
+			
+			TArray<uint32> NvTessAdjacency;
+			TArray<uint32> HashAdjacency;
+			{
+				const double StartTime = FPlatformTime::Seconds();
+				BuildAdjacency_NvTess(Indices, Positions, NvTessAdjacency);
+				NvTessTime += FPlatformTime::Seconds() - StartTime;
+			}
+			{
+				const double StartTime = FPlatformTime::Seconds();
+				BuildAdjacency_Hash(Indices, Positions, HashAdjacency);
+				HashTime += FPlatformTime::Seconds() - StartTime;
+			}
+
+			if (NvTessAdjacency.Num() != HashAdjacency.Num())
+			{
+				LOG_VOXEL(Error, TEXT("TestAdjacency: seed %d: %d indices vs %d"), Seed, NvTessAdjacency.Num(), HashAdjacency.Num());
+				NumFailed++;
+				continue;
+			}
+			for (int32 Index = 0; Index < NvTessAdjacency.Num(); Index++)
+			{
+				if (NvTessAdjacency[Index] != HashAdjacency[Index])
+				{
+					LOG_VOXEL(Error, TEXT("TestAdjacency: seed %d (triangle %d, slot %d): %u vs %u"), Seed, Index / 12, Index % 12, NvTessAdjacency[Index], HashAdjacency[Index]);
+					NumFailed++;
+					break;
+				}
+			}
+		}
+
+		LOG_VOXEL(Log, TEXT("TestAdjacency: %d/%d tests passed. NvTess: %.3fms, Hash: %.3fms"), NumTests - NumFailed, NumTests, NvTessTime * 1000, HashTime * 1000);
+	}));
+#endif
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -127,12 +417,7 @@ void FVoxelChunkMeshBuffers::ComputeBounds()
 void FVoxelChunkMeshBuffers::UpdateStats()
 {
 	DEC_VOXEL_MEMORY_STAT_BY(STAT_VoxelChunkMeshMemory, LastAllocatedSize);
-	LastAllocatedSize = Indices.GetAllocatedSize();
-	LastAllocatedSize += Positions.GetAllocatedSize();
-	LastAllocatedSize += Normals.GetAllocatedSize();
-	LastAllocatedSize += Tangents.GetAllocatedSize();
-	LastAllocatedSize += Colors.GetAllocatedSize();
-	for (auto& T : TextureCoordinates) LastAllocatedSize += T.GetAllocatedSize();
+	LastAllocatedSize = int32(GetAllocatedSize());
 	INC_VOXEL_MEMORY_STAT_BY(STAT_VoxelChunkMeshMemory, LastAllocatedSize);
 }
 
@@ -140,7 +425,18 @@ void FVoxelChunkMeshBuffers::UpdateStats()
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
-void FVoxelChunkMesh::BuildDistanceField(int32 LOD, const FIntVector& Position, const FVoxelData& Data, const FVoxelRendererSettingsBase& Settings)
+static TAutoConsoleVariable<int32> CVarDistanceFieldReuseMesherValues(
+	TEXT("voxel.renderer.DistanceFieldReuseMesherValues"),
+	1,
+	TEXT("If 1, the chunks distance fields will reuse the values queried by the mesher and only query the values around them"),
+	ECVF_Default);
+
+void FVoxelChunkMesh::BuildDistanceField(
+	int32 LOD, 
+	const FIntVector& Position,
+	const FVoxelData& Data,
+	const FVoxelRendererSettingsBase& Settings,
+	const FVoxelChunkMeshKnownValues& KnownValues)
 {
 	VOXEL_ASYNC_FUNCTION_COUNTER();
 	
@@ -171,7 +467,57 @@ void FVoxelChunkMesh::BuildDistanceField(int32 LOD, const FIntVector& Position,
 
 			FVoxelReadScopeLock Lock(Data, Bounds, FUNCTION_FNAME);
 			TVoxelQueryZone<FVoxelValue> QueryZone(Bounds, FIntVector(ValuesSize), LOD, Values);
-			Data.Get<FVoxelValue>(QueryZone, LOD);
+
+			const bool bUseKnownValues =
+				KnownValues.Values &&
+				KnownValues.Bounds.Intersect(Bounds) &&
+				KnownValues.Bounds.IsMultipleOf(Step) &&
+				CVarDistanceFieldReuseMesherValues.GetValueOnAnyThread() != 0;
+			
+			if (!bUseKnownValues)
+			{
+				Data.Get<FVoxelValue>(QueryZone, LOD);
+			}
+			else
+			{
+				const FVoxelIntBox Known = KnownValues.Bounds.Overlap(Bounds);
+				const FIntVector KnownSize = KnownValues.Bounds.Size() / Step;
+				{
+					VOXEL_ASYNC_SCOPE_COUNTER("Copy mesher values");
+					for (int32 Z = Known.Min.Z; Z < Known.Max.Z; Z += Step)
+					{
+						for (int32 Y = Known.Min.Y; Y < Known.Max.Y; Y += Step)
+						{
+							for (int32 X = Known.Min.X; X < Known.Max.X; X += Step)
+							{
+								const FIntVector KnownPosition = (FIntVector(X, Y, Z) - KnownValues.Bounds.Min) / Step;
+								const FIntVector LocalPosition = (FIntVector(X, Y, Z) - Bounds.Min) / Step;
+								FVoxelUtilities::Get3D(Values, FIntVector(ValuesSize), LocalPosition) = FVoxelUtilities::Get3D(KnownValues.Values, KnownSize, KnownPosition);
+							}
+						}
+					}
+				}
+
+				// Only query the shell around the mesher values
+				const auto QueryBox = [&](const FIntVector& Min, const FIntVector& Max)
+				{
+					if (Min.X < Max.X && Min.Y < Max.Y && Min.Z < Max.Z)
+					{
+						Data.Get<FVoxelValue>(QueryZone.ShrinkTo(FVoxelIntBox(Min, Max)), LOD);
+					}
+				};
+				const FIntVector& Min = Bounds.Min;
+				const FIntVector& Max = Bounds.Max;
+				// X slabs
+				QueryBox(Min, FIntVector(Known.Min.X, Max.Y, Max.Z));
+				QueryBox(FIntVector(Known.Max.X, Min.Y, Min.Z), Max);
+				// Y slabs
+				QueryBox(FIntVector(Known.Min.X, Min.Y, Min.Z), FIntVector(Known.Max.X, Known.Min.Y, Max.Z));
+				QueryBox(FIntVector(Known.Min.X, Known.Max.Y, Min.Z), FIntVector(Known.Max.X, Max.Y, Max.Z));
+				// Z slabs
+				QueryBox(FIntVector(Known.Min.X, Known.Min.Y, Min.Z), FIntVector(Known.Max.X, Known.Max.Y, Known.Min.Z));
+				QueryBox(FIntVector(Known.Min.X, Known.Min.Y, Known.Max.Z), FIntVector(Known.Max.X, Known.Max.Y, Max.Z));
+			}
 		}
 		
 		TArray<float> Distances;
@@ -279,3 +625,154 @@ void FVoxelChunkMesh::BuildDistanceField(int32 LOD, const FIntVector& Position,
 		CompressedDistanceFieldVolume = QuantizedDistanceFieldVolume;
 	}
 }
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+void FVoxelChunkMesh::BuildHeightfieldCollisionData(int32 LOD, const FIntVector& Position, const FVoxelData& Data)
+{
+	VOXEL_ASYNC_FUNCTION_COUNTER();
+
+	if (IsEmpty())
+	{
+		return;
+	}
+
+	const int32 Step = 1 << LOD;
+	const int32 NumSamples = RENDER_CHUNK_SIZE + 1;
+	// Extend: the mesher queries one more voxel on each side for the normals
+	const FVoxelIntBox Bounds = FVoxelIntBox(Position, Position + RENDER_CHUNK_SIZE * Step).Extend(Step);
+
+	if (!Data.Generator->IsHeightmapInBounds(Bounds))
+	{
+		return;
+	}
+
+	{
+		// Any edit or item can create overhangs: use a trimesh
+		FVoxelReadScopeLock Lock(Data, Bounds, FUNCTION_FNAME);
+		const bool bIsUnedited = FVoxelOctreeUtilities::IterateTreeInBoundsEarlyExit(Data.GetOctree(), Bounds, [&](const FVoxelDataOctreeBase& Tree)
+		{
+			if (Tree.IsLeafOrHasNoChildren() && Tree.GetItemHolder().NumItems() > 0)
+			{
+				return false;
+			}
+			if (Tree.IsLeaf() && Tree.AsLeaf().GetData<FVoxelValue>().IsDirty())
+			{
+				return false;
+			}
+			return true;
+		});
+		if (!bIsUnedited)
+		{
+			return;
+		}
+	}
+
+	const auto NewData = MakeVoxelShared<FVoxelHeightfieldCollisionData>();
+	NewData->NumSamples = NumSamples;
+	NewData->Step = Step;
+	NewData->MinHeight = 0;
+	NewData->MaxHeight = RENDER_CHUNK_SIZE * Step;
+
+	NewData->Heights.SetNumUninitialized(NumSamples * NumSamples);
+	for (int32 Y = 0; Y < NumSamples; Y++)
+	{
+		for (int32 X = 0; X < NumSamples; X++)
+		{
+			const v_flt Height = Data.Generator->GetHeightmapHeight(Position.X + X * Step, Position.Y + Y * Step);
+			NewData->Heights[X + NumSamples * Y] = Height - Position.Z;
+		}
+	}
+
+	// Skip chunks that only touch the surface of the chunks above or below
+	bool bHasCells = false;
+	for (int32 Y = 0; Y < NumSamples - 1 && !bHasCells; Y++)
+	{
+		for (int32 X = 0; X < NumSamples - 1 && !bHasCells; X++)
+		{
+			bHasCells = !NewData->IsHole(X, Y);
+		}
+	}
+	if (!bHasCells)
+	{
+		return;
+	}
+
+	check(!HeightfieldCollisionData.IsValid());
+	HeightfieldCollisionData = NewData;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+static TAutoConsoleVariable<float> CVarVoxelConvexMaxEmptyRatio(
+	TEXT("voxel.collision.VoxelConvexMaxEmptyRatio"),
+	0.25f,
+	TEXT("Max ratio of empty voxels in the bounds of a convex piece built by voxel.collision.UseVoxelConvexDecomposition. Higher = fewer hulls, but a worse fit"),
+	ECVF_Default);
+
+void FVoxelChunkMesh::BuildConvexCollisionData(int32 LOD, const FIntVector& Position, int32 NumConvexHullsPerAxis, const FVoxelChunkMeshKnownValues& KnownValues)
+{
+	VOXEL_ASYNC_FUNCTION_COUNTER();
+
+	if (IsEmpty() || !KnownValues.Values)
+	{
+		return;
+	}
+
+	const int32 Step = 1 << LOD;
+	const int32 NumSamples = RENDER_CHUNK_SIZE + 1;
+	const FVoxelIntBox Bounds(Position, Position + NumSamples * Step);
+	if (!KnownValues.Bounds.Contains(Bounds) || !KnownValues.Bounds.IsMultipleOf(Step))
+	{
+		// Mesher values don't cover the whole chunk
+		return;
+	}
+
+	TArray<bool> SolidSamples;
+	SolidSamples.SetNumUninitialized(NumSamples * NumSamples * NumSamples);
+	{
+		VOXEL_ASYNC_SCOPE_COUNTER("Copy mesher values");
+		const FIntVector KnownSize = KnownValues.Bounds.Size() / Step;
+		const FIntVector Offset = (Position - KnownValues.Bounds.Min) / Step;
+		for (int32 Z = 0; Z < NumSamples; Z++)
+		{
+			for (int32 Y = 0; Y < NumSamples; Y++)
+			{
+				for (int32 X = 0; X < NumSamples; X++)
+				{
+					const FVoxelValue Value = FVoxelUtilities::Get3D(KnownValues.Values, KnownSize, Offset + FIntVector(X, Y, Z));
+					SolidSamples[X + NumSamples * Y + NumSamples * NumSamples * Z] = !Value.IsEmpty();
+				}
+			}
+		}
+	}
+
+	const auto NewData = MakeVoxelShared<FVoxelConvexCollisionData>();
+	FVoxelConvexDecompositionUtilities::DecomposeSolidSamples(
+		RENDER_CHUNK_SIZE,
+		SolidSamples,
+		// 4 cells per hull: the pieces will be merged
+		FVoxelConvexDecompositionUtilities::GetResolution(RENDER_CHUNK_SIZE, 4 * NumConvexHullsPerAxis),
+		FMath::Clamp(CVarVoxelConvexMaxEmptyRatio.GetValueOnAnyThread(), 0.f, 1.f),
+		NewData->Convexes);
+
+	if (NewData->Convexes.Num() == 0)
+	{
+		return;
+	}
+
+	for (auto& Convex : NewData->Convexes)
+	{
+		for (auto& Vertex : Convex)
+		{
+			Vertex *= Step;
+		}
+	}
+
+	check(!ConvexCollisionData.IsValid());
+	ConvexCollisionData = NewData;
+}
@@ -4,6 +4,7 @@
 #include "VoxelRender/VoxelProceduralMeshSceneProxy.h"
 #include "VoxelRender/PhysicsCooker/VoxelAsyncPhysicsCooker.h"
 #include "VoxelRender/VoxelProcMeshBuffers.h"
+#include "VoxelRender/VoxelChunkMesh.h"
 #include "VoxelRender/VoxelMaterialInterface.h"
 #include "VoxelRender/VoxelToolRendering.h"
 #include "VoxelRender/IVoxelRenderer.h"
@@ -22,6 +23,13 @@
 #include "DrawDebugHelpers.h"
 #include "Materials/Material.h"
 
+#if WITH_PHYSX && PHYSICS_INTERFACE_PHYSX
+#include "PhysXPublic.h"
+#include "PhysicsPublic.h"
+#include "PhysicsFiltering.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
+#endif
+
 DEFINE_VOXEL_MEMORY_STAT(STAT_VoxelPhysicsTriangleMeshesMemory);
 
 static TAutoConsoleVariable<int32> CVarShowCollisionsUpdates(
@@ -94,6 +102,8 @@ void UVoxelProceduralMeshComponent::Init(
 void UVoxelProceduralMeshComponent::ClearInit()
 {
 	ensure(ProcMeshSections.Num() == 0);
+	HeightfieldCollisionData.Reset();
+	ConvexCollisionData.Reset();
 	bInit = false;
 }
 
@@ -210,6 +220,16 @@ void UVoxelProceduralMeshComponent::SetDistanceFieldData(const TVoxelSharedPtr<c
 	MarkRenderStateDirty();
 }
 
+void UVoxelProceduralMeshComponent::SetHeightfieldCollisionData(const TVoxelSharedPtr<const FVoxelHeightfieldCollisionData>& InHeightfieldCollisionData)
+{
+	HeightfieldCollisionData = InHeightfieldCollisionData;
+}
+
+void UVoxelProceduralMeshComponent::SetConvexCollisionData(const TVoxelSharedPtr<const FVoxelConvexCollisionData>& InConvexCollisionData)
+{
+	ConvexCollisionData = InConvexCollisionData;
+}
+
 void UVoxelProceduralMeshComponent::SetProcMeshSection(int32 Index, FVoxelProcMeshSectionSettings Settings, TUniquePtr<FVoxelProcMeshBuffers> Buffers, EVoxelProcMeshSectionUpdate Update)
 {
 	VOXEL_FUNCTION_COUNTER();
@@ -571,6 +591,10 @@ void UVoxelProceduralMeshComponent::OnComponentDestroyed(bool bDestroyingHierarc
 		UpdateConvexMeshes({}, {}, {}, true);
 #endif
 	}
+
+#if WITH_PHYSX && PHYSICS_INTERFACE_PHYSX
+	SetCookedHeightfield(nullptr, nullptr);
+#endif
 	
 	// Destroy async cooker
 	if (AsyncCooker)
@@ -583,6 +607,57 @@ void UVoxelProceduralMeshComponent::OnComponentDestroyed(bool bDestroyingHierarc
 	ProcMeshSections.Reset();
 }
 
+void UVoxelProceduralMeshComponent::OnCreatePhysicsState()
+{
+	Super::OnCreatePhysicsState();
+
+#if WITH_PHYSX && PHYSICS_INTERFACE_PHYSX
+	CreateHeightfieldActor();
+#endif
+}
+
+void UVoxelProceduralMeshComponent::OnDestroyPhysicsState()
+{
+#if WITH_PHYSX && PHYSICS_INTERFACE_PHYSX
+	DestroyHeightfieldActor();
+#endif
+
+	Super::OnDestroyPhysicsState();
+}
+
+void UVoxelProceduralMeshComponent::OnUpdateTransform(EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
+{
+	Super::OnUpdateTransform(UpdateTransformFlags, Teleport);
+
+#if WITH_PHYSX && PHYSICS_INTERFACE_PHYSX
+	if (HeightfieldActor)
+	{
+		// The heightfield geometry depends on the scale: simpler to recreate it, this is rare
+		DestroyHeightfieldActor();
+		CreateHeightfieldActor();
+	}
+#endif
+}
+
+void UVoxelProceduralMeshComponent::SetPhysMaterialOverride(UPhysicalMaterial* NewPhysMaterial)
+{
+	Super::SetPhysMaterialOverride(NewPhysMaterial);
+
+#if WITH_PHYSX && PHYSICS_INTERFACE_PHYSX
+	RecreateHeightfieldActor();
+#endif
+}
+
+void UVoxelProceduralMeshComponent::OnComponentCollisionSettingsChanged()
+{
+	Super::OnComponentCollisionSettingsChanged();
+
+#if WITH_PHYSX && PHYSICS_INTERFACE_PHYSX
+	// Also creates or destroys the actor if collisions were enabled or disabled
+	RecreateHeightfieldActor();
+#endif
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -596,6 +671,27 @@ void UVoxelProceduralMeshComponent::UpdatePhysicalMaterials()
 	{
 		BodyInst->UpdatePhysicalMaterials();
 	}
+
+#if WITH_PHYSX && PHYSICS_INTERFACE_PHYSX
+	// The heightfield actor isn't updated by the body instance
+	if (HeightfieldActor)
+	{
+		UPhysicalMaterial* PhysicalMaterial = BodyInstance.GetSimplePhysicalMaterial();
+		physx::PxMaterial* Material = PhysicalMaterial ? PhysicalMaterial->GetPhysicsMaterial().Material : nullptr;
+
+		physx::PxShape* Shape = nullptr;
+		physx::PxMaterial* ShapeMaterial = nullptr;
+		if (ensure(Material) && 
+			ensure(HeightfieldActor->getShapes(&Shape, 1) == 1) &&
+			Shape->getMaterials(&ShapeMaterial, 1) == 1 &&
+			ShapeMaterial != Material)
+		{
+			physx::PxScene* PScene = HeightfieldActor->getScene();
+			SCOPED_SCENE_WRITE_LOCK(PScene);
+			Shape->setMaterials(&Material, 1);
+		}
+	}
+#endif
 }
 
 void UVoxelProceduralMeshComponent::UpdateLocalBounds()
@@ -675,6 +771,7 @@ void UVoxelProceduralMeshComponent::UpdateCollision()
 	{
 #if WITH_PHYSX && PHYSICS_INTERFACE_PHYSX
 		UpdateConvexMeshes({}, {}, {});
+		SetCookedHeightfield(nullptr, nullptr);
 #endif
 		FinishCollisionUpdate();
 	}
@@ -732,6 +829,149 @@ void UVoxelProceduralMeshComponent::UpdateConvexMeshes(
 
 	Root->UpdateConvexCollision(UniqueId, ConvexBounds, MoveTemp(ConvexElements), MoveTemp(ConvexMeshes));
 }
+
+void UVoxelProceduralMeshComponent::SetCookedHeightfield(physx::PxHeightField* NewHeightfield, const TVoxelSharedPtr<const FVoxelHeightfieldCollisionData>& NewHeightfieldData)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	ensure(!NewHeightfield == !NewHeightfieldData.IsValid());
+
+	// Will be recreated by RecreatePhysicsState
+	DestroyHeightfieldActor();
+
+	if (Heightfield)
+	{
+		// Ref counted: safe even if a shape still uses it
+		Heightfield->release();
+	}
+	Heightfield = NewHeightfield;
+	HeightfieldData = NewHeightfieldData;
+}
+
+void UVoxelProceduralMeshComponent::CreateHeightfieldActor()
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	ensure(!HeightfieldActor);
+
+	if (!Heightfield || !ensure(HeightfieldData.IsValid()) || !IsCollisionEnabled())
+	{
+		return;
+	}
+
+	UWorld* World = GetWorld();
+	FPhysScene* PhysScene = World ? World->GetPhysicsScene() : nullptr;
+	physx::PxScene* PScene = PhysScene ? PhysScene->GetPxScene() : nullptr;
+	if (!PScene)
+	{
+		return;
+	}
+
+	UPhysicalMaterial* PhysicalMaterial = BodyInstance.GetSimplePhysicalMaterial();
+	physx::PxMaterial* Material = PhysicalMaterial ? PhysicalMaterial->GetPhysicsMaterial().Material : nullptr;
+	if (!ensure(Material))
+	{
+		return;
+	}
+
+	const FTransform Transform = GetComponentTransform();
+	const FVector Scale = Transform.GetScale3D();
+	const int32 NumSamples = HeightfieldData->NumSamples;
+	const float Step = HeightfieldData->Step;
+
+	const physx::PxHeightFieldGeometry Geometry(
+		Heightfield,
+		physx::PxMeshGeometryFlags(),
+		HeightfieldData->GetHeightScale() * Scale.Z,
+		Step * Scale.X,
+		Step * Scale.Y);
+	if (!ensure(Geometry.isValid()))
+	{
+		return;
+	}
+
+	physx::PxShape* Shape = GPhysXSDK->createShape(Geometry, *Material, true);
+	if (!ensure(Shape))
+	{
+		return;
+	}
+
+	// Rows along X, columns along -Y and heights along Z, see FVoxelAsyncPhysicsCooker_PhysX::CreateHeightfield
+	Shape->setLocalPose(physx::PxTransform(
+		physx::PxVec3(0, (NumSamples - 1) * Step * Scale.Y, 0),
+		physx::PxQuat(physx::PxHalfPi, physx::PxVec3(1, 0, 0))));
+
+	FCollisionFilterData QueryFilterData;
+	FCollisionFilterData SimFilterData;
+	CreateShapeFilterData(
+		GetCollisionObjectType(),
+		FMaskFilter(0),
+		GetOwner() ? GetOwner()->GetUniqueID() : 0,
+		GetCollisionResponseToChannels(),
+		GetUniqueID(),
+		0,
+		QueryFilterData,
+		SimFilterData,
+		false,
+		false,
+		true);
+	// The heightfield is used for both simple & complex queries
+	QueryFilterData.Word3 |= EPDF_SimpleCollision | EPDF_ComplexCollision;
+	SimFilterData.Word3 |= EPDF_SimpleCollision | EPDF_ComplexCollision;
+
+	Shape->setQueryFilterData(U2PFilterData(QueryFilterData));
+	Shape->setSimulationFilterData(U2PFilterData(SimFilterData));
+	Shape->setFlag(physx::PxShapeFlag::eSCENE_QUERY_SHAPE, CollisionEnabledHasQuery(GetCollisionEnabled()));
+	Shape->setFlag(physx::PxShapeFlag::eSIMULATION_SHAPE, CollisionEnabledHasPhysics(GetCollisionEnabled()));
+	Shape->setFlag(physx::PxShapeFlag::eVISUALIZATION, true);
+
+	physx::PxRigidStatic* Actor = GPhysXSDK->createRigidStatic(U2PTransform(FTransform(Transform.GetRotation(), Transform.GetTranslation())));
+	Actor->attachShape(*Shape);
+	Shape->release();
+
+	HeightfieldBodyInstance.OwnerComponent = this;
+	HeightfieldBodyInstance.PhysxUserData = FPhysxUserData(&HeightfieldBodyInstance);
+	Actor->userData = &HeightfieldBodyInstance.PhysxUserData;
+
+	{
+		SCOPED_SCENE_WRITE_LOCK(PScene);
+		PScene->addActor(*Actor);
+	}
+
+	HeightfieldActor = Actor;
+}
+
+void UVoxelProceduralMeshComponent::DestroyHeightfieldActor()
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	if (!HeightfieldActor)
+	{
+		return;
+	}
+
+	if (physx::PxScene* PScene = HeightfieldActor->getScene())
+	{
+		SCOPED_SCENE_WRITE_LOCK(PScene);
+		PScene->removeActor(*HeightfieldActor);
+	}
+	HeightfieldActor->release();
+	HeightfieldActor = nullptr;
+}
+
+void UVoxelProceduralMeshComponent::RecreateHeightfieldActor()
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	// Else it will be created by OnCreatePhysicsState
+	if (!IsPhysicsStateCreated())
+	{
+		return;
+	}
+
+	DestroyHeightfieldActor();
+	CreateHeightfieldActor();
+}
 #endif
 
 ///////////////////////////////////////////////////////////////////////////////
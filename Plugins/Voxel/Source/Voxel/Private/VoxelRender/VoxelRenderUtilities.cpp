@@ -13,6 +13,7 @@
 #include "VoxelMessages.h"
 
 #include "Materials/MaterialInstanceDynamic.h"
+#include "Async/ParallelFor.h"
 
 static TAutoConsoleVariable<int32> CVarMaxSectionsPerChunk(
 	TEXT("voxel.renderer.MaxSectionsPerChunk"),
@@ -195,7 +196,12 @@ TUniquePtr<FVoxelProcMeshBuffers> FVoxelRenderUtilities::MergeSections_AnyThread
 		
 		const auto BufferIterator = [&](const FVoxelChunkMeshBuffers& ChunkBuffers)
 		{
-			ProcMeshBuffers.Guids.Add(ChunkBuffers.Guid);
+			{
+				// Identical chunks share their buffers & guid, see FVoxelChunkMeshDeduplicator: make the guids unique in the merged buffers
+				const FIntVector Offset = Section.ChunkPosition - CenterPosition;
+				const FGuid& Guid = ChunkBuffers.Guid;
+				ProcMeshBuffers.Guids.Add(FGuid(Guid.A ^ uint32(Offset.X), Guid.B ^ uint32(Offset.Y), Guid.C ^ uint32(Offset.Z), Guid.D));
+			}
 
 			// Else wrong NumTextureCoordinates gets assigned
 			// Only part of the buffers can be empty; having all of them empty is invalid
@@ -326,10 +332,43 @@ TUniquePtr<FVoxelProcMeshBuffers> FVoxelRenderUtilities::MergeSections_AnyThread
 			IndexBuffer.SetIndex(IndicesOffset + Index, VerticesOffset + Get(Chunk.Indices, Index));
 		}
 	};
+
+	// Build the adjacency of all the chunks in parallel: this is by far the most expensive part when using tessellation
+	TArray<TArray<uint32>> ChunksAdjacencyIndices;
+	if (NumAdjacencyIndices > 0)
+	{
+		VOXEL_ASYNC_SCOPE_COUNTER("BuildAdjacency");
+		
+		// Same order as the copy loop below
+		TArray<const FVoxelChunkMeshBuffers*> ChunksNeedingAdjacency;
+		for (const FVoxelChunkMeshSection& Chunk : Sections)
+		{
+			if (!Chunk.bEnableTessellation) continue;
+			
+			if (Chunk.MainChunk.IsValid() && bShowMainChunks)
+			{
+				ChunksNeedingAdjacency.Add(Chunk.MainChunk.Get());
+			}
+			if (Chunk.TransitionChunk.IsValid())
+			{
+				ChunksNeedingAdjacency.Add(Chunk.TransitionChunk.Get());
+			}
+		}
+
+		ChunksAdjacencyIndices.SetNum(ChunksNeedingAdjacency.Num());
+		ParallelFor(ChunksNeedingAdjacency.Num(), [&](int32 Index)
+		{
+			ChunksNeedingAdjacency[Index]->BuildAdjacency(ChunksAdjacencyIndices[Index]);
+		}, ChunksNeedingAdjacency.Num() < 2);
+	}
+	CHECK_CANCEL();
+	
+	int32 ChunkAdjacencyIndex = 0;
 	const auto CopyAdjacencyIndices = [&](const FVoxelChunkMeshBuffers& Chunk)
 	{
-		TArray<uint32> AdjacencyIndices;
-		Chunk.BuildAdjacency(AdjacencyIndices);
+		if (!ensure(ChunksAdjacencyIndices.IsValidIndex(ChunkAdjacencyIndex))) return 0;
+		
+		const TArray<uint32>& AdjacencyIndices = ChunksAdjacencyIndices[ChunkAdjacencyIndex++];
 		ensure(AdjacencyIndices.Num() == 4 * Chunk.Indices.Num());
 		
 		VOXEL_ASYNC_SCOPE_COUNTER("CopyAdjacencyIndices");
@@ -474,6 +513,159 @@ TUniquePtr<FVoxelBuiltChunkMeshes> FVoxelRenderUtilities::BuildMeshes_AnyThread(
 	return BuiltMeshesPtr;
 }
 
+TUniquePtr<FVoxelProcMeshBuffers> FVoxelRenderUtilities::ConcatenateBuffers_AnyThread(
+	const TArray<const FVoxelProcMeshBuffers*>& Buffers,
+	const FThreadSafeCounter& CancelCounter,
+	int32 CancelThreshold)
+{
+	VOXEL_ASYNC_FUNCTION_COUNTER();
+
+	if (!ensure(Buffers.Num() > 0)) return {};
+
+	const FVoxelProcMeshBuffers& FirstBuffers = *Buffers[0];
+	const auto& FirstStaticMeshBuffer = FirstBuffers.VertexBuffers.StaticMeshVertexBuffer;
+	// Not initialized if bRenderWorld is false
+	const bool bHasStaticMeshData = FirstStaticMeshBuffer.GetNumVertices() > 0;
+	const bool bHasColorData = FirstBuffers.VertexBuffers.ColorVertexBuffer.GetNumVertices() > 0;
+	const int32 NumTextureCoordinates = FirstStaticMeshBuffer.GetNumTexCoords();
+	
+	int32 NumVertices = 0;
+	int32 NumIndices = 0;
+	int32 NumAdjacencyIndices = 0;
+	for (const FVoxelProcMeshBuffers* It : Buffers)
+	{
+		NumVertices += It->GetNumVertices();
+		NumIndices += It->GetNumIndices();
+		NumAdjacencyIndices += It->AdjacencyIndexBuffer.GetNumIndices();
+		
+		const auto& StaticMeshBuffer = It->VertexBuffers.StaticMeshVertexBuffer;
+		if (!ensure(
+			(StaticMeshBuffer.GetNumVertices() > 0) == bHasStaticMeshData &&
+			(It->VertexBuffers.ColorVertexBuffer.GetNumVertices() > 0) == bHasColorData &&
+			StaticMeshBuffer.GetNumTexCoords() == NumTextureCoordinates &&
+			StaticMeshBuffer.GetUseFullPrecisionUVs() == FirstStaticMeshBuffer.GetUseFullPrecisionUVs() &&
+			StaticMeshBuffer.GetUseHighPrecisionTangentBasis() == FirstStaticMeshBuffer.GetUseHighPrecisionTangentBasis()))
+		{
+			return {};
+		}
+	}
+	ensure(NumAdjacencyIndices == 4 * NumIndices || NumAdjacencyIndices == 0);
+	if (!ensure(NumVertices > 0)) return {};
+
+	auto ProcMeshBuffersPtr = MakeUnique<FVoxelProcMeshBuffers>();
+	auto& ProcMeshBuffers = *ProcMeshBuffersPtr;
+	
+	auto& PositionBuffer = ProcMeshBuffers.VertexBuffers.PositionVertexBuffer;
+	auto& StaticMeshBuffer = ProcMeshBuffers.VertexBuffers.StaticMeshVertexBuffer;
+	auto& ColorBuffer = ProcMeshBuffers.VertexBuffers.ColorVertexBuffer;
+	auto& IndexBuffer = ProcMeshBuffers.IndexBuffer;
+	auto& AdjacencyIndexBuffer = ProcMeshBuffers.AdjacencyIndexBuffer;
+
+	CHECK_CANCEL();
+	PositionBuffer.Init(NumVertices, FVoxelProcMeshBuffers::bNeedsCPUAccess);
+	if (bHasStaticMeshData)
+	{
+		StaticMeshBuffer.SetUseFullPrecisionUVs(FirstStaticMeshBuffer.GetUseFullPrecisionUVs());
+		StaticMeshBuffer.SetUseHighPrecisionTangentBasis(FirstStaticMeshBuffer.GetUseHighPrecisionTangentBasis());
+		StaticMeshBuffer.Init(NumVertices, NumTextureCoordinates, FVoxelProcMeshBuffers::bNeedsCPUAccess);
+	}
+	if (bHasColorData)
+	{
+		ColorBuffer.Init(NumVertices, FVoxelProcMeshBuffers::bNeedsCPUAccess);
+	}
+	IndexBuffer.AllocateData(NumIndices);
+	AdjacencyIndexBuffer.AllocateData(NumAdjacencyIndices);
+	CHECK_CANCEL();
+
+	int32 VerticesOffset = 0;
+	int32 IndicesOffset = 0;
+	int32 AdjacencyIndicesOffset = 0;
+	// Tangents & UVs are stored per vertex, with the same stride in all the buffers
+	uint32 TangentsByteOffset = 0;
+	uint32 TexCoordsByteOffset = 0;
+	
+	for (const FVoxelProcMeshBuffers* It : Buffers)
+	{
+		CHECK_CANCEL();
+		
+		const FVoxelProcMeshBuffers& Source = *It;
+		const int32 SourceNumVertices = Source.GetNumVertices();
+
+		ProcMeshBuffers.Guids.Append(Source.Guids);
+		ProcMeshBuffers.LocalBounds += Source.LocalBounds;
+		
+		if (SourceNumVertices > 0)
+		{
+			VOXEL_ASYNC_SCOPE_COUNTER("Copy vertices");
+			
+			FMemory::Memcpy(
+				&PositionBuffer.VertexPosition(VerticesOffset),
+				&Source.VertexBuffers.PositionVertexBuffer.VertexPosition(0),
+				SourceNumVertices * sizeof(FVector));
+			
+			if (bHasColorData)
+			{
+				FMemory::Memcpy(
+					&ColorBuffer.VertexColor(VerticesOffset),
+					&Source.VertexBuffers.ColorVertexBuffer.VertexColor(0),
+					SourceNumVertices * sizeof(FColor));
+			}
+			
+			if (bHasStaticMeshData)
+			{
+				const auto& SourceStaticMeshBuffer = Source.VertexBuffers.StaticMeshVertexBuffer;
+				
+				const uint32 TangentsSize = SourceStaticMeshBuffer.GetTangentSize();
+				FMemory::Memcpy(
+					static_cast<uint8*>(StaticMeshBuffer.GetTangentData()) + TangentsByteOffset,
+					SourceStaticMeshBuffer.GetTangentData(),
+					TangentsSize);
+				TangentsByteOffset += TangentsSize;
+
+				const uint32 TexCoordsSize = SourceStaticMeshBuffer.GetTexCoordSize();
+				if (TexCoordsSize > 0)
+				{
+					FMemory::Memcpy(
+						static_cast<uint8*>(StaticMeshBuffer.GetTexCoordData()) + TexCoordsByteOffset,
+						SourceStaticMeshBuffer.GetTexCoordData(),
+						TexCoordsSize);
+					TexCoordsByteOffset += TexCoordsSize;
+				}
+			}
+		}
+
+		{
+			VOXEL_ASYNC_SCOPE_COUNTER("Copy indices");
+			
+			const auto& SourceIndexBuffer = Source.IndexBuffer;
+			for (int32 Index = 0; Index < SourceIndexBuffer.GetNumIndices(); Index++)
+			{
+				IndexBuffer.SetIndex(IndicesOffset + Index, VerticesOffset + SourceIndexBuffer.GetIndex(Index));
+			}
+			IndicesOffset += SourceIndexBuffer.GetNumIndices();
+			
+			const auto& SourceAdjacencyIndexBuffer = Source.AdjacencyIndexBuffer;
+			for (int32 Index = 0; Index < SourceAdjacencyIndexBuffer.GetNumIndices(); Index++)
+			{
+				AdjacencyIndexBuffer.SetIndex(AdjacencyIndicesOffset + Index, VerticesOffset + SourceAdjacencyIndexBuffer.GetIndex(Index));
+			}
+			AdjacencyIndicesOffset += SourceAdjacencyIndexBuffer.GetNumIndices();
+		}
+
+		VerticesOffset += SourceNumVertices;
+	}
+
+	check(VerticesOffset == NumVertices);
+	check(IndicesOffset == NumIndices);
+	check(AdjacencyIndicesOffset == NumAdjacencyIndices);
+
+	ProcMeshBuffers.UpdateStats();
+
+	CHECK_CANCEL();
+
+	return ProcMeshBuffersPtr;
+}
+
 #undef CHECK_CANCEL
 
 FVoxelChunkMeshesToBuild FVoxelRenderUtilities::GetMeshesToBuild(
@@ -93,6 +93,13 @@ namespace FVoxelRenderUtilities
 		const FIntVector& CenterPosition,
 		const FThreadSafeCounter& CancelCounter = FThreadSafeCounter(),
 		int32 CancelThreshold = 0);
+	// Appends already built buffers, offsetting their indices. Much cheaper than MergeSections_AnyThread:
+	// no transvoxel translation, tangents packing or adjacency computation, mostly memcpys
+	// All the buffers must have been built with the same settings & relative to the same position
+	TUniquePtr<FVoxelProcMeshBuffers> ConcatenateBuffers_AnyThread(
+		const TArray<const FVoxelProcMeshBuffers*>& Buffers,
+		const FThreadSafeCounter& CancelCounter = FThreadSafeCounter(),
+		int32 CancelThreshold = 0);
 	TUniquePtr<FVoxelBuiltChunkMeshes> BuildMeshes_AnyThread(
 		const FVoxelChunkMeshesToBuild& ChunkMeshesToBuild,
 		const FVoxelRendererSettingsBase& RendererSettings,
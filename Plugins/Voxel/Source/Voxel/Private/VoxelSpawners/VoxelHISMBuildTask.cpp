@@ -5,9 +5,12 @@
 #include "VoxelSpawners/VoxelInstancedMeshManager.h"
 #include "VoxelUtilities/VoxelThreadingUtilities.h"
 
+#include "Algo/BinarySearch.h"
 #include "Engine/StaticMesh.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
 
-static TAutoConsoleVariable<int32> CVarLogHISMBuildTimes(
+TAutoConsoleVariable<int32> CVarLogHISMBuildTimes(
 	TEXT("voxel.spawners.LogCullingTreeBuildTimes"),
 	0,
 	TEXT("If true, will log all the HISM build times"),
@@ -176,3 +179,335 @@ uint64 FVoxelHISMBuildTask::GetUniqueId()
 {
 	return UNIQUE_ID();
 }
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+namespace FVoxelHISMClusterTreeUtilities
+{
+	struct FRefitContext
+	{
+		TArray<FClusterNode>& ClusterTree;
+		TBitArray<>& EmptyNodes;
+		const TArray<FVoxelSpawnerMatrix>& BuiltMatrices;
+		const FBox& MeshBox;
+		const TArray<int32>& SortedBuiltIndices;
+		int32 NumRefitted = 0;
+	};
+
+	// DirtyStart/DirtyEnd: range of SortedBuiltIndices inside this node
+	// Returns the new bounds of the node, invalid if it has no instance left
+	FBox RefitNode(FRefitContext& Context, int32 NodeIndex, int32 DirtyStart, int32 DirtyEnd)
+	{
+		FClusterNode& Node = Context.ClusterTree[NodeIndex];
+		Context.NumRefitted++;
+
+		FBox Box(ForceInit);
+		if (Node.FirstChild == -1)
+		{
+			for (int32 InstanceIndex = Node.FirstInstance; InstanceIndex <= Node.LastInstance; InstanceIndex++)
+			{
+				const FMatrix CleanMatrix = Context.BuiltMatrices[InstanceIndex].GetCleanMatrix();
+				if (CleanMatrix.GetScaleVector().IsNearlyZero())
+				{
+					continue;
+				}
+				Box += Context.MeshBox.TransformBy(CleanMatrix);
+			}
+		}
+		else
+		{
+			const auto First = Context.SortedBuiltIndices.GetData() + DirtyStart;
+			const int32 Num = DirtyEnd - DirtyStart;
+			for (int32 ChildIndex = Node.FirstChild; ChildIndex <= Node.LastChild; ChildIndex++)
+			{
+				const FClusterNode& Child = Context.ClusterTree[ChildIndex];
+				const int32 ChildDirtyStart = DirtyStart + Algo::LowerBound(TArrayView<const int32>(First, Num), Child.FirstInstance);
+				const int32 ChildDirtyEnd = DirtyStart + Algo::UpperBound(TArrayView<const int32>(First, Num), Child.LastInstance);
+				if (ChildDirtyStart < ChildDirtyEnd)
+				{
+					Box += RefitNode(Context, ChildIndex, ChildDirtyStart, ChildDirtyEnd);
+				}
+				else if (!Context.EmptyNodes[ChildIndex])
+				{
+					Box += FBox(Child.BoundMin, Child.BoundMax);
+				}
+			}
+		}
+
+		if (Box.IsValid)
+		{
+			Node.BoundMin = Box.Min;
+			Node.BoundMax = Box.Max;
+			Context.EmptyNodes[NodeIndex] = false;
+		}
+		else
+		{
+			// Collapse the node, it only contains instances scaled to zero
+			const FVector Center = (Node.BoundMin + Node.BoundMax) / 2;
+			Node.BoundMin = Center;
+			Node.BoundMax = Center;
+			Context.EmptyNodes[NodeIndex] = true;
+		}
+		return Box;
+	}
+}
+
+int32 FVoxelHISMClusterTreeUtilities::RefitClusters(
+	TArray<FClusterNode>& ClusterTree,
+	TBitArray<>& EmptyNodes,
+	const TArray<FVoxelSpawnerMatrix>& BuiltMatrices,
+	const FBox& MeshBox,
+	TArray<int32> BuiltIndices)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	if (ClusterTree.Num() == 0 || BuiltIndices.Num() == 0)
+	{
+		return 0;
+	}
+	if (!ensure(EmptyNodes.Num() == ClusterTree.Num()))
+	{
+		EmptyNodes.Init(false, ClusterTree.Num());
+	}
+
+	BuiltIndices.Sort();
+
+	FRefitContext Context{ ClusterTree, EmptyNodes, BuiltMatrices, MeshBox, BuiltIndices };
+	RefitNode(Context, 0, 0, BuiltIndices.Num());
+	return Context.NumRefitted;
+}
+
+FVoxelHISMClusterTreeUtilities::FClusterTreePtr FVoxelHISMClusterTreeUtilities::RefitClustersDoubleBuffered(
+	const FClusterTreePtr& FrontTree,
+	FDoubleBufferedTree& DoubleBufferedTree,
+	TBitArray<>& EmptyNodes,
+	const TArray<FVoxelSpawnerMatrix>& BuiltMatrices,
+	const FBox& MeshBox,
+	const TArray<int32>& BuiltIndices,
+	int32& OutNumRefitted,
+	bool& bOutCopied)
+{
+	VOXEL_FUNCTION_COUNTER();
+	check(FrontTree.IsValid());
+
+	FClusterTreePtr NewTree = MoveTemp(DoubleBufferedTree.BackTree);
+	TArray<int32> IndicesToRefit = BuiltIndices;
+
+	bOutCopied = !NewTree.IsValid() || !NewTree.IsUnique() || NewTree->Num() != FrontTree->Num();
+	if (bOutCopied)
+	{
+		VOXEL_SCOPE_COUNTER("Copy tree");
+		NewTree = MakeShared<TArray<FClusterNode>, ESPMode::ThreadSafe>(*FrontTree);
+	}
+	else
+	{
+		// Catch up with the removals done on the front tree since we swapped them
+		// Refitting only depends on the current matrices, so it doesn't matter that some of these were already refitted
+		// EmptyNodes is valid for both trees: nodes not refitted here didn't change since the swap
+		IndicesToRefit.Append(DoubleBufferedTree.PendingBuiltIndices);
+	}
+
+	OutNumRefitted = RefitClusters(*NewTree, EmptyNodes, BuiltMatrices, MeshBox, MoveTemp(IndicesToRefit));
+
+	DoubleBufferedTree.BackTree = FrontTree;
+	DoubleBufferedTree.PendingBuiltIndices = BuiltIndices;
+
+	return NewTree;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+static void BenchmarkHISMInstanceRemoval(const TArray<FString>& Args)
+{
+	const int32 NumInstances = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 100000;
+	const int32 NumRemovals = Args.Num() > 1 ? FMath::Max(1, FCString::Atoi(*Args[1])) : 20;
+	const float Radius = Args.Num() > 2 ? FMath::Max(1.f, FCString::Atof(*Args[2])) : 1000.f;
+	
+	constexpr int32 DesiredInstancesPerLeaf = 16;
+	// Keep a constant density of instances: 1 instance per 200x200 area
+	const float WorldSize = FMath::Sqrt(float(NumInstances)) * 200.f;
+	const FBox MeshBox(FVector(-50.f), FVector(50.f));
+
+	FRandomStream Stream(NumInstances);
+	
+	TArray<FMatrix> Transforms;
+	Transforms.Reserve(NumInstances);
+	for (int32 Index = 0; Index < NumInstances; Index++)
+	{
+		const FVector Position(Stream.FRandRange(0, WorldSize), Stream.FRandRange(0, WorldSize), Stream.FRandRange(0, 500.f));
+		const FRotator Rotation(0, Stream.FRandRange(0, 360.f), 0);
+		const FVector Scale(Stream.FRandRange(0.8f, 1.2f));
+		Transforms.Add(FTransform(Rotation, Position, Scale).ToMatrixWithScale());
+	}
+
+	const auto BuildTree = [&](TArray<FMatrix>& InTransforms, TArray<FClusterNode>& OutClusterTree, TArray<int32>& OutSortedInstances)
+	{
+		TArray<float> CustomDataFloats;
+		TArray<int32> InstanceReorderTable;
+		int32 OcclusionLayerNum = 0;
+		UHierarchicalInstancedStaticMeshComponent::BuildTreeAnyThread(
+			InTransforms,
+			ONLY_UE_25_AND_HIGHER(CustomDataFloats,)
+			ONLY_UE_25_AND_HIGHER(0,)
+			MeshBox,
+			OutClusterTree,
+			OutSortedInstances,
+			InstanceReorderTable,
+			OcclusionLayerNum,
+			DesiredInstancesPerLeaf,
+			false);
+	};
+
+	using FClusterTreePtr = FVoxelHISMClusterTreeUtilities::FClusterTreePtr;
+	
+	FClusterTreePtr ClusterTree = MakeShared<TArray<FClusterNode>, ESPMode::ThreadSafe>();
+	TArray<FVoxelSpawnerMatrix> BuiltMatrices;
+	{
+		TArray<int32> SortedInstances;
+		BuildTree(Transforms, *ClusterTree, SortedInstances);
+		
+		BuiltMatrices.Reserve(NumInstances);
+		for (int32 InstanceIndex : SortedInstances)
+		{
+			BuiltMatrices.Add(FVoxelSpawnerMatrix(Transforms[InstanceIndex]));
+		}
+	}
+	TBitArray<> EmptyNodes(false, ClusterTree->Num());
+	FVoxelHISMClusterTreeUtilities::FDoubleBufferedTree DoubleBufferedTree;
+
+	// Same refits, but the previous tree is still used by a scene proxy every time, so it has to be copied
+	FClusterTreePtr CopiedClusterTree = MakeShared<TArray<FClusterNode>, ESPMode::ThreadSafe>(*ClusterTree);
+	TBitArray<> CopiedEmptyNodes = EmptyNodes;
+	FVoxelHISMClusterTreeUtilities::FDoubleBufferedTree CopiedDoubleBufferedTree;
+	FClusterTreePtr ProxyClusterTree;
+
+	const FMatrix EmptyMatrix = FTransform(FQuat::Identity, FVector::ZeroVector, FVector::ZeroVector).ToMatrixWithScale();
+
+	double IncrementalTime = 0;
+	double CopiedIncrementalTime = 0;
+	double RebuildTime = 0;
+	int64 NumRemoved = 0;
+	int64 NumRefitted = 0;
+	int32 NumCopies = 0;
+	for (int32 Removal = 0; Removal < NumRemovals; Removal++)
+	{
+		const FVector Center(Stream.FRandRange(0, WorldSize), Stream.FRandRange(0, WorldSize), Stream.FRandRange(0, 500.f));
+
+		TArray<int32> BuiltIndicesToClear;
+		for (int32 BuiltIndex = 0; BuiltIndex < BuiltMatrices.Num(); BuiltIndex++)
+		{
+			const FMatrix CleanMatrix = BuiltMatrices[BuiltIndex].GetCleanMatrix();
+			if (!CleanMatrix.GetScaleVector().IsNearlyZero() && FVector::DistSquared(CleanMatrix.GetOrigin(), Center) < FMath::Square(Radius))
+			{
+				BuiltIndicesToClear.Add(BuiltIndex);
+			}
+		}
+		NumRemoved += BuiltIndicesToClear.Num();
+
+		{
+			const double StartTime = FPlatformTime::Seconds();
+			for (int32 BuiltIndex : BuiltIndicesToClear)
+			{
+				BuiltMatrices[BuiltIndex] = FVoxelSpawnerMatrix(EmptyMatrix);
+			}
+			int32 NumNodesRefitted = 0;
+			bool bCopied = false;
+			ClusterTree = FVoxelHISMClusterTreeUtilities::RefitClustersDoubleBuffered(
+				ClusterTree,
+				DoubleBufferedTree,
+				EmptyNodes,
+				BuiltMatrices,
+				MeshBox,
+				BuiltIndicesToClear,
+				NumNodesRefitted,
+				bCopied);
+			IncrementalTime += FPlatformTime::Seconds() - StartTime;
+			NumRefitted += NumNodesRefitted;
+			NumCopies += bCopied;
+		}
+		{
+			const double StartTime = FPlatformTime::Seconds();
+			ProxyClusterTree = CopiedClusterTree;
+			int32 NumNodesRefitted = 0;
+			bool bCopied = false;
+			CopiedClusterTree = FVoxelHISMClusterTreeUtilities::RefitClustersDoubleBuffered(
+				CopiedClusterTree,
+				CopiedDoubleBufferedTree,
+				CopiedEmptyNodes,
+				BuiltMatrices,
+				MeshBox,
+				BuiltIndicesToClear,
+				NumNodesRefitted,
+				bCopied);
+			CopiedIncrementalTime += FPlatformTime::Seconds() - StartTime;
+		}
+		{
+			const double StartTime = FPlatformTime::Seconds();
+			TArray<FMatrix> RemainingTransforms;
+			RemainingTransforms.Reserve(BuiltMatrices.Num());
+			for (auto& Matrix : BuiltMatrices)
+			{
+				const FMatrix CleanMatrix = Matrix.GetCleanMatrix();
+				if (!CleanMatrix.GetScaleVector().IsNearlyZero())
+				{
+					RemainingTransforms.Add(CleanMatrix);
+				}
+			}
+			if (RemainingTransforms.Num() > 0)
+			{
+				TArray<FClusterNode> RebuiltClusterTree;
+				TArray<int32> SortedInstances;
+				BuildTree(RemainingTransforms, RebuiltClusterTree, SortedInstances);
+			}
+			RebuildTime += FPlatformTime::Seconds() - StartTime;
+		}
+	}
+
+	// Check that every remaining instance is still inside all of its clusters
+	bool bValid = true;
+	for (int32 NodeIndex = 0; NodeIndex < ClusterTree->Num(); NodeIndex++)
+	{
+		const FClusterNode& Node = (*ClusterTree)[NodeIndex];
+		const FBox NodeBox = FBox(Node.BoundMin, Node.BoundMax).ExpandBy(1.f);
+		for (int32 InstanceIndex = Node.FirstInstance; InstanceIndex <= Node.LastInstance; InstanceIndex++)
+		{
+			const FMatrix CleanMatrix = BuiltMatrices[InstanceIndex].GetCleanMatrix();
+			if (CleanMatrix.GetScaleVector().IsNearlyZero())
+			{
+				continue;
+			}
+			const FBox InstanceBox = MeshBox.TransformBy(CleanMatrix);
+			if (EmptyNodes[NodeIndex] || !NodeBox.IsInsideOrOn(InstanceBox.Min) || !NodeBox.IsInsideOrOn(InstanceBox.Max))
+			{
+				bValid = false;
+			}
+		}
+	}
+
+	LOG_VOXEL(Log, TEXT("HISM instance removal benchmark: %d instances, %d clusters, %d removals of radius %f, %lld instances removed"),
+		NumInstances,
+		ClusterTree->Num(),
+		NumRemovals,
+		Radius,
+		NumRemoved);
+	LOG_VOXEL(Log, TEXT("Incremental refit, double buffered: %fms per removal (%lld nodes refitted in total, %d tree copies)"), IncrementalTime * 1000 / NumRemovals, NumRefitted, NumCopies);
+	LOG_VOXEL(Log, TEXT("Incremental refit, copying the tree every time: %fms per removal"), CopiedIncrementalTime * 1000 / NumRemovals);
+	LOG_VOXEL(Log, TEXT("Full rebuild: %fms per removal"), RebuildTime * 1000 / NumRemovals);
+	if (bValid)
+	{
+		LOG_VOXEL(Log, TEXT("Refitted bounds are valid"));
+	}
+	else
+	{
+		LOG_VOXEL(Error, TEXT("Refitted bounds are invalid!"));
+	}
+}
+
+static FAutoConsoleCommand BenchmarkHISMInstanceRemovalCmd(
+	TEXT("voxel.spawners.BenchmarkInstanceRemoval"),
+	TEXT("Compare the latency of removing instances with an incremental cluster refit (including the tree copies) vs a full tree rebuild. Args: [NumInstances] [NumRemovals] [Radius]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkHISMInstanceRemoval));
@@ -6,11 +6,13 @@
 #include "VoxelMinimal.h"
 #include "VoxelAsyncWork.h"
 #include "VoxelSpawners/VoxelSpawnerMatrix.h"
+#include "VoxelSpawners/VoxelHierarchicalInstancedStaticMeshComponent.h"
 #include "Components/HierarchicalInstancedStaticMeshComponent.h"
 
 class FVoxelInstancedMeshManager;
 class UVoxelHierarchicalInstancedStaticMeshComponent;
 
+extern TAutoConsoleVariable<int32> CVarLogHISMBuildTimes;
 extern TAutoConsoleVariable<int32> CVarRandomColorPerHISM;
 
 struct FVoxelHISMBuiltData
@@ -27,6 +29,34 @@ struct FVoxelHISMBuiltData
 	int32 OcclusionLayerNum = 0;
 };
 
+namespace FVoxelHISMClusterTreeUtilities
+{
+	// Recompute the bounds of the clusters containing BuiltIndices and of their parents, ignoring instances scaled to zero
+	// Clusters with no instance left are flagged in EmptyNodes and are ignored by their parents
+	// Returns the number of nodes that were refitted
+	int32 RefitClusters(
+		TArray<FClusterNode>& ClusterTree,
+		TBitArray<>& EmptyNodes,
+		const TArray<FVoxelSpawnerMatrix>& BuiltMatrices,
+		const FBox& MeshBox,
+		TArray<int32> BuiltIndices);
+
+	using FClusterTreePtr = FVoxelHISMDoubleBufferedClusterTree::FClusterTreePtr;
+	using FDoubleBufferedTree = FVoxelHISMDoubleBufferedClusterTree;
+
+	// Returns the refitted tree, to use instead of FrontTree. FrontTree becomes the back tree
+	// The back tree is only copied from FrontTree if it is still referenced elsewhere, eg by the previous scene proxy
+	FClusterTreePtr RefitClustersDoubleBuffered(
+		const FClusterTreePtr& FrontTree,
+		FDoubleBufferedTree& DoubleBufferedTree,
+		TBitArray<>& EmptyNodes,
+		const TArray<FVoxelSpawnerMatrix>& BuiltMatrices,
+		const FBox& MeshBox,
+		const TArray<int32>& BuiltIndices,
+		int32& OutNumRefitted,
+		bool& bOutCopied);
+}
+
 // Will auto delete
 class FVoxelHISMBuildTask : public FVoxelAsyncWork
 {
@@ -36,6 +36,21 @@ static TAutoConsoleVariable<int32> CVarBVHDebugDepth(
 	TEXT("If above or equal to 1, debug BVH nodes at that depth, 1 being the root"),
 	ECVF_Default);
 
+static TAutoConsoleVariable<int32> CVarIncrementalHISMUpdates(
+	TEXT("voxel.spawners.IncrementalHISMUpdates"),
+	1,
+	TEXT("If true, removing instances will only refit the affected clusters instead of rebuilding the whole HISM culling tree"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarHISMRebuildThreshold(
+	TEXT("voxel.spawners.HISMRebuildThreshold"),
+	0.25f,
+	TEXT("Fraction of removed instances above which the HISM culling tree is fully rebuilt instead of being refitted"),
+	ECVF_Default);
+
+// GetBuiltIndex/GetUnbuiltIndex are linear in the number of deletions: rebuild the tree once there are too many
+static constexpr int32 MaxIncrementalDeletions = 64;
+
 static const FMatrix EmptyMatrix = FTransform(FQuat::Identity, FVector::ZeroVector, FVector::ZeroVector).ToMatrixWithScale();
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -170,6 +185,23 @@ void UVoxelHierarchicalInstancedStaticMeshComponent::Voxel_RemoveSection(const T
 	if (!ensure(Voxel_Sections.Remove(PinnedSection) == 1)) return;
 
 	ensure(PinnedSection.IsUnique());
+
+	// If no tree build is pending, clear the instances from the current tree instead of rebuilding it
+	const bool bIncremental = Voxel_CanRemoveSectionIncrementally(Num);
+	TArray<int32> BuiltIndicesToClear;
+	if (bIncremental)
+	{
+		VOXEL_SCOPE_COUNTER("Find Built Indices");
+		BuiltIndicesToClear.Reserve(Num);
+		for (int32 UnbuiltIndex = StartIndex; UnbuiltIndex < StartIndex + Num; UnbuiltIndex++)
+		{
+			const int32 BuiltIndex = Voxel_Mappings.GetBuiltIndex(UnbuiltIndex);
+			if (BuiltIndex != -1)
+			{
+				BuiltIndicesToClear.Add(BuiltIndex);
+			}
+		}
+	}
 	
 	const auto Fix = [&](int32& Index)
 	{
@@ -231,6 +263,7 @@ void UVoxelHierarchicalInstancedStaticMeshComponent::Voxel_RemoveSection(const T
 
 	if (Voxel_UnbuiltMatrices.Num() == 0)
 	{
+		ensure(!bIncremental);
 		ensure(Voxel_UnbuiltInstancesToClear.Num() == 0);
 		// Having 0 instances creates a whole bunch of issues, so add one
 		Voxel_UnbuiltMatrices.Add(FVoxelSpawnerMatrix(EmptyMatrix));
@@ -258,7 +291,14 @@ void UVoxelHierarchicalInstancedStaticMeshComponent::Voxel_RemoveSection(const T
 	}
 #endif
 
-	Voxel_ScheduleBuildTree();
+	if (bIncremental)
+	{
+		Voxel_ClearBuiltInstances(BuiltIndicesToClear);
+	}
+	else
+	{
+		Voxel_ScheduleBuildTree();
+	}
 	Voxel_UpdateAllocatedMemory();
 }
 
@@ -379,6 +419,8 @@ void UVoxelHierarchicalInstancedStaticMeshComponent::Voxel_FinishBuilding(FVoxel
 		VOXEL_SCOPE_COUNTER("AcceptPrebuiltTree");
 		AcceptPrebuiltTree(BuiltData.ClusterTree, BuiltData.OcclusionLayerNum, NumInstances);
 	}
+	Voxel_EmptyClusterNodes.Init(false, ClusterTreePtr.IsValid() ? ClusterTreePtr->Num() : 0);
+	Voxel_DoubleBufferedClusterTree.Reset();
 
 	for (auto It = Voxel_TaskIdToNewInstancesBounds.CreateIterator(); It; ++It)
 	{
@@ -668,6 +710,8 @@ void UVoxelHierarchicalInstancedStaticMeshComponent::OnComponentDestroyed(bool b
 	Voxel_Mappings.BuiltInstancesToInstances.Empty();
 	Voxel_Mappings.DeletionsStack.Empty();
 	Voxel_UnbuiltInstancesToClear.Empty();
+	Voxel_EmptyClusterNodes.Empty();
+	Voxel_DoubleBufferedClusterTree.Reset();
 	Voxel_TaskIdToNewInstancesBounds.Empty();
 	Voxel_PendingNewInstancesBounds.Empty();
 	
@@ -825,6 +869,8 @@ void UVoxelHierarchicalInstancedStaticMeshComponent::Voxel_UpdateAllocatedMemory
 	Voxel_AllocatedMemory += Voxel_Mappings.BuiltInstancesToInstances.GetAllocatedSize();
 	Voxel_AllocatedMemory += Voxel_Mappings.DeletionsStack.GetAllocatedSize();
 	Voxel_AllocatedMemory += Voxel_UnbuiltInstancesToClear.GetAllocatedSize();
+	Voxel_AllocatedMemory += Voxel_EmptyClusterNodes.GetAllocatedSize();
+	Voxel_AllocatedMemory += Voxel_DoubleBufferedClusterTree.GetAllocatedSize();
 	Voxel_AllocatedMemory += Voxel_TaskIdToNewInstancesBounds.GetAllocatedSize();
 	Voxel_AllocatedMemory += Voxel_PendingNewInstancesBounds.GetAllocatedSize();
 	Voxel_AllocatedMemory += Voxel_InstanceBodies.GetAllocatedSize();
@@ -888,19 +934,13 @@ void UVoxelHierarchicalInstancedStaticMeshComponent::Voxel_SetInstancesScaleToZe
 {
 	VOXEL_FUNCTION_COUNTER();
 
-	const auto InstanceBuffer = PerInstanceRenderData.IsValid() ? PerInstanceRenderData->InstanceBuffer_GameThread : nullptr;
-	ensure(InstanceBuffer.IsValid() || Voxel_TaskUniqueId > 0);
+	ensure(PerInstanceRenderData.IsValid() || Voxel_TaskUniqueId > 0);
 	for (int32 BuiltIndex : BuiltIndices)
 	{
 		const int32 UnbuiltIndex = Voxel_Mappings.GetUnbuiltIndex(BuiltIndex);
 		check(UnbuiltIndex >= 0);
 		
-		if (InstanceBuffer.IsValid())
-		{
-			InstanceBuffer->SetInstance(BuiltIndex, EmptyMatrix, 0);
-		}
 		ensure(Voxel_BuiltMatrices[BuiltIndex] == Voxel_UnbuiltMatrices[UnbuiltIndex]);
-		Voxel_BuiltMatrices[BuiltIndex] = FVoxelSpawnerMatrix(EmptyMatrix);
 		Voxel_UnbuiltMatrices[UnbuiltIndex] = FVoxelSpawnerMatrix(EmptyMatrix);
 
 		if (Voxel_TaskUniqueId > 0)
@@ -909,6 +949,25 @@ void UVoxelHierarchicalInstancedStaticMeshComponent::Voxel_SetInstancesScaleToZe
 		}
 	}
 
+	Voxel_ClearBuiltInstances(BuiltIndices);
+}
+
+void UVoxelHierarchicalInstancedStaticMeshComponent::Voxel_ClearBuiltInstances(const TArray<int32>& BuiltIndices)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	const auto InstanceBuffer = PerInstanceRenderData.IsValid() ? PerInstanceRenderData->InstanceBuffer_GameThread : nullptr;
+	for (int32 BuiltIndex : BuiltIndices)
+	{
+		if (InstanceBuffer.IsValid())
+		{
+			InstanceBuffer->SetInstance(BuiltIndex, EmptyMatrix, 0);
+		}
+		Voxel_BuiltMatrices[BuiltIndex] = FVoxelSpawnerMatrix(EmptyMatrix);
+	}
+
+	Voxel_RefitClusterTree(BuiltIndices);
+
 	if (InstanceBuffer.IsValid())
 	{
 		ENQUEUE_RENDER_COMMAND(UVoxelHierarchicalInstancedStaticMeshComponent_UpdateBuffer)(
@@ -922,6 +981,80 @@ void UVoxelHierarchicalInstancedStaticMeshComponent::Voxel_SetInstancesScaleToZe
 	}
 }
 
+void UVoxelHierarchicalInstancedStaticMeshComponent::Voxel_RefitClusterTree(const TArray<int32>& BuiltIndices)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	if (CVarIncrementalHISMUpdates.GetValueOnGameThread() == 0 ||
+		BuiltIndices.Num() == 0 ||
+		!ClusterTreePtr.IsValid() ||
+		ClusterTreePtr->Num() == 0 ||
+		!GetStaticMesh())
+	{
+		return;
+	}
+
+	if (Voxel_EmptyClusterNodes.Num() != ClusterTreePtr->Num())
+	{
+		Voxel_EmptyClusterNodes.Init(false, ClusterTreePtr->Num());
+	}
+
+	// The tree is shared with the scene proxy: refit the back tree and swap them
+	int32 NumRefitted = 0;
+	bool bCopied = false;
+	ClusterTreePtr = FVoxelHISMClusterTreeUtilities::RefitClustersDoubleBuffered(
+		ClusterTreePtr,
+		Voxel_DoubleBufferedClusterTree,
+		Voxel_EmptyClusterNodes,
+		Voxel_BuiltMatrices,
+		GetStaticMesh()->GetBounds().GetBox(),
+		BuiltIndices,
+		NumRefitted,
+		bCopied);
+
+	UpdateBounds();
+	// Recreate the proxy so that it uses the new tree
+	MarkRenderStateDirty();
+
+	if (CVarLogHISMBuildTimes.GetValueOnGameThread() != 0)
+	{
+		LOG_VOXEL(Log, TEXT("Refitted %d HISM clusters out of %d for %d removed instances%s"), NumRefitted, ClusterTreePtr->Num(), BuiltIndices.Num(), bCopied ? TEXT(" (tree copied)") : TEXT(""));
+	}
+}
+
+bool UVoxelHierarchicalInstancedStaticMeshComponent::Voxel_CanRemoveSectionIncrementally(int32 NumToRemove) const
+{
+	if (CVarIncrementalHISMUpdates.GetValueOnGameThread() == 0)
+	{
+		return false;
+	}
+
+	// A build is already pending: it will take care of the removal
+	if (Voxel_TaskUniqueId != 0 || Voxel_PendingNewInstancesBounds.Num() > 0)
+	{
+		return false;
+	}
+	if (GetWorld() && GetWorld()->GetTimerManager().IsTimerActive(Voxel_TimerHandle))
+	{
+		return false;
+	}
+
+	if (!PerInstanceRenderData.IsValid() || !ClusterTreePtr.IsValid() || ClusterTreePtr->Num() == 0)
+	{
+		return false;
+	}
+
+	const int32 NumRemaining = Voxel_UnbuiltMatrices.Num() - NumToRemove;
+	if (NumRemaining <= 0 || Voxel_Mappings.DeletionsStack.Num() >= MaxIncrementalDeletions)
+	{
+		return false;
+	}
+
+	// Rebuild once too many built instances are dead, as they are still processed when rendering
+	const int32 NumBuilt = Voxel_BuiltMatrices.Num();
+	return NumBuilt - NumRemaining <= CVarHISMRebuildThreshold.GetValueOnGameThread() * NumBuilt;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -11,9 +11,46 @@
 #include "Misc/ScopeLock.h"
 #include "Misc/ScopeExit.h"
 #include "Async/TaskGraphInterfaces.h"
+#include "HAL/IConsoleManager.h"
 
 DECLARE_DWORD_COUNTER_STAT(TEXT("VoxelThreadPoolDummyCounter"), STAT_VoxelThreadPoolDummyCounter, STATGROUP_ThreadPoolAsyncTasks);
 DECLARE_DWORD_COUNTER_STAT(TEXT("Recomputed Voxel Tasks Priorities"), STAT_RecomputedVoxelTasksPriorities, STATGROUP_VoxelCounters);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Voxel Thread Pool Wake Ups"), STAT_VoxelThreadPoolWakeUps, STATGROUP_VoxelCounters);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Retracted Voxel Tasks"), STAT_RetractedVoxelTasks, STATGROUP_VoxelCounters);
+
+static TAutoConsoleVariable<int32> CVarThreadPoolSpinTime(
+	TEXT("voxel.threading.SpinTime"),
+	50,
+	TEXT("Time in microseconds a voxel pool thread keeps looking for new work before going to sleep. Avoids waking up threads when works are queued in quick succession. 0 to disable"),
+	ECVF_Default);
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+double FVoxelTaskTypeStats::GetPercentile(const uint64 (&Histogram)[NumBuckets], uint64 Num, double Percentile)
+{
+	const uint64 Threshold = FMath::Max<uint64>(1, uint64(FMath::CeilToDouble(Num * Percentile)));
+	uint64 Count = 0;
+	for (int32 Bucket = 0; Bucket < NumBuckets; Bucket++)
+	{
+		Count += Histogram[Bucket];
+		if (Count >= Threshold)
+		{
+			return double(uint64(1) << Bucket) / 1e6;
+		}
+	}
+	return double(uint64(1) << (NumBuckets - 1)) / 1e6;
+}
+
+FVoxelQueuedThreadPoolStats::FThreadStats::FTaskTypeStats::FTaskTypeStats()
+{
+	for (int32 Bucket = 0; Bucket < FVoxelTaskTypeStats::NumBuckets; Bucket++)
+	{
+		TimeHistogram[Bucket] = 0;
+		QueueTimeHistogram[Bucket] = 0;
+	}
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -25,21 +62,112 @@ FVoxelQueuedThreadPoolStats& FVoxelQueuedThreadPoolStats::Get()
 	return Stats;
 }
 
-void FVoxelQueuedThreadPoolStats::Report(FName Name, double Time)
+FVoxelQueuedThreadPoolStats::FThreadStats* FVoxelQueuedThreadPoolStats::CreateThreadStats()
 {
 	FScopeLock Lock(&Section);
-	Times.FindOrAdd(Name) += Time;
+	return AllThreadStats.Add_GetRef(MakeUnique<FThreadStats>()).Get();
 }
 
-void FVoxelQueuedThreadPoolStats::LogTimes() const
+void FVoxelQueuedThreadPoolStats::DestroyThreadStats(FThreadStats* ThreadStats)
+{
+	FScopeLock Lock(&Section);
+	
+	DestroyedThreadsStats.SetNum(NumTaskTypes);
+	AddThreadStats(DestroyedThreadsStats, *ThreadStats);
+	AllThreadStats.RemoveAllSwap([&](const TUniquePtr<FThreadStats>& Other) { return Other.Get() == ThreadStats; });
+}
+
+TArray<FVoxelTaskTypeStats> FVoxelQueuedThreadPoolStats::GetStats() const
+{
+	FScopeLock Lock(&Section);
+
+	TArray<FVoxelTaskTypeStats> Result = GetTotalStats_AssumeLocked();
+	if (ResetStats.Num() == NumTaskTypes)
+	{
+		for (int32 Index = 0; Index < NumTaskTypes; Index++)
+		{
+			FVoxelTaskTypeStats& Stats = Result[Index];
+			const FVoxelTaskTypeStats& OldStats = ResetStats[Index];
+			
+			Stats.NumTasks -= OldStats.NumTasks;
+			Stats.TotalTime -= OldStats.TotalTime;
+			Stats.TotalQueueTime -= OldStats.TotalQueueTime;
+			for (int32 Bucket = 0; Bucket < FVoxelTaskTypeStats::NumBuckets; Bucket++)
+			{
+				Stats.TimeHistogram[Bucket] -= OldStats.TimeHistogram[Bucket];
+				Stats.QueueTimeHistogram[Bucket] -= OldStats.QueueTimeHistogram[Bucket];
+			}
+		}
+	}
+	return Result;
+}
+
+void FVoxelQueuedThreadPoolStats::Reset()
 {
 	FScopeLock Lock(&Section);
+	// Threads are writing to their stats without any lock: instead of clearing them, store the current values and subtract them on read
+	ResetStats = GetTotalStats_AssumeLocked();
+}
+
+void FVoxelQueuedThreadPoolStats::LogTimes() const
+{
+	const TArray<FVoxelTaskTypeStats> AllStats = GetStats();
+	const UEnum* Enum = StaticEnum<EVoxelTaskType>();
+	
 	LOG_VOXEL(Log, TEXT("#############################################"));
 	LOG_VOXEL(Log, TEXT("########## Voxel Thread Pool Stats ##########"));
 	LOG_VOXEL(Log, TEXT("#############################################"));
-	for (const auto& It : Times)
+	for (int32 Index = 0; Index < NumTaskTypes; Index++)
 	{
-		LOG_VOXEL(Log, TEXT("%s: %fs"), *It.Key.ToString(), It.Value);
+		const FVoxelTaskTypeStats& Stats = AllStats[Index];
+		if (Stats.NumTasks == 0)
+		{
+			continue;
+		}
+
+		LOG_VOXEL(Log, TEXT("%s: %llu tasks; Total: %fs; Average: %.3fms; P50 < %.3fms; P90 < %.3fms; P99 < %.3fms; Queue Average: %.3fms; Queue P90 < %.3fms; Queue P99 < %.3fms"),
+			*Enum->GetNameStringByValue(Index),
+			Stats.NumTasks,
+			Stats.TotalTime,
+			Stats.TotalTime / Stats.NumTasks * 1000,
+			FVoxelTaskTypeStats::GetPercentile(Stats.TimeHistogram, Stats.NumTasks, 0.5) * 1000,
+			FVoxelTaskTypeStats::GetPercentile(Stats.TimeHistogram, Stats.NumTasks, 0.9) * 1000,
+			FVoxelTaskTypeStats::GetPercentile(Stats.TimeHistogram, Stats.NumTasks, 0.99) * 1000,
+			Stats.TotalQueueTime / Stats.NumTasks * 1000,
+			FVoxelTaskTypeStats::GetPercentile(Stats.QueueTimeHistogram, Stats.NumTasks, 0.9) * 1000,
+			FVoxelTaskTypeStats::GetPercentile(Stats.QueueTimeHistogram, Stats.NumTasks, 0.99) * 1000);
+	}
+}
+
+TArray<FVoxelTaskTypeStats> FVoxelQueuedThreadPoolStats::GetTotalStats_AssumeLocked() const
+{
+	TArray<FVoxelTaskTypeStats> Result = DestroyedThreadsStats;
+	Result.SetNum(NumTaskTypes);
+	for (const auto& ThreadStats : AllThreadStats)
+	{
+		AddThreadStats(Result, *ThreadStats);
+	}
+	return Result;
+}
+
+void FVoxelQueuedThreadPoolStats::AddThreadStats(TArray<FVoxelTaskTypeStats>& Result, const FThreadStats& ThreadStats)
+{
+	check(Result.Num() == NumTaskTypes);
+	
+	const double SecondsPerCycle = FPlatformTime::GetSecondsPerCycle64();
+	for (int32 Index = 0; Index < NumTaskTypes; Index++)
+	{
+		FVoxelTaskTypeStats& Stats = Result[Index];
+		const FThreadStats::FTaskTypeStats& ThreadTaskTypeStats = ThreadStats.TaskTypes[Index];
+		
+		Stats.NumTasks += ThreadTaskTypeStats.NumTasks.Load(EMemoryOrder::Relaxed);
+		Stats.TotalTime += ThreadTaskTypeStats.Cycles.Load(EMemoryOrder::Relaxed) * SecondsPerCycle;
+		Stats.TotalQueueTime += ThreadTaskTypeStats.QueueCycles.Load(EMemoryOrder::Relaxed) * SecondsPerCycle;
+		for (int32 Bucket = 0; Bucket < FVoxelTaskTypeStats::NumBuckets; Bucket++)
+		{
+			Stats.TimeHistogram[Bucket] += ThreadTaskTypeStats.TimeHistogram[Bucket].Load(EMemoryOrder::Relaxed);
+			Stats.QueueTimeHistogram[Bucket] += ThreadTaskTypeStats.QueueTimeHistogram[Bucket].Load(EMemoryOrder::Relaxed);
+		}
 	}
 }
 
@@ -54,6 +182,7 @@ public:
 		: SynchObject(InSynchObject)
 	{
 		VOXEL_ASYNC_SCOPE_COUNTER("Lock");
+		VOXEL_TRACE_SCOPE(Lock, TEXT("Voxel Thread Pool Lock"));
 		SynchObject.Lock();
 	}
 	~FScopeLockWithStats()
@@ -77,8 +206,16 @@ public:
 	FVoxelQueuedThreadPool* const ThreadPool;
 	/** The event that tells the thread there is work to do. */
 	FEvent* const DoWorkEvent;
-
-	FVoxelQueuedThread(FVoxelQueuedThreadPool* Pool, const FString& ThreadName, uint32 StackSize, EThreadPriority ThreadPriority);
+	/** If not -1, the EVoxelTaskType this thread is reserved to. */
+	const int32 ReservedTaskType;
+
+	FVoxelQueuedThread(
+		FVoxelQueuedThreadPool* Pool, 
+		const FString& ThreadName, 
+		uint32 StackSize, 
+		EThreadPriority ThreadPriority, 
+		uint64 AffinityMask, 
+		int32 ReservedTaskType);
 	~FVoxelQueuedThread();
 
 	//~ Begin FRunnable Interface
@@ -90,6 +227,8 @@ private:
 	FThreadSafeBool TimeToDie;
 	/** The work this thread is doing. */
 	TAtomic<IVoxelQueuedWork*> QueuedWork;
+	/** Only written by this thread. */
+	FVoxelQueuedThreadPoolStats::FThreadStats* const Stats;
 
 	const TUniquePtr<FRunnableThread> Thread;
 };
@@ -98,13 +237,21 @@ private:
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
-FVoxelQueuedThread::FVoxelQueuedThread(FVoxelQueuedThreadPool* Pool, const FString& ThreadName, uint32 StackSize, EThreadPriority ThreadPriority)
+FVoxelQueuedThread::FVoxelQueuedThread(
+	FVoxelQueuedThreadPool* Pool, 
+	const FString& ThreadName, 
+	uint32 StackSize, 
+	EThreadPriority ThreadPriority, 
+	uint64 AffinityMask, 
+	int32 ReservedTaskType)
 	: ThreadName(ThreadName)
 	, ThreadPool(Pool)
 	, DoWorkEvent(FPlatformProcess::GetSynchEventFromPool()) // Create event BEFORE thread
+	, ReservedTaskType(ReservedTaskType) // BEFORE creating thread
 	, TimeToDie(false) // BEFORE creating thread
 	, QueuedWork(nullptr)
-	, Thread(FRunnableThread::Create(this, *ThreadName, StackSize, ThreadPriority, FPlatformAffinity::GetPoolThreadMask()))
+	, Stats(FVoxelQueuedThreadPoolStats::Get().CreateThreadStats()) // BEFORE creating thread
+	, Thread(FRunnableThread::Create(this, *ThreadName, StackSize, ThreadPriority, AffinityMask))
 {
 	check(Thread.IsValid());
 }
@@ -119,6 +266,7 @@ FVoxelQueuedThread::~FVoxelQueuedThread()
 	// If waiting was specified, wait the amount of time. If that fails,
 	// brute force kill that thread. Very bad as that might leak.
 	Thread->WaitForCompletion();
+	FVoxelQueuedThreadPoolStats::Get().DestroyThreadStats(Stats);
 	// Clean up the event
 	FPlatformProcess::ReturnSynchEventToPool(DoWorkEvent);
 }
@@ -129,34 +277,35 @@ uint32 FVoxelQueuedThread::Run()
 	{
 		// This will force sending the stats packet from the previous frame.
 		SET_DWORD_STAT(STAT_VoxelThreadPoolDummyCounter, 0);
-		// We need to wait for shorter amount of time
-		bool bContinueWaiting = true;
-		while (bContinueWaiting)
 		{
 			VOXEL_ASYNC_VERBOSE_SCOPE_COUNTER("FVoxelQueuedThread::Run.WaitForWork");
 			
-			// Wait for some work to do
-			bContinueWaiting = !DoWorkEvent->Wait(10);
+			// Only triggered by the pool when there is new work for this thread, or when the thread should exit
+			DoWorkEvent->Wait();
 		}
 
 		if (!TimeToDie)
 		{
-			IVoxelQueuedWork* LocalQueuedWork = ThreadPool->ReturnToPoolOrGetNextJob(this);
+			EVoxelTaskType TaskType;
+			uint64 QueueCycles;
+			IVoxelQueuedWork* LocalQueuedWork = ThreadPool->ReturnToPoolOrGetNextJob(this, TaskType, QueueCycles);
 
 			while (LocalQueuedWork)
 			{
-				const FName Name = LocalQueuedWork->Name;
+				const uint64 StartCycles = FPlatformTime::Cycles64();
 				
-				const double StartTime = FPlatformTime::Seconds();
+				{
+					VOXEL_TRACE_DYNAMIC_SCOPE(Task, LocalQueuedWork->Name);
+					LocalQueuedWork->DoThreadedWork();
+					// IMPORTANT: LocalQueuedWork should be considered as deleted after this line
+				}
 				
-				LocalQueuedWork->DoThreadedWork();
-				// IMPORTANT: LocalQueuedWork should be considered as deleted after this line
-				
-				const double EndTime = FPlatformTime::Seconds();
+				const uint64 EndCycles = FPlatformTime::Cycles64();
 
-				FVoxelQueuedThreadPoolStats::Get().Report(Name, EndTime - StartTime);
+				Stats->Report(TaskType, QueueCycles, EndCycles - StartCycles);
+				ThreadPool->OnWorkDone(TaskType);
 				
-				LocalQueuedWork = ThreadPool->ReturnToPoolOrGetNextJob(this);
+				LocalQueuedWork = ThreadPool->ReturnToPoolOrGetNextJob(this, TaskType, QueueCycles);
 			}
 		}
 	}
@@ -172,13 +321,55 @@ FVoxelQueuedThreadPoolSettings::FVoxelQueuedThreadPoolSettings(
 	uint32 NumThreads, 
 	uint32 StackSize, 
 	EThreadPriority ThreadPriority, 
-	bool bConstantPriorities)
+	bool bConstantPriorities,
+	const TArray<int32>& MaxConcurrentTasks,
+	const TArray<int32>& NumReservedThreads,
+	int32 AffinityFirstCore)
 	: PoolName(PoolName)
 	, NumThreads(NumThreads)
 	, StackSize(StackSize)
 	, ThreadPriority(ThreadPriority)
 	, bConstantPriorities(bConstantPriorities)
+	, MaxConcurrentTasks(MaxConcurrentTasks)
+	, NumReservedThreads(NumReservedThreads)
+	, AffinityFirstCore(AffinityFirstCore)
+{
+}
+
+inline uint64 GetThreadAffinityMask(const FVoxelQueuedThreadPoolSettings& Settings, uint32 ThreadIndex)
+{
+#if PLATFORM_LINUX
+	if (Settings.AffinityFirstCore >= 0)
+	{
+		const int32 NumCores = FMath::Clamp(FPlatformMisc::NumberOfCoresIncludingHyperthreads(), 1, 64);
+		return uint64(1) << ((Settings.AffinityFirstCore + ThreadIndex) % NumCores);
+	}
+#else
+	if (Settings.AffinityFirstCore >= 0 && ThreadIndex == 0)
+	{
+		LOG_VOXEL(Warning, TEXT("%s: thread affinity is only supported on Linux, ignoring AffinityFirstCore"), *Settings.PoolName);
+	}
+#endif
+	return FPlatformAffinity::GetPoolThreadMask();
+}
+
+// The first threads are the reserved ones
+inline TArray<int32> GetThreadsReservedTaskTypes(const FVoxelQueuedThreadPoolSettings& Settings)
 {
+	TArray<int32> ReservedTaskTypes;
+	for (int32 TaskType = 0; TaskType < Settings.NumReservedThreads.Num(); TaskType++)
+	{
+		for (int32 Index = 0; Index < Settings.NumReservedThreads[TaskType]; Index++)
+		{
+			if (ReservedTaskTypes.Num() + 1 >= int32(Settings.NumThreads))
+			{
+				LOG_VOXEL(Warning, TEXT("%s: not enough threads for all the reserved threads, at least one thread must run all the tasks"), *Settings.PoolName);
+				return ReservedTaskTypes;
+			}
+			ReservedTaskTypes.Add(TaskType);
+		}
+	}
+	return ReservedTaskTypes;
 }
 
 inline TArray<TUniquePtr<FVoxelQueuedThread>> CreateThreads(FVoxelQueuedThreadPool* Pool)
@@ -195,13 +386,23 @@ inline TArray<TUniquePtr<FVoxelQueuedThread>> CreateThreads(FVoxelQueuedThreadPo
 	
 	auto& Settings = Pool->Settings;
 	const uint32 NumThreads = Settings.NumThreads;
+	const TArray<int32> ReservedTaskTypes = GetThreadsReservedTaskTypes(Settings);
 	
 	TArray<TUniquePtr<FVoxelQueuedThread>> Threads;
 	Threads.Reserve(NumThreads);
 	for (uint32 ThreadIndex = 0; ThreadIndex < NumThreads; ThreadIndex++)
 	{
-		const FString Name = FString::Printf(TEXT("%s Thread %d"), *Settings.PoolName, ThreadIndex);
-		Threads.Add(MakeUnique<FVoxelQueuedThread>(Pool, Name, Settings.StackSize, Settings.ThreadPriority));
+		const int32 ReservedTaskType = ReservedTaskTypes.IsValidIndex(ThreadIndex) ? ReservedTaskTypes[ThreadIndex] : -1;
+		const FString Name = ReservedTaskType == -1
+			? FString::Printf(TEXT("%s Thread %d"), *Settings.PoolName, ThreadIndex)
+			: FString::Printf(TEXT("%s Thread %d (%s)"), *Settings.PoolName, ThreadIndex, *StaticEnum<EVoxelTaskType>()->GetNameStringByValue(ReservedTaskType));
+		Threads.Add(MakeUnique<FVoxelQueuedThread>(
+			Pool, 
+			Name, 
+			Settings.StackSize, 
+			Settings.ThreadPriority, 
+			GetThreadAffinityMask(Settings, ThreadIndex), 
+			ReservedTaskType));
 	}
 	return Threads;
 }
@@ -210,11 +411,17 @@ FVoxelQueuedThreadPool::FVoxelQueuedThreadPool(const FVoxelQueuedThreadPoolSetti
 	: Settings(Settings)
 	, AllThreads(CreateThreads(this))
 {
+	for (auto& NumRunning : NumRunningTasks)
+	{
+		NumRunning = 0;
+	}
+	
 	QueuedThreads.Reserve(Settings.NumThreads);
 	for (auto& Thread : AllThreads) 
 	{
 		QueuedThreads.Add(Thread.Get());
 	}
+	NumSleepingThreads = QueuedThreads.Num();
 }
 
 TVoxelSharedRef<FVoxelQueuedThreadPool> FVoxelQueuedThreadPool::Create(const FVoxelQueuedThreadPoolSettings& Settings)
@@ -247,17 +454,17 @@ inline uint32 AddPriorityOffset(uint32 Priority, int32 PriorityOffset)
 	return FMath::Clamp<int64>(int64(Priority) + PriorityOffset, MIN_uint32, MAX_uint32);
 }
 
-FORCEINLINE void FVoxelQueuedThreadPool::FQueuedWorkInfo::RecomputePriority(double Time)
+FORCEINLINE void FVoxelQueuedThreadPool::FQueuedWorkInfo::RecomputePriority(double Time, uint32 Epoch)
 {
 	Priority = AddPriorityOffset(Work->GetPriority(), PriorityOffset);
 	NextPriorityUpdateTime = Time + Work->PriorityDuration;
+	PriorityEpoch = Epoch;
 }
 
-void FVoxelQueuedThreadPool::AddQueuedWork(IVoxelQueuedWork* InQueuedWork, uint32 PriorityCategory, int32 PriorityOffset)
+void FVoxelQueuedThreadPool::AddQueuedWork(IVoxelQueuedWork* InQueuedWork, uint32 PriorityCategory, int32 PriorityOffset, EVoxelTaskType TaskType)
 {
-	VOXEL_FUNCTION_COUNTER();
+	VOXEL_ASYNC_FUNCTION_COUNTER();
 	
-	check(IsInGameThread());
 	check(InQueuedWork);
 
 	if (TimeToDie)
@@ -266,50 +473,25 @@ void FVoxelQueuedThreadPool::AddQueuedWork(IVoxelQueuedWork* InQueuedWork, uint3
 		return;
 	}
 
-	FQueuedWorkInfo WorkInfo;
+	FQueuedWorkInfo WorkInfo(InQueuedWork, PriorityCategory, PriorityOffset, TaskType, FPlatformTime::Cycles64());
+	if (Settings.bConstantPriorities)
 	{
-		VOXEL_SCOPE_COUNTER("Compute Priority");
-		WorkInfo = FQueuedWorkInfo(InQueuedWork, PriorityCategory, PriorityOffset);
+		VOXEL_ASYNC_SCOPE_COUNTER("Compute Priority");
+		WorkInfo.RecomputePriority(FPlatformTime::Seconds(), 0);
 	}
+	InQueuedWork->QueuedPool = this;
 
-	{
-		VOXEL_SCOPE_COUNTER("Lock");
-		Section.Lock();
-	}
-	{
-		VOXEL_SCOPE_COUNTER("Add Work");
-		if (Settings.bConstantPriorities)
-		{
-			WorkInfo.RecomputePriority(FPlatformTime::Seconds());
-			StaticQueuedWorks.push(WorkInfo);
-		}
-		else
-		{
-			QueuedWorks.Add(WorkInfo);
-		}
-	}
+	PendingWorks.Enqueue(WorkInfo);
+	NumQueuedWorks++;
+	QueueVersion++;
 
-	{
-		VOXEL_SCOPE_COUNTER("Wake up threads");
-		for (auto* QueuedThread : QueuedThreads)
-		{
-			QueuedThread->DoWorkEvent->Trigger();
-		}
-		QueuedThreads.Reset();
-	}
-	
-	{
-		VOXEL_SCOPE_COUNTER("Unlock");
-		Section.Unlock();
-	}
+	WakeUpThreads(1, TaskType);
 }
 
-void FVoxelQueuedThreadPool::AddQueuedWorks(const TArray<IVoxelQueuedWork*>& InQueuedWorks, uint32 PriorityCategory, int32 PriorityOffset)
+void FVoxelQueuedThreadPool::AddQueuedWorks(const TArray<IVoxelQueuedWork*>& InQueuedWorks, uint32 PriorityCategory, int32 PriorityOffset, EVoxelTaskType TaskType)
 {
-	VOXEL_FUNCTION_COUNTER();
+	VOXEL_ASYNC_FUNCTION_COUNTER();
 	
-	check(IsInGameThread());
-
 	if (TimeToDie)
 	{
 		for (auto* InQueuedWork : InQueuedWorks)
@@ -320,60 +502,158 @@ void FVoxelQueuedThreadPool::AddQueuedWorks(const TArray<IVoxelQueuedWork*>& InQ
 	}
 
 	{
-		VOXEL_SCOPE_COUNTER("Lock");
-		Section.Lock();
+		VOXEL_ASYNC_SCOPE_COUNTER("Add Works");
+		const uint64 QueuedCycles = FPlatformTime::Cycles64();
+		const double Time = FPlatformTime::Seconds();
+		for (auto* InQueuedWork : InQueuedWorks)
+		{
+			FQueuedWorkInfo WorkInfo(InQueuedWork, PriorityCategory, PriorityOffset, TaskType, QueuedCycles);
+			if (Settings.bConstantPriorities)
+			{
+				WorkInfo.RecomputePriority(Time, 0);
+			}
+			InQueuedWork->QueuedPool = this;
+			PendingWorks.Enqueue(WorkInfo);
+		}
 	}
+	NumQueuedWorks += InQueuedWorks.Num();
+	QueueVersion++;
 
+	WakeUpThreads(InQueuedWorks.Num(), TaskType);
+}
+
+IVoxelQueuedWork* FVoxelQueuedThreadPool::ReturnToPoolOrGetNextJob(FVoxelQueuedThread* InQueuedThread, EVoxelTaskType& OutTaskType, uint64& OutQueueCycles)
+{
+	VOXEL_ASYNC_FUNCTION_COUNTER();
+
+	check(InQueuedThread);
+
+	const int32 SpinTime = FMath::Max(0, CVarThreadPoolSpinTime.GetValueOnAnyThread());
+	const uint64 SpinEndCycles = FPlatformTime::Cycles64() + uint64(SpinTime / 1e6 / FPlatformTime::GetSecondsPerCycle64());
+	// Reserved threads can't pick up any work, so they're not accounted for when waking up threads
+	const bool bCountAsSpinning = InQueuedThread->ReservedTaskType == -1;
+
+	bool bIsSpinning = false;
+	while (true)
 	{
-		if (!Settings.bConstantPriorities)
+		// Must be read before looking for work: if it changes, new works might be runnable by this thread
+		const uint32 Version = QueueVersion.Load();
+		
+		if (IVoxelQueuedWork* Work = GetNextJob(*InQueuedThread, OutTaskType, OutQueueCycles))
 		{
-			VOXEL_SCOPE_COUNTER("Reserve");
-			QueuedWorks.Reserve(QueuedWorks.Num() + InQueuedWorks.Num());
+			if (bIsSpinning && bCountAsSpinning)
+			{
+				FScopeLock Lock(&ThreadsSection);
+				NumSpinningThreads--;
+			}
+			return Work;
 		}
-		VOXEL_SCOPE_COUNTER("Add Works");
-		for (auto* InQueuedWork : InQueuedWorks)
+
+		if (TimeToDie || FPlatformTime::Cycles64() >= SpinEndCycles)
 		{
-			FQueuedWorkInfo WorkInfo(InQueuedWork, PriorityCategory, PriorityOffset);
+			{
+				FScopeLock Lock(&ThreadsSection);
+				if (bIsSpinning && bCountAsSpinning)
+				{
+					NumSpinningThreads--;
+				}
+				bIsSpinning = false;
+				// Wait for WakeUpThreads
+				QueuedThreads.Add(InQueuedThread);
+				NumSleepingThreads++;
+			}
 
-			if (Settings.bConstantPriorities)
+			// A work might have been queued after GetNextJob by a thread that didn't see us sleeping
+			if (!TimeToDie && QueueVersion.Load() != Version)
 			{
-				WorkInfo.RecomputePriority(FPlatformTime::Seconds());
-				StaticQueuedWorks.push(WorkInfo);
+				FScopeLock Lock(&ThreadsSection);
+				// If we're not in the list, we've already been triggered and will be woken up right away
+				if (QueuedThreads.RemoveSingleSwap(InQueuedThread, false))
+				{
+					NumSleepingThreads--;
+					continue;
+				}
 			}
-			else
+			return nullptr;
+		}
+
+		if (!bIsSpinning)
+		{
+			if (bCountAsSpinning)
 			{
-				QueuedWorks.Add(WorkInfo);
+				// Spinning threads are accounted for when waking up threads
+				FScopeLock Lock(&ThreadsSection);
+				NumSpinningThreads++;
 			}
+			bIsSpinning = true;
 		}
-	}
 
-	{
-		VOXEL_SCOPE_COUNTER("Wake up threads");
-		for (auto* QueuedThread : QueuedThreads)
+		VOXEL_ASYNC_VERBOSE_SCOPE_COUNTER("Voxel Thread Pool Spin");
+		while (QueueVersion.Load(EMemoryOrder::Relaxed) == Version && FPlatformTime::Cycles64() < SpinEndCycles && !TimeToDie)
 		{
-			QueuedThread->DoWorkEvent->Trigger();
+			FPlatformProcess::SleepNoStats(0.f);
 		}
-		QueuedThreads.Reset();
 	}
+}
 
+void FVoxelQueuedThreadPool::OnWorkDone(EVoxelTaskType TaskType)
+{
+	const int32 MaxConcurrentTasks = Settings.GetMaxConcurrentTasks(TaskType);
+	if (MaxConcurrentTasks <= 0)
 	{
-		VOXEL_SCOPE_COUNTER("Unlock");
-		Section.Unlock();
+		return;
+	}
+	
+	NumRunningTasks[int32(TaskType)]--;
+	if (NumQueuedWorks.Load() > 0)
+	{
+		// Works of this type might have been skipped because of the limit: let the other threads know they can run them
+		// This thread will look for work right after this, but it might pick a work with a higher priority instead
+		QueueVersion++;
+		WakeUpThreads(1, TaskType);
 	}
 }
 
-IVoxelQueuedWork* FVoxelQueuedThreadPool::ReturnToPoolOrGetNextJob(FVoxelQueuedThread* InQueuedThread)
+FORCEINLINE bool FVoxelQueuedThreadPool::CanRunTask(const FVoxelQueuedThread& Thread, EVoxelTaskType TaskType) const
 {
-	VOXEL_ASYNC_FUNCTION_COUNTER();
+	if (Thread.ReservedTaskType != -1 && Thread.ReservedTaskType != int32(TaskType))
+	{
+		return false;
+	}
+	const int32 MaxConcurrentTasks = Settings.GetMaxConcurrentTasks(TaskType);
+	return MaxConcurrentTasks <= 0 || NumRunningTasks[int32(TaskType)].Load() < MaxConcurrentTasks;
+}
 
-	check(InQueuedThread);
+FORCEINLINE void FVoxelQueuedThreadPool::OnWorkDequeued_AssumeLocked(EVoxelTaskType TaskType)
+{
+	if (Settings.GetMaxConcurrentTasks(TaskType) > 0)
+	{
+		// Only incremented under the lock, so CanRunTask can't be outdated by another thread picking a work at the same time
+		NumRunningTasks[int32(TaskType)]++;
+	}
+}
 
+IVoxelQueuedWork* FVoxelQueuedThreadPool::GetNextJob(const FVoxelQueuedThread& Thread, EVoxelTaskType& OutTaskType, uint64& OutQueueCycles)
+{
+	if (NumQueuedWorks.Load(EMemoryOrder::Relaxed) <= 0 || TimeToDie)
+	{
+		// Avoid locking if there's nothing to do
+		return nullptr;
+	}
+	
 	FScopeLockWithStats Lock(Section);
 
+	MovePendingWorks_AssumeLocked();
+
+	bool CanRunTaskType[FVoxelQueuedThreadPoolStats::NumTaskTypes];
+	for (int32 TaskType = 0; TaskType < FVoxelQueuedThreadPoolStats::NumTaskTypes; TaskType++)
+	{
+		CanRunTaskType[TaskType] = CanRunTask(Thread, EVoxelTaskType(TaskType));
+	}
+
 	if (QueuedWorks.Num() > 0)
 	{
 		check(!Settings.bConstantPriorities);
-		check(!TimeToDie);
 
 		VOXEL_ASYNC_SCOPE_COUNTER("Voxel Thread Pool Recompute Priorities");
 
@@ -382,13 +662,18 @@ IVoxelQueuedWork* FVoxelQueuedThreadPool::ReturnToPoolOrGetNextJob(FVoxelQueuedT
 		uint64 BestPriority = 0;
 		int32 NumRecomputed = 0;
 		const double Time = FPlatformTime::Seconds();
+		const uint32 Epoch = PrioritiesEpoch.Load(EMemoryOrder::Relaxed);
 		for (int32 Index = 0; Index < QueuedWorks.Num(); Index++)
 		{
 			auto& WorkInfo = QueuedWorks.GetData()[Index];
-			if (WorkInfo.NextPriorityUpdateTime < Time)
+			if (!CanRunTaskType[int32(WorkInfo.TaskType)])
+			{
+				continue;
+			}
+			if (WorkInfo.NextPriorityUpdateTime < Time || WorkInfo.PriorityEpoch != Epoch)
 			{
 				NumRecomputed++;
-				WorkInfo.RecomputePriority(Time);
+				WorkInfo.RecomputePriority(Time, Epoch);
 			}
 			const uint64 Priority = WorkInfo.GetPriority();
 			if (Priority >= BestPriority)
@@ -400,57 +685,245 @@ IVoxelQueuedWork* FVoxelQueuedThreadPool::ReturnToPoolOrGetNextJob(FVoxelQueuedT
 
 		INC_DWORD_STAT_BY(STAT_RecomputedVoxelTasksPriorities, NumRecomputed);
 
-		auto* Work = QueuedWorks[BestIndex].Work;
-		QueuedWorks.RemoveAtSwap(BestIndex);
+		if (BestIndex == -1)
+		{
+			// No work this thread can run
+			return nullptr;
+		}
+
+		const FQueuedWorkInfo& WorkInfo = QueuedWorks[BestIndex];
+		auto* Work = WorkInfo.Work;
+		OutTaskType = WorkInfo.TaskType;
+		OutQueueCycles = FPlatformTime::Cycles64() - WorkInfo.QueuedCycles;
+		OnWorkDequeued_AssumeLocked(WorkInfo.TaskType);
+		RemoveQueuedWork_AssumeLocked(BestIndex);
 		check(Work);
 		return Work;
 	}
-	else if (!StaticQueuedWorks.empty())
+	
+	if (Settings.bConstantPriorities)
 	{
-		check(Settings.bConstantPriorities);
-		auto* Work = StaticQueuedWorks.top().Work;
-		StaticQueuedWorks.pop();
+		std::priority_queue<FQueuedWorkInfo>* BestQueue = nullptr;
+		for (int32 TaskType = 0; TaskType < FVoxelQueuedThreadPoolStats::NumTaskTypes; TaskType++)
+		{
+			auto& Queue = StaticQueuedWorks[TaskType];
+			PopRetractedStaticWorks_AssumeLocked(Queue);
+			if (CanRunTaskType[TaskType] && !Queue.empty() && (!BestQueue || BestQueue->top() < Queue.top()))
+			{
+				BestQueue = &Queue;
+			}
+		}
+		if (!BestQueue)
+		{
+			return nullptr;
+		}
+		
+		const FQueuedWorkInfo& WorkInfo = BestQueue->top();
+		auto* Work = WorkInfo.Work;
+		check(StaticWorkSlots[WorkInfo.StaticSlot] == Work);
+		StaticWorkSlots[WorkInfo.StaticSlot] = nullptr;
+		FreeStaticWorkSlots.Add(WorkInfo.StaticSlot);
+		Work->QueueIndex = -1;
+		OutTaskType = WorkInfo.TaskType;
+		OutQueueCycles = FPlatformTime::Cycles64() - WorkInfo.QueuedCycles;
+		OnWorkDequeued_AssumeLocked(WorkInfo.TaskType);
+		BestQueue->pop();
+		NumQueuedWorks--;
 		check(Work);
 		return Work;
 	}
-	else
+	
+	return nullptr;
+}
+
+void FVoxelQueuedThreadPool::MovePendingWorks_AssumeLocked()
+{
+	FQueuedWorkInfo WorkInfo;
+	while (PendingWorks.Dequeue(WorkInfo))
 	{
-		QueuedThreads.Add(InQueuedThread);
-		return nullptr;
+		if (Settings.bConstantPriorities)
+		{
+			WorkInfo.StaticSlot = AllocateStaticWorkSlot_AssumeLocked(WorkInfo.Work);
+			WorkInfo.Work->QueueIndex = WorkInfo.StaticSlot;
+			StaticQueuedWorks[int32(WorkInfo.TaskType)].push(WorkInfo);
+		}
+		else
+		{
+			WorkInfo.Work->QueueIndex = QueuedWorks.Add(WorkInfo);
+		}
 	}
 }
 
-void FVoxelQueuedThreadPool::AbandonAllTasks()
+void FVoxelQueuedThreadPool::RemoveQueuedWork_AssumeLocked(int32 Index)
+{
+	QueuedWorks[Index].Work->QueueIndex = -1;
+	QueuedWorks.RemoveAtSwap(Index, 1, false);
+	if (Index < QueuedWorks.Num())
+	{
+		QueuedWorks[Index].Work->QueueIndex = Index;
+	}
+	NumQueuedWorks--;
+}
+
+int32 FVoxelQueuedThreadPool::AllocateStaticWorkSlot_AssumeLocked(IVoxelQueuedWork* Work)
+{
+	if (FreeStaticWorkSlots.Num() > 0)
+	{
+		const int32 Slot = FreeStaticWorkSlots.Pop(false);
+		check(!StaticWorkSlots[Slot]);
+		StaticWorkSlots[Slot] = Work;
+		return Slot;
+	}
+	return StaticWorkSlots.Add(Work);
+}
+
+void FVoxelQueuedThreadPool::PopRetractedStaticWorks_AssumeLocked(std::priority_queue<FQueuedWorkInfo>& Queue)
+{
+	// Don't access the work: it's deleted once retracted
+	while (!Queue.empty() && !StaticWorkSlots[Queue.top().StaticSlot])
+	{
+		FreeStaticWorkSlots.Add(Queue.top().StaticSlot);
+		Queue.pop();
+	}
+}
+
+bool FVoxelQueuedThreadPool::RetractQueuedWork(IVoxelQueuedWork& Work)
 {
 	VOXEL_ASYNC_FUNCTION_COUNTER();
 	
-	ensure(!TimeToDie);
+	// Valid as the work isn't done yet: the pool is either running it, or will abandon or run it
+	FVoxelQueuedThreadPool* const Pool = Work.QueuedPool;
+	if (!Pool)
+	{
+		return false;
+	}
+
+	FScopeLockWithStats Lock(Pool->Section);
+
+	// The work might still be in the pending queue
+	Pool->MovePendingWorks_AssumeLocked();
+
+	const int32 Index = Work.QueueIndex;
+	if (Index == -1)
+	{
+		// Already started or abandoned
+		return false;
+	}
+
+	if (Pool->Settings.bConstantPriorities)
+	{
+		// Lazy deletion: the queue entry is skipped once it reaches the top, see PopRetractedStaticWorks_AssumeLocked
+		check(Pool->StaticWorkSlots[Index] == &Work);
+		Pool->StaticWorkSlots[Index] = nullptr;
+		Work.QueueIndex = -1;
+		Pool->NumQueuedWorks--;
+	}
+	else
+	{
+		check(Pool->QueuedWorks[Index].Work == &Work);
+		Pool->RemoveQueuedWork_AssumeLocked(Index);
+	}
+	INC_DWORD_STAT(STAT_RetractedVoxelTasks);
 	
+	return true;
+}
+
+void FVoxelQueuedThreadPool::WakeUpThreads(int32 NumNewWorks, EVoxelTaskType TaskType)
+{
+	// Must be read after NumQueuedWorks is incremented: either we see the sleeping thread, or it sees the new work
+	if (NumSleepingThreads.Load() == 0)
 	{
-		FScopeLockWithStats Lock(Section);
-		TimeToDie = true;
-		// Clean up all queued objects
-		for (auto& WorkInfo : QueuedWorks)
-		{
-			WorkInfo.Work->Abandon();
-		}
-		QueuedWorks.Reset();
-		while (!StaticQueuedWorks.empty())
+		return;
+	}
+	
+	VOXEL_ASYNC_SCOPE_COUNTER("Wake up threads");
+	FScopeLock Lock(&ThreadsSection);
+
+	// Only wake up as many threads as there are works that no spinning or awake thread is going to pick up
+	// Busy threads will also query new works once they're done, so we might wake up a few threads for nothing, but never too few
+	const int32 NumWorksToAssign = FMath::Max(0, NumQueuedWorks.Load() - NumSpinningThreads);
+	int32 NumToWakeUp = FMath::Min3(NumNewWorks, NumWorksToAssign, QueuedThreads.Num());
+	
+	const int32 MaxConcurrentTasks = Settings.GetMaxConcurrentTasks(TaskType);
+	if (MaxConcurrentTasks > 0)
+	{
+		// No need to wake up threads that won't be able to run the works
+		NumToWakeUp = FMath::Min(NumToWakeUp, FMath::Max(0, MaxConcurrentTasks - NumRunningTasks[int32(TaskType)].Load()));
+	}
+	
+	int32 NumWokenUp = 0;
+	for (int32 Pass = 0; Pass < 2 && NumWokenUp < NumToWakeUp; Pass++)
+	{
+		// First wake up the threads reserved to this task type, then the ones that can run any task
+		const int32 ReservedTaskType = Pass == 0 ? int32(TaskType) : -1;
+		for (int32 Index = QueuedThreads.Num() - 1; Index >= 0 && NumWokenUp < NumToWakeUp; Index--)
 		{
-			StaticQueuedWorks.top().Work->Abandon();
-			StaticQueuedWorks.pop();
+			FVoxelQueuedThread* Thread = QueuedThreads[Index];
+			if (Thread->ReservedTaskType == ReservedTaskType)
+			{
+				QueuedThreads.RemoveAtSwap(Index, 1, false);
+				Thread->DoWorkEvent->Trigger();
+				NumWokenUp++;
+			}
 		}
 	}
-	// Wait for all threads to finish up
-	while (true)
+	NumSleepingThreads -= NumWokenUp;
+	INC_DWORD_STAT_BY(STAT_VoxelThreadPoolWakeUps, NumWokenUp);
+}
+
+void FVoxelQueuedThreadPool::AbandonAllTasks()
+{
+	VOXEL_ASYNC_FUNCTION_COUNTER();
+	
+	ensure(!TimeToDie);
+
+	TimeToDie = true;
+	
+	const auto AbandonQueuedWorks = [&]()
 	{
+		TArray<IVoxelQueuedWork*> WorksToAbandon;
 		{
 			FScopeLockWithStats Lock(Section);
-			if (AllThreads.Num() == QueuedThreads.Num())
+			MovePendingWorks_AssumeLocked();
+			for (auto& WorkInfo : QueuedWorks)
+			{
+				WorkInfo.Work->QueueIndex = -1;
+				WorksToAbandon.Add(WorkInfo.Work);
+			}
+			QueuedWorks.Reset();
+			for (auto& Queue : StaticQueuedWorks)
 			{
-				break;
+				while (!Queue.empty())
+				{
+					// Skip the retracted works
+					if (IVoxelQueuedWork* Work = StaticWorkSlots[Queue.top().StaticSlot])
+					{
+						Work->QueueIndex = -1;
+						WorksToAbandon.Add(Work);
+					}
+					Queue.pop();
+				}
 			}
+			StaticWorkSlots.Reset();
+			FreeStaticWorkSlots.Reset();
+			NumQueuedWorks -= WorksToAbandon.Num();
 		}
+		// Abandon outside of the lock, as works canceled at the same time lock themselves before calling RetractQueuedWork
+		for (IVoxelQueuedWork* Work : WorksToAbandon)
+		{
+			Work->Abandon();
+		}
+	};
+
+	// Clean up all queued objects
+	AbandonQueuedWorks();
+	
+	// Wait for all threads to finish up
+	while (NumSleepingThreads.Load() != AllThreads.Num())
+	{
 		FPlatformProcess::Sleep(0.0f);
 	}
+
+	// Works queued by the last running works
+	AbandonQueuedWorks();
 }
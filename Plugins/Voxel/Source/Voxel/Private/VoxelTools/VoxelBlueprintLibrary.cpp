@@ -1129,6 +1129,8 @@ void UVoxelBlueprintLibrary::SetToolRenderingEnabled(AVoxelWorld* World, FVoxelT
 void UVoxelBlueprintLibrary::CreateGlobalVoxelThreadPool(
 	const TMap<EVoxelTaskType, int32>& PriorityCategoriesOverrides,
 	const TMap<EVoxelTaskType, int32>& PriorityOffsetsOverrides,
+	const TMap<EVoxelTaskType, int32>& MaxConcurrentTasks,
+	const TMap<EVoxelTaskType, int32>& ReservedThreads,
 	int32 NumberOfThreads,
 	bool bConstantPriorities)
 {
@@ -1144,7 +1146,9 @@ void UVoxelBlueprintLibrary::CreateGlobalVoxelThreadPool(
 		FMath::Max(1, NumberOfThreads),
 		bConstantPriorities,
 		PriorityCategoriesOverrides,
-		PriorityOffsetsOverrides);
+		PriorityOffsetsOverrides,
+		MaxConcurrentTasks,
+		ReservedThreads);
 	IVoxelPool::SetGlobalPool(Pool, __FUNCTION__);
 }
 
@@ -1169,6 +1173,8 @@ void UVoxelBlueprintLibrary::CreateWorldVoxelThreadPool(
 	UWorld* World,
 	const TMap<EVoxelTaskType, int32>& PriorityCategoriesOverrides,
 	const TMap<EVoxelTaskType, int32>& PriorityOffsetsOverrides, 
+	const TMap<EVoxelTaskType, int32>& MaxConcurrentTasks,
+	const TMap<EVoxelTaskType, int32>& ReservedThreads,
 	int32 NumberOfThreads, 
 	bool bConstantPriorities)
 {
@@ -1190,7 +1196,9 @@ void UVoxelBlueprintLibrary::CreateWorldVoxelThreadPool(
 		FMath::Max(1, NumberOfThreads),
 		bConstantPriorities,
 		PriorityCategoriesOverrides,
-		PriorityOffsetsOverrides);
+		PriorityOffsetsOverrides,
+		MaxConcurrentTasks,
+		ReservedThreads);
 	IVoxelPool::SetWorldPool(World, Pool, __FUNCTION__);
 }
 
@@ -0,0 +1,295 @@
+// Copyright 2020 Phyronnaz
+
+#include "VoxelTrace.h"
+#include "VoxelMinimal.h"
+
+#include "HAL/IConsoleManager.h"
+#include "HAL/ThreadManager.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+
+static TAutoConsoleVariable<int32> CVarTraceEventsPerThread(
+	TEXT("voxel.trace.EventsPerThread"),
+	1 << 16,
+	TEXT("Size of the ring buffer of each thread recording voxel trace events. Older events are overwritten. Applied when a thread records its first event"),
+	ECVF_Default);
+
+static FAutoConsoleCommand TraceStartCmd(
+	TEXT("voxel.trace.Start"),
+	TEXT("Start recording voxel trace events (scopes, tasks, lock waits, mesher phases). Clears the previous events"),
+	FConsoleCommandDelegate::CreateStatic(&FVoxelTrace::StartRecording));
+
+static FAutoConsoleCommand TraceStopCmd(
+	TEXT("voxel.trace.Stop"),
+	TEXT("Stop recording voxel trace events"),
+	FConsoleCommandDelegate::CreateStatic(&FVoxelTrace::StopRecording));
+
+static FAutoConsoleCommand TraceDumpCmd(
+	TEXT("voxel.trace.Dump"),
+	TEXT("Dump the recorded voxel trace events as a Chrome trace JSON, to be opened in chrome://tracing or ui.perfetto.dev. Args: [Path]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const FString Path = Args.Num() > 0 ? Args[0] : FVoxelTrace::GetDefaultDumpPath();
+		if (FVoxelTrace::DumpChromeTrace(Path))
+		{
+			LOG_VOXEL(Log, TEXT("Voxel trace written to %s"), *Path);
+		}
+		else
+		{
+			LOG_VOXEL(Error, TEXT("Failed to write voxel trace to %s"), *Path);
+		}
+	}));
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// Only written by its thread
+struct FVoxelTraceThreadBuffer
+{
+	const uint32 ThreadId;
+	const FString ThreadName;
+
+	TArray<FVoxelTraceEvent> Events;
+	// Total number of events written, the last Events.Num() ones are valid
+	TAtomic<uint64> NumWritten{ 0 };
+	// Value of NumWritten on the last StartRecording, events before it are ignored
+	uint64 FirstEvent = 0;
+	// Set while the thread is writing an event, so that we can wait for it after pausing the recording
+	TAtomic<bool> bIsWriting{ false };
+
+	FVoxelTraceThreadBuffer(uint32 ThreadId, const FString& ThreadName, int32 Size)
+		: ThreadId(ThreadId)
+		, ThreadName(ThreadName)
+	{
+		Events.SetNum(Size);
+	}
+};
+
+struct FVoxelTraceBuffers
+{
+	FCriticalSection Section;
+	// Never freed, so that the events of exited threads can still be dumped
+	TArray<TUniquePtr<FVoxelTraceThreadBuffer>> Buffers;
+
+	static FVoxelTraceBuffers& Get()
+	{
+		static FVoxelTraceBuffers Instance;
+		return Instance;
+	}
+
+	// Recording must be paused. Once this returns, no thread is writing and all the events written are visible
+	// New threads can't add their buffer while we hold the lock, and they check IsRecording after adding it
+	void WaitForWriters_Locked() const
+	{
+		for (auto& Buffer : Buffers)
+		{
+			while (Buffer->bIsWriting.Load())
+			{
+				FPlatformProcess::Yield();
+			}
+		}
+	}
+};
+
+inline FString GetCurrentThreadName(uint32 ThreadId)
+{
+	if (IsInGameThread())
+	{
+		return TEXT("GameThread");
+	}
+	if (IsInActualRenderingThread())
+	{
+		return TEXT("RenderThread");
+	}
+	const FString& Name = FThreadManager::Get().GetThreadName(ThreadId);
+	return Name.IsEmpty() ? FString::Printf(TEXT("Thread %u"), ThreadId) : Name;
+}
+
+inline FVoxelTraceThreadBuffer& GetThreadBuffer()
+{
+	static thread_local FVoxelTraceThreadBuffer* Buffer = nullptr;
+	if (!Buffer)
+	{
+		const uint32 ThreadId = FPlatformTLS::GetCurrentThreadId();
+		auto NewBuffer = MakeUnique<FVoxelTraceThreadBuffer>(ThreadId, GetCurrentThreadName(ThreadId), FMath::Max(1024, CVarTraceEventsPerThread.GetValueOnAnyThread()));
+		Buffer = NewBuffer.Get();
+
+		auto& Buffers = FVoxelTraceBuffers::Get();
+		FScopeLock Lock(&Buffers.Section);
+		Buffers.Buffers.Add(MoveTemp(NewBuffer));
+	}
+	return *Buffer;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+TAtomic<bool> FVoxelTrace::bIsRecording{ false };
+
+void FVoxelTrace::StartRecording()
+{
+	auto& Buffers = FVoxelTraceBuffers::Get();
+	{
+		FScopeLock Lock(&Buffers.Section);
+		bIsRecording = false;
+		Buffers.WaitForWriters_Locked();
+		// Buffers are only written by their thread: don't reset them, just skip their current events
+		for (auto& Buffer : Buffers.Buffers)
+		{
+			Buffer->FirstEvent = Buffer->NumWritten.Load();
+		}
+	}
+	bIsRecording = true;
+	LOG_VOXEL(Log, TEXT("Voxel trace recording started"));
+}
+
+void FVoxelTrace::StopRecording()
+{
+	bIsRecording = false;
+	LOG_VOXEL(Log, TEXT("Voxel trace recording stopped"));
+}
+
+void FVoxelTrace::Record(FName Name, EVoxelTraceCategory Category, uint64 StartCycles, uint64 EndCycles)
+{
+	FVoxelTraceThreadBuffer& Buffer = GetThreadBuffer();
+
+	// Sequentially consistent with bIsRecording: either we see that the recording was paused,
+	// or the thread pausing it sees bIsWriting and waits for us, see WaitForWriters_Locked
+	Buffer.bIsWriting = true;
+	if (!bIsRecording.Load())
+	{
+		Buffer.bIsWriting = false;
+		return;
+	}
+
+	const uint64 Index = Buffer.NumWritten.Load(EMemoryOrder::Relaxed);
+	FVoxelTraceEvent& Event = Buffer.Events.GetData()[Index % Buffer.Events.Num()];
+	Event.Name = Name;
+	Event.StartCycles = StartCycles;
+	Event.EndCycles = EndCycles;
+	Event.Category = Category;
+	Buffer.NumWritten.Store(Index + 1);
+
+	Buffer.bIsWriting = false;
+}
+
+bool FVoxelTrace::DumpChromeTrace(const FString& Path)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	const bool bWasRecording = bIsRecording.Load();
+	bIsRecording = false;
+
+	struct FThreadEvents
+	{
+		uint32 ThreadId;
+		FString ThreadName;
+		TArray<FVoxelTraceEvent> Events;
+	};
+	TArray<FThreadEvents> AllThreadEvents;
+	{
+		auto& Buffers = FVoxelTraceBuffers::Get();
+		FScopeLock Lock(&Buffers.Section);
+		Buffers.WaitForWriters_Locked();
+		for (auto& Buffer : Buffers.Buffers)
+		{
+			const uint64 NumWritten = Buffer->NumWritten.Load();
+			const int32 Size = Buffer->Events.Num();
+			const uint64 NumRecorded = NumWritten - FMath::Min(NumWritten, Buffer->FirstEvent);
+			const int32 NumValid = int32(FMath::Min<uint64>(NumRecorded, Size));
+			if (NumValid <= 0)
+			{
+				continue;
+			}
+
+			FThreadEvents& ThreadEvents = AllThreadEvents.Emplace_GetRef();
+			ThreadEvents.ThreadId = Buffer->ThreadId;
+			ThreadEvents.ThreadName = Buffer->ThreadName;
+			ThreadEvents.Events.Reserve(NumValid);
+			for (uint64 Index = NumWritten - NumValid; Index < NumWritten; Index++)
+			{
+				ThreadEvents.Events.Add(Buffer->Events[Index % Size]);
+			}
+		}
+	}
+
+	bIsRecording = bWasRecording;
+
+	uint64 BaseCycles = MAX_uint64;
+	int32 NumEvents = 0;
+	for (auto& ThreadEvents : AllThreadEvents)
+	{
+		for (auto& Event : ThreadEvents.Events)
+		{
+			BaseCycles = FMath::Min(BaseCycles, Event.StartCycles);
+		}
+		NumEvents += ThreadEvents.Events.Num();
+	}
+
+	static const TCHAR* CategoryNames[] = { TEXT("Scope"), TEXT("Task"), TEXT("Lock"), TEXT("Mesher") };
+	const double MicrosecondsPerCycle = FPlatformTime::GetSecondsPerCycle64() * 1e6;
+
+	TMap<FName, FString> EscapedNames;
+	const auto GetEscapedName = [&](FName Name) -> const FString&
+	{
+		if (const FString* Escaped = EscapedNames.Find(Name))
+		{
+			return *Escaped;
+		}
+		return EscapedNames.Add(Name, Name.ToString().ReplaceCharWithEscapedChar());
+	};
+
+	FString Json;
+	Json.Reserve(NumEvents * 128);
+	Json += TEXT("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+	bool bFirst = true;
+	const auto AddSeparator = [&]()
+	{
+		if (!bFirst)
+		{
+			Json += TEXT(",\n");
+		}
+		bFirst = false;
+	};
+
+	for (auto& ThreadEvents : AllThreadEvents)
+	{
+		AddSeparator();
+		Json += FString::Printf(
+			TEXT("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}"),
+			ThreadEvents.ThreadId,
+			*ThreadEvents.ThreadName.ReplaceCharWithEscapedChar());
+
+		for (auto& Event : ThreadEvents.Events)
+		{
+			AddSeparator();
+			Json += FString::Printf(
+				TEXT("{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}"),
+				*GetEscapedName(Event.Name),
+				CategoryNames[int32(Event.Category)],
+				ThreadEvents.ThreadId,
+				(Event.StartCycles - BaseCycles) * MicrosecondsPerCycle,
+				(Event.EndCycles - Event.StartCycles) * MicrosecondsPerCycle);
+		}
+	}
+	Json += TEXT("\n]}\n");
+
+	LOG_VOXEL(Log, TEXT("Dumping %d voxel trace events from %d threads"), NumEvents, AllThreadEvents.Num());
+
+	return FFileHelper::SaveStringToFile(Json, *Path, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM);
+}
+
+FString FVoxelTrace::GetDefaultDumpPath()
+{
+	return FPaths::ProfilingDir() / FString::Printf(TEXT("VoxelTrace-%s.json"), *FDateTime::Now().ToString());
+}
+
+FName FVoxelTrace::MakeName(const FString& Name)
+{
+	return FName(*Name.Left(NAME_SIZE - 1));
+}
@@ -0,0 +1,270 @@
+// Copyright 2020 Phyronnaz
+
+#include "VoxelUtilities/VoxelConvexDecompositionUtilities.h"
+#include "VoxelMinimal.h"
+#include "VoxelUtilities/VoxelIntVectorUtilities.h"
+
+int32 FVoxelConvexDecompositionUtilities::GetResolution(int32 NumCells, int32 WantedResolution)
+{
+	int32 Resolution = FMath::Clamp(WantedResolution, 1, NumCells);
+	while (NumCells % Resolution != 0)
+	{
+		Resolution--;
+	}
+	return Resolution;
+}
+
+void FVoxelConvexDecompositionUtilities::DecomposeSolidSamples(
+	int32 NumCells,
+	const TArray<bool>& SolidSamples,
+	int32 Resolution,
+	float MaxEmptyRatio,
+	TArray<TArray<FVector>>& OutConvexes)
+{
+	VOXEL_ASYNC_FUNCTION_COUNTER();
+
+	OutConvexes.Reset();
+
+	const int32 NumSamples = NumCells + 1;
+	if (!ensure(SolidSamples.Num() == NumSamples * NumSamples * NumSamples) ||
+		!ensure(Resolution > 0 && NumCells % Resolution == 0))
+	{
+		return;
+	}
+
+	const int32 CellSize = NumCells / Resolution;
+	const int32 Size = Resolution;
+	const auto GetIndex = [&](int32 X, int32 Y, int32 Z)
+	{
+		return X + Size * Y + Size * Size * Z;
+	};
+
+	// Downsample: a cell is solid if at least half of its samples are
+	TArray<bool> Solid;
+	Solid.SetNumUninitialized(Size * Size * Size);
+	{
+		VOXEL_ASYNC_SCOPE_COUNTER("Downsample");
+		const int32 NumCellSamples = FMath::Cube(CellSize + 1);
+		for (int32 Z = 0; Z < Size; Z++)
+		{
+			for (int32 Y = 0; Y < Size; Y++)
+			{
+				for (int32 X = 0; X < Size; X++)
+				{
+					int32 NumSolid = 0;
+					for (int32 SZ = Z * CellSize; SZ <= (Z + 1) * CellSize; SZ++)
+					{
+						for (int32 SY = Y * CellSize; SY <= (Y + 1) * CellSize; SY++)
+						{
+							for (int32 SX = X * CellSize; SX <= (X + 1) * CellSize; SX++)
+							{
+								NumSolid += SolidSamples[SX + NumSamples * SY + NumSamples * NumSamples * SZ];
+							}
+						}
+					}
+					Solid[GetIndex(X, Y, Z)] = 2 * NumSolid >= NumCellSamples;
+				}
+			}
+		}
+	}
+
+	// Summed volume table of the empty cells, to count them in any box in constant time
+	const int32 SumsSize = Size + 1;
+	TArray<int32> EmptySums;
+	EmptySums.SetNumZeroed(SumsSize * SumsSize * SumsSize);
+	const auto Sum = [&](int32 X, int32 Y, int32 Z) -> int32&
+	{
+		return EmptySums[X + SumsSize * Y + SumsSize * SumsSize * Z];
+	};
+	for (int32 Z = 1; Z < SumsSize; Z++)
+	{
+		for (int32 Y = 1; Y < SumsSize; Y++)
+		{
+			for (int32 X = 1; X < SumsSize; X++)
+			{
+				Sum(X, Y, Z) =
+					!Solid[GetIndex(X - 1, Y - 1, Z - 1)]
+					+ Sum(X - 1, Y, Z) + Sum(X, Y - 1, Z) + Sum(X, Y, Z - 1)
+					- Sum(X - 1, Y - 1, Z) - Sum(X - 1, Y, Z - 1) - Sum(X, Y - 1, Z - 1)
+					+ Sum(X - 1, Y - 1, Z - 1);
+			}
+		}
+	}
+	// Max is exclusive
+	const auto CountEmpty = [&](const FIntVector& Min, const FIntVector& Max)
+	{
+		return
+			Sum(Max.X, Max.Y, Max.Z)
+			- Sum(Min.X, Max.Y, Max.Z) - Sum(Max.X, Min.Y, Max.Z) - Sum(Max.X, Max.Y, Min.Z)
+			+ Sum(Min.X, Min.Y, Max.Z) + Sum(Min.X, Max.Y, Min.Z) + Sum(Max.X, Min.Y, Min.Z)
+			- Sum(Min.X, Min.Y, Min.Z);
+	};
+
+	struct FPiece
+	{
+		// Bounds of all the boxes. Max is exclusive
+		FIntVector Min;
+		FIntVector Max;
+		TArray<FIntVector, TInlineAllocator<8>> BoxesMin;
+		TArray<FIntVector, TInlineAllocator<8>> BoxesMax;
+	};
+	TArray<FPiece> Pieces;
+
+	// Greedily merge the solid cells into boxes, first along X, then Y, then Z
+	{
+		VOXEL_ASYNC_SCOPE_COUNTER("Merge cells");
+
+		TArray<bool> Visited;
+		Visited.SetNumZeroed(Size * Size * Size);
+		const auto IsFree = [&](int32 X, int32 Y, int32 Z)
+		{
+			const int32 Index = GetIndex(X, Y, Z);
+			return Solid[Index] && !Visited[Index];
+		};
+
+		for (int32 Z = 0; Z < Size; Z++)
+		{
+			for (int32 Y = 0; Y < Size; Y++)
+			{
+				for (int32 X = 0; X < Size; X++)
+				{
+					if (!IsFree(X, Y, Z))
+					{
+						continue;
+					}
+
+					const auto IsRowFree = [&](int32 MaxX, int32 RowY, int32 RowZ)
+					{
+						for (int32 RowX = X; RowX < MaxX; RowX++)
+						{
+							if (!IsFree(RowX, RowY, RowZ))
+							{
+								return false;
+							}
+						}
+						return true;
+					};
+
+					const auto IsSlabFree = [&](int32 MaxX, int32 MaxY, int32 SlabZ)
+					{
+						for (int32 SlabY = Y; SlabY < MaxY; SlabY++)
+						{
+							if (!IsRowFree(MaxX, SlabY, SlabZ))
+							{
+								return false;
+							}
+						}
+						return true;
+					};
+
+					int32 MaxX = X + 1;
+					while (MaxX < Size && IsFree(MaxX, Y, Z))
+					{
+						MaxX++;
+					}
+					int32 MaxY = Y + 1;
+					while (MaxY < Size && IsRowFree(MaxX, MaxY, Z))
+					{
+						MaxY++;
+					}
+					int32 MaxZ = Z + 1;
+					while (MaxZ < Size && IsSlabFree(MaxX, MaxY, MaxZ))
+					{
+						MaxZ++;
+					}
+
+					for (int32 BoxZ = Z; BoxZ < MaxZ; BoxZ++)
+					{
+						for (int32 BoxY = Y; BoxY < MaxY; BoxY++)
+						{
+							for (int32 BoxX = X; BoxX < MaxX; BoxX++)
+							{
+								Visited[GetIndex(BoxX, BoxY, BoxZ)] = true;
+							}
+						}
+					}
+
+					FPiece& Piece = Pieces.Emplace_GetRef();
+					Piece.Min = FIntVector(X, Y, Z);
+					Piece.Max = FIntVector(MaxX, MaxY, MaxZ);
+					Piece.BoxesMin.Add(Piece.Min);
+					Piece.BoxesMax.Add(Piece.Max);
+				}
+			}
+		}
+	}
+
+	// Merge touching pieces while their bounds are mostly solid
+	// The convex hull of a piece is always inside its bounds, so it has at most as many empty cells
+	{
+		VOXEL_ASYNC_SCOPE_COUNTER("Merge pieces");
+
+		const auto IsTouching = [](const FPiece& A, const FPiece& B)
+		{
+			return
+				A.Min.X <= B.Max.X && B.Min.X <= A.Max.X &&
+				A.Min.Y <= B.Max.Y && B.Min.Y <= A.Max.Y &&
+				A.Min.Z <= B.Max.Z && B.Min.Z <= A.Max.Z;
+		};
+
+		bool bMerged = true;
+		while (bMerged)
+		{
+			bMerged = false;
+			for (int32 IndexA = 0; IndexA < Pieces.Num(); IndexA++)
+			{
+				for (int32 IndexB = IndexA + 1; IndexB < Pieces.Num(); IndexB++)
+				{
+					FPiece& A = Pieces[IndexA];
+					const FPiece& B = Pieces[IndexB];
+					if (!IsTouching(A, B))
+					{
+						continue;
+					}
+
+					const FIntVector Min = FVoxelUtilities::ComponentMin(A.Min, B.Min);
+					const FIntVector Max = FVoxelUtilities::ComponentMax(A.Max, B.Max);
+					const FIntVector BoundsSize = Max - Min;
+					const int32 Volume = BoundsSize.X * BoundsSize.Y * BoundsSize.Z;
+					if (CountEmpty(Min, Max) > MaxEmptyRatio * Volume)
+					{
+						continue;
+					}
+
+					A.Min = Min;
+					A.Max = Max;
+					A.BoxesMin.Append(B.BoxesMin);
+					A.BoxesMax.Append(B.BoxesMax);
+					Pieces.RemoveAtSwap(IndexB, 1, false);
+					IndexB--;
+					bMerged = true;
+				}
+			}
+		}
+	}
+
+	OutConvexes.Reserve(Pieces.Num());
+	for (const FPiece& Piece : Pieces)
+	{
+		TArray<FIntVector, TInlineAllocator<64>> Corners;
+		for (int32 BoxIndex = 0; BoxIndex < Piece.BoxesMin.Num(); BoxIndex++)
+		{
+			const FIntVector& Min = Piece.BoxesMin[BoxIndex];
+			const FIntVector& Max = Piece.BoxesMax[BoxIndex];
+			for (int32 Corner = 0; Corner < 8; Corner++)
+			{
+				Corners.AddUnique(FIntVector(
+					(Corner & 1) ? Max.X : Min.X,
+					(Corner & 2) ? Max.Y : Min.Y,
+					(Corner & 4) ? Max.Z : Min.Z));
+			}
+		}
+
+		TArray<FVector>& Vertices = OutConvexes.Emplace_GetRef();
+		Vertices.Reserve(Corners.Num());
+		for (const FIntVector& Corner : Corners)
+		{
+			Vertices.Add(FVector(Corner * CellSize));
+		}
+	}
+}
@@ -23,7 +23,13 @@ FColor FVoxelDistanceFieldUtilities::GetDistanceFieldColor(float Value)
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
-void FVoxelDistanceFieldUtilities::JumpFlood(const FIntVector& Size, TArray<FVector>& InOutSurfacePositions, EVoxelComputeDevice Device, bool bMultiThreaded, int32 MaxPasses_Debug)
+void FVoxelDistanceFieldUtilities::JumpFlood(
+	const FIntVector& Size, 
+	TArray<FVector>& InOutSurfacePositions, 
+	EVoxelComputeDevice Device, 
+	bool bMultiThreaded, 
+	int32 MaxPasses_Debug,
+	const TFunction<void(float Progress)>& OnProgress)
 {
 	VOXEL_ASYNC_FUNCTION_COUNTER();
 	
@@ -38,38 +44,87 @@ void FVoxelDistanceFieldUtilities::JumpFlood(const FIntVector& Size, TArray<FVec
 		Helper->WaitForCompletion();
 
 		InOutSurfacePositions = MoveTemp(*DataPtr);
+
+		if (OnProgress)
+		{
+			OnProgress(1.f);
+		}
 	}
 	else
 	{
-		bool bUseTempAsSrc = false;
+		const int32 Num = InOutSurfacePositions.Num();
 		
-		TArray<FVector> Temp;
-		Temp.Empty(InOutSurfacePositions.Num());
-		Temp.SetNumUninitialized(InOutSurfacePositions.Num());
+		FJumpFloodBuffer Buffers[2];
+		for (FJumpFloodBuffer& Buffer : Buffers)
+		{
+			Buffer.X.Empty(Num);
+			Buffer.X.SetNumUninitialized(Num);
+			Buffer.Y.Empty(Num);
+			Buffer.Y.SetNumUninitialized(Num);
+			Buffer.Z.Empty(Num);
+			Buffer.Z.SetNumUninitialized(Num);
+		}
+
+		// Process slices of Size.X * Size.Y voxels when copying from/to the packed positions
+		const int32 SliceSize = Size.X * Size.Y;
 		
-		const int32 PowerOfTwo = FMath::CeilLogTwo(Size.GetMax());
-		for (int32 Pass = 0; Pass < PowerOfTwo; Pass++)
 		{
-			if (MaxPasses_Debug == Pass)
+			VOXEL_ASYNC_SCOPE_COUNTER("Unpack");
+			ParallelFor(Size.Z, [&](int32 Z)
 			{
-				break;
-			}
-			
+				const FVector* RESTRICT const Positions = InOutSurfacePositions.GetData();
+				FJumpFloodBuffer& Buffer = Buffers[0];
+				for (int32 Index = Z * SliceSize; Index < (Z + 1) * SliceSize; Index++)
+				{
+					Buffer.X.GetData()[Index] = Positions[Index].X;
+					Buffer.Y.GetData()[Index] = Positions[Index].Y;
+					Buffer.Z.GetData()[Index] = Positions[Index].Z;
+				}
+			}, !bMultiThreaded);
+		}
+		
+		int32 SourceIndex = 0;
+		
+		const int32 PowerOfTwo = FMath::CeilLogTwo(Size.GetMax());
+		const int32 NumPasses = MaxPasses_Debug >= 0 ? FMath::Min(MaxPasses_Debug, PowerOfTwo) : PowerOfTwo;
+		for (int32 Pass = 0; Pass < NumPasses; Pass++)
+		{
 			// -1: we want to start with half the size
 			const int32 Step = 1 << (PowerOfTwo - 1 - Pass);
 			JumpFloodStep_CPU(
 				Size, 
-				bUseTempAsSrc ? Temp : InOutSurfacePositions,
-				bUseTempAsSrc ? InOutSurfacePositions : Temp,
+				Buffers[SourceIndex],
+				Buffers[1 - SourceIndex],
 				Step,
 				bMultiThreaded);
 
-			bUseTempAsSrc = !bUseTempAsSrc;
+			SourceIndex = 1 - SourceIndex;
+
+			if (OnProgress)
+			{
+				OnProgress(float(Pass + 1) / NumPasses);
+			}
+		}
+
+		{
+			VOXEL_ASYNC_SCOPE_COUNTER("Pack");
+			ParallelFor(Size.Z, [&](int32 Z)
+			{
+				FVector* RESTRICT const Positions = InOutSurfacePositions.GetData();
+				const FJumpFloodBuffer& Buffer = Buffers[SourceIndex];
+				for (int32 Index = Z * SliceSize; Index < (Z + 1) * SliceSize; Index++)
+				{
+					Positions[Index] = FVector(
+						Buffer.X.GetData()[Index],
+						Buffer.Y.GetData()[Index],
+						Buffer.Z.GetData()[Index]);
+				}
+			}, !bMultiThreaded);
 		}
 
-		if (bUseTempAsSrc)
+		if (NumPasses == 0 && OnProgress)
 		{
-			InOutSurfacePositions = MoveTemp(Temp);
+			OnProgress(1.f);
 		}
 	}
 }
@@ -135,7 +190,8 @@ void FVoxelDistanceFieldUtilities::DownSample(
 	TArrayView<float> OutDistances, 
 	TArrayView<FVector> OutSurfacePositions, 
 	int32 Divisor,
-	bool bShrink)
+	bool bShrink,
+	bool bMultiThreaded)
 {
 	VOXEL_ASYNC_FUNCTION_COUNTER();
 	
@@ -145,23 +201,29 @@ void FVoxelDistanceFieldUtilities::DownSample(
 
 	const FIntVector LowSize = FVoxelUtilities::DivideCeil(Size, Divisor);
 
-	for (int32 LowX = 0; LowX < LowSize.X; LowX++)
+	// Each low slice only reads Divisor high slices, and only writes to itself
+	ParallelFor(LowSize.Z, [&](int32 LowZ)
 	{
 		for (int32 LowY = 0; LowY < LowSize.Y; LowY++)
 		{
-			for (int32 LowZ = 0; LowZ < LowSize.Z; LowZ++)
+			for (int32 LowX = 0; LowX < LowSize.X; LowX++)
 			{
 				float BestDistance = MAX_flt;
 				FVector BestSurfacePosition = MakeInvalidSurfacePosition();
 				float Sign = FVoxelUtilities::Get3D(InDistances, Size, LowX * Divisor, LowY * Divisor, LowZ * Divisor);
+
+				const FIntVector HighStart = FIntVector(LowX, LowY, LowZ) * Divisor;
+				const FIntVector HighEnd = FVoxelUtilities::ComponentMin(Size, HighStart + Divisor);
 				
-				for (int32 HighX = LowX * Divisor; HighX < FMath::Min(Size.X, (LowX + 1) * Divisor); HighX++)
+				// Keep the X Y Z order so that ties are resolved the same way as before
+				for (int32 HighX = HighStart.X; HighX < HighEnd.X; HighX++)
 				{
-					for (int32 HighY = LowY * Divisor; HighY < FMath::Min(Size.Y, (LowY + 1) * Divisor); HighY++)
+					for (int32 HighY = HighStart.Y; HighY < HighEnd.Y; HighY++)
 					{
-						for (int32 HighZ = LowZ * Divisor; HighZ < FMath::Min(Size.Z, (LowZ + 1) * Divisor); HighZ++)
+						for (int32 HighZ = HighStart.Z; HighZ < HighEnd.Z; HighZ++)
 						{
-							FVector NeighborSurfacePosition = FVoxelUtilities::Get3D(InSurfacePositions, Size, HighX, HighY, HighZ);
+							const int32 HighIndex = FVoxelUtilities::Get3DIndex(Size, HighX, HighY, HighZ);
+							FVector NeighborSurfacePosition = FVoxelUtilities::Get(InSurfacePositions, HighIndex);
 							
 							if (IsSurfacePositionValid(NeighborSurfacePosition))
 							{
@@ -172,18 +234,19 @@ void FVoxelDistanceFieldUtilities::DownSample(
 								{
 									BestDistance = Distance;
 									BestSurfacePosition = NeighborSurfacePosition;
-									Sign = FVoxelUtilities::Get3D(InDistances, Size, HighX, HighY, HighZ);
+									Sign = FVoxelUtilities::Get(InDistances, HighIndex);
 								}
 							}
 						}
 					}
 				}
 
-				FVoxelUtilities::Get3D(OutSurfacePositions, LowSize, LowX, LowY, LowZ) = BestSurfacePosition;
-				FVoxelUtilities::Get3D(OutDistances, LowSize, LowX, LowY, LowZ) = Sign;
+				const int32 LowIndex = FVoxelUtilities::Get3DIndex(LowSize, LowX, LowY, LowZ);
+				FVoxelUtilities::Get(OutSurfacePositions, LowIndex) = BestSurfacePosition;
+				FVoxelUtilities::Get(OutDistances, LowIndex) = Sign;
 			}
 		}
-	}
+	}, !bMultiThreaded);
 }
 
 void FVoxelDistanceFieldUtilities::DownSample(
@@ -191,7 +254,8 @@ void FVoxelDistanceFieldUtilities::DownSample(
 	TArray<float>& Distances,
 	TArray<FVector>& SurfacePositions,
 	int32 Divisor,
-	bool bShrink)
+	bool bShrink,
+	bool bMultiThreaded)
 {
 	ensure(Divisor >= 1);
 	if (Divisor <= 1)
@@ -210,7 +274,7 @@ void FVoxelDistanceFieldUtilities::DownSample(
 	NewSurfacePositions.Empty(NewSize);
 	NewSurfacePositions.SetNumUninitialized(NewSize);
 
-	DownSample(Size, Distances, SurfacePositions, NewDistances, NewSurfacePositions, Divisor, bShrink);
+	DownSample(Size, Distances, SurfacePositions, NewDistances, NewSurfacePositions, Divisor, bShrink, bMultiThreaded);
 
 	Size = LowSize;
 	Distances = MoveTemp(NewDistances);
@@ -221,70 +285,333 @@ void FVoxelDistanceFieldUtilities::DownSample(
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
-void FVoxelDistanceFieldUtilities::JumpFloodStep_CPU(const FIntVector& Size, TArrayView<const FVector> InData, TArrayView<FVector> OutData, int32 Step, bool bMultiThreaded)
+void FVoxelDistanceFieldUtilities::JumpFloodStep_CPU(const FIntVector& Size, const FJumpFloodBuffer& InData, FJumpFloodBuffer& OutData, int32 Step, bool bMultiThreaded)
 {
 	VOXEL_ASYNC_FUNCTION_COUNTER();
 
-	check(InData.Num() == OutData.Num());
-	check(InData.Num() == Size.X * Size.Y * Size.Z);
+	const int32 Num = Size.X * Size.Y * Size.Z;
+	check(InData.X.Num() == Num && InData.Y.Num() == Num && InData.Z.Num() == Num);
+	check(OutData.X.Num() == Num && OutData.Y.Num() == Num && OutData.Z.Num() == Num);
+
+	const float InvalidValue = MakeInvalidSurfacePosition().X;
 	
-	const auto DoWork = [&](int32 X)
+	// Work is done row by row: for every neighbor offset, the whole row is compared against the neighbor row,
+	// which is contiguous in memory. The neighbors are visited in the same order as a per-voxel loop would, so the result is the same.
+	const auto DoWork = [&](int32 Z)
 	{
+		TArray<float> BestDistances;
+		BestDistances.SetNumUninitialized(Size.X);
+
+		const VectorRegister InvalidValue4 = VectorSetFloat1(InvalidValue);
+		const VectorRegister Offsets4 = MakeVectorRegister(0.f, 1.f, 2.f, 3.f);
+		
 		for (int32 Y = 0; Y < Size.Y; Y++)
 		{
-			for (int32 Z = 0; Z < Size.Z; Z++)
-			{
-				const FIntVector Position(X, Y, Z);
+			const int32 RowIndex = FVoxelUtilities::Get3DIndex(Size, 0, Y, Z);
+			
+			float* RESTRICT const BestDistance = BestDistances.GetData();
+			float* RESTRICT const BestX = OutData.X.GetData() + RowIndex;
+			float* RESTRICT const BestY = OutData.Y.GetData() + RowIndex;
+			float* RESTRICT const BestZ = OutData.Z.GetData() + RowIndex;
 
-				float BestDistance = MAX_flt;
-				FVector BestSurfacePosition = MakeInvalidSurfacePosition();
+			for (int32 X = 0; X < Size.X; X++)
+			{
+				BestDistance[X] = MAX_flt;
+				BestX[X] = InvalidValue;
+				BestY[X] = InvalidValue;
+				BestZ[X] = InvalidValue;
+			}
 
-				for (int32 DX = -1; DX <= 1; ++DX)
+			const VectorRegister PositionY4 = VectorSetFloat1(float(Y));
+			const VectorRegister PositionZ4 = VectorSetFloat1(float(Z));
+			
+			for (int32 DX = -1; DX <= 1; ++DX)
+			{
+				// Only process the voxels whose neighbor is inside the row
+				const int32 StartX = FMath::Max(0, -DX * Step);
+				const int32 EndX = FMath::Min(Size.X, Size.X - DX * Step);
+				
+				for (int32 DY = -1; DY <= 1; ++DY)
 				{
-					for (int32 DY = -1; DY <= 1; ++DY)
+					const int32 NeighborY = Y + DY * Step;
+					if (NeighborY < 0 || NeighborY >= Size.Y)
+					{
+						continue;
+					}
+					
+					for (int32 DZ = -1; DZ <= 1; ++DZ)
 					{
-						for (int32 DZ = -1; DZ <= 1; ++DZ)
+						const int32 NeighborZ = Z + DZ * Step;
+						if (NeighborZ < 0 || NeighborZ >= Size.Z)
+						{
+							continue;
+						}
+
+						const int32 NeighborRowIndex = FVoxelUtilities::Get3DIndex(Size, 0, NeighborY, NeighborZ) + DX * Step;
+						const float* RESTRICT const NeighborRowX = InData.X.GetData() + NeighborRowIndex;
+						const float* RESTRICT const NeighborRowY = InData.Y.GetData() + NeighborRowIndex;
+						const float* RESTRICT const NeighborRowZ = InData.Z.GetData() + NeighborRowIndex;
+
+						int32 X = StartX;
+						for (; X + 4 <= EndX; X += 4)
+						{
+							const VectorRegister CandidateX = VectorLoad(NeighborRowX + X);
+							const VectorRegister CandidateY = VectorLoad(NeighborRowY + X);
+							const VectorRegister CandidateZ = VectorLoad(NeighborRowZ + X);
+
+							const VectorRegister DeltaX = VectorSubtract(CandidateX, VectorAdd(VectorSetFloat1(float(X)), Offsets4));
+							const VectorRegister DeltaY = VectorSubtract(CandidateY, PositionY4);
+							const VectorRegister DeltaZ = VectorSubtract(CandidateZ, PositionZ4);
+							
+							// Same operation order as FVector::SizeSquared
+							const VectorRegister Distance = VectorAdd(
+								VectorAdd(VectorMultiply(DeltaX, DeltaX), VectorMultiply(DeltaY, DeltaY)),
+								VectorMultiply(DeltaZ, DeltaZ));
+
+							const VectorRegister OldDistance = VectorLoad(BestDistance + X);
+							const VectorRegister Mask = VectorBitwiseAnd(
+								VectorCompareGT(OldDistance, Distance),
+								VectorCompareGT(InvalidValue4, CandidateX));
+
+							VectorStore(VectorSelect(Mask, Distance, OldDistance), BestDistance + X);
+							VectorStore(VectorSelect(Mask, CandidateX, VectorLoad(BestX + X)), BestX + X);
+							VectorStore(VectorSelect(Mask, CandidateY, VectorLoad(BestY + X)), BestY + X);
+							VectorStore(VectorSelect(Mask, CandidateZ, VectorLoad(BestZ + X)), BestZ + X);
+						}
+						for (; X < EndX; X++)
 						{
-							const FIntVector NeighborPosition = Position + FIntVector(DX, DY, DZ) * Step;
-
-							if (NeighborPosition.X < 0 ||
-								NeighborPosition.Y < 0 ||
-								NeighborPosition.Z < 0 ||
-								NeighborPosition.X >= Size.X ||
-								NeighborPosition.Y >= Size.Y ||
-								NeighborPosition.Z >= Size.Z)
+							const float CandidateX = NeighborRowX[X];
+							if (!(CandidateX < InvalidValue))
 							{
 								continue;
 							}
+							
+							const float CandidateY = NeighborRowY[X];
+							const float CandidateZ = NeighborRowZ[X];
+							const float Distance = FVector(CandidateX - X, CandidateY - Y, CandidateZ - Z).SizeSquared();
+							if (Distance < BestDistance[X])
+							{
+								BestDistance[X] = Distance;
+								BestX[X] = CandidateX;
+								BestY[X] = CandidateY;
+								BestZ[X] = CandidateZ;
+							}
+						}
+					}
+				}
+			}
+		}
+	};
 
-							const FVector NeighborSurfacePosition = FVoxelUtilities::Get3D(InData, Size, NeighborPosition);
+	ParallelFor(Size.Z, DoWork, !bMultiThreaded);
+}
 
-							if (IsSurfacePositionValid(NeighborSurfacePosition))
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// Straightforward per-voxel implementations, used to check the optimized ones
+namespace FVoxelDistanceFieldReference
+{
+	void JumpFloodStep(const FIntVector& Size, TArrayView<const FVector> InData, TArrayView<FVector> OutData, int32 Step)
+	{
+		for (int32 X = 0; X < Size.X; X++)
+		{
+			for (int32 Y = 0; Y < Size.Y; Y++)
+			{
+				for (int32 Z = 0; Z < Size.Z; Z++)
+				{
+					const FIntVector Position(X, Y, Z);
+
+					float BestDistance = MAX_flt;
+					FVector BestSurfacePosition = FVoxelDistanceFieldUtilities::MakeInvalidSurfacePosition();
+
+					for (int32 DX = -1; DX <= 1; ++DX)
+					{
+						for (int32 DY = -1; DY <= 1; ++DY)
+						{
+							for (int32 DZ = -1; DZ <= 1; ++DZ)
 							{
-								const float Distance = (NeighborSurfacePosition - FVector(Position)).SizeSquared();
-								if (Distance < BestDistance)
+								const FIntVector NeighborPosition = Position + FIntVector(DX, DY, DZ) * Step;
+
+								if (NeighborPosition.X < 0 ||
+									NeighborPosition.Y < 0 ||
+									NeighborPosition.Z < 0 ||
+									NeighborPosition.X >= Size.X ||
+									NeighborPosition.Y >= Size.Y ||
+									NeighborPosition.Z >= Size.Z)
 								{
-									BestDistance = Distance;
-									BestSurfacePosition = NeighborSurfacePosition;
+									continue;
+								}
+
+								const FVector NeighborSurfacePosition = FVoxelUtilities::Get3D(InData, Size, NeighborPosition);
+
+								if (FVoxelDistanceFieldUtilities::IsSurfacePositionValid(NeighborSurfacePosition))
+								{
+									const float Distance = (NeighborSurfacePosition - FVector(Position)).SizeSquared();
+									if (Distance < BestDistance)
+									{
+										BestDistance = Distance;
+										BestSurfacePosition = NeighborSurfacePosition;
+									}
 								}
 							}
 						}
 					}
+					FVoxelUtilities::Get3D(OutData, Size, Position) = BestSurfacePosition;
 				}
-				FVoxelUtilities::Get3D(OutData, Size, Position) = BestSurfacePosition;
 			}
 		}
-	};
+	}
 
-	if (bMultiThreaded)
+	void JumpFlood(const FIntVector& Size, TArray<FVector>& InOutSurfacePositions)
 	{
-		ParallelFor(Size.X, DoWork);
+		TArray<FVector> Temp;
+		Temp.SetNumUninitialized(InOutSurfacePositions.Num());
+		
+		const int32 PowerOfTwo = FMath::CeilLogTwo(Size.GetMax());
+		for (int32 Pass = 0; Pass < PowerOfTwo; Pass++)
+		{
+			JumpFloodStep(Size, InOutSurfacePositions, Temp, 1 << (PowerOfTwo - 1 - Pass));
+			Swap(InOutSurfacePositions, Temp);
+		}
 	}
-	else
+
+	void DownSample(
+		const FIntVector& Size,
+		TArrayView<const float> InDistances,
+		TArrayView<const FVector> InSurfacePositions,
+		TArray<float>& OutDistances,
+		TArray<FVector>& OutSurfacePositions,
+		int32 Divisor)
 	{
-		for (int32 X = 0; X < Size.X; X++)
+		const FIntVector LowSize = FVoxelUtilities::DivideCeil(Size, Divisor);
+		OutDistances.SetNumUninitialized(LowSize.X * LowSize.Y * LowSize.Z);
+		OutSurfacePositions.SetNumUninitialized(LowSize.X * LowSize.Y * LowSize.Z);
+		
+		for (int32 LowX = 0; LowX < LowSize.X; LowX++)
 		{
-			DoWork(X);
+			for (int32 LowY = 0; LowY < LowSize.Y; LowY++)
+			{
+				for (int32 LowZ = 0; LowZ < LowSize.Z; LowZ++)
+				{
+					float BestDistance = MAX_flt;
+					FVector BestSurfacePosition = FVoxelDistanceFieldUtilities::MakeInvalidSurfacePosition();
+					float Sign = FVoxelUtilities::Get3D(InDistances, Size, LowX * Divisor, LowY * Divisor, LowZ * Divisor);
+					
+					for (int32 HighX = LowX * Divisor; HighX < FMath::Min(Size.X, (LowX + 1) * Divisor); HighX++)
+					{
+						for (int32 HighY = LowY * Divisor; HighY < FMath::Min(Size.Y, (LowY + 1) * Divisor); HighY++)
+						{
+							for (int32 HighZ = LowZ * Divisor; HighZ < FMath::Min(Size.Z, (LowZ + 1) * Divisor); HighZ++)
+							{
+								FVector NeighborSurfacePosition = FVoxelUtilities::Get3D(InSurfacePositions, Size, HighX, HighY, HighZ);
+								
+								if (FVoxelDistanceFieldUtilities::IsSurfacePositionValid(NeighborSurfacePosition))
+								{
+									NeighborSurfacePosition /= Divisor;
+									const float Distance = (NeighborSurfacePosition - FVector(LowX, LowY, LowZ)).SizeSquared();
+									if (Distance < BestDistance)
+									{
+										BestDistance = Distance;
+										BestSurfacePosition = NeighborSurfacePosition;
+										Sign = FVoxelUtilities::Get3D(InDistances, Size, HighX, HighY, HighZ);
+									}
+								}
+							}
+						}
+					}
+
+					FVoxelUtilities::Get3D(OutSurfacePositions, LowSize, LowX, LowY, LowZ) = BestSurfacePosition;
+					FVoxelUtilities::Get3D(OutDistances, LowSize, LowX, LowY, LowZ) = Sign;
+				}
+			}
 		}
 	}
-}
\ No newline at end of file
+}
+
+static FAutoConsoleCommand CmdTestDistanceFieldCPU(
+	TEXT("voxel.distancefield.TestCPU"),
+	TEXT("Compares the CPU jump flood & down sampling against a reference implementation on random seeds. Args: NumTests (default 16)"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 NumTests = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 16;
+
+		int32 NumFailed = 0;
+		double ReferenceTime = 0;
+		double OptimizedTime = 0;
+		
+		for (int32 Seed = 0; Seed < NumTests; Seed++)
+		{
+			FRandomStream Stream(Seed);
+
+			const FIntVector Size(Stream.RandRange(1, 64), Stream.RandRange(1, 64), Stream.RandRange(1, 64));
+			const int32 Num = Size.X * Size.Y * Size.Z;
+			const float SeedProbability = Stream.FRandRange(0.0001f, 0.05f);
+			
+			TArray<float> Distances;
+			TArray<FVector> SurfacePositions;
+			Distances.SetNumUninitialized(Num);
+			SurfacePositions.SetNumUninitialized(Num);
+			for (int32 Index = 0; Index < Num; Index++)
+			{
+				Distances[Index] = Stream.FRand() < 0.5f ? -1.f : 1.f;
+				SurfacePositions[Index] =
+					Stream.FRand() < SeedProbability
+					? FVector(Stream.FRandRange(0, Size.X - 1), Stream.FRandRange(0, Size.Y - 1), Stream.FRandRange(0, Size.Z - 1))
+					: FVoxelDistanceFieldUtilities::MakeInvalidSurfacePosition();
+			}
+
+			const auto Compare = [&](const TCHAR* Name, TArrayView<const FVector> A, TArrayView<const FVector> B, TArrayView<const float> DistancesA, TArrayView<const float> DistancesB)
+			{
+				for (int32 Index = 0; Index < A.Num(); Index++)
+				{
+					if (!A[Index].Equals(B[Index], KINDA_SMALL_NUMBER) || DistancesA[Index] != DistancesB[Index])
+					{
+						LOG_VOXEL(Error, TEXT("%s: seed %d (size %s): mismatch at index %d: %s vs %s"), 
+							Name, Seed, *Size.ToString(), Index, *A[Index].ToString(), *B[Index].ToString());
+						NumFailed++;
+						return;
+					}
+				}
+			};
+
+			// Down sampling
+			{
+				const int32 Divisor = Stream.RandRange(2, 4);
+				
+				TArray<float> ReferenceDistances;
+				TArray<FVector> ReferenceSurfacePositions;
+				FVoxelDistanceFieldReference::DownSample(Size, Distances, SurfacePositions, ReferenceDistances, ReferenceSurfacePositions, Divisor);
+
+				FIntVector NewSize = Size;
+				TArray<float> NewDistances = Distances;
+				TArray<FVector> NewSurfacePositions = SurfacePositions;
+				FVoxelDistanceFieldUtilities::DownSample(NewSize, NewDistances, NewSurfacePositions, Divisor, false, true);
+
+				Compare(TEXT("DownSample"), ReferenceSurfacePositions, NewSurfacePositions, ReferenceDistances, NewDistances);
+			}
+
+			// Jump flood
+			{
+				TArray<FVector> ReferenceSurfacePositions = SurfacePositions;
+				{
+					const double StartTime = FPlatformTime::Seconds();
+					FVoxelDistanceFieldReference::JumpFlood(Size, ReferenceSurfacePositions);
+					ReferenceTime += FPlatformTime::Seconds() - StartTime;
+				}
+				
+				TArray<FVector> NewSurfacePositions = SurfacePositions;
+				{
+					const double StartTime = FPlatformTime::Seconds();
+					FVoxelDistanceFieldUtilities::JumpFlood(Size, NewSurfacePositions, EVoxelComputeDevice::CPU, true);
+					OptimizedTime += FPlatformTime::Seconds() - StartTime;
+				}
+
+				Compare(TEXT("JumpFlood"), ReferenceSurfacePositions, NewSurfacePositions, Distances, Distances);
+			}
+		}
+
+		LOG_VOXEL(Log, TEXT("voxel.distancefield.TestCPU: %d/%d tests passed. Jump flood: reference %.2fms, optimized %.2fms"),
+			2 * NumTests - NumFailed, 2 * NumTests, ReferenceTime * 1000, OptimizedTime * 1000);
+	}));
@@ -858,7 +858,10 @@ TVoxelSharedRef<IVoxelPool> AVoxelWorld::CreatePool() const
 			FMath::Max(1, InNumberOfThreads),
 			bInConstantPriorities,
 			PriorityCategories,
-			PriorityOffsets);
+			PriorityOffsets,
+			MaxConcurrentTasks,
+			ReservedThreads,
+			ThreadsFirstCore);
 	};
 	
 	if (PlayType == EVoxelPlayType::Preview)
@@ -11,9 +11,13 @@ class TVoxelFastNoise_SimplexNoise : public T
 public:
 	DEFINE_VOXEL_NOISE_CLASS()
 	GENERATED_VOXEL_NOISE_FUNCTION_2D(Simplex)
+	GENERATED_VOXEL_NOISE_FUNCTION_2D_DERIV(Simplex)
 	GENERATED_VOXEL_NOISE_FUNCTION_3D(Simplex)
+	GENERATED_VOXEL_NOISE_FUNCTION_3D_DERIV(Simplex)
 	GENERATED_VOXEL_NOISE_FUNCTION_FRACTAL_2D(Simplex, Simplex)
+	GENERATED_VOXEL_NOISE_FUNCTION_FRACTAL_2D_DERIV(Simplex, Simplex)
 	GENERATED_VOXEL_NOISE_FUNCTION_FRACTAL_3D(Simplex, Simplex)
+	GENERATED_VOXEL_NOISE_FUNCTION_FRACTAL_3D_DERIV(Simplex, Simplex)
 
 protected:
 	static constexpr v_flt SQRT3 = v_flt(1.7320508075688772935274463415059);
@@ -24,5 +28,8 @@ protected:
 	static constexpr v_flt G3 = 1 / v_flt(6);
 	
 	v_flt SingleSimplex_2D(uint8 offset, v_flt x, v_flt y) const;
+	v_flt SingleSimplex_2D_Deriv(uint8 offset, v_flt x, v_flt y, v_flt& outDx, v_flt& outDy) const;
+	
 	v_flt SingleSimplex_3D(uint8 offset, v_flt x, v_flt y, v_flt z) const;
+	v_flt SingleSimplex_3D_Deriv(uint8 offset, v_flt x, v_flt y, v_flt z, v_flt& outDx, v_flt& outDy, v_flt& outDz) const;
 };
\ No newline at end of file
@@ -213,4 +213,209 @@ FN_FORCEINLINE_SINGLE v_flt TVoxelFastNoise_SimplexNoise<T>::SingleSimplex_3D(ui
 	}
 
 	return 32 * (n0 + n1 + n2 + n3);
-}
\ No newline at end of file
+}
+
+// Each corner contributes t^4 * dot(g, d), with t = r - dot(d, d)
+// Its derivative is t^4 * g - 8 * t^3 * dot(g, d) * d
+
+template<typename T>
+FN_FORCEINLINE_SINGLE v_flt TVoxelFastNoise_SimplexNoise<T>::SingleSimplex_2D_Deriv(uint8 offset, v_flt x, v_flt y, v_flt& outDx, v_flt& outDy) const
+{
+	v_flt t = (x + y) * F2;
+	const int32 i = FNoiseMath::FastFloor(x + t);
+	const int32 j = FNoiseMath::FastFloor(y + t);
+
+	t = (i + j) * G2;
+	const v_flt X0 = i - t;
+	const v_flt Y0 = j - t;
+
+	const v_flt x0 = x - X0;
+	const v_flt y0 = y - Y0;
+
+	int32 i1, j1;
+	if (x0 > y0)
+	{
+		i1 = 1; j1 = 0;
+	}
+	else
+	{
+		i1 = 0; j1 = 1;
+	}
+
+	const v_flt x1 = x0 - v_flt(i1) + G2;
+	const v_flt y1 = y0 - v_flt(j1) + G2;
+	const v_flt x2 = x0 - 1 + 2 * G2;
+	const v_flt y2 = y0 - 1 + 2 * G2;
+
+	v_flt value = 0;
+	v_flt dx = 0;
+	v_flt dy = 0;
+	v_flt gx, gy;
+
+	t = v_flt(0.5) - x0 * x0 - y0 * y0;
+	if (t >= 0)
+	{
+		const v_flt n = This().GradCoord2D(offset, i, j, x0, y0, gx, gy);
+		const v_flt t2 = t * t;
+		const v_flt t4 = t2 * t2;
+		const v_flt f = -8 * t2 * t * n;
+		value += t4 * n;
+		dx += t4 * gx + f * x0;
+		dy += t4 * gy + f * y0;
+	}
+
+	t = v_flt(0.5) - x1 * x1 - y1 * y1;
+	if (t >= 0)
+	{
+		const v_flt n = This().GradCoord2D(offset, i + i1, j + j1, x1, y1, gx, gy);
+		const v_flt t2 = t * t;
+		const v_flt t4 = t2 * t2;
+		const v_flt f = -8 * t2 * t * n;
+		value += t4 * n;
+		dx += t4 * gx + f * x1;
+		dy += t4 * gy + f * y1;
+	}
+
+	t = v_flt(0.5) - x2 * x2 - y2 * y2;
+	if (t >= 0)
+	{
+		const v_flt n = This().GradCoord2D(offset, i + 1, j + 1, x2, y2, gx, gy);
+		const v_flt t2 = t * t;
+		const v_flt t4 = t2 * t2;
+		const v_flt f = -8 * t2 * t * n;
+		value += t4 * n;
+		dx += t4 * gx + f * x2;
+		dy += t4 * gy + f * y2;
+	}
+
+	outDx = 70 * dx;
+	outDy = 70 * dy;
+	return 70 * value;
+}
+
+template<typename T>
+FN_FORCEINLINE_SINGLE v_flt TVoxelFastNoise_SimplexNoise<T>::SingleSimplex_3D_Deriv(uint8 offset, v_flt x, v_flt y, v_flt z, v_flt& outDx, v_flt& outDy, v_flt& outDz) const
+{
+	v_flt t = (x + y + z) * F3;
+	const int32 i = FNoiseMath::FastFloor(x + t);
+	const int32 j = FNoiseMath::FastFloor(y + t);
+	const int32 k = FNoiseMath::FastFloor(z + t);
+
+	t = (i + j + k) * G3;
+	const v_flt X0 = i - t;
+	const v_flt Y0 = j - t;
+	const v_flt Z0 = k - t;
+
+	const v_flt x0 = x - X0;
+	const v_flt y0 = y - Y0;
+	const v_flt z0 = z - Z0;
+
+	int32 i1, j1, k1;
+	int32 i2, j2, k2;
+
+	if (x0 >= y0)
+	{
+		if (y0 >= z0)
+		{
+			i1 = 1; j1 = 0; k1 = 0; i2 = 1; j2 = 1; k2 = 0;
+		}
+		else if (x0 >= z0)
+		{
+			i1 = 1; j1 = 0; k1 = 0; i2 = 1; j2 = 0; k2 = 1;
+		}
+		else // x0 < z0
+		{
+			i1 = 0; j1 = 0; k1 = 1; i2 = 1; j2 = 0; k2 = 1;
+		}
+	}
+	else // x0 < y0
+	{
+		if (y0 < z0)
+		{
+			i1 = 0; j1 = 0; k1 = 1; i2 = 0; j2 = 1; k2 = 1;
+		}
+		else if (x0 < z0)
+		{
+			i1 = 0; j1 = 1; k1 = 0; i2 = 0; j2 = 1; k2 = 1;
+		}
+		else // x0 >= z0
+		{
+			i1 = 0; j1 = 1; k1 = 0; i2 = 1; j2 = 1; k2 = 0;
+		}
+	}
+
+	const v_flt x1 = x0 - i1 + G3;
+	const v_flt y1 = y0 - j1 + G3;
+	const v_flt z1 = z0 - k1 + G3;
+	
+	const v_flt x2 = x0 - i2 + 2 * G3;
+	const v_flt y2 = y0 - j2 + 2 * G3;
+	const v_flt z2 = z0 - k2 + 2 * G3;
+	
+	const v_flt x3 = x0 - 1 + 3 * G3;
+	const v_flt y3 = y0 - 1 + 3 * G3;
+	const v_flt z3 = z0 - 1 + 3 * G3;
+
+	v_flt value = 0;
+	v_flt dx = 0;
+	v_flt dy = 0;
+	v_flt dz = 0;
+	v_flt gx, gy, gz;
+
+	t = v_flt(0.6) - x0 * x0 - y0 * y0 - z0 * z0;
+	if (t >= 0)
+	{
+		const v_flt n = This().GradCoord3D(offset, i, j, k, x0, y0, z0, gx, gy, gz);
+		const v_flt t2 = t * t;
+		const v_flt t4 = t2 * t2;
+		const v_flt f = -8 * t2 * t * n;
+		value += t4 * n;
+		dx += t4 * gx + f * x0;
+		dy += t4 * gy + f * y0;
+		dz += t4 * gz + f * z0;
+	}
+
+	t = v_flt(0.6) - x1 * x1 - y1 * y1 - z1 * z1;
+	if (t >= 0)
+	{
+		const v_flt n = This().GradCoord3D(offset, i + i1, j + j1, k + k1, x1, y1, z1, gx, gy, gz);
+		const v_flt t2 = t * t;
+		const v_flt t4 = t2 * t2;
+		const v_flt f = -8 * t2 * t * n;
+		value += t4 * n;
+		dx += t4 * gx + f * x1;
+		dy += t4 * gy + f * y1;
+		dz += t4 * gz + f * z1;
+	}
+
+	t = v_flt(0.6) - x2 * x2 - y2 * y2 - z2 * z2;
+	if (t >= 0)
+	{
+		const v_flt n = This().GradCoord3D(offset, i + i2, j + j2, k + k2, x2, y2, z2, gx, gy, gz);
+		const v_flt t2 = t * t;
+		const v_flt t4 = t2 * t2;
+		const v_flt f = -8 * t2 * t * n;
+		value += t4 * n;
+		dx += t4 * gx + f * x2;
+		dy += t4 * gy + f * y2;
+		dz += t4 * gz + f * z2;
+	}
+
+	t = v_flt(0.6) - x3 * x3 - y3 * y3 - z3 * z3;
+	if (t >= 0)
+	{
+		const v_flt n = This().GradCoord3D(offset, i + 1, j + 1, k + 1, x3, y3, z3, gx, gy, gz);
+		const v_flt t2 = t * t;
+		const v_flt t4 = t2 * t2;
+		const v_flt f = -8 * t2 * t * n;
+		value += t4 * n;
+		dx += t4 * gx + f * x3;
+		dy += t4 * gy + f * y3;
+		dz += t4 * gz + f * z3;
+	}
+
+	outDx = 32 * dx;
+	outDy = 32 * dy;
+	outDz = 32 * dz;
+	return 32 * value;
+}
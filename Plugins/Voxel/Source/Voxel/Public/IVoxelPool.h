@@ -83,9 +83,13 @@ public:
 	virtual ~IVoxelPool() {}
 
 	//~ Begin IVoxelPool Interface
+	// Can be called from any thread, eg by a task to queue its follow-up tasks
 	virtual void QueueTask(EVoxelTaskType Type, IVoxelQueuedWork* Task) = 0;
 	virtual void QueueTasks(EVoxelTaskType Type, const TArray<IVoxelQueuedWork*>& Tasks) = 0;
 
+	// Makes the queued tasks recompute their priorities before the next task is picked, eg when the invokers teleported
+	virtual void InvalidatePriorities() = 0;
+
 	virtual int32 GetNumTasks() const = 0;
 	//~ End IVoxelPool Interface
 
@@ -121,5 +121,14 @@ public:
 	{
 		return FVector::UpVector;
 	}
+	virtual bool IsHeightmapInBounds(const FVoxelIntBox& Bounds) const override final
+	{
+		// Outside of the asset bounds the world is empty
+		return bInfiniteExtent || WorldBounds.Contains(Bounds);
+	}
+	virtual v_flt GetHeightmapHeight(v_flt X, v_flt Y) const override final
+	{
+		return Wrapper.GetHeight(X + Wrapper.GetWidth() / 2, Y + Wrapper.GetHeight() / 2, EVoxelSamplerMode::Clamp);
+	}
 	//~ End FVoxelGeneratorInstance Interface
 };
\ No newline at end of file
@@ -4,6 +4,8 @@
 
 #include "CoreMinimal.h"
 #include "VoxelQueuedWork.h"
+#include "VoxelMinimal.h"
+#include "IVoxelPool.h"
 
 class VOXEL_API FVoxelAsyncWork : public IVoxelQueuedWork
 {
@@ -24,8 +26,14 @@ public:
 	virtual void PostDoWork() {} // Will be called when IsDone is true
 	//~ End FVoxelAsyncWork Interface
 
+	// If the work is still queued, it's removed from the pool queue and deleted right away
 	// @return: IsDone and PostDoWork was called
 	bool CancelAndAutodelete();
+
+	// Work queued on Pool by the thread that ran this work, right after PostDoWork, without going through the game thread
+	// If this work is canceled or abandoned, or if the pool is destroyed, the continuation is abandoned
+	// Must be called before this work is queued
+	void SetContinuation(const TVoxelSharedRef<IVoxelPool>& Pool, EVoxelTaskType TaskType, IVoxelQueuedWork* Work);
 	
 	bool IsDone() const
 	{
@@ -77,6 +85,16 @@ private:
 	bool bAutodelete = false;
 
 	FThreadSafeCounter WasAbandonedCounter;
+
+	struct FContinuation
+	{
+		TVoxelWeakPtr<IVoxelPool> Pool;
+		EVoxelTaskType TaskType = EVoxelTaskType::ChunksMeshing;
+		IVoxelQueuedWork* Work = nullptr;
+	};
+	FContinuation Continuation;
+
+	void FlushContinuation(bool bQueue);
 };
 
 template<typename T>
@@ -0,0 +1,379 @@
+// Copyright 2020 Phyronnaz
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VoxelUtilities/VoxelBaseUtilities.h"
+
+/**
+ * Map from uint64 ids to elements, for the renderer chunks
+ * The index is an open addressing hash table with linear probing, only storing the keys & the slot indices:
+ * a lookup touches one or two cache lines instead of chasing the TSet hash chains
+ * Elements are stored in fixed size pages: their addresses & handles are stable until they are removed
+ * Iteration goes through a dense array of slots, so it doesn't need to skip holes
+ */
+template<typename ElementType, int32 PageSize = 256>
+class TVoxelChunkTable
+{
+public:
+	// Stays valid until its element is removed. Get returns null afterwards
+	struct FHandle
+	{
+		FHandle() = default;
+
+		FORCEINLINE bool IsValid() const
+		{
+			return Generation != 0;
+		}
+		FORCEINLINE bool operator==(FHandle Other) const
+		{
+			return SlotIndex == Other.SlotIndex && Generation == Other.Generation;
+		}
+		FORCEINLINE bool operator!=(FHandle Other) const
+		{
+			return !(*this == Other);
+		}
+
+	private:
+		uint32 SlotIndex = 0;
+		uint32 Generation = 0;
+
+		FHandle(uint32 SlotIndex, uint32 Generation)
+			: SlotIndex(SlotIndex)
+			, Generation(Generation)
+		{
+		}
+
+		friend class TVoxelChunkTable;
+	};
+
+public:
+	TVoxelChunkTable() = default;
+	~TVoxelChunkTable()
+	{
+		Reset();
+	}
+
+	TVoxelChunkTable(const TVoxelChunkTable&) = delete;
+	TVoxelChunkTable& operator=(const TVoxelChunkTable&) = delete;
+
+public:
+	FORCEINLINE int32 Num() const
+	{
+		return DenseSlots.Num();
+	}
+
+	FORCEINLINE ElementType* Find(uint64 Key)
+	{
+		const int32 BucketIndex = FindBucket(Key);
+		return BucketIndex == -1 ? nullptr : &GetSlot(Buckets[BucketIndex].SlotIndex).GetElement();
+	}
+	FORCEINLINE const ElementType* Find(uint64 Key) const
+	{
+		return const_cast<TVoxelChunkTable&>(*this).Find(Key);
+	}
+	FORCEINLINE ElementType& FindChecked(uint64 Key)
+	{
+		ElementType* Element = Find(Key);
+		check(Element);
+		return *Element;
+	}
+	FORCEINLINE const ElementType& FindChecked(uint64 Key) const
+	{
+		return const_cast<TVoxelChunkTable&>(*this).FindChecked(Key);
+	}
+	FORCEINLINE ElementType& operator[](uint64 Key)
+	{
+		return FindChecked(Key);
+	}
+	FORCEINLINE const ElementType& operator[](uint64 Key) const
+	{
+		return FindChecked(Key);
+	}
+	FORCEINLINE bool Contains(uint64 Key) const
+	{
+		return FindBucket(Key) != -1;
+	}
+
+	FORCEINLINE FHandle FindHandle(uint64 Key) const
+	{
+		const int32 BucketIndex = FindBucket(Key);
+		if (BucketIndex == -1)
+		{
+			return {};
+		}
+		const uint32 SlotIndex = Buckets[BucketIndex].SlotIndex;
+		return { SlotIndex, GetSlot(SlotIndex).Generation };
+	}
+	// Returns null if the element was removed since the handle was created
+	FORCEINLINE ElementType* Get(FHandle Handle)
+	{
+		if (!Handle.IsValid() || Handle.SlotIndex >= NumSlots)
+		{
+			return nullptr;
+		}
+		FSlot& Slot = GetSlot(Handle.SlotIndex);
+		return Slot.Generation == Handle.Generation && Slot.DenseIndex != -1 ? &Slot.GetElement() : nullptr;
+	}
+
+public:
+	// Key must not be in the table already
+	template<typename... ArgsType>
+	ElementType& Emplace(uint64 Key, ArgsType&&... Args)
+	{
+		checkVoxelSlow(!Contains(Key));
+
+		if ((Num() + 1) * 10 > Buckets.Num() * 7)
+		{
+			Rehash(FMath::Max(64, 2 * Buckets.Num()));
+		}
+
+		const uint32 SlotIndex = AllocateSlot();
+		FSlot& Slot = GetSlot(SlotIndex);
+		Slot.Key = Key;
+		Slot.Generation = NextGeneration++;
+		if (NextGeneration == 0)
+		{
+			NextGeneration = 1;
+		}
+		Slot.DenseIndex = DenseSlots.Add(SlotIndex);
+		new (&Slot.Storage) ElementType(Forward<ArgsType>(Args)...);
+
+		InsertInBuckets(Key, SlotIndex);
+
+		return Slot.GetElement();
+	}
+	FORCEINLINE ElementType& Add(uint64 Key, ElementType&& Element)
+	{
+		return Emplace(Key, MoveTemp(Element));
+	}
+	FORCEINLINE ElementType& Add(uint64 Key, const ElementType& Element)
+	{
+		return Emplace(Key, Element);
+	}
+
+	// Returns the number of elements removed, like TMap
+	int32 Remove(uint64 Key)
+	{
+		const int32 BucketIndex = FindBucket(Key);
+		if (BucketIndex == -1)
+		{
+			return 0;
+		}
+
+		const uint32 SlotIndex = Buckets[BucketIndex].SlotIndex;
+		RemoveFromBuckets(BucketIndex);
+
+		FSlot& Slot = GetSlot(SlotIndex);
+		DestructItem(&Slot.GetElement());
+
+		const int32 DenseIndex = Slot.DenseIndex;
+		DenseSlots.RemoveAtSwap(DenseIndex, 1, false);
+		if (DenseIndex < DenseSlots.Num())
+		{
+			GetSlot(DenseSlots[DenseIndex]).DenseIndex = DenseIndex;
+		}
+		Slot.DenseIndex = -1;
+
+		FreeSlots.Add(SlotIndex);
+		return 1;
+	}
+
+	void Reset()
+	{
+		for (uint32 SlotIndex : DenseSlots)
+		{
+			DestructItem(&GetSlot(SlotIndex).GetElement());
+		}
+		DenseSlots.Reset();
+		FreeSlots.Reset();
+		Pages.Reset();
+		Buckets.Reset();
+		NumSlots = 0;
+	}
+
+	uint32 GetAllocatedSize() const
+	{
+		return
+			Buckets.GetAllocatedSize() +
+			Pages.GetAllocatedSize() + Pages.Num() * sizeof(FPage) +
+			DenseSlots.GetAllocatedSize() +
+			FreeSlots.GetAllocatedSize();
+	}
+
+public:
+	// Removing elements while iterating is not supported
+	template<typename TableType, typename IteratorElementType>
+	struct TIterator
+	{
+		TableType& Table;
+		int32 Index;
+
+		FORCEINLINE IteratorElementType& operator*() const
+		{
+			return Table.GetSlot(Table.DenseSlots[Index]).GetElement();
+		}
+		FORCEINLINE void operator++()
+		{
+			Index++;
+		}
+		FORCEINLINE bool operator!=(const TIterator& Other) const
+		{
+			return Index != Other.Index;
+		}
+	};
+	using FIterator = TIterator<TVoxelChunkTable, ElementType>;
+	using FConstIterator = TIterator<const TVoxelChunkTable, const ElementType>;
+
+	FORCEINLINE FIterator begin() { return { *this, 0 }; }
+	FORCEINLINE FIterator end() { return { *this, Num() }; }
+	FORCEINLINE FConstIterator begin() const { return { *this, 0 }; }
+	FORCEINLINE FConstIterator end() const { return { *this, Num() }; }
+
+private:
+	struct FBucket
+	{
+		uint64 Key;
+		// MAX_uint32 if empty
+		uint32 SlotIndex;
+	};
+	struct FSlot
+	{
+		uint64 Key = 0;
+		uint32 Generation = 0;
+		// Index in DenseSlots, -1 if the slot is free
+		int32 DenseIndex = -1;
+		TTypeCompatibleBytes<ElementType> Storage;
+
+		FORCEINLINE ElementType& GetElement()
+		{
+			return *reinterpret_cast<ElementType*>(&Storage);
+		}
+		FORCEINLINE const ElementType& GetElement() const
+		{
+			return *reinterpret_cast<const ElementType*>(&Storage);
+		}
+	};
+	struct FPage
+	{
+		FSlot Slots[PageSize];
+	};
+
+	// Size is a power of 2
+	TArray<FBucket> Buckets;
+	TArray<TUniquePtr<FPage>> Pages;
+	TArray<uint32> DenseSlots;
+	TArray<uint32> FreeSlots;
+	uint32 NumSlots = 0;
+	uint32 NextGeneration = 1;
+
+	FORCEINLINE static uint32 HashKey(uint64 Key)
+	{
+		// Chunk ids are very regular, scramble them
+		return uint32(FVoxelUtilities::MurmurHash64(Key));
+	}
+
+	FORCEINLINE FSlot& GetSlot(uint32 SlotIndex)
+	{
+		return Pages[SlotIndex / PageSize]->Slots[SlotIndex % PageSize];
+	}
+	FORCEINLINE const FSlot& GetSlot(uint32 SlotIndex) const
+	{
+		return Pages[SlotIndex / PageSize]->Slots[SlotIndex % PageSize];
+	}
+
+	FORCEINLINE int32 FindBucket(uint64 Key) const
+	{
+		if (Buckets.Num() == 0)
+		{
+			return -1;
+		}
+
+		const uint32 Mask = Buckets.Num() - 1;
+		for (uint32 BucketIndex = HashKey(Key) & Mask; ; BucketIndex = (BucketIndex + 1) & Mask)
+		{
+			const FBucket& Bucket = Buckets.GetData()[BucketIndex];
+			if (Bucket.SlotIndex == MAX_uint32)
+			{
+				return -1;
+			}
+			if (Bucket.Key == Key)
+			{
+				return BucketIndex;
+			}
+		}
+	}
+
+	FORCEINLINE void InsertInBuckets(uint64 Key, uint32 SlotIndex)
+	{
+		const uint32 Mask = Buckets.Num() - 1;
+		uint32 BucketIndex = HashKey(Key) & Mask;
+		while (Buckets[BucketIndex].SlotIndex != MAX_uint32)
+		{
+			BucketIndex = (BucketIndex + 1) & Mask;
+		}
+		Buckets[BucketIndex] = { Key, SlotIndex };
+	}
+
+	// Backward shift deletion: no tombstones, so lookups never get slower over time
+	void RemoveFromBuckets(int32 InBucketIndex)
+	{
+		const uint32 Mask = Buckets.Num() - 1;
+
+		uint32 HoleIndex = InBucketIndex;
+		uint32 BucketIndex = InBucketIndex;
+		while (true)
+		{
+			Buckets[HoleIndex].SlotIndex = MAX_uint32;
+
+			while (true)
+			{
+				BucketIndex = (BucketIndex + 1) & Mask;
+				const FBucket& Bucket = Buckets[BucketIndex];
+				if (Bucket.SlotIndex == MAX_uint32)
+				{
+					return;
+				}
+
+				// The bucket can fill the hole if its ideal position is not in (HoleIndex, BucketIndex]
+				const uint32 IdealIndex = HashKey(Bucket.Key) & Mask;
+				if (((BucketIndex - IdealIndex) & Mask) >= ((BucketIndex - HoleIndex) & Mask))
+				{
+					break;
+				}
+			}
+
+			Buckets[HoleIndex] = Buckets[BucketIndex];
+			HoleIndex = BucketIndex;
+		}
+	}
+
+	void Rehash(int32 NewNumBuckets)
+	{
+		check(FMath::IsPowerOfTwo(NewNumBuckets));
+
+		Buckets.Reset(NewNumBuckets);
+		Buckets.SetNumUninitialized(NewNumBuckets);
+		for (FBucket& Bucket : Buckets)
+		{
+			Bucket.SlotIndex = MAX_uint32;
+		}
+		for (uint32 SlotIndex : DenseSlots)
+		{
+			InsertInBuckets(GetSlot(SlotIndex).Key, SlotIndex);
+		}
+	}
+
+	uint32 AllocateSlot()
+	{
+		if (FreeSlots.Num() > 0)
+		{
+			return FreeSlots.Pop(false);
+		}
+		if (NumSlots == uint32(Pages.Num()) * PageSize)
+		{
+			Pages.Add(MakeUnique<FPage>());
+		}
+		return NumSlots++;
+	}
+};
@@ -49,6 +49,16 @@ class VOXEL_API UVoxelCookingLibrary : public UBlueprintFunctionLibrary
 public:
 	static FVoxelCookedData CookVoxelDataImpl(const FVoxelCookingSettings& Settings, const FVoxelUncompressedWorldSaveImpl* Save = nullptr);
 
+	// Cook the geometry of a chunk as a PhysX tri mesh, in global space. Vertices are modified. Thread safe
+	static bool CookChunkCollision(
+		const FIntVector& ChunkPosition, 
+		float VoxelSize, 
+		bool bFastCollisionCook, 
+		bool bCleanCollisionMesh, 
+		const TArray<uint32>& Indices, 
+		TArray<FVector>& Vertices, 
+		TArray<uint8>& OutData);
+
 	// Cook collision meshes and save the result to VoxelCookedData
 	// Can then be loaded using LoadCookedVoxelData
 	// Useful for servers
@@ -17,6 +17,7 @@ class FVoxelDataLockInfo;
 class FVoxelDataOctreeBase;
 class FVoxelDataOctreeLeaf;
 class FVoxelDataOctreeParent;
+class FVoxelGeneratorCache;
 class FVoxelGeneratorInstance;
 class FVoxelTransformableGeneratorInstance;
 
@@ -108,9 +109,13 @@ public:
 	
 private:
 	TUniquePtr<FVoxelDataOctreeParent> Octree;
+	// Opt-in cache of the generator outputs, see voxel.data.GeneratorCacheSize
+	TUniquePtr<FVoxelGeneratorCache> GeneratorCache;
 	// Is locked as read when a lock is done
 	// Lock as write to clear the octree, making sure no octrees are locked
 	mutable FVoxelSharedMutex MainLock;
+	// Incremented on every write lock, see GetModificationCounter
+	mutable FThreadSafeCounter64 ModificationCounter;
 
 public:
 	FORCEINLINE int32 Size() const
@@ -118,6 +123,11 @@ public:
 		return DATA_CHUNK_SIZE << Depth;
 	}
 	FVoxelDataOctreeBase& GetOctree() const;
+	// Null if the generator cache is disabled
+	FORCEINLINE FVoxelGeneratorCache* GetGeneratorCache() const
+	{
+		return GeneratorCache.Get();
+	}
 
 	// NOTE: what if we query between WorldBounds.Max - 1 and WorldBounds.Max?
 	template<typename T>
@@ -156,6 +166,15 @@ public:
 	 * Unlock previously locked bounds
 	 */
 	void Unlock(TUniquePtr<FVoxelDataLockInfo> LockInfo) const;
+
+	/**
+	 * Incremented every time the data might be modified, ie on write locks and on ClearData
+	 * Values read under a lock are still valid as long as the counter read under that same lock hasn't changed
+	 */
+	FORCEINLINE uint64 GetModificationCounter() const
+	{
+		return ModificationCounter.GetValue();
+	}
 	 	
 public:	
 	// Must NOT be locked. Will delete the entire octree & recreate one
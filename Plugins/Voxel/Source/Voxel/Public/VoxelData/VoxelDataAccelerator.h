@@ -16,6 +16,7 @@ namespace FVoxelDataAcceleratorParameters
 	VOXEL_API int32 GetDefaultCacheSize();
 	VOXEL_API bool GetUseAcceleratorMap();
 	VOXEL_API bool GetShowStats();
+	VOXEL_API bool GetUseAnalyticGradients();
 }
 	
 template<typename TData>
@@ -51,6 +52,10 @@ public:
 		return GetFloatValue(P.X, P.Y, P.Z, LOD, bIsGeneratorValue);
 	}
 
+	// Analytic gradient of the generator, see FVoxelGeneratorInstance::GetGradient
+	// Returns false if the values are edited at this position or if the generator doesn't support it
+	bool GetGeneratorGradient(v_flt X, v_flt Y, v_flt Z, int32 LOD, FVector& OutGradient) const;
+
 public:
 	template<typename T>
 	T Get(int32 X, int32 Y, int32 Z, int32 LOD) const;
@@ -102,6 +102,23 @@ FORCEINLINE v_flt TVoxelDataAccelerator<TData>::GetFloatValue(v_flt X, v_flt Y,
 	               });
 }
 
+template<typename TData>
+FORCEINLINE bool TVoxelDataAccelerator<TData>::GetGeneratorGradient(v_flt X, v_flt Y, v_flt Z, int32 LOD, FVector& OutGradient) const
+{
+	// Clamp to world, to avoid un-editable border
+	Data.ClampToWorld(X, Y, Z);
+
+	return GetImpl(int32(X), int32(Y), int32(Z),
+	               [&](const FVoxelDataOctreeBase& Octree)
+	               {
+		               if (Octree.IsLeaf() && Octree.AsLeaf().GetData<FVoxelValue>().HasData())
+		               {
+			               return false;
+		               }
+		               return Octree.GetGradientFromGenerator(*Data.Generator, X, Y, Z, LOD, OutGradient);
+	               });
+}
+
 template<typename TData>
 template<typename T>
 FORCEINLINE T TVoxelDataAccelerator<TData>::Get(int32 X, int32 Y, int32 Z, int32 LOD) const
@@ -74,6 +74,8 @@ public:
 	T GetFromGeneratorAndAssets(const FVoxelGeneratorInstance& Generator, U X, U Y, U Z, int32 LOD) const;
 	template<typename T>
 	void GetFromGeneratorAndAssets(const FVoxelGeneratorInstance& Generator, TVoxelQueryZone<T>& QueryZone, int32 LOD) const;
+	// Returns false if the generator can't compute analytic gradients, or if there's an asset at this position
+	bool GetGradientFromGenerator(const FVoxelGeneratorInstance& Generator, v_flt X, v_flt Y, v_flt Z, int32 LOD, FVector& OutGradient) const;
 
 public:
 #if DO_THREADSAFE_CHECKS
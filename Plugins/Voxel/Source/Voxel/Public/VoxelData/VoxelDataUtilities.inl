@@ -24,6 +24,17 @@ FVector FVoxelDataUtilities::GetGradientFromGetFloatValue(TData& Data, T X, T Y,
 {
 	// Force offset to 1 as we don't have data any further outside of the generator
 	const auto Fallback = [&]() { return GetGradientFromGetValue<T>(MakeBilinearInterpolatedData(Data), X, Y, Z, LOD, 1); };
+
+	if (FVoxelDataAcceleratorParameters::GetUseAnalyticGradients())
+	{
+		// Single generator query if it supports it
+		FVector Gradient;
+		if (Data.GetGeneratorGradient(X, Y, Z, LOD, Gradient))
+		{
+			return Gradient.GetSafeNormal();
+		}
+	}
+
 	bool bIsGeneratorValue = true;
 
 	const double MinX = Data.GetFloatValue(X - Offset, Y, Z, LOD, &bIsGeneratorValue);
@@ -0,0 +1,101 @@
+// Copyright 2020 Phyronnaz
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VoxelMinimal.h"
+#include "VoxelValue.h"
+#include "VoxelMaterial.h"
+#include "Containers/LruCache.h"
+#include "HAL/ConsoleManager.h"
+
+class FVoxelDataOctreeBase;
+class FVoxelGeneratorInstance;
+
+template<typename T>
+class TVoxelQueryZone;
+
+DECLARE_VOXEL_MEMORY_STAT(TEXT("Voxel Generator Cache Memory"), STAT_VoxelGeneratorCacheMemory, STATGROUP_VoxelMemory, VOXEL_API);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Voxel Generator Cache Hits"), STAT_VoxelGeneratorCacheHits, STATGROUP_VoxelCounters, VOXEL_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Voxel Generator Cache Misses"), STAT_VoxelGeneratorCacheMisses, STATGROUP_VoxelCounters, VOXEL_API);
+
+extern VOXEL_API TAutoConsoleVariable<int32> CVarGeneratorCacheSize;
+
+struct FVoxelGeneratorCacheStats
+{
+	int64 NumHits = 0;
+	int64 NumMisses = 0;
+	int32 NumValueBlocks = 0;
+	int32 NumMaterialBlocks = 0;
+	int64 AllocatedSize = 0;
+
+	double GetHitRate() const
+	{
+		return NumHits + NumMisses == 0 ? 0. : double(NumHits) / double(NumHits + NumMisses);
+	}
+};
+
+/**
+ * Bounded LRU cache of generated blocks of BlockSize^3 voxels, shared by everything querying the data (meshing, collisions, spawners, tools)
+ * Only used for octrees without any placeable item, as the generator values then only depend on the position & LOD
+ * Thread safe
+ */
+class VOXEL_API FVoxelGeneratorCache
+{
+public:
+	static constexpr int32 BlockSize = DATA_CHUNK_SIZE;
+	static constexpr int32 BlockNum = BlockSize * BlockSize * BlockSize;
+
+	// MaxBlocks: max number of blocks per type (values & materials)
+	explicit FVoxelGeneratorCache(int32 MaxBlocks);
+	~FVoxelGeneratorCache();
+
+	// Octree must be a leaf or have no children, and QueryZone must be inside it
+	bool CanCache(const FVoxelDataOctreeBase& Octree, int32 Step) const;
+
+	// Will read cached blocks & generate the missing ones. Octree must satisfy CanCache
+	template<typename T>
+	void Get(const FVoxelGeneratorInstance& Generator, const FVoxelDataOctreeBase& Octree, TVoxelQueryZone<T>& QueryZone, int32 LOD);
+
+	void Clear();
+	FVoxelGeneratorCacheStats GetStats() const;
+
+	// Stats of all the caches since the last reset
+	static FVoxelGeneratorCacheStats GetGlobalStats();
+	static void ResetGlobalStats();
+
+private:
+	struct FKey
+	{
+		FIntVector Min;
+		int32 Step = 0;
+		int32 LOD = 0;
+
+		FORCEINLINE bool operator==(const FKey& Other) const
+		{
+			return Min == Other.Min && Step == Other.Step && LOD == Other.LOD;
+		}
+		FORCEINLINE friend uint32 GetTypeHash(const FKey& Key)
+		{
+			return HashCombine(HashCombine(GetTypeHash(Key.Min), GetTypeHash(Key.Step)), GetTypeHash(Key.LOD));
+		}
+	};
+
+	template<typename T>
+	using TBlock = TVoxelSharedPtr<const TArray<T>>;
+	template<typename T>
+	using TBlocks = TLruCache<FKey, TBlock<T>>;
+
+	mutable FCriticalSection Section;
+	TBlocks<FVoxelValue> ValueBlocks;
+	TBlocks<FVoxelMaterial> MaterialBlocks;
+	int64 NumHits = 0;
+	int64 NumMisses = 0;
+
+	template<typename T>
+	TBlocks<T>& GetBlocks();
+
+	template<typename T>
+	TBlock<T> FindOrGenerateBlock(const FVoxelGeneratorInstance& Generator, const FVoxelDataOctreeBase& Octree, const FKey& Key);
+};
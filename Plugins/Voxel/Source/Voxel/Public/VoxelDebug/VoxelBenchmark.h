@@ -0,0 +1,74 @@
+// Copyright 2020 Phyronnaz
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VoxelEnums.h"
+#include "VoxelIntBox.h"
+#include "VoxelGenerators/VoxelGeneratorPicker.h"
+
+class UVoxelSpawnerConfig;
+
+struct VOXEL_API FVoxelBenchmarkSettings
+{
+	FVoxelGeneratorPicker Generator;
+	// Used in the results. Defaults to the generator path
+	FString Name;
+
+	// Region to generate & mesh. Will be made a multiple of the biggest chunk size
+	FVoxelIntBox Bounds = FVoxelIntBox(-128, 128);
+	float VoxelSize = 100.f;
+
+	TArray<EVoxelRenderType> RenderTypes = { EVoxelRenderType::MarchingCubes, EVoxelRenderType::Cubic, EVoxelRenderType::SurfaceNets };
+	TArray<int32> LODs = { 0, 1, 2 };
+
+	// If false, chunks are processed with a ParallelFor
+	bool bSingleThread = false;
+
+	// Cook the LOD 0 marching cubes chunks with PhysX
+	bool bCookCollisions = true;
+
+	// If set, will create a transient game world with a voxel world using this config and time the foliage spawning
+	UVoxelSpawnerConfig* SpawnerConfig = nullptr;
+	float SpawnerTimeout = 120.f;
+};
+
+struct VOXEL_API FVoxelBenchmarkStage
+{
+	FString Name;
+
+	double WallTime = 0;
+	// Sum of the time spent in each task, in seconds
+	double TaskTime = 0;
+
+	int64 NumTasks = 0;
+	int64 NumVertices = 0;
+	int64 NumTriangles = 0;
+	int64 NumInstances = 0;
+
+	// Process memory, in bytes. The peak is the process peak so far
+	int64 UsedMemoryBefore = 0;
+	int64 UsedMemoryAfter = 0;
+	int64 PeakUsedMemory = 0;
+};
+
+struct VOXEL_API FVoxelBenchmarkResult
+{
+	FString Name;
+	bool bSuccess = true;
+	FString Error;
+	TArray<FVoxelBenchmarkStage> Stages;
+};
+
+/**
+ * Headless benchmark: generates, meshes, cooks & optionally spawns foliage for a fixed region
+ * Doesn't need a viewport or a GPU, see UVoxelBenchmarkCommandlet & voxel.Benchmark
+ */
+class VOXEL_API FVoxelBenchmark
+{
+public:
+	static FVoxelBenchmarkResult Run(const FVoxelBenchmarkSettings& Settings);
+
+	static FString ToJson(const TArray<FVoxelBenchmarkResult>& Results);
+	static FString GetDefaultOutputPath();
+};
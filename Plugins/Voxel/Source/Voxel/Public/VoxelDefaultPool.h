@@ -9,11 +9,17 @@
 class VOXEL_API FVoxelDefaultPool : public IVoxelPool
 {
 public:
+	// MaxConcurrentTasks: max number of tasks of a type running at the same time, 0 or missing for no limit
+	// ReservedThreads: number of threads only running tasks of a type. They are part of ThreadCount
+	// ThreadsFirstCore: if >= 0, the threads are pinned to the cores starting at this one. Only supported on Linux
 	static TVoxelSharedRef<FVoxelDefaultPool> Create(
 		int32 ThreadCount,
 		bool bConstantPriorities,
 		const TMap<EVoxelTaskType, int32>& PriorityCategories,
-		const TMap<EVoxelTaskType, int32>& PriorityOffsets);
+		const TMap<EVoxelTaskType, int32>& PriorityOffsets,
+		const TMap<EVoxelTaskType, int32>& MaxConcurrentTasks = {},
+		const TMap<EVoxelTaskType, int32>& ReservedThreads = {},
+		int32 ThreadsFirstCore = -1);
 	virtual ~FVoxelDefaultPool();
 
 public:
@@ -21,6 +27,8 @@ public:
 	virtual void QueueTask(EVoxelTaskType Type, IVoxelQueuedWork* Task) override;
 	virtual void QueueTasks(EVoxelTaskType Type, const TArray<IVoxelQueuedWork*>& Tasks) override;
 
+	virtual void InvalidatePriorities() override;
+
 	virtual int32 GetNumTasks() const override;
 	//~ End IVoxelPool Interface
 	
@@ -33,7 +41,10 @@ private:
 		int32 ThreadCount,
 		bool bConstantPriorities,
 		const TMap<EVoxelTaskType, int32>& PriorityCategories,
-		const TMap<EVoxelTaskType, int32>& PriorityOffsets);
+		const TMap<EVoxelTaskType, int32>& PriorityOffsets,
+		const TMap<EVoxelTaskType, int32>& MaxConcurrentTasks,
+		const TMap<EVoxelTaskType, int32>& ReservedThreads,
+		int32 ThreadsFirstCore);
 
 public:
 	static void FixPriorityCategories(TMap<EVoxelTaskType, int32>& PriorityCategories);
@@ -77,6 +77,13 @@
 #define ENABLE_MESHER_STATS (!UE_BUILD_SHIPPING)
 #endif
 
+// Enables the voxel trace recorder (see VoxelTrace.h): voxel scope counters, tasks, lock waits & mesher phases
+// can then be dumped as a Chrome trace using voxel.trace.Start/Dump, even without UE stats
+// Only costs a branch per scope when not recording
+#ifndef VOXEL_ENABLE_TRACE
+#define VOXEL_ENABLE_TRACE (!UE_BUILD_SHIPPING)
+#endif
+
 // Records memory stats about voxels in addition to UE's stat system
 // Unlike UE's stat system, it can be used in shipping builds
 // Use UVoxelBlueprintLibrary::GetMemoryUsageInMB to get the info
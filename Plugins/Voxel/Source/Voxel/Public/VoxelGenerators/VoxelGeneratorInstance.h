@@ -98,6 +98,17 @@ public:
 
 	// World up vector at position (must be normalized). Used for spawners
 	virtual FVector GetUpVector(v_flt X, v_flt Y, v_flt Z) const = 0;
+
+	// 2D generators can implement these to allow heightfield collisions, see voxel.collision.UseHeightfields
+	// Return true if the surface in Bounds is exactly at Z = GetHeightmapHeight(X, Y), with no overhangs
+	// Needs to be thread safe!
+	virtual bool IsHeightmapInBounds(const FVoxelIntBox& Bounds) const { return false; }
+	virtual v_flt GetHeightmapHeight(v_flt X, v_flt Y) const { return 0; }
+
+	// Generators that can compute analytic derivatives can implement this to skip the 6 value queries of gradient normals
+	// Return false to fall back to finite differences. OutGradient doesn't need to be normalized
+	// Needs to be thread safe!
+	virtual bool GetGradient(v_flt X, v_flt Y, v_flt Z, int32 LOD, const FVoxelItemStack& Items, FVector& OutGradient) const { return false; }
 	//~ End FVoxelGeneratorInstance Interface
 	
 public:
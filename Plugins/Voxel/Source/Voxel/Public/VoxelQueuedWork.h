@@ -5,6 +5,8 @@
 #include "CoreMinimal.h"
 #include "Misc/IQueuedWork.h"
 
+class FVoxelQueuedThreadPool;
+
 class IVoxelQueuedWork : public IQueuedWork
 {
 public:
@@ -26,4 +28,12 @@ public:
 	// Voxel works are usually quite long, so it's worth it to compute all the priorities
 	// Must be thread safe
 	virtual uint32 GetPriority() const = 0;
+
+private:
+	// Pool this work was queued in. Only valid until the work is done or abandoned
+	FVoxelQueuedThreadPool* QueuedPool = nullptr;
+	// Index in the queue of QueuedPool (or in its static work slots if it has constant priorities), -1 if not in it. Only accessed under the pool lock
+	int32 QueueIndex = -1;
+
+	friend class FVoxelQueuedThreadPool;
 };
\ No newline at end of file
@@ -19,6 +19,8 @@ class FInvokerPositionsArray;
 class IVoxelPool;
 class FVoxelData;
 class FVoxelDebugManager;
+class FVoxelMesherValuesCache;
+class FVoxelChunkMeshDeduplicator;
 class FVoxelToolRenderingManager;
 class UMaterialInterface;
 class UMaterialInstanceDynamic;
@@ -138,6 +140,10 @@ struct FVoxelRendererSettings : FVoxelRendererSettingsBase
 	const TVoxelSharedRef<IVoxelPool> Pool;
 	const TVoxelSharedPtr<FVoxelToolRenderingManager> ToolRenderingManager; // No tools in asset actors
 	const TVoxelSharedRef<FVoxelDebugManager> DebugManager;
+	// Shared by the meshers so that neighboring chunks reuse each other borders
+	const TVoxelSharedRef<FVoxelMesherValuesCache> MesherValuesCache;
+	// Shared by the meshers so that identical chunks share their buffers
+	const TVoxelSharedRef<FVoxelChunkMeshDeduplicator> ChunkMeshDeduplicator;
 
 	FVoxelRendererSettings(
 		const AVoxelWorld* World, 
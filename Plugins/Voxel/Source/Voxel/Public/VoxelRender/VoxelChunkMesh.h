@@ -4,6 +4,8 @@
 
 #include "CoreMinimal.h"
 #include "VoxelMinimal.h"
+#include "VoxelValue.h"
+#include "VoxelIntBox.h"
 #include "VoxelRender/VoxelProcMeshTangent.h"
 #include "VoxelRender/VoxelMaterialIndices.h"
 
@@ -25,7 +27,7 @@ struct VOXEL_API FVoxelChunkMeshBuffers
 	TArray<TArray<FVector2D>> TextureCoordinates;
 
 	FBox Bounds;
-	FGuid Guid; // Use to avoid rebuilding collisions when the mesh didn't change
+	FGuid Guid; // Use to avoid rebuilding collisions when the mesh didn't change. Identical buffers shared by several chunks have the same guid
 
 	FVoxelChunkMeshBuffers() = default;
 	~FVoxelChunkMeshBuffers()
@@ -37,6 +39,16 @@ struct VOXEL_API FVoxelChunkMeshBuffers
 	{
 		return Positions.Num();
 	}
+	inline int64 GetAllocatedSize() const
+	{
+		int64 AllocatedSize = Indices.GetAllocatedSize();
+		AllocatedSize += Positions.GetAllocatedSize();
+		AllocatedSize += Normals.GetAllocatedSize();
+		AllocatedSize += Tangents.GetAllocatedSize();
+		AllocatedSize += Colors.GetAllocatedSize();
+		for (auto& T : TextureCoordinates) AllocatedSize += T.GetAllocatedSize();
+		return AllocatedSize;
+	}
 
 	void BuildAdjacency(TArray<uint32>& OutAdjacencyIndices) const;
 	void OptimizeIndices();
@@ -49,6 +61,67 @@ private:
 	void UpdateStats();
 };
 
+// Values already queried by the mesher: the distance field reuses them instead of querying them again
+struct FVoxelChunkMeshKnownValues
+{
+	// Multiple of the chunk step. Values are stored X first, with a size of Bounds.Size() / Step
+	FVoxelIntBox Bounds;
+	const FVoxelValue* Values = nullptr;
+};
+
+// Heights of an unedited heightmap chunk, to create a heightfield collision instead of cooking a trimesh
+struct FVoxelHeightfieldCollisionData
+{
+	// Number of samples on each side
+	int32 NumSamples = 0;
+	// Distance between two samples, in voxels
+	int32 Step = 1;
+	// Relative to the chunk position, in voxels. X first
+	TArray<float> Heights;
+
+	// The same heights are shared by all the chunks of a column:
+	// each chunk only keeps the cells whose average height is in [MinHeight, MaxHeight), the others are holes
+	float MinHeight = 0;
+	float MaxHeight = 0;
+
+	inline int64 GetAllocatedSize() const
+	{
+		return Heights.GetAllocatedSize();
+	}
+	// Heights are quantized to int16 by PhysX: keep some range above & below the chunk for the cells crossing its borders
+	inline float GetHeightScale() const
+	{
+		return 2 * FMath::Max(FMath::Abs(MinHeight), FMath::Abs(MaxHeight)) / MAX_int16;
+	}
+	inline float GetHeight(int32 X, int32 Y) const
+	{
+		return Heights[X + NumSamples * Y];
+	}
+	inline bool IsHole(int32 CellX, int32 CellY) const
+	{
+		const float Height = (GetHeight(CellX, CellY) + GetHeight(CellX + 1, CellY) + GetHeight(CellX, CellY + 1) + GetHeight(CellX + 1, CellY + 1)) / 4;
+		return Height < MinHeight || Height >= MaxHeight;
+	}
+};
+
+// Convex pieces approximating the solid part of a chunk, built from the mesher values
+// Used instead of decomposing the mesh for the simple collisions
+struct FVoxelConvexCollisionData
+{
+	// Vertices of each piece, relative to the chunk position, in voxels
+	TArray<TArray<FVector>> Convexes;
+
+	inline int64 GetAllocatedSize() const
+	{
+		int64 AllocatedSize = Convexes.GetAllocatedSize();
+		for (auto& Convex : Convexes)
+		{
+			AllocatedSize += Convex.GetAllocatedSize();
+		}
+		return AllocatedSize;
+	}
+};
+
 struct FVoxelChunkMesh
 {
 public:
@@ -71,6 +144,14 @@ public:
 	{
 		return DistanceFieldVolumeData;
 	}
+	inline TVoxelSharedPtr<const FVoxelHeightfieldCollisionData> GetHeightfieldCollisionData() const
+	{
+		return HeightfieldCollisionData;
+	}
+	inline TVoxelSharedPtr<const FVoxelConvexCollisionData> GetConvexCollisionData() const
+	{
+		return ConvexCollisionData;
+	}
 	inline TVoxelSharedPtr<const FVoxelChunkMeshBuffers> FindBuffer(const FVoxelMaterialIndices& MaterialIndices) const
 	{
 		ensure(!IsSingle());
@@ -102,7 +183,23 @@ public:
 	}
 	
 public:
-	void BuildDistanceField(int32 LOD, const FIntVector& Position, const FVoxelData& Data, const FVoxelRendererSettingsBase& Settings);
+	void BuildDistanceField(
+		int32 LOD, 
+		const FIntVector& Position, 
+		const FVoxelData& Data, 
+		const FVoxelRendererSettingsBase& Settings, 
+		const FVoxelChunkMeshKnownValues& KnownValues = {});
+	// Only builds the data if the chunk is an unedited part of a heightmap, see FVoxelGeneratorInstance::IsHeightmapInBounds
+	void BuildHeightfieldCollisionData(
+		int32 LOD,
+		const FIntVector& Position,
+		const FVoxelData& Data);
+	// Does nothing if KnownValues doesn't contain all the chunk values
+	void BuildConvexCollisionData(
+		int32 LOD,
+		const FIntVector& Position,
+		int32 NumConvexHullsPerAxis,
+		const FVoxelChunkMeshKnownValues& KnownValues);
 	
 	template<typename T>
 	inline void IterateBuffers(T Lambda)
@@ -135,6 +232,24 @@ public:
 		}
 	}
 	
+	// Lambda(MaterialIndices, BuffersPtr): the buffers can be replaced, eg by identical ones shared with other chunks
+	// MaterialIndices is default constructed for single buffers
+	template<typename T>
+	inline void IterateBufferPtrs(T Lambda)
+	{
+		if (bSingleBuffers)
+		{
+			Lambda(FVoxelMaterialIndices(), SingleBuffers);
+		}
+		else
+		{
+			for (auto& It : Map)
+			{
+				Lambda(It.Key, It.Value);
+			}
+		}
+	}
+	
 	template<typename T>
 	inline void IterateMaterials(T Lambda) const
 	{
@@ -151,4 +266,6 @@ private:
 	TMap<FVoxelMaterialIndices, TVoxelSharedPtr<FVoxelChunkMeshBuffers>> Map;
 	
 	TVoxelSharedPtr<FDistanceFieldVolumeData> DistanceFieldVolumeData;
+	TVoxelSharedPtr<FVoxelHeightfieldCollisionData> HeightfieldCollisionData;
+	TVoxelSharedPtr<FVoxelConvexCollisionData> ConvexCollisionData;
 };
\ No newline at end of file
@@ -42,6 +42,13 @@ public:
 		const FIntVector& ChunkPosition,
 		TArray<uint32>& OutIndices,
 		TArray<FVector>& OutVertices);
+	
+	static TUniquePtr<FVoxelMesherBase> GetMesher(
+		const FVoxelRendererSettings& Settings,
+		int32 LOD,
+		const FIntVector& ChunkPosition,
+		bool bIsTransitionTask,
+		uint8 TransitionsMask);
 
 private:
 	// Important: do not allow public delete
@@ -52,14 +59,6 @@ private:
 	virtual void PostDoWork() override final;
 	virtual uint32 GetPriority() const override final;
 	//~ End FVoxelAsyncWork Interface
-
-	static TUniquePtr<FVoxelMesherBase> GetMesher(
-		const FVoxelRendererSettings& Settings,
-		int32 LOD,
-		const FIntVector& ChunkPosition,
-		bool bIsTransitionTask,
-		uint8 TransitionsMask);
-	
 	
 	const TVoxelWeakPtr<FVoxelDefaultRenderer> Renderer;
 	const FVoxelPriorityHandler PriorityHandler;
@@ -14,6 +14,8 @@
 struct FKConvexElem;
 struct FVoxelProcMeshBuffers;
 struct FVoxelRendererSettings;
+struct FVoxelHeightfieldCollisionData;
+struct FVoxelConvexCollisionData;
 struct FMaterialRelevance;
 class FVoxelToolRenderingManager;
 class FDistanceFieldVolumeData;
@@ -25,6 +27,14 @@ class AVoxelWorld;
 class IVoxelPool;
 class IVoxelProceduralMeshComponent_PhysicsCallbackHandler;
 
+#if WITH_PHYSX && PHYSICS_INTERFACE_PHYSX
+namespace physx
+{
+	class PxHeightField;
+	class PxRigidStatic;
+}
+#endif
+
 DECLARE_VOXEL_MEMORY_STAT(TEXT("Voxel Physics Triangle Meshes Memory"), STAT_VoxelPhysicsTriangleMeshesMemory, STATGROUP_VoxelMemory, VOXEL_API);
 
 struct FVoxelProceduralMeshComponentMemoryUsage
@@ -118,6 +128,10 @@ private:
 
 public:
 	void SetDistanceFieldData(const TVoxelSharedPtr<const FDistanceFieldVolumeData>& InDistanceFieldData);
+	// Used instead of the sections collisions on the next collision update. Set to null to cook them
+	void SetHeightfieldCollisionData(const TVoxelSharedPtr<const FVoxelHeightfieldCollisionData>& InHeightfieldCollisionData);
+	// Used instead of decomposing the sections for the convex collisions on the next collision update
+	void SetConvexCollisionData(const TVoxelSharedPtr<const FVoxelConvexCollisionData>& InConvexCollisionData);
 	void SetProcMeshSection(int32 Index, FVoxelProcMeshSectionSettings Settings, TUniquePtr<FVoxelProcMeshBuffers> Buffers, EVoxelProcMeshSectionUpdate Update);
 	int32 AddProcMeshSection(FVoxelProcMeshSectionSettings Settings, TUniquePtr<FVoxelProcMeshBuffers> Buffers, EVoxelProcMeshSectionUpdate Update);
 	void ReplaceProcMeshSection(FVoxelProcMeshSectionSettings Settings, TUniquePtr<FVoxelProcMeshBuffers> Buffers, EVoxelProcMeshSectionUpdate Update);
@@ -152,8 +166,24 @@ public:
 	virtual bool DoCustomNavigableGeometryExport(FNavigableGeometryExport& GeomExport) const override final;
 	virtual FBoxSphereBounds CalcBounds(const FTransform& LocalToWorld) const override final;
 	virtual void OnComponentDestroyed(bool bDestroyingHierarchy) override;
+	virtual void SetPhysMaterialOverride(UPhysicalMaterial* NewPhysMaterial) override;
 	//~ End UPrimitiveComponent Interface.
 
+protected:
+	//~ Begin UPrimitiveComponent Interface.
+	virtual void OnComponentCollisionSettingsChanged() override;
+	//~ End UPrimitiveComponent Interface.
+
+	//~ Begin UActorComponent Interface.
+	virtual void OnCreatePhysicsState() override;
+	virtual void OnDestroyPhysicsState() override;
+	//~ End UActorComponent Interface.
+
+	//~ Begin USceneComponent Interface.
+	virtual void OnUpdateTransform(EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport = ETeleportType::None) override;
+	//~ End USceneComponent Interface.
+
+public:
 	FMaterialRelevance GetMaterialRelevance(ERHIFeatureLevel::Type InFeatureLevel) const;	
 	
 private:
@@ -169,6 +199,13 @@ private:
 		TArray<FKConvexElem>&& ConvexElements,
 		TArray<physx::PxConvexMesh*>&& ConvexMeshes,
 		bool bCanFail = false);
+
+	// Takes ownership of the heightfield
+	void SetCookedHeightfield(physx::PxHeightField* NewHeightfield, const TVoxelSharedPtr<const FVoxelHeightfieldCollisionData>& NewHeightfieldData);
+	void CreateHeightfieldActor();
+	void DestroyHeightfieldActor();
+	// The heightfield actor copies the collision settings & physical material when created, so it needs to be recreated when they change
+	void RecreateHeightfieldActor();
 #endif
 
 private:
@@ -195,6 +232,17 @@ private:
 	};
 	TArray<FVoxelProcMeshSection> ProcMeshSections;
 	TVoxelSharedPtr<const FDistanceFieldVolumeData> DistanceFieldData;
+	TVoxelSharedPtr<const FVoxelHeightfieldCollisionData> HeightfieldCollisionData;
+	TVoxelSharedPtr<const FVoxelConvexCollisionData> ConvexCollisionData;
+
+#if WITH_PHYSX && PHYSICS_INTERFACE_PHYSX
+	// Heightfield collisions don't go through the body setup: the heightfield has its own static actor
+	physx::PxHeightField* Heightfield = nullptr;
+	TVoxelSharedPtr<const FVoxelHeightfieldCollisionData> HeightfieldData;
+	physx::PxRigidStatic* HeightfieldActor = nullptr;
+	// Lets queries & hit events find this component from the heightfield actor
+	FBodyInstance HeightfieldBodyInstance;
+#endif
 
 	// Used to skip rebuilding collisions & navmesh
 	// GUID to detect geometry change
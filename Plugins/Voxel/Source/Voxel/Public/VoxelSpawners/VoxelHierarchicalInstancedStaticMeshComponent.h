@@ -30,6 +30,27 @@ struct FVoxelInstancesSection
 	TArray<int32> RemovedIndices;
 };
 
+// The cluster tree is shared with the scene proxy, so it can't be refitted in place:
+// instead a second tree is refitted and the two are swapped, see FVoxelHISMClusterTreeUtilities::RefitClustersDoubleBuffered
+struct FVoxelHISMDoubleBufferedClusterTree
+{
+	using FClusterTreePtr = TSharedPtr<TArray<FClusterNode>, ESPMode::ThreadSafe>;
+
+	// Previous tree, which is missing the refit of PendingBuiltIndices. Reused once the scene proxy released it
+	FClusterTreePtr BackTree;
+	TArray<int32> PendingBuiltIndices;
+
+	void Reset()
+	{
+		BackTree.Reset();
+		PendingBuiltIndices.Empty();
+	}
+	int64 GetAllocatedSize() const
+	{
+		return (BackTree.IsValid() ? BackTree->GetAllocatedSize() : 0) + PendingBuiltIndices.GetAllocatedSize();
+	}
+};
+
 // Need to prefix names with Voxel to avoid collisions with normal HISM
 UCLASS()
 class VOXEL_API UVoxelHierarchicalInstancedStaticMeshComponent : public UHierarchicalInstancedStaticMeshComponent
@@ -187,6 +208,11 @@ private:
 
 	// Unbuilt instances indices to clear when task finishes
 	TArray<int32> Voxel_UnbuiltInstancesToClear;
+
+	// Clusters of the current tree with no instance left, see FVoxelHISMClusterTreeUtilities::RefitClusters
+	TBitArray<> Voxel_EmptyClusterNodes;
+	// Previous cluster tree, reused by Voxel_RefitClusterTree once the scene proxy released it
+	FVoxelHISMDoubleBufferedClusterTree Voxel_DoubleBufferedClusterTree;
 	
 	uint64 Voxel_TaskUniqueId = 0;
 	TVoxelSharedPtr<FThreadSafeCounter> Voxel_TaskCancelCounterPtr;
@@ -207,6 +233,10 @@ private:
 	void Voxel_ScheduleBuildTree();
 	void Voxel_RemoveInstancesFromSections(const TArray<int32>& BuiltIndices);
 	void Voxel_SetInstancesScaleToZero(const TArray<int32>& BuiltIndices);
+	// Clear the built instances and refit the clusters containing them, without rebuilding the tree
+	void Voxel_ClearBuiltInstances(const TArray<int32>& BuiltIndices);
+	void Voxel_RefitClusterTree(const TArray<int32>& BuiltIndices);
+	bool Voxel_CanRemoveSectionIncrementally(int32 NumToRemove) const;
 	
 	// These 2 do not modify Voxel_InstanceBodies. Used by RefreshPhysics.
 	void Voxel_EnablePhysicsImpl(const FVoxelIntBox& Chunk, TArray<FBodyInstance*>& OutBodies) const;
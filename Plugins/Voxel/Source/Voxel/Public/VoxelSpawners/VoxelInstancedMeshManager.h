@@ -122,6 +122,11 @@ public:
 	
 	void RecomputeMeshPositions();
 
+	int64 GetNumInstances() const
+	{
+		return NumInstances;
+	}
+
 protected:
 	//~ Begin FVoxelTickable Interface
 	virtual void Tick(float DeltaTime) override;
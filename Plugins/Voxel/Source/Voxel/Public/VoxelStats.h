@@ -5,6 +5,7 @@
 #include "CoreMinimal.h"
 #include "Stats/Stats.h"
 #include "VoxelDefinitions.h"
+#include "VoxelTrace.h"
 
 DECLARE_STATS_GROUP(TEXT("Voxel"), STATGROUP_Voxel, STATCAT_Advanced);
 DECLARE_STATS_GROUP(TEXT("Voxel Slow"), STATGROUP_VoxelSlow, STATCAT_Advanced);
@@ -46,7 +47,7 @@ struct TStat_Voxel_Initializer
 #define VOXEL_SCOPE_COUNTER_STAT_CLASS_NAME(Suffix) PREPROCESSOR_JOIN(PREPROCESSOR_JOIN(FStat_Voxel_, __LINE__), Suffix)
 
 // We want to be able to use __FUNCTION__ as description, so it's a bit tricky
-#define VOXEL_SCOPE_COUNTER_IMPL_IMPL(StatGroup, Description) \
+#define VOXEL_STATS_SCOPE_COUNTER_IMPL(StatGroup, Description) \
 	struct VOXEL_SCOPE_COUNTER_STAT_CLASS_NAME(PREPROCESSOR_NOTHING) : FStat_Voxel_Base \
 	{ \
 		using TGroup = FStatGroup_##StatGroup; \
@@ -70,9 +71,13 @@ struct TStat_Voxel_Initializer
 	FScopeCycleCounter VOXEL_SCOPE_COUNTER_STAT_CLASS_NAME(_CycleCount)(VOXEL_SCOPE_COUNTER_STAT_CLASS_NAME(_Ptr.GetStatId()));
 
 #else
-#define VOXEL_SCOPE_COUNTER_IMPL_IMPL(StatGroup, Description)
+#define VOXEL_STATS_SCOPE_COUNTER_IMPL(StatGroup, Description)
 #endif
 
+#define VOXEL_SCOPE_COUNTER_IMPL_IMPL(StatGroup, Description) \
+	VOXEL_STATS_SCOPE_COUNTER_IMPL(StatGroup, Description) \
+	VOXEL_TRACE_SCOPE_IMPL(EVoxelTraceCategory::Scope, Description)
+
 VOXEL_API FString VoxelStats_RemoveLambdaFromFunctionName(const FString& FunctionName);
 
 #define VOXEL_INLINE_COUNTER_IMPL(Macro, Name, ...) ([&]() -> decltype(auto) { Macro(VoxelStats_RemoveLambdaFromFunctionName(__FUNCTION__) + TEXT(".") + Name); return __VA_ARGS__; }())
@@ -5,25 +5,102 @@
 #include "CoreMinimal.h"
 #include "HAL/PlatformAffinity.h"
 #include "HAL/ThreadSafeBool.h"
+#include "Containers/Queue.h"
 #include "VoxelMinimal.h"
+#include "IVoxelPool.h"
 #include <queue>
 
 class IVoxelQueuedWork;
 class FVoxelQueuedThread;
 
+struct VOXEL_API FVoxelTaskTypeStats
+{
+	// Bucket N holds the tasks that took between 2^(N-1) and 2^N microseconds. The last bucket holds everything above
+	static constexpr int32 NumBuckets = 24;
+
+	uint64 NumTasks = 0;
+	// In seconds
+	double TotalTime = 0;
+	double TotalQueueTime = 0;
+	uint64 TimeHistogram[NumBuckets] = {};
+	uint64 QueueTimeHistogram[NumBuckets] = {};
+
+	FORCEINLINE static int32 GetBucket(uint64 Cycles)
+	{
+		const uint64 Microseconds = uint64(Cycles * FPlatformTime::GetSecondsPerCycle64() * 1e6);
+		return Microseconds == 0 ? 0 : FMath::Min<int32>(FMath::FloorLog2_64(Microseconds) + 1, NumBuckets - 1);
+	}
+	// Upper bound of the percentile, in seconds
+	static double GetPercentile(const uint64 (&Histogram)[NumBuckets], uint64 Num, double Percentile);
+};
+
+/**
+ * Each pool thread writes to its own stats without any lock. They are only summed when read
+ */
 class VOXEL_API FVoxelQueuedThreadPoolStats
 {
+public:
+	static constexpr int32 NumTaskTypes = int32(EVoxelTaskType::RenderOctree) + 1;
+
+	// Only written by its thread
+	struct FThreadStats
+	{
+		struct FTaskTypeStats
+		{
+			TAtomic<uint64> NumTasks{ 0 };
+			TAtomic<uint64> Cycles{ 0 };
+			TAtomic<uint64> QueueCycles{ 0 };
+			TAtomic<uint64> TimeHistogram[FVoxelTaskTypeStats::NumBuckets];
+			TAtomic<uint64> QueueTimeHistogram[FVoxelTaskTypeStats::NumBuckets];
+
+			FTaskTypeStats();
+		};
+		FTaskTypeStats TaskTypes[NumTaskTypes];
+
+		FORCEINLINE void Report(EVoxelTaskType TaskType, uint64 QueueCycles, uint64 Cycles)
+		{
+			FTaskTypeStats& Stats = TaskTypes[uint8(TaskType)];
+			Increment(Stats.NumTasks, 1);
+			Increment(Stats.Cycles, Cycles);
+			Increment(Stats.QueueCycles, QueueCycles);
+			Increment(Stats.TimeHistogram[FVoxelTaskTypeStats::GetBucket(Cycles)], 1);
+			Increment(Stats.QueueTimeHistogram[FVoxelTaskTypeStats::GetBucket(QueueCycles)], 1);
+		}
+
+	private:
+		// Single writer: no need for an atomic add
+		FORCEINLINE static void Increment(TAtomic<uint64>& Value, uint64 Amount)
+		{
+			Value.Store(Value.Load(EMemoryOrder::Relaxed) + Amount, EMemoryOrder::Relaxed);
+		}
+	};
+
 public:
 	static FVoxelQueuedThreadPoolStats& Get();
 
-	void Report(FName Name, double Time);
+	FThreadStats* CreateThreadStats();
+	// Stats are kept in the totals
+	void DestroyThreadStats(FThreadStats* ThreadStats);
+
+	// Since the last reset
+	TArray<FVoxelTaskTypeStats> GetStats() const;
+	void Reset();
+	
 	void LogTimes() const;
 
 private:
 	FVoxelQueuedThreadPoolStats() = default;
-	
+
+	// Only used when creating/destroying threads & when reading
 	mutable FCriticalSection Section;
-	TMap<FName, double> Times;
+	TArray<TUniquePtr<FThreadStats>> AllThreadStats;
+	// Stats of the destroyed threads
+	TArray<FVoxelTaskTypeStats> DestroyedThreadsStats;
+	// Stats at the last reset
+	TArray<FVoxelTaskTypeStats> ResetStats;
+
+	TArray<FVoxelTaskTypeStats> GetTotalStats_AssumeLocked() const;
+	static void AddThreadStats(TArray<FVoxelTaskTypeStats>& Result, const FThreadStats& ThreadStats);
 };
 
 struct VOXEL_API FVoxelQueuedThreadPoolSettings
@@ -33,13 +110,28 @@ struct VOXEL_API FVoxelQueuedThreadPoolSettings
 	const uint32 StackSize;
 	const EThreadPriority ThreadPriority;
 	const bool bConstantPriorities;
+	// Indexed by EVoxelTaskType. Max number of tasks of that type running at the same time, 0 or missing for no limit
+	const TArray<int32> MaxConcurrentTasks;
+	// Indexed by EVoxelTaskType. Number of threads that will only run tasks of that type
+	// These threads are part of NumThreads. At least one thread is always left for all the tasks
+	const TArray<int32> NumReservedThreads;
+	// If >= 0, thread N is pinned to the core AffinityFirstCore + N. Only supported on Linux
+	const int32 AffinityFirstCore;
 
 	FVoxelQueuedThreadPoolSettings(
 		const FString& PoolName, 
 		uint32 NumThreads, 
 		uint32 StackSize, 
 		EThreadPriority ThreadPriority, 
-		bool bConstantPriorities);
+		bool bConstantPriorities,
+		const TArray<int32>& MaxConcurrentTasks = {},
+		const TArray<int32>& NumReservedThreads = {},
+		int32 AffinityFirstCore = -1);
+
+	FORCEINLINE int32 GetMaxConcurrentTasks(EVoxelTaskType TaskType) const
+	{
+		return MaxConcurrentTasks.IsValidIndex(int32(TaskType)) ? MaxConcurrentTasks[int32(TaskType)] : 0;
+	}
 };
 
 class VOXEL_API FVoxelQueuedThreadPool : public TVoxelSharedFromThis<FVoxelQueuedThreadPool>
@@ -52,9 +144,8 @@ public:
 
 	int32 GetNumPendingWorks() const
 	{
-		// Not really thread safe, only use this for debug
 		// Also count active threads
-		return (Settings.bConstantPriorities ? StaticQueuedWorks.size() : QueuedWorks.Num()) + GetNumThreads() - QueuedThreads.Num();
+		return NumQueuedWorks.Load() + GetNumThreads() - NumSleepingThreads.Load();
 	}
 	int32 GetNumThreads() const
 	{
@@ -63,20 +154,62 @@ public:
 	
 	// Final priority is 64 bits: PriorityCategory in upper bits, and GetPriority in lower bits
 	// Use PriorityCategory to make some type of tasks have a higher priority than other
-	void AddQueuedWork(IVoxelQueuedWork* InQueuedWork, uint32 PriorityCategory, int32 PriorityOffset);
-	void AddQueuedWorks(const TArray<IVoxelQueuedWork*>& InQueuedWorks, uint32 PriorityCategory, int32 PriorityOffset);
+	// TaskType is used for stats, Settings.MaxConcurrentTasks & Settings.NumReservedThreads
+	// Can be called from any thread, including from the pool threads: the works are added to a lock free queue,
+	// and a lock is only taken if threads need to be woken up
+	void AddQueuedWork(IVoxelQueuedWork* InQueuedWork, uint32 PriorityCategory, int32 PriorityOffset, EVoxelTaskType TaskType);
+	void AddQueuedWorks(const TArray<IVoxelQueuedWork*>& InQueuedWorks, uint32 PriorityCategory, int32 PriorityOffset, EVoxelTaskType TaskType);
 
-	IVoxelQueuedWork* ReturnToPoolOrGetNextJob(FVoxelQueuedThread* InQueuedThread);
+	// OutQueueCycles: time the work spent in the queue
+	// Spins for voxel.threading.SpinTime before returning the thread to the pool
+	IVoxelQueuedWork* ReturnToPoolOrGetNextJob(FVoxelQueuedThread* InQueuedThread, EVoxelTaskType& OutTaskType, uint64& OutQueueCycles);
+	// Must be called by the pool threads once a work returned by ReturnToPoolOrGetNextJob is done
+	void OnWorkDone(EVoxelTaskType TaskType);
 
 	void AbandonAllTasks();
 
+	// Removes a work that is still waiting in its pool queue, in constant time
+	// The work must not be done or abandoned yet, and Abandon/DoThreadedWork will never be called on it if this returns true
+	static bool RetractQueuedWork(IVoxelQueuedWork& Work);
+
+	// Forces all the queued works to recompute their priorities the next time a work is picked, eg after a teleport
+	// No effect on pools with constant priorities
+	void InvalidatePriorities()
+	{
+		PrioritiesEpoch++;
+	}
+
 private:
 	explicit FVoxelQueuedThreadPool(const FVoxelQueuedThreadPoolSettings& Settings);
 
 	const TArray<TUniquePtr<FVoxelQueuedThread>> AllThreads;
 
+	// Protects QueuedWorks, StaticQueuedWorks & StaticWorkSlots, and the consumer side of PendingWorks
 	FCriticalSection Section;
+
+	// Protects QueuedThreads & NumSpinningThreads
+	FCriticalSection ThreadsSection;
+	// Threads waiting on their DoWorkEvent. They're removed from this list when triggered
 	TArray<FVoxelQueuedThread*> QueuedThreads;
+	// Threads looking for work before being added to QueuedThreads
+	int32 NumSpinningThreads = 0;
+	
+	// QueuedThreads.Num(), readable without lock
+	TAtomic<int32> NumSleepingThreads{ 0 };
+	// Works in PendingWorks, QueuedWorks & StaticQueuedWorks
+	// Incremented after adding to PendingWorks, so can briefly be negative
+	TAtomic<int32> NumQueuedWorks{ 0 };
+	// Incremented after NumQueuedWorks, and when a task type gets below its MaxConcurrentTasks
+	// Threads only go to sleep if it didn't change since they last looked for work, as the queued works might not be runnable by them
+	TAtomic<uint32> QueueVersion{ 0 };
+	// Works dequeued but not done yet, per task type. Only used for task types with a MaxConcurrentTasks
+	TAtomic<int32> NumRunningTasks[FVoxelQueuedThreadPoolStats::NumTaskTypes];
+
+	IVoxelQueuedWork* GetNextJob(const FVoxelQueuedThread& Thread, EVoxelTaskType& OutTaskType, uint64& OutQueueCycles);
+	void MovePendingWorks_AssumeLocked();
+	void WakeUpThreads(int32 NumNewWorks, EVoxelTaskType TaskType);
+	bool CanRunTask(const FVoxelQueuedThread& Thread, EVoxelTaskType TaskType) const;
+	void OnWorkDequeued_AssumeLocked(EVoxelTaskType TaskType);
 
 	struct FQueuedWorkInfo
 	{
@@ -85,21 +218,33 @@ private:
 		uint32 PriorityCategory;
 		uint32 Priority;
 		int32 PriorityOffset;
+		EVoxelTaskType TaskType;
+		uint64 QueuedCycles;
+		// Value of PrioritiesEpoch when Priority was computed
+		uint32 PriorityEpoch;
+		// Index in StaticWorkSlots, only used with constant priorities
+		int32 StaticSlot;
 
 		FQueuedWorkInfo() = default;
 		FQueuedWorkInfo(
 			IVoxelQueuedWork* Work,
 			uint32 PriorityCategory,
-			int32 PriorityOffset)
+			int32 PriorityOffset,
+			EVoxelTaskType TaskType,
+			uint64 QueuedCycles)
 			: Work(Work)
 			, NextPriorityUpdateTime(0)
 			, PriorityCategory(PriorityCategory)
 			, Priority(0)
 			, PriorityOffset(PriorityOffset)
+			, TaskType(TaskType)
+			, QueuedCycles(QueuedCycles)
+			, PriorityEpoch(0)
+			, StaticSlot(-1)
 		{
 		}
 
-		void RecomputePriority(double Time);
+		void RecomputePriority(double Time, uint32 Epoch);
 
 		FORCEINLINE uint64 GetPriority() const
 		{
@@ -110,8 +255,23 @@ private:
 			return GetPriority() < Other.GetPriority();
 		}
 	};
+	// Filled by AddQueuedWork(s) from any thread, emptied in GetNextJob
+	TQueue<FQueuedWorkInfo, EQueueMode::Mpsc> PendingWorks;
+	// IVoxelQueuedWork::QueueIndex is the index in this array
 	TArray<FQueuedWorkInfo> QueuedWorks;
-	std::priority_queue<FQueuedWorkInfo> StaticQueuedWorks;
+	// One queue per task type, so that the best runnable work can be found when some task types can't run
+	std::priority_queue<FQueuedWorkInfo> StaticQueuedWorks[FVoxelQueuedThreadPoolStats::NumTaskTypes];
+	// Works in StaticQueuedWorks, IVoxelQueuedWork::QueueIndex is the index in this array
+	// Retracted works are set to null and stay in their queue until they reach its top, as priority queues can't remove an arbitrary element
+	// Slots are only freed once their queue entry is popped, so that they can't be reused by another work before that
+	TArray<IVoxelQueuedWork*> StaticWorkSlots;
+	TArray<int32> FreeStaticWorkSlots;
 	
 	FThreadSafeBool TimeToDie = false;
+	TAtomic<uint32> PrioritiesEpoch{ 0 };
+
+	void RemoveQueuedWork_AssumeLocked(int32 Index);
+	int32 AllocateStaticWorkSlot_AssumeLocked(IVoxelQueuedWork* Work);
+	// Pops the retracted works at the top of the queue
+	void PopRetractedStaticWorks_AssumeLocked(std::priority_queue<FQueuedWorkInfo>& Queue);
 };
\ No newline at end of file
@@ -424,11 +424,15 @@ public:
 	 * CreateWorldVoxelThreadPool is preferred, as pools will be per level
 	 * @param	NumberOfThreads		At least 1
 	 * @param	bConstantPriorities	If true won't recompute the tasks priorities once added. Useful if you have many tasks, but will give bad task scheduling when moving fast
+	 * @param	MaxConcurrentTasks	Max number of tasks of a type running at the same time, 0 or not set for no limit
+	 * @param	ReservedThreads		Number of threads only running tasks of a type. They are part of NumberOfThreads
 	 */
-	UFUNCTION(BlueprintCallable, Category = "Voxel|Threads", meta = (AdvancedDisplay = "PriorityCategoriesOverrides, PriorityOffsetsOverrides"))
+	UFUNCTION(BlueprintCallable, Category = "Voxel|Threads", meta = (AdvancedDisplay = "PriorityCategoriesOverrides, PriorityOffsetsOverrides, MaxConcurrentTasks, ReservedThreads"))
 	static void CreateGlobalVoxelThreadPool(
 		const TMap<EVoxelTaskType, int32>& PriorityCategoriesOverrides,
 		const TMap<EVoxelTaskType, int32>& PriorityOffsetsOverrides,
+		const TMap<EVoxelTaskType, int32>& MaxConcurrentTasks,
+		const TMap<EVoxelTaskType, int32>& ReservedThreads,
 		int32 NumberOfThreads = 2,
 		bool bConstantPriorities = false);
 
@@ -444,12 +448,16 @@ public:
 	 * Create the voxel thread pool for a specific world. Must not be already created.
 	 * @param	NumberOfThreads		At least 1
 	 * @param	bConstantPriorities	If true won't recompute the tasks priorities once added. Useful if you have many tasks, but will give bad task scheduling when moving fast
+	 * @param	MaxConcurrentTasks	Max number of tasks of a type running at the same time, 0 or not set for no limit
+	 * @param	ReservedThreads		Number of threads only running tasks of a type. They are part of NumberOfThreads
 	 */
-	UFUNCTION(BlueprintCallable, Category = "Voxel|Threads", meta = (AdvancedDisplay = "PriorityCategoriesOverrides, PriorityOffsetsOverrides"))
+	UFUNCTION(BlueprintCallable, Category = "Voxel|Threads", meta = (AdvancedDisplay = "PriorityCategoriesOverrides, PriorityOffsetsOverrides, MaxConcurrentTasks, ReservedThreads"))
 	static void CreateWorldVoxelThreadPool(
 		UWorld* World,
 		const TMap<EVoxelTaskType, int32>& PriorityCategoriesOverrides,
 		const TMap<EVoxelTaskType, int32>& PriorityOffsetsOverrides,
+		const TMap<EVoxelTaskType, int32>& MaxConcurrentTasks,
+		const TMap<EVoxelTaskType, int32>& ReservedThreads,
 		int32 NumberOfThreads = 2,
 		bool bConstantPriorities = false);
 
@@ -0,0 +1,88 @@
+// Copyright 2020 Phyronnaz
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VoxelDefinitions.h"
+
+enum class EVoxelTraceCategory : uint8
+{
+	Scope,
+	Task,
+	Lock,
+	Mesher
+};
+
+struct FVoxelTraceEvent
+{
+	FName Name;
+	uint64 StartCycles = 0;
+	uint64 EndCycles = 0;
+	EVoxelTraceCategory Category = EVoxelTraceCategory::Scope;
+};
+
+/**
+ * Low overhead event recorder: each thread records its events in its own ring buffer, without any lock
+ * The events can then be dumped as a Chrome trace JSON, to be opened in chrome://tracing or ui.perfetto.dev
+ * Works without the UE stats system, eg on headless servers
+ */
+class VOXEL_API FVoxelTrace
+{
+public:
+	FORCEINLINE static bool IsRecording()
+	{
+		return bIsRecording.Load(EMemoryOrder::Relaxed);
+	}
+
+	// Clears the previous events
+	static void StartRecording();
+	static void StopRecording();
+
+	static void Record(FName Name, EVoxelTraceCategory Category, uint64 StartCycles, uint64 EndCycles);
+
+	// Recording is paused while dumping
+	static bool DumpChromeTrace(const FString& Path);
+	static FString GetDefaultDumpPath();
+
+	static FName MakeName(const FString& Name);
+
+private:
+	static TAtomic<bool> bIsRecording;
+};
+
+struct FVoxelTraceScope
+{
+	FORCEINLINE explicit FVoxelTraceScope(FName Name, EVoxelTraceCategory Category = EVoxelTraceCategory::Scope)
+		: StartCycles(FVoxelTrace::IsRecording() ? FPlatformTime::Cycles64() : 0)
+		, Name(Name)
+		, Category(Category)
+	{
+	}
+	FORCEINLINE ~FVoxelTraceScope()
+	{
+		if (StartCycles != 0 && FVoxelTrace::IsRecording())
+		{
+			FVoxelTrace::Record(Name, Category, StartCycles, FPlatformTime::Cycles64());
+		}
+	}
+
+private:
+	const uint64 StartCycles;
+	const FName Name;
+	const EVoxelTraceCategory Category;
+};
+
+#if VOXEL_ENABLE_TRACE
+#define VOXEL_TRACE_SCOPE_IMPL(Category, Description) \
+	static const FName PREPROCESSOR_JOIN(VoxelTraceName_, __LINE__) = FVoxelTrace::MakeName(Description); \
+	FVoxelTraceScope PREPROCESSOR_JOIN(VoxelTraceScope_, __LINE__)(PREPROCESSOR_JOIN(VoxelTraceName_, __LINE__), Category);
+
+// Name is computed once
+#define VOXEL_TRACE_SCOPE(Category, Description) VOXEL_TRACE_SCOPE_IMPL(EVoxelTraceCategory::Category, Description)
+// Name can change
+#define VOXEL_TRACE_DYNAMIC_SCOPE(Category, Name) FVoxelTraceScope PREPROCESSOR_JOIN(VoxelTraceScope_, __LINE__)(Name, EVoxelTraceCategory::Category);
+#else
+#define VOXEL_TRACE_SCOPE_IMPL(Category, Description)
+#define VOXEL_TRACE_SCOPE(Category, Description)
+#define VOXEL_TRACE_DYNAMIC_SCOPE(Category, Name)
+#endif
@@ -0,0 +1,30 @@
+// Copyright 2020 Phyronnaz
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct VOXEL_API FVoxelConvexDecompositionUtilities
+{
+public:
+	/**
+	 * Approximate the solid part of a grid by a few convex pieces
+	 * The grid is downsampled to Resolution cells per axis, the solid cells are merged into boxes,
+	 * and then neighboring boxes are merged as long as their bounds don't have more than MaxEmptyRatio of empty cells
+	 *
+	 * @param	NumCells		Number of cells per axis. Must be a multiple of Resolution
+	 * @param	SolidSamples	(NumCells + 1)^3 samples, X first, true if inside the surface
+	 * @param	Resolution		Number of cells per axis after downsampling
+	 * @param	MaxEmptyRatio	Between 0 and 1. Higher = fewer pieces, but a worse fit
+	 * @param	OutConvexes		Vertices of each piece, with the samples as unit
+	 */
+	static void DecomposeSolidSamples(
+		int32 NumCells,
+		const TArray<bool>& SolidSamples,
+		int32 Resolution,
+		float MaxEmptyRatio,
+		TArray<TArray<FVector>>& OutConvexes);
+
+	// Largest resolution <= WantedResolution that divides NumCells
+	static int32 GetResolution(int32 NumCells, int32 WantedResolution);
+};
@@ -22,7 +22,14 @@ public:
 	static FColor GetDistanceFieldColor(float Value);
 
 public:
-	static void JumpFlood(const FIntVector& Size, TArray<FVector>& InOutPackedPositions, EVoxelComputeDevice Device, bool bMultiThreaded = false, int32 MaxPasses_Debug = -1);
+	// OnProgress is called on the calling thread after each pass with a value between 0 and 1
+	static void JumpFlood(
+		const FIntVector& Size, 
+		TArray<FVector>& InOutPackedPositions, 
+		EVoxelComputeDevice Device, 
+		bool bMultiThreaded = false, 
+		int32 MaxPasses_Debug = -1,
+		const TFunction<void(float Progress)>& OnProgress = nullptr);
 	// Only the InOutDistances sign will be used, not their actual values
 	static void GetDistancesFromSurfacePositions(const FIntVector& Size, TArrayView<const FVector> SurfacePositions, TArrayView<float> InOutDistances);
 	
@@ -53,15 +60,24 @@ public:
 		TArrayView<float> OutDistances, 
 		TArrayView<FVector> OutSurfacePositions,
 		int32 Divisor,
-		bool bShrink);
+		bool bShrink,
+		bool bMultiThreaded = false);
 	
 	static void DownSample(
 		FIntVector& Size, 
 		TArray<float>& Distances, 
 		TArray<FVector>& SurfacePositions,
 		int32 Divisor,
-		bool bShrink);
+		bool bShrink,
+		bool bMultiThreaded = false);
 
 private:
-	static void JumpFloodStep_CPU(const FIntVector& Size, TArrayView<const FVector> InData, TArrayView<FVector> OutData, int32 Step, bool bMultiThreaded);
+	// Structure of arrays, so that whole rows can be processed with SIMD
+	struct FJumpFloodBuffer
+	{
+		TArray<float> X;
+		TArray<float> Y;
+		TArray<float> Z;
+	};
+	static void JumpFloodStep_CPU(const FIntVector& Size, const FJumpFloodBuffer& InData, FJumpFloodBuffer& OutData, int32 Step, bool bMultiThreaded);
 };
\ No newline at end of file
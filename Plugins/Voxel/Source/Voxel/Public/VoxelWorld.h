@@ -556,6 +556,21 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, AdvancedDisplay, Category = "Voxel - Performance", meta = (Recreate, EditCondition = "bCreateGlobalPool"))
 	TMap<EVoxelTaskType, int32> PriorityOffsets;
 
+	// Max number of tasks of a type that can run at the same time, eg to keep bursts of foliage tasks from using all the threads
+	// Not set or 0: no limit
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, AdvancedDisplay, Category = "Voxel - Performance", meta = (Recreate, EditCondition = "bCreateGlobalPool"))
+	TMap<EVoxelTaskType, int32> MaxConcurrentTasks;
+
+	// Number of threads that will only run tasks of a type, eg to always have a thread available for visible chunks meshing
+	// These threads are part of NumberOfThreads, and at least one thread is always left to run any task
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, AdvancedDisplay, Category = "Voxel - Performance", meta = (Recreate, EditCondition = "bCreateGlobalPool"))
+	TMap<EVoxelTaskType, int32> ReservedThreads;
+
+	// If not -1, each voxel thread is pinned to its own core, starting from this one
+	// Only supported on Linux, eg for dedicated servers
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, AdvancedDisplay, Category = "Voxel - Performance", meta = (Recreate, ClampMin = -1, EditCondition = "bCreateGlobalPool"))
+	int32 ThreadsFirstCore = -1;
+
 	// If true, won't recompute task priorities once they are queued
 	// If false, will recompute task priorities with the new voxel invoker positions every PriorityDuration seconds
 	// True: useful if you have many tasks
@@ -0,0 +1,212 @@
+// Copyright 2020 Phyronnaz
+
+#include "Commandlets/VoxelBenchmarkCommandlet.h"
+#include "VoxelDebug/VoxelBenchmark.h"
+#include "VoxelGenerators/VoxelGenerator.h"
+#include "VoxelGenerators/VoxelFlatGenerator.h"
+#include "VoxelSpawners/VoxelSpawnerConfig.h"
+#include "VoxelMinimal.h"
+
+#include "AssetRegistryModule.h"
+#include "Misc/FileHelper.h"
+#include "UObject/UObjectIterator.h"
+
+UVoxelBenchmarkCommandlet::UVoxelBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+inline TArray<FVoxelGeneratorPicker> GetDefaultBenchmarkGenerators()
+{
+	TArray<FVoxelGeneratorPicker> Generators;
+	Generators.Add(UVoxelFlatGenerator::StaticClass());
+	
+	// C++ examples, eg VoxelExamples
+	for (TObjectIterator<UClass> It; It; ++It)
+	{
+		UClass* Class = *It;
+		if (Class->IsChildOf(UVoxelGenerator::StaticClass()) && 
+			!Class->HasAnyClassFlags(CLASS_Abstract | CLASS_Deprecated) &&
+			Class->GetOutermost()->GetName().EndsWith(TEXT("VoxelExamples")))
+		{
+			Generators.Add(Class);
+		}
+	}
+
+	// Graph examples bundled with the plugin
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry")).Get();
+	AssetRegistry.SearchAllAssets(true);
+	
+	FARFilter Filter;
+	Filter.PackagePaths.Add(TEXT("/Voxel/Examples"));
+	Filter.bRecursivePaths = true;
+	Filter.ClassNames.Add(UVoxelGenerator::StaticClass()->GetFName());
+	Filter.bRecursiveClasses = true;
+
+	TArray<FAssetData> Assets;
+	AssetRegistry.GetAssets(Filter, Assets);
+	Assets.Sort([](const FAssetData& A, const FAssetData& B) { return A.ObjectPath.LexicalLess(B.ObjectPath); });
+	
+	for (auto& Asset : Assets)
+	{
+		if (auto* Generator = Cast<UVoxelGenerator>(Asset.GetAsset()))
+		{
+			Generators.Add(Generator);
+		}
+	}
+
+	return Generators;
+}
+
+inline FVoxelGeneratorPicker FindBenchmarkGenerator(const FString& Name)
+{
+	if (UClass* Class = FindObject<UClass>(ANY_PACKAGE, *Name))
+	{
+		return Class;
+	}
+	return LoadObject<UVoxelGenerator>(nullptr, *Name);
+}
+
+int32 UVoxelBenchmarkCommandlet::Main(const FString& Params)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	FVoxelBenchmarkSettings BaseSettings;
+	
+	int32 Size = 0;
+	if (FParse::Value(*Params, TEXT("Size="), Size))
+	{
+		Size = FMath::Max(Size, RENDER_CHUNK_SIZE);
+		BaseSettings.Bounds = FVoxelIntBox(-Size / 2, Size / 2);
+	}
+	FParse::Value(*Params, TEXT("VoxelSize="), BaseSettings.VoxelSize);
+	FParse::Value(*Params, TEXT("SpawnerTimeout="), BaseSettings.SpawnerTimeout);
+	BaseSettings.bSingleThread = FParse::Param(*Params, TEXT("SingleThread"));
+	BaseSettings.bCookCollisions = !FParse::Param(*Params, TEXT("NoCollisions"));
+
+	FString LODs;
+	if (FParse::Value(*Params, TEXT("LODs="), LODs, false))
+	{
+		TArray<FString> LODStrings;
+		LODs.ParseIntoArray(LODStrings, TEXT(","));
+		BaseSettings.LODs.Reset();
+		for (auto& LOD : LODStrings)
+		{
+			BaseSettings.LODs.Add(FCString::Atoi(*LOD));
+		}
+	}
+
+	FString RenderTypes;
+	if (FParse::Value(*Params, TEXT("RenderTypes="), RenderTypes, false))
+	{
+		const UEnum* Enum = StaticEnum<EVoxelRenderType>();
+		
+		TArray<FString> RenderTypeStrings;
+		RenderTypes.ParseIntoArray(RenderTypeStrings, TEXT(","));
+		BaseSettings.RenderTypes.Reset();
+		for (auto& RenderType : RenderTypeStrings)
+		{
+			const int64 Value = Enum->GetValueByNameString(RenderType);
+			if (Value == INDEX_NONE)
+			{
+				LOG_VOXEL(Error, TEXT("VOXEL BENCHMARK: Invalid render type: %s"), *RenderType);
+				return 1;
+			}
+			BaseSettings.RenderTypes.Add(EVoxelRenderType(Value));
+		}
+	}
+
+	FString SpawnerConfig;
+	if (FParse::Value(*Params, TEXT("SpawnerConfig="), SpawnerConfig))
+	{
+		BaseSettings.SpawnerConfig = LoadObject<UVoxelSpawnerConfig>(nullptr, *SpawnerConfig);
+		if (!BaseSettings.SpawnerConfig)
+		{
+			LOG_VOXEL(Error, TEXT("VOXEL BENCHMARK: Invalid spawner config: %s"), *SpawnerConfig);
+			return 1;
+		}
+		BaseSettings.SpawnerConfig->AddToRoot();
+	}
+
+	TArray<FVoxelGeneratorPicker> Generators;
+	TArray<FString> InvalidGenerators;
+	
+	FString GeneratorNames;
+	if (FParse::Value(*Params, TEXT("Generators="), GeneratorNames, false))
+	{
+		TArray<FString> Names;
+		GeneratorNames.ParseIntoArray(Names, TEXT(","));
+		for (auto& Name : Names)
+		{
+			const FVoxelGeneratorPicker Generator = FindBenchmarkGenerator(Name);
+			if (Generator.IsValid())
+			{
+				Generators.Add(Generator);
+			}
+			else
+			{
+				InvalidGenerators.Add(Name);
+			}
+		}
+	}
+	else
+	{
+		Generators = GetDefaultBenchmarkGenerators();
+	}
+
+	// Keep the generators alive in case a GC happens while benchmarking
+	for (auto& Generator : Generators)
+	{
+		Generator.GetObject()->AddToRoot();
+	}
+
+	TArray<FVoxelBenchmarkResult> Results;
+	for (auto& Name : InvalidGenerators)
+	{
+		FVoxelBenchmarkResult& Result = Results.Emplace_GetRef();
+		Result.Name = Name;
+		Result.bSuccess = false;
+		Result.Error = TEXT("Generator not found");
+	}
+	for (auto& Generator : Generators)
+	{
+		FVoxelBenchmarkSettings Settings = BaseSettings;
+		Settings.Generator = Generator;
+		Results.Add(FVoxelBenchmark::Run(Settings));
+	}
+
+	for (auto& Generator : Generators)
+	{
+		Generator.GetObject()->RemoveFromRoot();
+	}
+	if (BaseSettings.SpawnerConfig)
+	{
+		BaseSettings.SpawnerConfig->RemoveFromRoot();
+	}
+
+	FString Output;
+	if (!FParse::Value(*Params, TEXT("Output="), Output))
+	{
+		Output = FVoxelBenchmark::GetDefaultOutputPath();
+	}
+	if (!FFileHelper::SaveStringToFile(FVoxelBenchmark::ToJson(Results), *Output))
+	{
+		LOG_VOXEL(Error, TEXT("VOXEL BENCHMARK: Failed to write results to %s"), *Output);
+		return 1;
+	}
+	LOG_VOXEL(Log, TEXT("VOXEL BENCHMARK: Results written to %s"), *Output);
+
+	int32 NumFailed = 0;
+	for (auto& Result : Results)
+	{
+		if (!Result.bSuccess)
+		{
+			LOG_VOXEL(Error, TEXT("VOXEL BENCHMARK: %s failed: %s"), *Result.Name, *Result.Error);
+			NumFailed++;
+		}
+	}
+	return NumFailed > 0 ? 1 : 0;
+}
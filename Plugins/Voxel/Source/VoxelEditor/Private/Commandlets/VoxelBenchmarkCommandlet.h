@@ -0,0 +1,33 @@
+// Copyright 2020 Phyronnaz
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "VoxelBenchmarkCommandlet.generated.h"
+
+/**
+ * Headless voxel benchmark, to catch performance regressions on CPU-only machines
+ * For each generator: creates the data, generates & meshes a fixed region at several LODs with each mesher, cooks collisions and optionally spawns foliage
+ * Timings & memory are written as JSON
+ *
+ * Usage: UE4Editor-Cmd Project.uproject -run=VoxelBenchmark -nullrhi -unattended
+ *	-Generators=/Voxel/Examples/VoxelGraphs/Dunes/VG_Example_Dunes,VoxelFlatGenerator (defaults to the examples & the native generators)
+ *	-Size=256 -LODs=0,1,2 -RenderTypes=MarchingCubes,Cubic,SurfaceNets
+ *	-SpawnerConfig=/Game/MySpawnerConfig -SingleThread -NoCollisions
+ *	-Output=Path.json (defaults to Saved/Profiling/VoxelBenchmark-Date.json)
+ *
+ * Returns 1 if a benchmark failed
+ */
+UCLASS()
+class UVoxelBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UVoxelBenchmarkCommandlet();
+
+	//~ Begin UCommandlet Interface
+	virtual int32 Main(const FString& Params) override;
+	//~ End UCommandlet Interface
+};
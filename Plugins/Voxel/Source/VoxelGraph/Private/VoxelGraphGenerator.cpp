@@ -85,6 +85,12 @@ TArray<FVoxelGraphPermutationArray> UVoxelGraphGenerator::GetPermutations() cons
 				Result.Add(NewRangeElement);
 			}
 		}
+
+		FVoxelGraphPermutationArray GradientPermutation;
+		if (FVoxelGraphOutputsUtils::GetGradientPermutation(GetOutputs(), GradientPermutation))
+		{
+			Result.Add(GradientPermutation);
+		}
 	}
 	return Result;
 }
@@ -120,7 +120,26 @@ FVoxelGraphGeneratorInstance::FVoxelGraphGeneratorInstance(
 	, Generator(&Generator)
 	, Graphs(Graphs)
 {
+	static const FName GradientNames[] = { "GradientX", "GradientY", "GradientZ" };
 
+	FVoxelGraphPermutationArray GradientPermutation;
+	for (int32 Axis = 0; Axis < 3; Axis++)
+	{
+		const uint32* Index = FloatOutputs.Find(GradientNames[Axis]);
+		if (!Index)
+		{
+			return;
+		}
+		GradientIndices[Axis] = *Index;
+		GradientPermutation.Add(*Index);
+	}
+	GradientPermutation.Sort();
+
+	// Can be missing if the graph was compiled before the gradient outputs were added
+	if (auto* Graph = Graphs->GetGraphsMap().Find(GradientPermutation))
+	{
+		GradientGraph = *Graph;
+	}
 }
 
 FVoxelGraphGeneratorInstance::~FVoxelGraphGeneratorInstance()
@@ -159,6 +178,33 @@ void FVoxelGraphGeneratorInstance::InitGraph(const FVoxelGeneratorInit& InitStru
 	}
 }
 
+bool FVoxelGraphGeneratorInstance::GetGradient(v_flt X, v_flt Y, v_flt Z, int32 LOD, const FVoxelItemStack& Items, FVector& OutGradient) const
+{
+	if (!GradientGraph.IsValid())
+	{
+		return false;
+	}
+
+	// Gradient outputs are floats, no need to init the material builder
+	const FTarget Target{ *GradientGraph, FVoxelGraphVMComputeBuffers(GetVariablesBuffer(GradientGraph)) };
+	auto Outputs = Target.GetOutputs();
+	for (const uint32 Index : GradientIndices)
+	{
+		Outputs.GraphOutputs->Buffer[Index].Get<v_flt>() = 0;
+	}
+
+	FVoxelContext Context(LOD, Items, FTransform::Identity, false);
+	Context.UpdateCoordinates<false>(X, Y, Z);
+	Target.ComputeXYZWithoutCache(Context, Outputs);
+
+	OutGradient = FVector(
+		Outputs.GraphOutputs->Buffer[GradientIndices[0]].Get<v_flt>(),
+		Outputs.GraphOutputs->Buffer[GradientIndices[1]].Get<v_flt>(),
+		Outputs.GraphOutputs->Buffer[GradientIndices[2]].Get<v_flt>());
+
+	return !OutGradient.IsNearlyZero();
+}
+
 FVoxelNodeType* FVoxelGraphGeneratorInstance::GetVariablesBuffer(const TVoxelWeakPtr<const FVoxelGraph>& Graph) const
 {
 	auto& BuffersMap = FThreadVariables::Get();
@@ -79,4 +79,29 @@ TMap<FName, uint32> FVoxelGraphOutputsUtils::GetSingleOutputsNamesMap(
 bool FVoxelGraphOutputsUtils::IsVoxelGraphOutputHidden(int32 Index)
 {
 	return Index == FVoxelGraphOutputsIndices::RangeAnalysisIndex;
+}
+
+bool FVoxelGraphOutputsUtils::GetGradientPermutation(const TMap<uint32, FVoxelGraphOutput>& Outputs, FVoxelGraphPermutationArray& OutPermutation)
+{
+	static const FName Names[] = { "GradientX", "GradientY", "GradientZ" };
+
+	OutPermutation.Reset();
+	for (const FName Name : Names)
+	{
+		for (auto& It : Outputs)
+		{
+			if (It.Value.Name == Name && It.Value.Category == EVoxelDataPinCategory::Float)
+			{
+				OutPermutation.Add(It.Key);
+				break;
+			}
+		}
+	}
+	if (OutPermutation.Num() != 3)
+	{
+		OutPermutation.Reset();
+		return false;
+	}
+	OutPermutation.Sort();
+	return true;
 }
\ No newline at end of file
@@ -137,6 +137,10 @@ public:
 	}
 	//~ End TVoxelGraphGeneratorInstanceHelper Interface
 
+	//~ Begin FVoxelGeneratorInstance Interface
+	virtual bool GetGradient(v_flt X, v_flt Y, v_flt Z, int32 LOD, const FVoxelItemStack& Items, FVector& OutGradient) const override;
+	//~ End FVoxelGeneratorInstance Interface
+
 	inline UVoxelGraphGenerator* GetOwner() const
 	{
 		return Generator.Get();
@@ -157,6 +161,10 @@ private:
 	const TWeakObjectPtr<UVoxelGraphGenerator> Generator;
 	const TVoxelSharedRef<FVoxelCompiledGraphs> Graphs;
 
+	// Graph computing the GradientX, GradientY and GradientZ outputs, if the generator has them
+	TVoxelSharedPtr<const FVoxelGraph> GradientGraph;
+	uint32 GradientIndices[3] = {};
+
 	TMap<TVoxelWeakPtr<const FVoxelGraph>, TArray<FVoxelNodeType>> Variables;
 	TMap<TVoxelWeakPtr<const FVoxelGraph>, TArray<FVoxelNodeRangeType>> RangeVariables;
 
@@ -54,4 +54,8 @@ namespace FVoxelGraphOutputsUtils
 		const TMap<uint32, FVoxelGraphOutput>& Outputs,
 		EVoxelDataPinCategory CategoryFilter);
 	VOXELGRAPH_API bool IsVoxelGraphOutputHidden(int32 Index);
+	
+	// If the graph has the float outputs GradientX, GradientY and GradientZ, they are computed together
+	// and used as the analytic gradient of Value for gradient normals. See FVoxelGeneratorInstance::GetGradient
+	VOXELGRAPH_API bool GetGradientPermutation(const TMap<uint32, FVoxelGraphOutput>& Outputs, FVoxelGraphPermutationArray& OutPermutation);
 }
\ No newline at end of file
@@ -45,18 +45,18 @@ class VOXELGRAPH_API UVoxelNode_2DPerlinNoiseFractal : public UVoxelNode_NoiseNo
 
 // 2D Simplex Noise
 UCLASS(DisplayName = "2D Simplex Noise", Category = "Noise|Simplex Noise")
-class VOXELGRAPH_API UVoxelNode_2DSimplexNoise : public UVoxelNode_NoiseNode
+class VOXELGRAPH_API UVoxelNode_2DSimplexNoise : public UVoxelNode_NoiseNodeWithDerivative
 {
 	GENERATED_BODY()
-	GENERATED_NOISENODE_BODY_DIM2(GetSimplex)
+	GENERATED_NOISENODE_BODY_DERIVATIVE_DIM2(GetSimplex)
 };
 
 // 2D Simplex Noise Fractal
 UCLASS(DisplayName = "2D Simplex Noise Fractal", Category = "Noise|Simplex Noise")
-class VOXELGRAPH_API UVoxelNode_2DSimplexNoiseFractal : public UVoxelNode_NoiseNodeFractal
+class VOXELGRAPH_API UVoxelNode_2DSimplexNoiseFractal : public UVoxelNode_NoiseNodeWithDerivativeFractal
 {
 	GENERATED_BODY()
-	GENERATED_NOISENODE_BODY_FRACTAL_DIM2(GetSimplexFractal)
+	GENERATED_NOISENODE_BODY_FRACTAL_DERIVATIVE_DIM2(GetSimplexFractal)
 };
 
 //////////////////////////////////////////////////////////////////////////////////////
@@ -119,18 +119,18 @@ class VOXELGRAPH_API UVoxelNode_3DPerlinNoiseFractal : public UVoxelNode_NoiseNo
 
 // 3D Simplex Noise
 UCLASS(DisplayName = "3D Simplex Noise", Category = "Noise|Simplex Noise")
-class VOXELGRAPH_API UVoxelNode_3DSimplexNoise : public UVoxelNode_NoiseNode
+class VOXELGRAPH_API UVoxelNode_3DSimplexNoise : public UVoxelNode_NoiseNodeWithDerivative
 {
 	GENERATED_BODY()
-	GENERATED_NOISENODE_BODY_DIM3(GetSimplex)
+	GENERATED_NOISENODE_BODY_DERIVATIVE_DIM3(GetSimplex)
 };
 
 // 3D Simplex Noise Fractal
 UCLASS(DisplayName = "3D Simplex Noise Fractal", Category = "Noise|Simplex Noise")
-class VOXELGRAPH_API UVoxelNode_3DSimplexNoiseFractal : public UVoxelNode_NoiseNodeFractal
+class VOXELGRAPH_API UVoxelNode_3DSimplexNoiseFractal : public UVoxelNode_NoiseNodeWithDerivativeFractal
 {
 	GENERATED_BODY()
-	GENERATED_NOISENODE_BODY_FRACTAL_DIM3(GetSimplexFractal)
+	GENERATED_NOISENODE_BODY_FRACTAL_DERIVATIVE_DIM3(GetSimplexFractal)
 };
 
 //////////////////////////////////////////////////////////////////////////////////////
@@ -4,6 +4,7 @@
 #include "VoxelVDBInclude.h"
 
 #include "VoxelMessages.h"
+#include "VoxelQueryZone.h"
 #include "VoxelObjectArchive.h"
 #include "VoxelFeedbackContext.h"
 #include "VoxelGenerators/VoxelGeneratorHelpers.h"
@@ -30,19 +31,271 @@ public:
 	bool IsValid() const { return bool(Grid); }
 	const openvdb::FloatGrid& GetGrid() const { return *Grid; }
 	const openvdb::FloatGrid::Ptr& GetGridPtr() const { return Grid; }
-	const openvdb::tools::FindActiveValues<openvdb::FloatTree>& GetFindActiveValues() const { return *FindActiveValues; }
 
 public:
 	void SetGrid(const openvdb::FloatGrid::Ptr& NewGrid)
 	{
+		// Never reused, so that accessors cached for a previous grid can't be mistaken for accessors of this one
+		static FThreadSafeCounter64 GridIdCounter;
+
 		Grid = NewGrid;
-		if (Grid)
+		GridId = GridIdCounter.Increment();
+		BuildRangeMips();
+	}
+
+	// Accessors cache the last nodes visited, making neighboring queries much cheaper than sampling the tree directly
+	// They are not thread safe: create one per query. They are not registered in the tree, which is fine as we never modify it
+	openvdb::FloatGrid::ConstUnsafeAccessor MakeAccessor() const
+	{
+		check(IsValid());
+		return Grid->getConstUnsafeAccessor();
+	}
+
+	// Same as MakeAccessor, but reuses the accessor of the previous point query on this thread, so that neighboring samples don't walk the tree from the root
+	// Each thread keeps a few accessors per channel, so that sampling several assets alternately doesn't thrash the cache
+	// Accessors are keyed by GridId: an accessor of a grid that was changed or freed is never used again, only overwritten
+	// Only valid until the next call on this thread
+	const openvdb::FloatGrid::ConstUnsafeAccessor& GetCachedAccessor() const
+	{
+		check(IsValid());
+
+		struct FCachedAccessor
+		{
+			int64 GridId = 0;
+			TOptional<openvdb::FloatGrid::ConstUnsafeAccessor> Accessor;
+		};
+		struct FChannelCache
 		{
-			FindActiveValues = MakeUnique<openvdb::tools::FindActiveValues<openvdb::FloatTree>>(Grid->tree());
+			static constexpr int32 NumAccessors = 4;
+			
+			FCachedAccessor Accessors[NumAccessors];
+			int32 NextAccessorToReplace = 0;
+		};
+		thread_local FChannelCache Caches[int32(EVoxelVDBChannel::Max)];
+
+		FChannelCache& Cache = Caches[int32(Channel)];
+		for (FCachedAccessor& CachedAccessor : Cache.Accessors)
+		{
+			if (CachedAccessor.GridId == GridId)
+			{
+				return CachedAccessor.Accessor.GetValue();
+			}
 		}
-		else
+
+		FCachedAccessor& CachedAccessor = Cache.Accessors[Cache.NextAccessorToReplace];
+		Cache.NextAccessorToReplace = (Cache.NextAccessorToReplace + 1) % FChannelCache::NumAccessors;
+		
+		CachedAccessor.GridId = GridId;
+		CachedAccessor.Accessor.Emplace(Grid->getConstUnsafeAccessor());
+		return CachedAccessor.Accessor.GetValue();
+	}
+
+	// Bounds in voxel space, ie Y and Z are swapped compared to VDB space
+	TVoxelRange<float> GetValueRange(const FVoxelIntBox& InBounds) const
+	{
+		check(IsValid());
+		
+		// Inclusive bounds: non integer positions are interpolated with the next voxel
+		const FVoxelIntBox Bounds = FVoxelIntBox(InBounds.Min, InBounds.Max + FIntVector(1));
+		
+		const float Background = Grid->background();
+		if (!RangeMipsBounds.IsValid() || !RangeMipsBounds.GetBox().Intersect(Bounds))
 		{
-			FindActiveValues = nullptr;
+			return Background;
+		}
+
+		const FVoxelIntBox QueryBounds = Bounds.Overlap(RangeMipsBounds.GetBox());
+
+		float RangeMin = MAX_flt;
+		float RangeMax = -MAX_flt;
+		uint64 NumCovered = 0;
+
+		const auto Visit = [&](auto& Lambda, int32 Level, const FIntVector& Key) -> void
+		{
+			const FRangeNode* Node = RangeMips[Level].Find(Key);
+			if (!Node)
+			{
+				return;
+			}
+
+			const int32 BlockSize = RangeMipsLeafSize << Level;
+			const FVoxelIntBox BlockBounds(Key * BlockSize, Key * BlockSize + FIntVector(BlockSize));
+			if (!BlockBounds.Intersect(QueryBounds))
+			{
+				return;
+			}
+
+			if (Level == 0 || Node->bIsTile)
+			{
+				// Fully covered & exact range
+				RangeMin = FMath::Min(RangeMin, Node->Min);
+				RangeMax = FMath::Max(RangeMax, Node->Max);
+				NumCovered += BlockBounds.Overlap(QueryBounds).Count();
+			}
+			else if (QueryBounds.Contains(BlockBounds))
+			{
+				RangeMin = FMath::Min(RangeMin, Node->Min);
+				RangeMax = FMath::Max(RangeMax, Node->Max);
+				NumCovered += Node->NumCovered;
+			}
+			else
+			{
+				for (int32 Child = 0; Child < 8; Child++)
+				{
+					const FIntVector ChildKey = Key * 2 + FIntVector(bool(Child & 1), bool(Child & 2), bool(Child & 4));
+					Lambda(Lambda, Level - 1, ChildKey);
+				}
+			}
+		};
+
+		const int32 TopLevel = RangeMips.Num() - 1;
+		const int32 TopBlockSize = RangeMipsLeafSize << TopLevel;
+		const FIntVector TopMin = FVoxelUtilities::DivideFloor(QueryBounds.Min, TopBlockSize);
+		const FIntVector TopMax = FVoxelUtilities::DivideCeil(QueryBounds.Max, TopBlockSize);
+		for (int32 X = TopMin.X; X < TopMax.X; X++)
+		{
+			for (int32 Y = TopMin.Y; Y < TopMax.Y; Y++)
+			{
+				for (int32 Z = TopMin.Z; Z < TopMax.Z; Z++)
+				{
+					Visit(Visit, TopLevel, FIntVector(X, Y, Z));
+				}
+			}
+		}
+
+		if (NumCovered < Bounds.Count())
+		{
+			// Some parts are not covered by any leaf or tile
+			RangeMin = FMath::Min(RangeMin, Background);
+			RangeMax = FMath::Max(RangeMax, Background);
+		}
+
+		return { RangeMin, RangeMax };
+	}
+
+private:
+	// Leaf nodes are 8x8x8
+	static constexpr int32 RangeMipsLeafSize = 8;
+	
+	struct FRangeNode
+	{
+		float Min = MAX_flt;
+		float Max = -MAX_flt;
+		// Number of voxels in this node that are in a leaf or a tile. Others have the background value
+		uint64 NumCovered = 0;
+		// If true this node is a single VDB tile, and its range is exact for any part of it
+		bool bIsTile = false;
+	};
+	// RangeMips[Level] maps blocks of size RangeMipsLeafSize << Level to their range
+	TArray<TMap<FIntVector, FRangeNode>> RangeMips;
+	FVoxelIntBoxWithValidity RangeMipsBounds;
+
+	void BuildRangeMips()
+	{
+		VOXEL_FUNCTION_COUNTER();
+		
+		RangeMips.Reset();
+		RangeMipsBounds = {};
+
+		if (!Grid)
+		{
+			return;
+		}
+
+		const auto ToVoxelSpace = [](const openvdb::Coord& Coord)
+		{
+			return FIntVector(Coord.x(), Coord.z(), Coord.y());
+		};
+		
+		const auto AddNode = [&](int32 Level, const FIntVector& Min, float NodeMin, float NodeMax, bool bIsTile)
+		{
+			if (RangeMips.Num() <= Level)
+			{
+				RangeMips.SetNum(Level + 1);
+			}
+			
+			const int32 BlockSize = RangeMipsLeafSize << Level;
+			ensure(FVoxelUtilities::DivideFloor(Min, BlockSize) * BlockSize == Min);
+			
+			FRangeNode& Node = RangeMips[Level].FindOrAdd(FVoxelUtilities::DivideFloor(Min, BlockSize));
+			Node.Min = NodeMin;
+			Node.Max = NodeMax;
+			Node.NumCovered = uint64(BlockSize) * uint64(BlockSize) * uint64(BlockSize);
+			Node.bIsTile = bIsTile;
+			
+			RangeMipsBounds += FVoxelIntBox(Min, Min + FIntVector(BlockSize));
+		};
+
+		const openvdb::FloatTree& Tree = Grid->constTree();
+		
+		{
+			VOXEL_SCOPE_COUNTER("Leaves");
+			for (auto LeafIterator = Tree.cbeginLeaf(); LeafIterator; ++LeafIterator)
+			{
+				float LeafMin = MAX_flt;
+				float LeafMax = -MAX_flt;
+				for (auto ValueIterator = LeafIterator->cbeginValueAll(); ValueIterator; ++ValueIterator)
+				{
+					LeafMin = FMath::Min(LeafMin, *ValueIterator);
+					LeafMax = FMath::Max(LeafMax, *ValueIterator);
+				}
+				AddNode(0, ToVoxelSpace(LeafIterator->origin()), LeafMin, LeafMax, false);
+			}
+		}
+		{
+			VOXEL_SCOPE_COUNTER("Tiles");
+
+			const float Background = Grid->background();
+
+			openvdb::FloatTree::ValueAllCIter Iterator = Tree.cbeginValueAll();
+			// Skip the leaf voxels, we only want the tiles
+			Iterator.setMaxDepth(openvdb::FloatTree::ValueAllCIter::LEAF_DEPTH - 1);
+			for (; Iterator; ++Iterator)
+			{
+				// Most tiles of a sparse grid are empty children of internal nodes, with the background value:
+				// don't store them, GetValueRange already uses the background for voxels not covered by any node
+				// Inactive tiles with other values (eg the inside of a level set) are still sampled, so we need to keep these
+				if (*Iterator == Background)
+				{
+					continue;
+				}
+
+				openvdb::CoordBBox BoundingBox;
+				Iterator.getBoundingBox(BoundingBox);
+				
+				const int32 TileSize = BoundingBox.dim().x();
+				if (!ensure(TileSize >= RangeMipsLeafSize && FMath::IsPowerOfTwo(TileSize)))
+				{
+					continue;
+				}
+
+				const int32 Level = FMath::FloorLog2(TileSize / RangeMipsLeafSize);
+				AddNode(Level, ToVoxelSpace(BoundingBox.min()), *Iterator, *Iterator, true);
+			}
+		}
+
+		if (!RangeMipsBounds.IsValid())
+		{
+			return;
+		}
+
+		// Add levels until a single block covers the size of the bounds
+		while ((RangeMipsLeafSize << (RangeMips.Num() - 1)) < RangeMipsBounds.GetBox().Size().GetMax())
+		{
+			RangeMips.Emplace();
+		}
+		
+		// Propagate to parents
+		for (int32 Level = 0; Level < RangeMips.Num() - 1; Level++)
+		{
+			for (auto& It : RangeMips[Level])
+			{
+				FRangeNode& Parent = RangeMips[Level + 1].FindOrAdd(FVoxelUtilities::DivideFloor(It.Key, 2));
+				ensure(!Parent.bIsTile);
+				Parent.Min = FMath::Min(Parent.Min, It.Value.Min);
+				Parent.Max = FMath::Max(Parent.Max, It.Value.Max);
+				Parent.NumCovered += It.Value.NumCovered;
+			}
 		}
 	}
 
@@ -101,7 +354,7 @@ public:
 
 private:
 	openvdb::FloatGrid::Ptr Grid;
-	TUniquePtr<openvdb::tools::FindActiveValues<openvdb::FloatTree>> FindActiveValues;
+	int64 GridId = 0;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -355,17 +608,15 @@ float FVoxelVDBAssetData::GetValue(double X, double Y, double Z) const
 		return 1.f;
 	}
 	
-	const auto& Tree = DensityChannel->GetGrid().constTree();
-	
 	const openvdb::Vec3R Position(X, Z, Y);
 	
 	// Compute the value of the grid at ijk via nearest-neighbor (zero-order)
 	// interpolation.
-	//float v0 = openvdb::tools::PointSampler::sample(Tree, Position);
+	//float v0 = openvdb::tools::PointSampler::sample(Accessor, Position);
 	// Compute the value via triquadratic (second-order) interpolation.
-	//float v2 = openvdb::tools::QuadraticSampler::sample(Tree, Position);
+	//float v2 = openvdb::tools::QuadraticSampler::sample(Accessor, Position);
 
-	return openvdb::tools::BoxSampler::sample(Tree, Position);
+	return openvdb::tools::BoxSampler::sample(DensityChannel->GetCachedAccessor(), Position);
 }
 
 FVoxelMaterial FVoxelVDBAssetData::GetMaterial(double X, double Y, double Z) const
@@ -379,8 +630,7 @@ FVoxelMaterial FVoxelVDBAssetData::GetMaterial(double X, double Y, double Z) con
 		const auto& Channel = Channels[int32(EVoxelVDBChannel::Name)]; \
 		if (Channel->IsValid()) \
 		{ \
-			const auto& Tree = Channel->GetGrid().constTree(); \
-			const float Value = openvdb::tools::BoxSampler::sample(Tree, Position); \
+			const float Value = openvdb::tools::BoxSampler::sample(Channel->GetCachedAccessor(), Position); \
 			Material.Set##Name##_AsFloat((Value - Channel->Min) / (Channel->Max - Channel->Min)); \
 		} \
 	}
@@ -403,34 +653,102 @@ FVoxelMaterial FVoxelVDBAssetData::GetMaterial(double X, double Y, double Z) con
 	return Material;
 }
 
-TVoxelRange<float> FVoxelVDBAssetData::GetValueRange(const FVoxelIntBox& Bounds) const
+void FVoxelVDBAssetData::GetValues(TVoxelQueryZone<FVoxelValue>& QueryZone) const
 {
+	VOXEL_ASYNC_FUNCTION_COUNTER();
+	
 	const auto& DensityChannel = Channels[int32(EVoxelVDBChannel::Density)];
 	if (!DensityChannel->IsValid())
 	{
-		return 1.f;
+		for (VOXEL_QUERY_ZONE_ITERATE(QueryZone, X))
+		{
+			for (VOXEL_QUERY_ZONE_ITERATE(QueryZone, Y))
+			{
+				for (VOXEL_QUERY_ZONE_ITERATE(QueryZone, Z))
+				{
+					QueryZone.Set(X, Y, Z, FVoxelValue::Empty());
+				}
+			}
+		}
+		return;
 	}
 	
-	const openvdb::CoordBBox Box(
-		{
-			Bounds.Min.X,
-			Bounds.Min.Z,
-			Bounds.Min.Y
-		},
+	const openvdb::FloatGrid::ConstUnsafeAccessor Accessor = DensityChannel->MakeAccessor();
+
+	// Positions are integers, so there's no need to interpolate
+	constexpr int32 LeafSize = openvdb::FloatTree::LeafNodeType::DIM;
+	if (QueryZone.Step >= LeafSize)
+	{
+		// At most one sample per leaf, just use the accessor
+		for (VOXEL_QUERY_ZONE_ITERATE(QueryZone, X))
 		{
-			Bounds.Max.X,
-			Bounds.Max.Z,
-			Bounds.Max.Y
-		});
+			for (VOXEL_QUERY_ZONE_ITERATE(QueryZone, Y))
+			{
+				for (VOXEL_QUERY_ZONE_ITERATE(QueryZone, Z))
+				{
+					QueryZone.Set(X, Y, Z, FVoxelValue(Accessor.getValue(openvdb::Coord(X, Z, Y))));
+				}
+			}
+		}
+		return;
+	}
 
-	if (DensityChannel->GetFindActiveValues().any(Box))
+	// Process the zone leaf by leaf: either the leaf exists and we read from its buffer directly,
+	// or the whole block is a single tile/background value
+	const FVoxelIntBox LeafBounds = QueryZone.Bounds.MakeMultipleOfBigger(LeafSize);
+	for (int32 LeafX = LeafBounds.Min.X; LeafX < LeafBounds.Max.X; LeafX += LeafSize)
 	{
-		return { -1, 1 };
+		for (int32 LeafY = LeafBounds.Min.Y; LeafY < LeafBounds.Max.Y; LeafY += LeafSize)
+		{
+			for (int32 LeafZ = LeafBounds.Min.Z; LeafZ < LeafBounds.Max.Z; LeafZ += LeafSize)
+			{
+				// Bounds are a multiple of Step, and Step divides LeafSize
+				const FVoxelIntBox Block = QueryZone.Bounds.Overlap(FVoxelIntBox(FIntVector(LeafX, LeafY, LeafZ), FIntVector(LeafX, LeafY, LeafZ) + FIntVector(LeafSize)));
+				const FIntVector Start = FVoxelUtilities::DivideCeil(Block.Min, QueryZone.Step) * QueryZone.Step;
+				
+				const openvdb::Coord LeafOrigin(LeafX, LeafZ, LeafY);
+				const auto* Leaf = Accessor.probeConstLeaf(LeafOrigin);
+				if (!Leaf)
+				{
+					const FVoxelValue Value = FVoxelValue(Accessor.getValue(LeafOrigin));
+					for (int32 X = Start.X; X < Block.Max.X; X += QueryZone.Step)
+					{
+						for (int32 Y = Start.Y; Y < Block.Max.Y; Y += QueryZone.Step)
+						{
+							for (int32 Z = Start.Z; Z < Block.Max.Z; Z += QueryZone.Step)
+							{
+								QueryZone.Set(X, Y, Z, Value);
+							}
+						}
+					}
+				}
+				else
+				{
+					for (int32 X = Start.X; X < Block.Max.X; X += QueryZone.Step)
+					{
+						for (int32 Y = Start.Y; Y < Block.Max.Y; Y += QueryZone.Step)
+						{
+							for (int32 Z = Start.Z; Z < Block.Max.Z; Z += QueryZone.Step)
+							{
+								QueryZone.Set(X, Y, Z, FVoxelValue(Leaf->getValue(openvdb::Coord(X, Z, Y))));
+							}
+						}
+					}
+				}
+			}
+		}
 	}
-	else
+}
+
+TVoxelRange<float> FVoxelVDBAssetData::GetValueRange(const FVoxelIntBox& Bounds) const
+{
+	const auto& DensityChannel = Channels[int32(EVoxelVDBChannel::Density)];
+	if (!DensityChannel->IsValid())
 	{
 		return 1.f;
 	}
+
+	return DensityChannel->GetValueRange(Bounds);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -466,6 +784,10 @@ public:
 	{
 		return TVoxelRange<v_flt>(Data->GetValueRange(Bounds));
 	}
+	virtual void GetValues(TVoxelQueryZone<FVoxelValue>& QueryZone, int32 LOD, const FVoxelItemStack& Items) const override
+	{
+		Data->GetValues(QueryZone);
+	}
 	FVector GetUpVector(v_flt X, v_flt Y, v_flt Z) const override final
 	{
 		return FVector::UpVector;
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "VoxelRange.h"
+#include "VoxelValue.h"
 #include "VoxelContainers/VoxelStaticArray.h"
 #include "VoxelGenerators/VoxelGenerator.h"
 #include "VoxelVDBAsset.generated.h"
@@ -11,6 +12,8 @@
 class UVoxelVDBAsset;
 class FVoxelVDBAssetInstance;
 struct FVoxelMaterial;
+template<typename T>
+class TVoxelQueryZone;
 struct FVoxelVDBAssetDataChannel;
 
 UENUM()
@@ -107,6 +110,9 @@ public:
 	float GetValue(double X, double Y, double Z) const;
 	FVoxelMaterial GetMaterial(double X, double Y, double Z) const;
 
+	// Same as GetValue on the integer positions of the zone, but iterates the VDB leaves directly
+	void GetValues(TVoxelQueryZone<FVoxelValue>& QueryZone) const;
+	// Uses precomputed value ranges, so this is cheap even for large bounds
 	TVoxelRange<float> GetValueRange(const FVoxelIntBox& Bounds) const;
 	
 private: